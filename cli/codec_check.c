@@ -0,0 +1,1658 @@
+/* Checks that optimized codec paths decode the same as simple reference versions, and times them.
+ * Uses libvgmstream's internal decoders, so it must be linked with the static lib (see Makefile).
+ *
+ * Usage: codec_check [ima] [crypto] [lanes] [simd] [matrix] [seek <file> <cache dir>] [-b]
+ *   ima: IMA variants (shared frame expander) vs per-nibble reference loops
+ *   crypto: Blowfish/XXTEA known answers, and multi-block vs single block decryption
+ *   lanes: multichannel PSX/DSP decoders (several channels per SIMD vector) vs the regular ones
+ *   simd: HCA decoding and float to s16 copies vs the same code built without SIMD (codec_check_ref.c)
+ *   matrix: mixing chains folded into a single matrix vs applying each op (within 1 LSB)
+ *   seek: builds a seek table for <file> (saved to <cache dir>), reloads it and compares seeks
+ *     with the table vs decoding from the start (only with a file, ex. Wwise Vorbis)
+ *   -b: also time each decoder with a few MB of data
+ * Returns 0 if all checks pass.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "../src/vgmstream.h"
+#include "../src/coding/coding.h"
+#include "../src/util.h"
+#include "../src/util/simd.h"
+#include "../src/util/cipher_blowfish.h"
+#include "../src/util/cipher_xxtea.h"
+#include "../src/util/reader_get.h"
+#include "../src/util/reader_put.h"
+#include "../src/base/sbuf.h"
+#include "../src/base/mixing.h"
+#include "../src/base/mixer_priv.h"
+#include "../src/base/seek_table.h"
+
+
+/* ************************************************************************* */
+/* helpers                                                                   */
+/* ************************************************************************* */
+
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t rng(void) {
+    /* xorshift32, so results are the same everywhere */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static double get_time(void) {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+/* memory STREAMFILE, without read_span (so decoders use the copy path) */
+typedef struct {
+    STREAMFILE vt;
+    const uint8_t* buf;
+    size_t size;
+} MEM_STREAMFILE;
+
+static size_t mem_read(MEM_STREAMFILE* sf, uint8_t* dst, offv_t offset, size_t length) {
+    if (offset < 0 || offset >= sf->size)
+        return 0;
+    if (length > sf->size - offset)
+        length = sf->size - offset;
+    memcpy(dst, sf->buf + offset, length);
+    return length;
+}
+
+static size_t mem_get_size(MEM_STREAMFILE* sf) {
+    return sf->size;
+}
+
+static offv_t mem_get_offset(MEM_STREAMFILE* sf) {
+    return 0;
+}
+
+static void mem_get_name(MEM_STREAMFILE* sf, char* name, size_t name_size) {
+    snprintf(name, name_size, "mem");
+}
+
+static STREAMFILE* mem_open(MEM_STREAMFILE* sf, const char* const filename, size_t buf_size) {
+    return NULL;
+}
+
+static void mem_close(MEM_STREAMFILE* sf) {
+}
+
+static void mem_init(MEM_STREAMFILE* sf, const uint8_t* buf, size_t size) {
+    memset(sf, 0, sizeof(MEM_STREAMFILE));
+    sf->vt.read = (void*)mem_read;
+    sf->vt.get_size = (void*)mem_get_size;
+    sf->vt.get_offset = (void*)mem_get_offset;
+    sf->vt.get_name = (void*)mem_get_name;
+    sf->vt.open = (void*)mem_open;
+    sf->vt.close = (void*)mem_close;
+    sf->buf = buf;
+    sf->size = size;
+}
+
+
+/* ************************************************************************* */
+/* IMA                                                                       */
+/* ************************************************************************* */
+
+/* Reference expansions, one nibble at a time like the decoders did before sharing the frame expander */
+
+static const int16_t ref_step_table[89+1] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143,
+    157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+    0
+};
+
+static const int8_t ref_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const int ref_mtf_index_table[16] = {
+    8, 6, 4, 2, -1, -1, -1, -1,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const int16_t ref_cd_step_table[89] = {
+    28,    32,    36,    40,    44,    48,    52,    56,    64,    68,    76,    84,    92,    100,   112,   124,
+    136,   148,   164,   180,   200,   220,   240,   264,   292,   320,   352,   388,   428,   472,   520,   572,
+    628,   692,   760,   836,   920,   1012,  1116,  1228,  1348,  1484,  1632,  1796,  1976,  2176,  2392,  2632,
+    2896,  3184,  3504,  3852,  4240,  4664,  5128,  5644,  6208,  6828,  7512,  8264,  9088,  9996,  10996, 12096,
+    13308, 14640, 16104, 17712, 19484, 21432, 23576, 25936, 28528, 31380, 32764, 32764, 32764, 32764, 32764, 32764,
+    32764, 32764, 32764, 32764, 32764, 32764, 32764, 32764, 32764
+};
+
+static const int16_t ref_cd_delta_table[16] = {
+    0x0800, 0x1800, 0x2800, 0x3800, 0x4800, 0x5800, 0x6800, 0x7800,
+   -0x0800,-0x1800,-0x2800,-0x3800,-0x4800,-0x5800,-0x6800,-0x7800
+};
+
+static void ref_update_index(int* index, int value) {
+    *index += value;
+    if (*index < 0) *index = 0;
+    if (*index > 88) *index = 88;
+}
+
+static int ref_std(int code, int32_t* hist, int* index) {
+    int step = ref_step_table[*index];
+    int delta = step >> 3;
+    if (code & 1) delta += step >> 2;
+    if (code & 2) delta += step >> 1;
+    if (code & 4) delta += step;
+    if (code & 8) delta = -delta;
+    *hist = clamp16(*hist + delta);
+    ref_update_index(index, ref_index_table[code]);
+    return *hist;
+}
+
+static int ref_mul(int code, int32_t* hist, int* index) {
+    int step = ref_step_table[*index];
+    int delta = (((code & 7) * 2 + 1) * step) >> 3;
+    if (code & 8) delta = -delta;
+    *hist = clamp16(*hist + delta);
+    ref_update_index(index, ref_index_table[code]);
+    return *hist;
+}
+
+static int ref_camelot(int code, int32_t* hist, int* index) {
+    int step = ref_step_table[*index];
+    int delta = step * (code & 7) * 2 + step;
+    if (code & 8) delta = -delta;
+    *hist = clamp16(((*hist << 3) + delta) >> 3);
+    ref_update_index(index, ref_index_table[code]);
+    return *hist;
+}
+
+static int ref_snds(int code, int32_t* hist, int* index) {
+    ref_update_index(index, ref_index_table[code & 7]);
+    int step = ref_step_table[*index];
+    int delta = (step >> 3) + ((step * (code & 7)) >> 2);
+    if (code & 8) delta = -delta;
+    *hist = clamp16(*hist + delta);
+    return *hist;
+}
+
+static int ref_otns(int code, int32_t* hist, int* index) {
+    int step = ref_step_table[*index];
+    int delta = 0;
+    if (code & 4) delta = step * 4;
+    if (code & 2) delta += step * 2;
+    if (code & 1) delta += step;
+    delta >>= 2;
+    if (code & 8) delta = -delta;
+    *hist = clamp16(*hist + delta);
+    ref_update_index(index, ref_index_table[code]);
+    return *hist;
+}
+
+static int ref_wv6(int code, int32_t* hist, int* index) {
+    int step = ref_step_table[*index];
+    int delta = (((code & 7) * step) >> 3) + (((code & 7) * step) >> 2);
+    if (code & 8) delta = -delta;
+    *hist = clamp16(*hist + delta);
+    ref_update_index(index, ref_index_table[code]);
+    return *hist;
+}
+
+static int ref_hv(int code, int32_t* hist, int* index) {
+    int step = ref_step_table[*index];
+    int delta = ((code & 7) * step) >> 2;
+    if (code & 8) delta = -delta;
+    *hist = clamp16(*hist + delta);
+    ref_update_index(index, ref_index_table[code]);
+    return *hist;
+}
+
+static int ref_ffta2(int code, int32_t* hist, int* index) {
+    int step = ref_step_table[*index] * 0x100;
+    int delta = step >> 3;
+    if (code & 1) delta += step >> 2;
+    if (code & 2) delta += step >> 1;
+    if (code & 4) delta += step;
+    if (code & 8) delta = -delta;
+    int sample = *hist + delta;
+    if (sample > 0x7FFF00) sample = 0x7FFF00;
+    else if (sample < -0x800000) sample = -0x800000;
+    *hist = sample;
+    ref_update_index(index, ref_index_table[code]);
+    return (short)((sample + 128) / 256);
+}
+
+static int ref_blitz(int code, int32_t* hist, int* index) {
+    int step = ref_step_table[*index];
+    if (step == 22385) step = 22358;
+    else if (step == 24623) step = 24633;
+    int delta = code & 7;
+    if (code & 8) delta = -delta;
+    *hist += (step >> 1) + delta * step;
+    ref_update_index(index, ref_index_table[code]);
+    return clamp16(*hist);
+}
+
+static int ref_mtf(int code, int32_t* hist, int* index) {
+    int step = ref_step_table[*index];
+    *hist += step * (2 * code - 15);
+    ref_update_index(index, ref_mtf_index_table[code]);
+    return clamp16(*hist >> 4);
+}
+
+static int ref_cd(int code, int32_t* hist, int* index) {
+    int step = ref_cd_step_table[*index];
+    int delta = (int16_t)((step * ref_cd_delta_table[code]) >> 16);
+    *hist = clamp16(*hist + delta);
+    ref_update_index(index, ref_index_table[code]);
+    return *hist;
+}
+
+typedef int (*ref_expand_t)(int code, int32_t* hist, int* index);
+
+/* Reference nibble position, as the old per-nibble loops: byte-interleaved stereo has one nibble per byte
+ * (at a fixed shift), otherwise nibbles are consecutive (high or low first). */
+typedef struct {
+    const char* name;
+    ref_expand_t expand;
+    int high_first;
+    int byte_nibble;
+    int byte_shift;
+} ref_ima_t;
+
+static void ref_ima_decode(const ref_ima_t* ref, const uint8_t* data, int32_t first_sample, int32_t samples_to_do,
+        int32_t* hist, int* index, sample_t* outbuf, int channelspacing) {
+    for (int i = first_sample; i < first_sample + samples_to_do; i++) {
+        int byte = ref->byte_nibble ? data[i] : data[i / 2];
+        int shift = ref->byte_nibble ? ref->byte_shift : ((i & 1) == ref->high_first ? 0 : 4);
+        *outbuf = (short)ref->expand((byte >> shift) & 0xf, hist, index);
+        outbuf += channelspacing;
+    }
+}
+
+enum { IMA_STD_MONO, IMA_STD_STEREO, IMA_CAMELOT, IMA_SNDS, IMA_OTNS, IMA_WV6, IMA_HV, IMA_SQEX, IMA_BLITZ,
+       IMA_MTF, IMA_UBI, IMA_UBI_SCE, IMA_H4M, IMA_CD, IMA_CRANKCASE, IMA_COUNT };
+
+static const char* ima_names[IMA_COUNT] = {
+    "standard mono", "standard stereo", "camelot", "snds", "otns", "wv6", "hv", "sqex", "blitz",
+    "mtf", "ubi", "ubi sce", "h4m", "cd", "crankcase",
+};
+
+/* reference setup per decoder (for config: stereo flag/channel/high first where the decoder has them) */
+static void get_ref_ima(int type, int stereo, int channel, int high_first, ref_ima_t* ref) {
+    memset(ref, 0, sizeof(ref_ima_t));
+    ref->name = ima_names[type];
+    ref->expand = ref_std;
+
+    switch (type) {
+        case IMA_STD_MONO:
+            ref->high_first = high_first;
+            break;
+        case IMA_STD_STEREO:
+            ref->byte_nibble = 1;
+            ref->byte_shift = high_first ? (!(channel&1) ? 4:0) : (!(channel&1) ? 0:4);
+            break;
+        case IMA_CAMELOT:   ref->expand = ref_camelot; break;
+        case IMA_WV6:       ref->expand = ref_wv6; ref->high_first = 1; break;
+        case IMA_HV:        ref->expand = ref_hv; ref->high_first = 1; break;
+        case IMA_SQEX:      ref->expand = ref_ffta2; ref->high_first = 1; break;
+        case IMA_BLITZ:     ref->expand = ref_blitz; break;
+        case IMA_SNDS:
+            ref->expand = ref_snds;
+            ref->byte_nibble = stereo;
+            ref->byte_shift = (channel&1) ? 4:0;
+            break;
+        case IMA_OTNS:
+            ref->expand = ref_otns;
+            ref->high_first = 1;
+            ref->byte_nibble = stereo;
+            ref->byte_shift = channel==0 ? 4:0;
+            break;
+        case IMA_MTF:
+            ref->expand = ref_mtf;
+            ref->high_first = 1;
+            ref->byte_nibble = stereo;
+            ref->byte_shift = (channel&1) ? 0:4;
+            break;
+        case IMA_UBI:
+        case IMA_UBI_SCE:
+            ref->expand = type == IMA_UBI ? ref_mul : ref_std;
+            ref->high_first = 1;
+            ref->byte_nibble = stereo;
+            ref->byte_shift = channel==0 ? 4:0;
+            break;
+        case IMA_H4M:
+            ref->byte_nibble = stereo;
+            ref->byte_shift = !(channel&1) ? 0:4;
+            break;
+        case IMA_CD:        ref->expand = ref_cd; break;
+        case IMA_CRANKCASE: break;
+        default:
+            break;
+    }
+}
+
+/* calls the real decoder for one run of samples (stream has the state) */
+static void ima_decode(int type, VGMSTREAM* vgmstream, VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing,
+        int32_t first_sample, int32_t samples_to_do, int channel, int stereo, int high_first) {
+    switch (type) {
+        case IMA_STD_MONO:      decode_standard_ima(stream, outbuf, channelspacing, first_sample, samples_to_do, channel, 0, high_first); break;
+        case IMA_STD_STEREO:    decode_standard_ima(stream, outbuf, channelspacing, first_sample, samples_to_do, channel, 1, high_first); break;
+        case IMA_CAMELOT:       decode_camelot_ima(stream, outbuf, channelspacing, first_sample, samples_to_do); break;
+        case IMA_SNDS:          decode_snds_ima(stream, outbuf, channelspacing, first_sample, samples_to_do, channel); break;
+        case IMA_OTNS:          decode_otns_ima(vgmstream, stream, outbuf, channelspacing, first_sample, samples_to_do, channel); break;
+        case IMA_WV6:           decode_wv6_ima(stream, outbuf, channelspacing, first_sample, samples_to_do); break;
+        case IMA_HV:            decode_hv_ima(stream, outbuf, channelspacing, first_sample, samples_to_do); break;
+        case IMA_SQEX:          decode_sqex_ima(stream, outbuf, channelspacing, first_sample, samples_to_do); break;
+        case IMA_BLITZ:         decode_blitz_ima(stream, outbuf, channelspacing, first_sample, samples_to_do); break;
+        case IMA_MTF:           decode_mtf_ima(stream, outbuf, channelspacing, first_sample, samples_to_do, channel, stereo); break;
+        case IMA_UBI:           decode_ubi_ima(stream, outbuf, channelspacing, first_sample + 10, samples_to_do, channel); break; /* past header */
+        case IMA_UBI_SCE:       decode_ubi_sce_ima(stream, outbuf, channelspacing, first_sample, samples_to_do, channel); break;
+        case IMA_H4M:           decode_h4m_ima(stream, outbuf, channelspacing, first_sample, samples_to_do, channel, 2); break; /* no header */
+        case IMA_CD:            decode_cd_ima(stream, outbuf, channelspacing, first_sample, samples_to_do); break;
+        case IMA_CRANKCASE:     decode_crankcase_ima(stream, outbuf, channelspacing, first_sample, samples_to_do); break;
+        default: break;
+    }
+}
+
+/* frame based decoders: headers are parsed by the decoder, frames have fixed sizes */
+static int ima_frame_info(int type, int* p_frame_size, int* p_header_size, int* p_frame_samples) {
+    switch (type) {
+        case IMA_CD:        *p_frame_size = 0x24; *p_header_size = 0x04; *p_frame_samples = (0x24 - 0x04) * 2; return 1;
+        case IMA_CRANKCASE: *p_frame_size = 0x23; *p_header_size = 0x03; *p_frame_samples = (0x23 - 0x03) * 2; return 1;
+        default:            return 0;
+    }
+}
+
+/* reference for frame based decoders: each frame starts with hist+step (cd writes the header sample) */
+static void ref_ima_frames(int type, const ref_ima_t* ref, const uint8_t* data, int32_t samples, sample_t* outbuf) {
+    int frame_size = 0, header_size = 0, frame_samples = 1;
+    ima_frame_info(type, &frame_size, &header_size, &frame_samples);
+
+    for (int s = 0; s < samples; s += frame_samples) {
+        const uint8_t* frame = data + (s / frame_samples) * frame_size;
+        int32_t hist = type == IMA_CD ? get_s16le(frame + 0x00) : get_s16be(frame + 0x00);
+        int index = frame[0x02];
+        int todo = samples - s < frame_samples ? samples - s : frame_samples;
+        if (index > 88) index = 88;
+
+        if (type == IMA_CD) {
+            outbuf[s] = (short)hist;
+            ref_ima_decode(ref, frame + header_size, 1, todo - 1, &hist, &index, outbuf + s + 1, 1);
+        }
+        else {
+            ref_ima_decode(ref, frame + header_size, 0, todo, &hist, &index, outbuf + s, 1);
+        }
+    }
+}
+
+static int check_ima_case(int type, STREAMFILE* sf, const uint8_t* data, size_t data_size, int stereo, int channel, int high_first, int bench) {
+    int channelspacing = stereo ? 2 : 1;
+    int32_t samples = (int32_t)(stereo ? data_size : data_size * 2) - 64;
+    int frame_size = 0, header_size = 0, frame_samples = 1;
+    int is_frames = ima_frame_info(type, &frame_size, &header_size, &frame_samples);
+    ref_ima_t ref;
+    sample_t* out_new = NULL;
+    sample_t* out_ref = NULL;
+    VGMSTREAM* vgmstream = NULL;
+    int ok = 0;
+
+    if (is_frames)
+        samples = (data_size / frame_size) * frame_samples;
+
+    get_ref_ima(type, stereo, channel, high_first, &ref);
+
+    out_new = calloc(samples * channelspacing, sizeof(sample_t));
+    out_ref = calloc(samples * channelspacing, sizeof(sample_t));
+    vgmstream = allocate_vgmstream(stereo ? 2 : 1, 0);
+    if (!out_new || !out_ref || !vgmstream) goto fail;
+
+    VGMSTREAMCHANNEL* stream = &vgmstream->ch[channel];
+    stream->streamfile = sf;
+    stream->offset = stream->channel_start_offset = 0;
+    if (type == IMA_UBI)
+        stream->channel_start_offset = 1; /* past header */
+    stream->adpcm_history1_32 = 0;
+    stream->adpcm_step_index = 0;
+
+    /* decode in random runs, as layouts do (frame decoders get one frame at a time) */
+    double time_start = get_time();
+    int32_t pos = 0;
+    while (pos < samples) {
+        int32_t todo;
+        if (is_frames) {
+            int32_t frame_pos = pos % frame_samples;
+            todo = 1 + rng() % (frame_samples - frame_pos);
+            stream->offset = (pos / frame_samples) * frame_size;
+            ima_decode(type, vgmstream, stream, out_new + pos * channelspacing + channel, channelspacing, frame_pos, todo, channel, stereo, high_first);
+        }
+        else {
+            todo = bench ? 0x10000 : 1 + rng() % 600;
+            if (todo > samples - pos)
+                todo = samples - pos;
+            ima_decode(type, vgmstream, stream, out_new + pos * channelspacing + channel, channelspacing, pos, todo, channel, stereo, high_first);
+        }
+        pos += todo;
+    }
+    double time_new = get_time() - time_start;
+
+    time_start = get_time();
+    if (is_frames) {
+        /* only mono */
+        ref_ima_frames(type, &ref, data, samples, out_ref + channel);
+    }
+    else {
+        int32_t hist = 0;
+        int index = 0;
+        ref_ima_decode(&ref, data, 0, samples, &hist, &index, out_ref + channel, channelspacing);
+    }
+    double time_ref = get_time() - time_start;
+
+    for (int i = 0; i < samples * channelspacing; i++) {
+        if (out_new[i] != out_ref[i]) {
+            printf("ima %s (%s ch%i %s): sample %i differs: %i vs reference %i\n",
+                    ref.name, stereo ? "stereo" : "mono", channel, high_first ? "high" : "low",
+                    i / channelspacing, out_new[i], out_ref[i]);
+            goto fail;
+        }
+    }
+
+    if (bench) {
+        printf("ima %-16s %s: %6.1f MB/s (reference %6.1f MB/s)\n", ref.name, stereo ? "stereo" : "mono  ",
+                time_new > 0 ? data_size / time_new / 1000000.0 : 0.0,
+                time_ref > 0 ? data_size / time_ref / 1000000.0 : 0.0);
+    }
+
+    ok = 1;
+fail:
+    if (vgmstream) {
+        for (int ch = 0; ch < vgmstream->channels; ch++)
+            vgmstream->ch[ch].streamfile = NULL; /* not owned */
+        close_vgmstream(vgmstream);
+    }
+    free(out_new);
+    free(out_ref);
+    return ok;
+}
+
+static int check_ima(int bench) {
+    size_t data_size = bench ? 0x400000 : 0x4000;
+    uint8_t* data = malloc(data_size);
+    MEM_STREAMFILE mem;
+    int errors = 0, cases = 0;
+
+    if (!data) return 0;
+    for (size_t i = 0; i < data_size; i++) {
+        data[i] = rng() & 0xFF;
+    }
+    /* valid frame headers for frame based decoders (step index <= 88) */
+    for (size_t i = 0; i < data_size; i++) {
+        if (i % 0x24 == 0x02 || i % 0x23 == 0x02)
+            data[i] %= 89;
+    }
+    mem_init(&mem, data, data_size);
+
+    for (int type = 0; type < IMA_COUNT; type++) {
+        int has_stereo = type == IMA_STD_STEREO || type == IMA_SNDS || type == IMA_OTNS || type == IMA_MTF ||
+                type == IMA_UBI || type == IMA_UBI_SCE || type == IMA_H4M;
+        int has_mono = type != IMA_STD_STEREO;
+        int has_order = type == IMA_STD_MONO || type == IMA_STD_STEREO;
+
+        for (int stereo = 0; stereo <= 1; stereo++) {
+            if ((stereo && !has_stereo) || (!stereo && !has_mono))
+                continue;
+            for (int channel = 0; channel <= stereo; channel++) {
+                for (int high_first = 0; high_first <= has_order; high_first++) {
+                    if (bench && (channel || high_first))
+                        continue;
+                    cases++;
+                    if (!check_ima_case(type, &mem.vt, data, data_size, stereo, channel, high_first, bench))
+                        errors++;
+                }
+            }
+        }
+    }
+
+    printf("ima: %i/%i cases ok\n", cases - errors, cases);
+    free(data);
+    return errors == 0;
+}
+
+
+/* ************************************************************************* */
+/* crypto                                                                    */
+/* ************************************************************************* */
+
+/* Blowfish known answers (Eric Young's test vectors, 8 byte keys) */
+static const struct {
+    uint8_t key[8];
+    uint8_t plain[8];
+    uint8_t cipher[8];
+} blowfish_vectors[] = {
+    { {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, {0x4E,0xF9,0x97,0x45,0x61,0x98,0xDD,0x78} },
+    { {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF}, {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF}, {0x51,0x86,0x6F,0xD5,0xB8,0x5E,0xCB,0x8A} },
+    { {0x30,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, {0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x01}, {0x7D,0x85,0x6F,0x9A,0x61,0x30,0x63,0xF2} },
+    { {0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11}, {0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11}, {0x24,0x66,0xDD,0x87,0x8B,0x96,0x3C,0x9D} },
+    { {0x01,0x23,0x45,0x67,0x89,0xAB,0xCD,0xEF}, {0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11}, {0x61,0xF9,0xC3,0x80,0x22,0x81,0xB0,0x96} },
+};
+
+/* reference XXTEA encryption (standard btea with n > 0), words are LE like xxtea_decrypt */
+static void ref_xxtea_encrypt(uint8_t* v, uint32_t size, const uint32_t* key) {
+    const uint32_t delta = 0x9e3779b9;
+    unsigned n = size >> 2;
+    uint32_t y, z, sum = 0;
+    unsigned rounds = 6 + 52 / n;
+
+    z = get_u32le(v + (n - 1) * 4);
+    do {
+        sum += delta;
+        unsigned e = (sum >> 2) & 3;
+        unsigned p;
+        for (p = 0; p < n; p++) {
+            y = get_u32le(v + ((p + 1) % n) * 4);
+            uint32_t mx = (((z >> 5) ^ (y << 2)) + ((y >> 3) ^ (z << 4))) ^ ((sum ^ y) + (key[(p & 3) ^ e] ^ z));
+            z = get_u32le(v + p * 4) + mx;
+            put_u32le(v + p * 4, z);
+        }
+    }
+    while (--rounds);
+}
+
+static int check_blowfish(int bench) {
+    size_t data_size = bench ? 0x800000 : 0x10000;
+    uint8_t* data = malloc(data_size);
+    uint8_t* buf_new = malloc(data_size);
+    uint8_t* buf_ref = malloc(data_size);
+    blowfish_ctx* ctx = NULL;
+    int ok = 0;
+
+    if (!data || !buf_new || !buf_ref) goto fail;
+
+    /* known answers, for the single block and the multi-block (repeated + tail) paths */
+    for (int i = 0; i < sizeof(blowfish_vectors) / sizeof(blowfish_vectors[0]); i++) {
+        uint8_t block[8];
+        uint8_t blocks[8 * 7];
+
+        ctx = blowfish_init_ecb((uint8_t*)blowfish_vectors[i].key, 8);
+        if (!ctx) goto fail;
+
+        memcpy(block, blowfish_vectors[i].cipher, 8);
+        blowfish_decrypt_ecb(ctx, block);
+        if (memcmp(block, blowfish_vectors[i].plain, 8) != 0) {
+            printf("blowfish: vector %i fails\n", i);
+            goto fail;
+        }
+
+        for (int j = 0; j < 7; j++) {
+            memcpy(blocks + j * 8, blowfish_vectors[i].cipher, 8);
+        }
+        blowfish_decrypt_ecb_blocks(ctx, blocks, sizeof(blocks));
+        for (int j = 0; j < 7; j++) {
+            if (memcmp(blocks + j * 8, blowfish_vectors[i].plain, 8) != 0) {
+                printf("blowfish: vector %i fails in blocks (block %i)\n", i, j);
+                goto fail;
+            }
+        }
+
+        blowfish_free(ctx);
+        ctx = NULL;
+    }
+
+    /* multi-block vs single block over random data and sizes */
+    {
+        uint8_t key[0x10];
+        for (int i = 0; i < sizeof(key); i++) {
+            key[i] = rng() & 0xFF;
+        }
+        ctx = blowfish_init_ecb(key, sizeof(key));
+        if (!ctx) goto fail;
+    }
+    for (size_t i = 0; i < data_size; i++) {
+        data[i] = rng() & 0xFF;
+    }
+
+    for (int i = 0; i < 100; i++) {
+        size_t size = (i < 10 ? i : rng() % (data_size / 0x08)) * 0x08;
+        memcpy(buf_new, data, size);
+        memcpy(buf_ref, data, size);
+        blowfish_decrypt_ecb_blocks(ctx, buf_new, size);
+        for (size_t pos = 0; pos < size; pos += 0x08) {
+            blowfish_decrypt_ecb(ctx, buf_ref + pos);
+        }
+        if (memcmp(buf_new, buf_ref, size) != 0) {
+            printf("blowfish: blocks differ from single block with size 0x%x\n", (uint32_t)size);
+            goto fail;
+        }
+    }
+
+    if (bench) {
+        memcpy(buf_new, data, data_size);
+        double time_start = get_time();
+        blowfish_decrypt_ecb_blocks(ctx, buf_new, data_size);
+        double time_new = get_time() - time_start;
+
+        time_start = get_time();
+        for (size_t pos = 0; pos < data_size; pos += 0x08) {
+            blowfish_decrypt_ecb(ctx, buf_new + pos);
+        }
+        double time_ref = get_time() - time_start;
+
+        printf("blowfish blocks: %6.1f MB/s (single block %6.1f MB/s)\n",
+                time_new > 0 ? data_size / time_new / 1000000.0 : 0.0,
+                time_ref > 0 ? data_size / time_ref / 1000000.0 : 0.0);
+    }
+
+    printf("blowfish: ok\n");
+    ok = 1;
+fail:
+    blowfish_free(ctx);
+    free(data);
+    free(buf_new);
+    free(buf_ref);
+    return ok;
+}
+
+static int check_xxtea(int bench) {
+    const int max_count = 9;
+    size_t data_size = bench ? 0x800000 : 0x20000;
+    uint8_t* data = malloc(data_size);
+    uint8_t* buf_new = malloc(data_size);
+    uint8_t* buf_ref = malloc(data_size);
+    uint32_t key[4];
+    int ok = 0;
+
+    if (!data || !buf_new || !buf_ref) goto fail;
+
+    for (int i = 0; i < 4; i++) {
+        key[i] = rng();
+    }
+    for (size_t i = 0; i < data_size; i++) {
+        data[i] = rng() & 0xFF;
+    }
+
+    /* known answers: reference encryption must decrypt back to the plaintext */
+    for (int i = 0; i < 50; i++) {
+        uint32_t size = i < 20 ? 0x08 + i * 0x04 : (0x08 + rng() % (data_size / max_count - 0x08)) & ~0x03;
+        memcpy(buf_ref, data, size);
+        ref_xxtea_encrypt(buf_ref, size, key);
+        xxtea_decrypt(buf_ref, size, key);
+        if (memcmp(buf_ref, data, size) != 0) {
+            printf("xxtea: known answer fails with size 0x%x\n", size);
+            goto fail;
+        }
+    }
+
+    /* multi-block vs single block over random sizes and counts */
+    for (int i = 0; i < 100; i++) {
+        int count = rng() % (max_count + 1);
+        uint32_t size = i < 20 ? 0x04 + i * 0x04 : (0x04 + rng() % (data_size / max_count - 0x04)) & ~0x03;
+
+        memcpy(buf_new, data, size * count);
+        memcpy(buf_ref, data, size * count);
+        xxtea_decrypt_blocks(buf_new, size, count, key);
+        for (int j = 0; j < count; j++) {
+            xxtea_decrypt(buf_ref + j * size, size, key);
+        }
+        if (memcmp(buf_new, buf_ref, size * count) != 0) {
+            printf("xxtea: blocks differ from single block with size 0x%x, count %i\n", size, count);
+            goto fail;
+        }
+    }
+
+    if (bench) {
+        const uint32_t block_size = 0x80000; /* usual AWC block */
+        int count = data_size / block_size;
+
+        memcpy(buf_new, data, data_size);
+        double time_start = get_time();
+        xxtea_decrypt_blocks(buf_new, block_size, count, key);
+        double time_new = get_time() - time_start;
+
+        time_start = get_time();
+        for (int j = 0; j < count; j++) {
+            xxtea_decrypt(buf_new + j * block_size, block_size, key);
+        }
+        double time_ref = get_time() - time_start;
+
+        printf("xxtea blocks:    %6.1f MB/s (single block %6.1f MB/s)\n",
+                time_new > 0 ? data_size / time_new / 1000000.0 : 0.0,
+                time_ref > 0 ? data_size / time_ref / 1000000.0 : 0.0);
+    }
+
+    printf("xxtea: ok\n");
+    ok = 1;
+fail:
+    free(data);
+    free(buf_new);
+    free(buf_ref);
+    return ok;
+}
+
+
+/* ************************************************************************* */
+/* lanes                                                                     */
+/* ************************************************************************* */
+
+/* Multichannel decoders (several channels per SIMD vector) vs the regular decoders called per channel */
+
+enum { LANES_PSX, LANES_DSP, LANES_COUNT };
+
+static const char* lanes_names[LANES_COUNT] = { "psx", "ngc_dsp" };
+
+static void lanes_setup(VGMSTREAM* v, STREAMFILE* sf, size_t channel_size) {
+    for (int ch = 0; ch < v->channels; ch++) {
+        VGMSTREAMCHANNEL* stream = &v->ch[ch];
+        stream->streamfile = sf;
+        stream->offset = stream->channel_start_offset = ch * channel_size;
+        stream->adpcm_history1_32 = stream->adpcm_history2_32 = 0;
+        stream->adpcm_history1_16 = stream->adpcm_history2_16 = 0;
+        for (int i = 0; i < 16; i++) {
+            stream->adpcm_coef[i] = (int16_t)((i & 1) ? -(int)(rng() % 0x1000) : 0x800 + rng() % 0x800); /* typical-ish DSP coefs */
+        }
+    }
+}
+
+static void lanes_decode(int type, VGMSTREAM* v, sample_t* outbuf, int32_t first_sample, int32_t samples_to_do, int is_badflags, int config, int is_mc) {
+    if (type == LANES_PSX) {
+        if (is_mc) {
+            decode_psx_mc(v, outbuf, first_sample, samples_to_do, is_badflags, config);
+            return;
+        }
+        for (int ch = 0; ch < v->channels; ch++) {
+            decode_psx(&v->ch[ch], outbuf + ch, v->channels, first_sample, samples_to_do, is_badflags, config);
+        }
+    }
+    else {
+        if (is_mc) {
+            decode_ngc_dsp_mc(v, outbuf, first_sample, samples_to_do);
+            return;
+        }
+        for (int ch = 0; ch < v->channels; ch++) {
+            decode_ngc_dsp(&v->ch[ch], outbuf + ch, v->channels, first_sample, samples_to_do);
+        }
+    }
+}
+
+static int check_lanes_case(int type, STREAMFILE* sf, size_t data_size, int channels, int is_badflags, int config, int bench) {
+    int frame_size = type == LANES_PSX ? 0x10 : 0x08;
+    int frame_samples = type == LANES_PSX ? 28 : 14;
+    size_t channel_size = data_size / channels / frame_size * frame_size;
+    int32_t samples = channel_size / frame_size * frame_samples;
+    sample_t* out_new = NULL;
+    sample_t* out_ref = NULL;
+    VGMSTREAM* v_new = NULL;
+    VGMSTREAM* v_ref = NULL;
+    double time_new = 0, time_ref = 0;
+    int ok = 0;
+
+    out_new = calloc(samples * channels, sizeof(sample_t));
+    out_ref = calloc(samples * channels, sizeof(sample_t));
+    v_new = allocate_vgmstream(channels, 0);
+    v_ref = allocate_vgmstream(channels, 0);
+    if (!out_new || !out_ref || !v_new || !v_ref) goto fail;
+
+    uint32_t seed = rng_state;
+    lanes_setup(v_new, sf, channel_size);
+    rng_state = seed;
+    lanes_setup(v_ref, sf, channel_size);
+
+    /* decode in random runs, as layouts do (same runs for both) */
+    int32_t pos = 0;
+    while (pos < samples) {
+        int32_t todo = bench ? 0x1000 : 1 + rng() % 300;
+        if (todo > samples - pos)
+            todo = samples - pos;
+
+        double time_start = get_time();
+        lanes_decode(type, v_new, out_new + pos * channels, pos, todo, is_badflags, config, 1);
+        time_new += get_time() - time_start;
+
+        time_start = get_time();
+        lanes_decode(type, v_ref, out_ref + pos * channels, pos, todo, is_badflags, config, 0);
+        time_ref += get_time() - time_start;
+
+        pos += todo;
+    }
+
+    for (int i = 0; i < samples * channels; i++) {
+        if (out_new[i] != out_ref[i]) {
+            printf("lanes %s (%ich badflags=%i config=%i): sample %i ch%i differs: %i vs regular %i\n",
+                    lanes_names[type], channels, is_badflags, config, i / channels, i % channels, out_new[i], out_ref[i]);
+            goto fail;
+        }
+    }
+    for (int ch = 0; ch < channels; ch++) {
+        if (v_new->ch[ch].adpcm_history1_32 != v_ref->ch[ch].adpcm_history1_32 ||
+            v_new->ch[ch].adpcm_history2_32 != v_ref->ch[ch].adpcm_history2_32 ||
+            v_new->ch[ch].adpcm_history1_16 != v_ref->ch[ch].adpcm_history1_16 ||
+            v_new->ch[ch].adpcm_history2_16 != v_ref->ch[ch].adpcm_history2_16) {
+            printf("lanes %s (%ich): ch%i final hist differs\n", lanes_names[type], channels, ch);
+            goto fail;
+        }
+    }
+
+    if (bench) {
+        printf("lanes %-8s %ich: %6.1f MB/s (regular %6.1f MB/s)\n", lanes_names[type], channels,
+                time_new > 0 ? channel_size * channels / time_new / 1000000.0 : 0.0,
+                time_ref > 0 ? channel_size * channels / time_ref / 1000000.0 : 0.0);
+    }
+
+    ok = 1;
+fail:
+    if (v_new) {
+        for (int ch = 0; ch < v_new->channels; ch++)
+            v_new->ch[ch].streamfile = NULL; /* not owned */
+        close_vgmstream(v_new);
+    }
+    if (v_ref) {
+        for (int ch = 0; ch < v_ref->channels; ch++)
+            v_ref->ch[ch].streamfile = NULL;
+        close_vgmstream(v_ref);
+    }
+    free(out_new);
+    free(out_ref);
+    return ok;
+}
+
+static int check_lanes(int bench) {
+    static const int channel_list[] = { 1, 2, 3, 4, 5, 6, 7, 8, 12 };
+    size_t data_size = bench ? 0x800000 : 0x30000;
+    uint8_t* data = malloc(data_size);
+    MEM_STREAMFILE mem;
+    int errors = 0, cases = 0;
+
+    if (!data) return 0;
+    for (size_t i = 0; i < data_size; i++) {
+        data[i] = rng() & 0xFF;
+    }
+    /* PS-ADPCM flags: mostly normal, some silent (0x07) and a few unknown */
+    for (size_t i = 0x01; i < data_size; i += 0x10) {
+        uint32_t r = rng() % 100;
+        data[i] = r < 90 ? data[i] % 0x07 : r < 98 ? 0x07 : data[i];
+    }
+    mem_init(&mem, data, data_size);
+
+    for (int type = 0; type < LANES_COUNT; type++) {
+        for (int i = 0; i < sizeof(channel_list) / sizeof(channel_list[0]); i++) {
+            int channels = channel_list[i];
+            int variants = type == LANES_PSX ? 4 : 1;
+
+            if (bench && channels != 2 && channels != 4 && channels != 8)
+                continue;
+            for (int variant = 0; variant < variants; variant++) {
+                int is_badflags = variant & 1;
+                int config = variant >> 1; /* 1: extended coefs */
+                if (bench && variant)
+                    continue;
+
+                cases++;
+                if (!check_lanes_case(type, &mem.vt, data_size, channels, is_badflags, config, bench))
+                    errors++;
+            }
+        }
+    }
+
+#ifndef VGM_SIMD
+    printf("lanes: no SIMD in this build, multichannel decoders use the regular ones\n");
+#endif
+    printf("lanes: %i/%i cases ok\n", cases - errors, cases);
+    free(data);
+    return errors == 0;
+}
+
+
+/* ************************************************************************* */
+/* SIMD vs scalar                                                            */
+/* ************************************************************************* */
+
+/* scalar versions (from codec_check_ref.c) */
+clHCA* ref_clHCA_new(void);
+void ref_clHCA_delete(clHCA* hca);
+int ref_clHCA_DecodeHeader(clHCA* hca, const void* data, unsigned int size);
+int ref_clHCA_DecodeBlock(clHCA* hca, void* data, unsigned int size);
+void ref_clHCA_ReadSamples(clHCA* hca, float* samples);
+void ref_clHCA_ReadSamples16(clHCA* hca, short* samples);
+void ref_sbuf_init(sbuf_t* sbuf, sfmt_t format, void* buf, int samples, int channels);
+void ref_sbuf_copy_segments(sbuf_t* sdst, sbuf_t* ssrc, int samples);
+
+/* max difference allowed between float outputs (relative to full scale), in case the compiler
+ * reorders the scalar version's ops; both currently give the same results */
+#define SIMD_FLOAT_TOLERANCE 1e-6f
+
+#define HCA_HEADER_SIZE 0x60
+#define HCA_BLOCK_SAMPLES 1024
+
+typedef struct {
+    const char* name;
+    int channels;
+    int base_bands;     /* of 128 */
+    int stereo_bands;   /* intensity stereo (channel pairs) */
+    int hfr_bands;      /* high frequency reconstruction, in groups of 8 */
+} hca_case_t;
+
+static const hca_case_t hca_cases[] = {
+    { "1ch",            1, 128,  0,  0 },
+    { "1ch-hfr",        1,  96,  0, 32 },
+    { "2ch",            2, 128,  0,  0 },
+    { "2ch-stereo-hfr", 2,  64, 32, 32 },
+    { "6ch-stereo",     6,  96, 32,  0 },
+};
+
+typedef struct {
+    uint8_t* buf;
+    int size;
+    int bit;
+} bitwriter_t;
+
+static void bw_put(bitwriter_t* bw, uint32_t value, int bits) {
+    for (int i = bits - 1; i >= 0; i--) {
+        int pos = bw->bit / 8;
+        if (pos >= bw->size)
+            return;
+        if ((value >> i) & 1)
+            bw->buf[pos] |= 0x80 >> (bw->bit % 8);
+        else
+            bw->buf[pos] &= ~(0x80 >> (bw->bit % 8));
+        bw->bit++;
+    }
+}
+
+static uint16_t hca_crc16(const uint8_t* data, int size) {
+    uint16_t crc = 0;
+    for (int i = 0; i < size; i++) {
+        crc ^= data[i] << 8;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static int hca_is_secondary(const hca_case_t* hc, int ch) {
+    if (hc->stereo_bands == 0)
+        return 0;
+    /* channel types for 1 track (see clHCA_DecodeHeader) */
+    if (hc->channels == 2)
+        return ch == 1;
+    if (hc->channels == 6)
+        return ch == 1 || ch == 5;
+    return 0;
+}
+
+/* Makes a v2.0 HCA with valid frames: random scalefactors/intensities/spectra (noise-like but
+ * goes through all transform steps) */
+static uint8_t* build_hca(const hca_case_t* hc, int frames, int* p_frame_size) {
+    int frame_size = 0x100 * hc->channels;
+    int hfr_groups = hc->hfr_bands / 8;
+    uint8_t* buf = calloc(1, HCA_HEADER_SIZE + frames * frame_size);
+    if (!buf) return NULL;
+
+    uint8_t* hdr = buf;
+    memcpy(hdr + 0x00, "HCA\0", 4);
+    put_u16be(hdr + 0x04, 0x0200);
+    put_u16be(hdr + 0x06, HCA_HEADER_SIZE);
+    memcpy(hdr + 0x08, "fmt\0", 4);
+    put_u32be(hdr + 0x0c, (hc->channels << 24) | 48000);
+    put_u32be(hdr + 0x10, frames);
+    put_u16be(hdr + 0x14, 0x80);
+    put_u16be(hdr + 0x16, 0x80);
+    memcpy(hdr + 0x18, "comp", 4);
+    put_u16be(hdr + 0x1c, frame_size);
+    put_u8   (hdr + 0x1e, 1);   /* min resolution */
+    put_u8   (hdr + 0x1f, 15);  /* max resolution */
+    put_u8   (hdr + 0x20, 1);   /* tracks */
+    put_u8   (hdr + 0x21, 0);   /* channel config */
+    put_u8   (hdr + 0x22, 128);
+    put_u8   (hdr + 0x23, hc->base_bands);
+    put_u8   (hdr + 0x24, hc->stereo_bands);
+    put_u8   (hdr + 0x25, hfr_groups ? 8 : 0);
+    memcpy(hdr + 0x28, "ciph", 4);
+    put_u16be(hdr + 0x2c, 0);
+    memcpy(hdr + 0x2e, "pad\0", 4);
+    put_u16be(hdr + HCA_HEADER_SIZE - 2, hca_crc16(hdr, HCA_HEADER_SIZE - 2));
+
+    for (int f = 0; f < frames; f++) {
+        uint8_t* frame = buf + HCA_HEADER_SIZE + f * frame_size;
+        bitwriter_t bw = { frame, frame_size - 2, 0 };
+
+        for (int i = 0; i < frame_size - 2; i++) {
+            frame[i] = rng() & 0xFF;
+        }
+
+        bw_put(&bw, 0xFFFF, 16);
+        bw_put(&bw, rng() % 512, 9); /* acceptable noise level */
+        bw_put(&bw, rng() % 128, 7); /* evaluation boundary */
+        for (int ch = 0; ch < hc->channels; ch++) {
+            int secondary = hca_is_secondary(hc, ch);
+            int coded = secondary ? hc->base_bands : hc->base_bands + hc->stereo_bands;
+
+            bw_put(&bw, 6, 3); /* fixed scalefactors */
+            for (int i = 0; i < coded; i++) {
+                bw_put(&bw, (rng() % 8) ? 20 + rng() % 38 : 0, 6);
+            }
+
+            if (secondary) {
+                for (int i = 0; i < 8; i++) {
+                    bw_put(&bw, rng() % 15, 4);
+                }
+            }
+            else {
+                for (int i = 0; i < hfr_groups; i++) {
+                    bw_put(&bw, 20 + rng() % 38, 6);
+                }
+            }
+        }
+        /* rest is random spectra */
+
+        put_u16be(frame + frame_size - 2, hca_crc16(frame, frame_size - 2));
+    }
+
+    *p_frame_size = frame_size;
+    return buf;
+}
+
+static int check_simd_hca_case(const hca_case_t* hc, int bench) {
+    int frames = bench ? 2000 : 100;
+    int frame_size = 0;
+    int channels = hc->channels;
+    uint8_t* hca_data = build_hca(hc, frames, &frame_size);
+    uint8_t* frame = malloc(frame_size);
+    float* out = malloc(HCA_BLOCK_SAMPLES * channels * sizeof(float));
+    float* ref = malloc(HCA_BLOCK_SAMPLES * channels * sizeof(float));
+    int16_t* out16 = malloc(HCA_BLOCK_SAMPLES * channels * sizeof(int16_t));
+    int16_t* ref16 = malloc(HCA_BLOCK_SAMPLES * channels * sizeof(int16_t));
+    clHCA* hca = clHCA_new();
+    clHCA* hca_ref = ref_clHCA_new();
+    double time_simd = 0, time_ref = 0;
+    float max_diff = 0;
+    int ok = 0, decoded = 0;
+
+    if (!hca_data || !frame || !out || !ref || !out16 || !ref16 || !hca || !hca_ref)
+        goto done;
+
+    if (clHCA_DecodeHeader(hca, hca_data, HCA_HEADER_SIZE) < 0 || ref_clHCA_DecodeHeader(hca_ref, hca_data, HCA_HEADER_SIZE) < 0) {
+        printf("simd: hca %s: bad header\n", hc->name);
+        goto done;
+    }
+
+    ok = 1;
+    for (int f = 0; f < frames && ok; f++) {
+        const uint8_t* src = hca_data + HCA_HEADER_SIZE + f * frame_size;
+        double time_start;
+
+        memcpy(frame, src, frame_size);
+        time_start = get_time();
+        int res = clHCA_DecodeBlock(hca, frame, frame_size);
+        clHCA_ReadSamples(hca, out);
+        time_simd += get_time() - time_start;
+
+        memcpy(frame, src, frame_size);
+        time_start = get_time();
+        int res_ref = ref_clHCA_DecodeBlock(hca_ref, frame, frame_size);
+        ref_clHCA_ReadSamples(hca_ref, ref);
+        time_ref += get_time() - time_start;
+
+        if ((res < 0) != (res_ref < 0)) {
+            printf("simd: hca %s: frame %i result %i vs %i\n", hc->name, f, res, res_ref);
+            ok = 0;
+            break;
+        }
+        if (res < 0)
+            continue;
+        decoded++;
+
+        for (int i = 0; i < HCA_BLOCK_SAMPLES * channels; i++) {
+            float diff = out[i] - ref[i];
+            if (diff < 0) diff = -diff;
+            if (diff > max_diff)
+                max_diff = diff;
+            if (diff > SIMD_FLOAT_TOLERANCE) {
+                printf("simd: hca %s: frame %i sample %i ch %i: %.9f vs %.9f\n", hc->name, f, i / channels, i % channels, out[i], ref[i]);
+                ok = 0;
+                break;
+            }
+        }
+
+        clHCA_ReadSamples16(hca, out16);
+        ref_clHCA_ReadSamples16(hca_ref, ref16);
+        for (int i = 0; i < HCA_BLOCK_SAMPLES * channels && ok; i++) {
+            int diff = out16[i] - ref16[i];
+            if (diff < -1 || diff > 1) {
+                printf("simd: hca %s: frame %i s16 sample %i ch %i: %i vs %i\n", hc->name, f, i / channels, i % channels, out16[i], ref16[i]);
+                ok = 0;
+            }
+        }
+    }
+
+    /* random data shouldn't make many frames fail, otherwise the check isn't testing much */
+    if (ok && decoded < frames / 2) {
+        printf("simd: hca %s: only %i/%i frames decoded\n", hc->name, decoded, frames);
+        ok = 0;
+    }
+
+    if (bench && ok) {
+        double bytes = (double)decoded * HCA_BLOCK_SAMPLES * channels * sizeof(float);
+        printf("simd: hca %-15s %7.1f MB/s vs %7.1f MB/s scalar (max diff %g)\n", hc->name,
+                bytes / 1024 / 1024 / time_simd, bytes / 1024 / 1024 / time_ref, max_diff);
+    }
+
+done:
+    clHCA_delete(hca);
+    ref_clHCA_delete(hca_ref);
+    free(hca_data);
+    free(frame);
+    free(out);
+    free(ref);
+    free(out16);
+    free(ref16);
+    return ok;
+}
+
+/* float to s16 (the vectorized conversion used by all float codecs) */
+static int check_simd_sbuf_case(sfmt_t src_fmt, int channels, int bench) {
+    const char* name = src_fmt == SFMT_FLT ? "flt" : "f16";
+    float range = src_fmt == SFMT_FLT ? 1.5f : 50000.0f; /* a bit over s16 to test clamping */
+    int samples = bench ? 0x100000 : 0x2000;
+    int repeats = bench ? 16 : 1;
+    float* src = malloc(samples * channels * sizeof(float));
+    int16_t* dst = malloc((samples + 1) * channels * sizeof(int16_t));
+    int16_t* ref = malloc((samples + 1) * channels * sizeof(int16_t));
+    double time_simd = 0, time_ref = 0;
+    int ok = 0;
+
+    if (!src || !dst || !ref)
+        goto done;
+
+    for (int i = 0; i < samples * channels; i++) {
+        src[i] = ((int32_t)rng() / 2147483648.0f) * range;
+    }
+    /* exact edges */
+    src[0] = src_fmt == SFMT_FLT ? 1.0f : 32767.0f;
+    src[1] = src_fmt == SFMT_FLT ? -1.0f : -32768.0f;
+    src[2] = 0.0f;
+    src[3] = -0.0f;
+
+    ok = 1;
+    /* odd sizes and a prefilled dst (unaligned), then one big copy */
+    for (int len = 1; len <= 40 + samples && ok; len = (len < 40) ? len + 1 : len + samples) {
+        int copy = len > samples ? samples : len;
+        int prefill = len & 1;
+        sbuf_t ssrc, sdst;
+
+        memset(dst, 0, (samples + 1) * channels * sizeof(int16_t));
+        memset(ref, 0, (samples + 1) * channels * sizeof(int16_t));
+
+        for (int r = 0; r < (copy == samples ? repeats : 1); r++) {
+            double time_start = get_time();
+            sbuf_init(&ssrc, src_fmt, src, copy, channels);
+            ssrc.filled = copy;
+            sbuf_init(&sdst, SFMT_S16, dst, copy + 1, channels);
+            sdst.filled = prefill;
+            sbuf_copy_segments(&sdst, &ssrc, copy);
+            time_simd += get_time() - time_start;
+
+            time_start = get_time();
+            ref_sbuf_init(&ssrc, src_fmt, src, copy, channels);
+            ssrc.filled = copy;
+            ref_sbuf_init(&sdst, SFMT_S16, ref, copy + 1, channels);
+            sdst.filled = prefill;
+            ref_sbuf_copy_segments(&sdst, &ssrc, copy);
+            time_ref += get_time() - time_start;
+        }
+
+        if (memcmp(dst, ref, (copy + 1) * channels * sizeof(int16_t)) != 0) {
+            for (int i = 0; i < (copy + 1) * channels; i++) {
+                if (dst[i] != ref[i]) {
+                    printf("simd: sbuf %s %ich: copy of %i, sample %i: %i vs %i\n", name, channels, copy, i, dst[i], ref[i]);
+                    break;
+                }
+            }
+            ok = 0;
+        }
+    }
+
+    if (bench && ok) {
+        double bytes = (double)samples * channels * sizeof(float) * repeats;
+        printf("simd: sbuf %s>s16 %ich    %7.1f MB/s vs %7.1f MB/s scalar\n", name, channels,
+                bytes / 1024 / 1024 / time_simd, bytes / 1024 / 1024 / time_ref);
+    }
+
+done:
+    free(src);
+    free(dst);
+    free(ref);
+    return ok;
+}
+
+static int check_simd(int bench) {
+    int errors = 0, cases = 0;
+
+    for (int i = 0; i < sizeof(hca_cases) / sizeof(hca_cases[0]); i++) {
+        cases++;
+        if (!check_simd_hca_case(&hca_cases[i], bench))
+            errors++;
+    }
+
+    for (int channels = 1; channels <= 2; channels++) {
+        cases += 2;
+        if (!check_simd_sbuf_case(SFMT_FLT, channels, bench))
+            errors++;
+        if (!check_simd_sbuf_case(SFMT_F16, channels, bench))
+            errors++;
+    }
+
+#ifndef VGM_SIMD
+    printf("simd: no SIMD in this build, both versions are the same code\n");
+#endif
+    printf("simd: %i/%i cases ok\n", cases - errors, cases);
+    return errors == 0;
+}
+
+
+/* ************************************************************************* */
+/* mixing matrix                                                             */
+/* ************************************************************************* */
+
+/* Consecutive linear mixing ops are folded into one matrix on first process (mixer_ops_matrix.c).
+ * Each case builds the same chain in two mixers, and one of them is marked as already grouped
+ * without stages, so mixer_process applies its ops one by one like before folding. */
+
+#define MATRIX_SAMPLES 0x1000
+
+typedef struct {
+    const char* name;
+    int channels;
+    sfmt_t fmt;
+    int folds;      /* expected folded stages (runs of ops that are cheap enough aren't folded) */
+} matrix_case_t;
+
+static const matrix_case_t matrix_cases[] = {
+    { "downmix 5.1>2",      6, SFMT_S16, 1 },
+    { "downmix 7.1>2",      8, SFMT_S16, 1 },
+    { "volumes",            4, SFMT_S16, 1 },
+    { "crossfeed",          2, SFMT_S16, 1 },
+    { "upmix/downmix",      2, SFMT_S16, 1 },
+    { "limit split",        2, SFMT_S16, 2 },
+    { "downmix 5.1>2 flt",  6, SFMT_FLT, 1 },
+    { "crossfeed flt",      2, SFMT_FLT, 1 },
+    { "swap/add/vol",       3, SFMT_S16, 0 },
+    { "single op",          2, SFMT_S16, 0 },
+};
+
+static void matrix_push_ops(VGMSTREAM* v, int index) {
+    switch(index) {
+        case 0:
+        case 1:
+        case 6:
+            mixing_macro_downmix(v, 2);
+            break;
+        case 2:
+            mixing_macro_volume(v, 0.5, 0x05);
+            mixing_macro_volume(v, 1.25, 0x0a);
+            mixing_macro_volume(v, 0.8, 0);
+            break;
+        case 3:
+        case 7:
+            /* mid/side-like tweaks done as separate ops (as TXTP commands would) */
+            mixing_push_upmix(v, 2);
+            mixing_push_add(v, 2, 0, 0.5);
+            mixing_push_add(v, 2, 1, 0.5);
+            mixing_push_volume(v, -1, 0.9);
+            mixing_push_add(v, 0, 1, -0.3);
+            mixing_push_add(v, 1, 0, 0.3);
+            mixing_push_add(v, 0, 2, 0.2);
+            mixing_push_add(v, 1, 2, 0.2);
+            mixing_push_swap(v, 0, 1);
+            mixing_push_killmix(v, 2);
+            break;
+        case 4:
+            mixing_push_upmix(v, 1);
+            mixing_push_upmix(v, 3);
+            mixing_push_add(v, 1, 0, 0.5);
+            mixing_push_add(v, 3, 2, 0.5);
+            mixing_push_downmix(v, 0);
+            mixing_push_killmix(v, 2);
+            break;
+        case 5:
+            mixing_push_upmix(v, 2);
+            mixing_push_add(v, 2, 0, 1.0);
+            mixing_push_add(v, 2, 1, 1.0);
+            mixing_push_killmix(v, 2);
+            mixing_push_limit(v, -1, 0.9);
+            mixing_push_volume(v, -1, 0.75);
+            mixing_push_volume(v, 0, 0.5);
+            break;
+        case 8:
+            mixing_push_swap(v, 0, 2);
+            mixing_push_add(v, 1, 0, 0.7);
+            mixing_push_add(v, 2, 1, -0.3);
+            mixing_push_volume(v, 0, 0.6);
+            mixing_push_volume(v, -1, 1.1);
+            break;
+        case 9:
+            mixing_push_volume(v, 1, 0.5);
+            break;
+        default:
+            break;
+    }
+}
+
+static VGMSTREAM* matrix_open(const matrix_case_t* mc, int index) {
+    VGMSTREAM* v = calloc(1, sizeof(VGMSTREAM));
+    if (!v) return NULL;
+
+    v->channels = mc->channels;
+    v->start_vgmstream = v;
+    v->mixer = mixer_init(mc->channels);
+    if (!v->mixer) goto fail;
+
+    matrix_push_ops(v, index);
+    if (!mixing_setup(v, MATRIX_SAMPLES))
+        goto fail;
+    return v;
+fail:
+    if (v) mixer_free(v->mixer);
+    free(v);
+    return NULL;
+}
+
+static void matrix_close(VGMSTREAM* v) {
+    if (!v) return;
+    mixer_free(v->mixer);
+    free(v);
+}
+
+/* mixes src into buf (sized for the max mixing channels); returns output channels */
+static int matrix_process(VGMSTREAM* v, const matrix_case_t* mc, const void* src, void* buf, double* p_time) {
+    sbuf_t sbuf;
+
+    memcpy(buf, src, MATRIX_SAMPLES * mc->channels * sfmt_get_sample_size(mc->fmt));
+
+    double time_start = get_time();
+    sbuf_init(&sbuf, mc->fmt, buf, MATRIX_SAMPLES, mc->channels);
+    sbuf.filled = MATRIX_SAMPLES;
+    mix_vgmstream(&sbuf, v);
+    *p_time += get_time() - time_start;
+
+    return sbuf.channels;
+}
+
+static int check_matrix_case(const matrix_case_t* mc, int index, int bench) {
+    VGMSTREAM* v_mtx = matrix_open(mc, index);
+    VGMSTREAM* v_ops = matrix_open(mc, index);
+    int repeats = bench ? 256 : 1;
+    int sample_size = sfmt_get_sample_size(mc->fmt);
+    uint8_t* src = malloc(MATRIX_SAMPLES * mc->channels * sample_size);
+    uint8_t* buf_mtx = NULL;
+    uint8_t* buf_ops = NULL;
+    double time_mtx = 0, time_ops = 0;
+    float max_diff = 0;
+    int folded = 0;
+    int ok = 0;
+
+    if (!v_mtx || !v_ops || !src)
+        goto done;
+
+    mixer_t* mixer_mtx = v_mtx->mixer;
+    mixer_t* mixer_ops = v_ops->mixer;
+
+    /* op by op: stages are only set up once, so marking them as done leaves none */
+    mixer_ops->stages_done = true;
+
+    int mixing_channels = mixer_mtx->mixing_channels;
+    buf_mtx = malloc(MATRIX_SAMPLES * mixing_channels * sample_size);
+    buf_ops = malloc(MATRIX_SAMPLES * mixing_channels * sample_size);
+    if (!buf_mtx || !buf_ops)
+        goto done;
+
+    for (int i = 0; i < MATRIX_SAMPLES * mc->channels; i++) {
+        if (mc->fmt == SFMT_FLT)
+            ((float*)src)[i] = (int32_t)rng() / 2147483648.0f;
+        else
+            ((int16_t*)src)[i] = (int16_t)rng();
+    }
+
+    int channels_mtx = 0, channels_ops = 0;
+    for (int r = 0; r < repeats; r++) {
+        channels_mtx = matrix_process(v_mtx, mc, src, buf_mtx, &time_mtx);
+        channels_ops = matrix_process(v_ops, mc, src, buf_ops, &time_ops);
+    }
+
+    for (int i = 0; i < mixer_mtx->stages_count; i++) {
+        if (mixer_mtx->stages[i].terms)
+            folded++;
+    }
+    if (folded != mc->folds) {
+        printf("matrix: %s: %i folded stages, expected %i\n", mc->name, folded, mc->folds);
+        goto done;
+    }
+    if (channels_mtx != channels_ops) {
+        printf("matrix: %s: %i vs %i output channels\n", mc->name, channels_mtx, channels_ops);
+        goto done;
+    }
+
+    /* within 1 LSB of s16 (floats are in -1.0..1.0 range) */
+    ok = 1;
+    for (int i = 0; i < MATRIX_SAMPLES * channels_mtx; i++) {
+        float diff;
+        if (mc->fmt == SFMT_FLT)
+            diff = fabsf(((float*)buf_mtx)[i] - ((float*)buf_ops)[i]) * 32768.0f;
+        else
+            diff = abs(((int16_t*)buf_mtx)[i] - ((int16_t*)buf_ops)[i]);
+        if (diff > max_diff)
+            max_diff = diff;
+        if (diff > 1.0f) {
+            printf("matrix: %s: sample %i ch %i differs by %.2f LSB\n", mc->name, i / channels_mtx, i % channels_mtx, diff);
+            ok = 0;
+            break;
+        }
+    }
+
+    if (bench && ok) {
+        double bytes = (double)MATRIX_SAMPLES * mc->channels * sample_size * repeats;
+        printf("matrix: %-18s %i>%ich, %i folded: %7.1f MB/s vs %7.1f MB/s op by op (max diff %.2f)\n",
+                mc->name, mc->channels, channels_mtx, folded,
+                bytes / 1024 / 1024 / time_mtx, bytes / 1024 / 1024 / time_ops, max_diff);
+    }
+
+done:
+    matrix_close(v_mtx);
+    matrix_close(v_ops);
+    free(src);
+    free(buf_mtx);
+    free(buf_ops);
+    return ok;
+}
+
+static int check_matrix(int bench) {
+    int errors = 0, cases = sizeof(matrix_cases) / sizeof(matrix_cases[0]);
+
+    for (int i = 0; i < cases; i++) {
+        if (!check_matrix_case(&matrix_cases[i], i, bench))
+            errors++;
+    }
+
+    printf("matrix: %i/%i cases ok\n", cases - errors, cases);
+    return errors == 0;
+}
+
+
+/* ************************************************************************* */
+/* seek tables                                                               */
+/* ************************************************************************* */
+
+#define SEEK_TARGETS 12
+#define SEEK_RENDER_SAMPLES 4096
+
+/* seeks to each target and renders a few samples after it */
+static double seek_render(VGMSTREAM* v, const int32_t* targets, sample_t* buf) {
+    double time_seek = 0;
+
+    for (int i = 0; i < SEEK_TARGETS; i++) {
+        double time_start = get_time();
+        seek_vgmstream(v, targets[i]);
+        time_seek += get_time() - time_start;
+
+        render_vgmstream2(buf + i * SEEK_RENDER_SAMPLES * v->channels, SEEK_RENDER_SAMPLES, v);
+    }
+
+    return time_seek;
+}
+
+/* Builds a cached seek table for a file, reopens it so the table is loaded from the saved file,
+ * and checks that seeking with the table outputs the same as seeking by decoding from the start. */
+static int check_seek(const char* filename, const char* cache_dir, int bench) {
+    int32_t targets[SEEK_TARGETS];
+    sample_t* buf_ref = NULL;
+    sample_t* buf_tbl = NULL;
+    STREAMFILE* sf = NULL;
+    VGMSTREAM* v = NULL;
+    int ok = 0;
+
+    sf = open_stdio_streamfile(filename);
+    if (!sf) {
+        printf("seek: can't open %s\n", filename);
+        return 0;
+    }
+
+    /* reference: no cache, so seeks decode and discard samples */
+    seek_table_set_cache_dir(NULL);
+    v = init_vgmstream_from_STREAMFILE(sf);
+    if (!v) {
+        printf("seek: %s isn't a supported file\n", filename);
+        goto done;
+    }
+    if (v->num_samples <= SEEK_RENDER_SAMPLES) {
+        printf("seek: %s is too short\n", filename);
+        goto done;
+    }
+
+    /* forward and backward seeks, near the start, at block-ish positions and near the end */
+    int32_t max_target = v->num_samples - SEEK_RENDER_SAMPLES;
+    targets[0] = max_target / 2;
+    targets[1] = 1;
+    targets[2] = max_target;
+    targets[3] = 4096;
+    targets[4] = 4095;
+    targets[5] = max_target / 3;
+    for (int i = 6; i < SEEK_TARGETS; i++) {
+        targets[i] = rng() % max_target;
+    }
+
+    buf_ref = malloc(SEEK_TARGETS * SEEK_RENDER_SAMPLES * v->channels * sizeof(sample_t));
+    buf_tbl = malloc(SEEK_TARGETS * SEEK_RENDER_SAMPLES * v->channels * sizeof(sample_t));
+    if (!buf_ref || !buf_tbl) goto done;
+
+    double time_ref = seek_render(v, targets, buf_ref);
+    close_vgmstream(v);
+
+    /* build and save the table, then reopen so it's loaded from the cache dir */
+    seek_table_set_cache_dir(cache_dir);
+    v = init_vgmstream_from_STREAMFILE(sf);
+    if (!v) goto done;
+
+    if (!seek_table_build(v)) {
+        printf("seek: no table built (codec doesn't record entries, or can't write to %s)\n", cache_dir);
+        goto done;
+    }
+    close_vgmstream(v);
+
+    v = init_vgmstream_from_STREAMFILE(sf);
+    if (!v) goto done;
+    if (!seek_table_is_cached(v)) {
+        printf("seek: saved table wasn't loaded\n");
+        goto done;
+    }
+
+    double time_tbl = seek_render(v, targets, buf_tbl);
+
+    ok = 1;
+    for (int i = 0; i < SEEK_TARGETS; i++) {
+        int samples = SEEK_RENDER_SAMPLES * v->channels;
+        const sample_t* ref = buf_ref + i * samples;
+        const sample_t* tbl = buf_tbl + i * samples;
+
+        for (int j = 0; j < samples; j++) {
+            if (ref[j] != tbl[j]) {
+                printf("seek: mismatch after seeking to %i, sample %i ch %i: %i vs %i\n",
+                        targets[i], j / v->channels, j % v->channels, ref[j], tbl[j]);
+                ok = 0;
+                break;
+            }
+        }
+    }
+
+    printf("seek: %i targets %s\n", SEEK_TARGETS, ok ? "ok" : "FAILED");
+    if (bench) {
+        printf("seek: %.3f ms decoding from start, %.3f ms with table\n", time_ref * 1000.0, time_tbl * 1000.0);
+    }
+
+done:
+    seek_table_set_cache_dir(NULL);
+    close_vgmstream(v);
+    close_streamfile(sf);
+    free(buf_ref);
+    free(buf_tbl);
+    return ok;
+}
+
+
+/* ************************************************************************* */
+
+int main(int argc, char** argv) {
+    int bench = 0, do_ima = 0, do_crypto = 0, do_lanes = 0, do_simd = 0, do_matrix = 0;
+    const char* seek_file = NULL;
+    const char* seek_dir = NULL;
+    int ok = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0)
+            bench = 1;
+        else if (strcmp(argv[i], "ima") == 0)
+            do_ima = 1;
+        else if (strcmp(argv[i], "crypto") == 0)
+            do_crypto = 1;
+        else if (strcmp(argv[i], "lanes") == 0)
+            do_lanes = 1;
+        else if (strcmp(argv[i], "simd") == 0)
+            do_simd = 1;
+        else if (strcmp(argv[i], "matrix") == 0)
+            do_matrix = 1;
+        else if (strcmp(argv[i], "seek") == 0 && i + 2 < argc) {
+            seek_file = argv[++i];
+            seek_dir = argv[++i];
+        }
+        else {
+            printf("usage: %s [ima] [crypto] [lanes] [simd] [matrix] [seek <file> <cache dir>] [-b]\n", argv[0]);
+            return 1;
+        }
+    }
+    /* all by default (seek needs a file) */
+    if (!do_ima && !do_crypto && !do_lanes && !do_simd && !do_matrix && !seek_file)
+        do_ima = do_crypto = do_lanes = do_simd = do_matrix = 1;
+
+    if (do_ima)
+        ok &= check_ima(bench);
+    if (do_crypto) {
+        ok &= check_blowfish(bench);
+        ok &= check_xxtea(bench);
+    }
+    if (do_lanes)
+        ok &= check_lanes(bench);
+    if (do_simd)
+        ok &= check_simd(bench);
+    if (do_matrix)
+        ok &= check_matrix(bench);
+    if (seek_file)
+        ok &= check_seek(seek_file, seek_dir, bench);
+
+    printf("%s\n", ok ? "all ok" : "FAILED");
+    return ok ? 0 : 1;
+}
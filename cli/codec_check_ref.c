@@ -0,0 +1,37 @@
+/* Scalar references for codec_check: libvgmstream sources with SIMD paths, built again without them
+ * (same as a VGM_DISABLE_SIMD build). Public functions get a ref_ prefix so they can be linked along
+ * with the static lib, and codec_check compares both versions. */
+#define VGM_DISABLE_SIMD
+
+#define clHCA_isOurFile         ref_clHCA_isOurFile
+#define clHCA_getInfo           ref_clHCA_getInfo
+#define clHCA_ReadSamples16     ref_clHCA_ReadSamples16
+#define clHCA_ReadSamples       ref_clHCA_ReadSamples
+#define clHCA_sizeof            ref_clHCA_sizeof
+#define clHCA_clear             ref_clHCA_clear
+#define clHCA_done              ref_clHCA_done
+#define clHCA_new               ref_clHCA_new
+#define clHCA_delete            ref_clHCA_delete
+#define clHCA_DecodeHeader      ref_clHCA_DecodeHeader
+#define clHCA_SetKey            ref_clHCA_SetKey
+#define clHCA_TestBlock         ref_clHCA_TestBlock
+#define clHCA_DecodeReset       ref_clHCA_DecodeReset
+#define clHCA_DecodeBlock       ref_clHCA_DecodeBlock
+#include "../src/coding/libs/clhca.c"
+
+#define sbuf_init               ref_sbuf_init
+#define sbuf_init_s16           ref_sbuf_init_s16
+#define sbuf_init_f16           ref_sbuf_init_f16
+#define sbuf_init_flt           ref_sbuf_init_flt
+#define sfmt_get_sample_size    ref_sfmt_get_sample_size
+#define sbuf_get_filled_buf     ref_sbuf_get_filled_buf
+#define sbuf_consume            ref_sbuf_consume
+#define sbuf_get_copy_max       ref_sbuf_get_copy_max
+#define sbuf_silence_part       ref_sbuf_silence_part
+#define sbuf_silence_rest       ref_sbuf_silence_rest
+#define sbuf_copy_segments      ref_sbuf_copy_segments
+#define sbuf_copy_layers        ref_sbuf_copy_layers
+#define sbuf_fadeout            ref_sbuf_fadeout
+#define sbuf_interleave         ref_sbuf_interleave
+#define sbuf_interleave_vorbis  ref_sbuf_interleave_vorbis
+#include "../src/base/sbuf.c"
@@ -60,6 +60,10 @@ static void print_usage(const char* progname, bool is_help) {
             "    -E: force end-to-end looping even if file has real loop points\n"
             "    -s N: select subsong N, if the format supports multiple subsongs\n"
             "    -S N: select end subsong N (set 0 for 'all')\n"
+            "    -j N: convert subsongs with N parallel jobs\n"
+            "    -J N: decode layers of multi-layer files with N threads\n"
+            "    -N N: keep at most N segments open in multi-segment files (min 2)\n"
+            "    -U N: open entries of .txtp with N threads\n"
             "    -p: output to stdout (for piping into another program)\n"
             "    -P: output to stdout even if stdout is a terminal\n"
             "    -c: loop forever (continuously) to stdout\n"
@@ -76,6 +80,8 @@ static void print_usage(const char* progname, bool is_help) {
     fprintf(is_help ? stdout : stderr,
             "Extra options:\n"
             "    -2 N: only output the Nth (first is 0) set of stereo channels\n"
+            "    -C <file>: load and save decryption keys found by searching in <file> (faster next runs)\n"
+            "    -Y <dir>: build seek tables for files that need them and save to <dir> (faster seeking in plugins)\n"
             "    -x: decode and print adxencd command line to encode as ADX\n"
             "    -g: decode and print oggenc command line to encode as OGG\n"
             "    -b: decode and print batch variable commands\n"
@@ -90,6 +96,11 @@ static void print_usage(const char* progname, bool is_help) {
             "    -B <samples> force a sample buffer size (for api testing)\n"
             "    -W <type>: force .wav output format (1=PCM16, 2=PCM24, 3=PCM32, 4=float)\n"
             "    -O: decode but don't write to file (for performance testing)\n"
+            "    -M: read files using memory-mapped IO (for performance testing, files must not change while playing)\n"
+            "    -R N: use N KB of read cache shared by channels, 0 = one buffer per channel (for performance testing)\n"
+            "    -A N: read files ahead in a background thread, in windows of N KB (for performance testing)\n"
+            "    -a N: decode up to N samples ahead in a background thread (for api testing)\n"
+            "    -z: print open, seek and decode times and memory used (for performance testing)\n"
     );
 
 }
@@ -100,6 +111,7 @@ static bool parse_config(cli_config_t* cfg, int argc, char** argv) {
     cfg->fade_time = 10.0;
     cfg->seek_samples1 = -1;
     cfg->seek_samples2 = -1;
+    cfg->read_cache_kb = -1;
 
     opterr = 0; // don't let getopt print errors to stdout automatically
     optind = 1; // reset getopt's ugly globals (needed in wasm that may call same main() multiple times)
@@ -116,7 +128,7 @@ getopt_start:
     // is found). BSD's getopt seem to behave like REQUIRE_ORDER and ignores '+'.
 
     // read config
-    while ((opt = getopt(argc, argv, "+o:l:f:d:ipPcmxeLEFrgb2:s:tTk:K:hOvD:S:B:VIwW:")) != -1) {
+    while ((opt = getopt(argc, argv, "+o:l:f:d:ipPcmxeLEFrgb2:s:tTk:K:hOvD:S:B:VIwW:zj:C:Y:MJ:N:R:A:U:a:")) != -1) {
         switch (opt) {
             case 'o':
                 cfg->outfilename = optarg;
@@ -169,6 +181,36 @@ getopt_start:
                 if (cfg->subsong_index == 0)
                     cfg->subsong_index = 1;
                 break;
+            case 'j':
+                cfg->jobs = atoi(optarg);
+                break;
+            case 'J':
+                cfg->layer_threads = atoi(optarg);
+                break;
+            case 'N':
+                cfg->max_open_segments = atoi(optarg);
+                break;
+            case 'U':
+                cfg->open_threads = atoi(optarg);
+                break;
+            case 'C':
+                cfg->key_cache_filename = optarg;
+                break;
+            case 'Y':
+                cfg->seek_cache_path = optarg;
+                break;
+            case 'M':
+                cfg->use_mmap = true;
+                break;
+            case 'R':
+                cfg->read_cache_kb = atoi(optarg);
+                break;
+            case 'A':
+                cfg->read_ahead_kb = atoi(optarg);
+                break;
+            case 'a':
+                cfg->decode_ahead_samples = atoi(optarg);
+                break;
 
             // wav config
             case 'L':
@@ -202,6 +244,9 @@ getopt_start:
             case 'O':
                 cfg->decode_only = true;
                 break;
+            case 'z':
+                cfg->print_timings = true;
+                break;
             case 'r':
                 cfg->test_reset = true;
                 break;
@@ -339,6 +384,12 @@ static void load_vconfig(libvgmstream_config_t* vcfg, cli_config_t* cfg) {
     vcfg->ignore_fade = cfg->ignore_fade;
 
     vcfg->auto_downmix_channels = cfg->downmix_channels;
+    vcfg->layer_threads = cfg->layer_threads;
+    vcfg->max_open_segments = cfg->max_open_segments;
+    if (cfg->read_ahead_kb > 0) {
+        vcfg->read_ahead_size = cfg->read_ahead_kb * 1024;
+    }
+    vcfg->decode_ahead_samples = cfg->decode_ahead_samples;
     if (cfg->wav_force_output) {
         vcfg->force_sfmt = cfg->wav_force_output;
     }
@@ -361,10 +412,12 @@ static bool write_file(libvgmstream_t* vgmstream, cli_config_t* cfg) {
     else if (cfg->seek_samples1 >= 0)
         play_samples -= cfg->seek_samples1;
 
+    double time_seek = cli_get_time();
     if (cfg->seek_samples1 >= 0)
         libvgmstream_seek(vgmstream, cfg->seek_samples1);
     if (cfg->seek_samples2 >= 0)
         libvgmstream_seek(vgmstream, cfg->seek_samples2);
+    cfg->time_seek = cli_get_time() - time_seek;
 
     if (cfg->sample_buffer_size > 0) {
         buf = malloc(cfg->sample_buffer_size * vgmstream->format->sample_size * vgmstream->format->channels);
@@ -416,6 +469,8 @@ static bool write_file(libvgmstream_t* vgmstream, cli_config_t* cfg) {
     }
 
     /* decode (normally or forever until program kill) */
+    double time_start = cli_get_time();
+    cfg->samples_done = 0;
     while (!vgmstream->decoder->done) {
         if (buf) {
             int err = libvgmstream_fill(vgmstream, buf, cfg->sample_buffer_size);
@@ -435,7 +490,14 @@ static bool write_file(libvgmstream_t* vgmstream, cli_config_t* cfg) {
             wav_swap_samples_le(buf, vgmstream->format->channels * buf_samples, sample_size);
             fwrite(buf, sizeof(uint8_t), buf_bytes, outfile);
         }
+
+        cfg->samples_done += buf_samples;
+
+        // decode-ahead doesn't wait for samples, but here there is nothing else to do
+        if (buf_samples == 0 && !vgmstream->decoder->done)
+            cli_sleep(1);
     }
+    cfg->time_decode = cli_get_time() - time_start;
 
     if (outfile && outfile != stdout)
         fclose(outfile);
@@ -465,7 +527,9 @@ static bool is_valid_extension(cli_config_t* cfg) {
 
 static libvgmstream_t* open_vgmstream(cli_config_t* cfg) {
 
-    libstreamfile_t* sf = libstreamfile_open_from_stdio(cfg->infilename);
+    libstreamfile_t* sf = cfg->use_mmap ?
+        libstreamfile_open_from_mmap(cfg->infilename) :
+        libstreamfile_open_from_stdio(cfg->infilename);
     if (!sf) {
         fprintf(stderr, "file %s not found\n", cfg->infilename);
         return NULL;
@@ -500,9 +564,14 @@ static bool convert_file(cli_config_t* cfg) {
         return false;
 
     /* open streamfile and pass subsong */
+    double time_start = cli_get_time();
     vgmstream = open_vgmstream(cfg);
+    cfg->time_open = cli_get_time() - time_start;
     if (!vgmstream) goto fail;
 
+    cfg->time_open_total += cfg->time_open;
+    cfg->files_opened++;
+
     /* force load total subsongs if signalled */
     if (cfg->subsong_current_end == -1) {
         cfg->subsong_current_end = vgmstream->format->subsong_count;
@@ -510,6 +579,11 @@ static bool convert_file(cli_config_t* cfg) {
         return true;
     }
 
+    /* done before decoding so the table can be used by seek tests below */
+    if (cfg->seek_cache_path) {
+        libvgmstream_build_seek_table(vgmstream);
+    }
+
 
     /* get final play config */
     play_samples = vgmstream->format->play_samples;
@@ -570,7 +644,8 @@ static bool convert_file(cli_config_t* cfg) {
     }
 
 
-    /* prints */
+    /* prints (in subsong order when converting in parallel) */
+    cli_jobs_print_start(cfg);
     if (cfg->print_metajson) {
         print_json_info(vgmstream, cfg, VGMSTREAM_VERSION);
     }
@@ -582,13 +657,17 @@ static bool convert_file(cli_config_t* cfg) {
 
     /* prints done */
     if (cfg->print_metaonly) {
+        print_timings(vgmstream, cfg, false);
+        cli_jobs_print_end(cfg);
         libvgmstream_free(vgmstream);
         return true;
     }
+    cli_jobs_print_end(cfg);
 
 
     /* main decode */
     write_file(vgmstream, cfg);
+    print_timings(vgmstream, cfg, true);
 
     /* try again with reset (for testing, simulates a seek to 0 after changing internal state)
      * (could simulate by seeking to last sample then to 0, too) */
@@ -611,6 +690,37 @@ fail:
     return false;
 }
 
+// "?s" or "?0Ns" (see replace_filename)
+static bool has_subsong_wildcard(const char* filename) {
+    const char* pos = filename;
+    while ((pos = strchr(pos, '?')) != NULL) {
+        if (pos[1] == 's')
+            return true;
+        if (pos[1] == '0' && pos[2] >= '1' && pos[2] <= '9' && pos[3] == 's')
+            return true;
+        pos++;
+    }
+    return false;
+}
+
+static bool is_parallel_subsongs(cli_config_t* cfg) {
+    if (cfg->jobs <= 1 || cfg->subsong_current_index >= cfg->subsong_current_end)
+        return false;
+    // output must be written in order
+    if (cfg->play_sdtout)
+        return false;
+    if (cfg->decode_only)
+        return true;
+    // default name (set on first convert) has the subsong
+    if (!cfg->outfilename_config && !cfg->outfilename)
+        return true;
+    // otherwise subsongs may write to the same file (last one wins when done in order), including
+    // "?n" alone as names can repeat (first convert also sets outfilename, so only config is checked)
+    if (cfg->outfilename_config && has_subsong_wildcard(cfg->outfilename_config))
+        return true;
+    return false;
+}
+
 static bool convert_subsongs(cli_config_t* cfg) {
     // set base value for current file (passed files may have different number of subsongs)
     cfg->subsong_current_index = cfg->subsong_index;
@@ -627,11 +737,16 @@ static bool convert_subsongs(cli_config_t* cfg) {
 
     // convert subsong range
     int ko_count = 0 ;
-    while (cfg->subsong_current_index < cfg->subsong_current_end + 1) {
-        bool res = convert_file(cfg);
-        if (!res) ko_count++;
+    if (is_parallel_subsongs(cfg)) {
+        ko_count = cli_jobs_convert_subsongs(cfg, convert_file);
+    }
+    else {
+        while (cfg->subsong_current_index < cfg->subsong_current_end + 1) {
+            bool res = convert_file(cfg);
+            if (!res) ko_count++;
 
-        cfg->subsong_current_index++;
+            cfg->subsong_current_index++;
+        }
     }
 
     if (ko_count) {
@@ -666,6 +781,22 @@ int main(int argc, char** argv) {
         libvgmstream_set_log(LIBVGMSTREAM_LOG_LEVEL_NONE, NULL);
     }
 
+    if (cfg.key_cache_filename) {
+        libvgmstream_set_key_cache(cfg.key_cache_filename);
+    }
+
+    if (cfg.seek_cache_path) {
+        libvgmstream_set_seek_cache(cfg.seek_cache_path);
+    }
+
+    if (cfg.read_cache_kb >= 0) {
+        libvgmstream_set_read_cache((int64_t)cfg.read_cache_kb * 1024);
+    }
+
+    if (cfg.open_threads > 1) {
+        libvgmstream_set_open_threads(cfg.open_threads);
+    }
+
     ok = false;
     for (int i = 1; i < argc; i++) {
         // ignore flags
@@ -692,6 +823,8 @@ int main(int argc, char** argv) {
         }
     }
 
+    print_timings_total(&cfg);
+
     /* ok if at least one succeeds, for programs that check result code */
     if (!ok)
         goto fail;
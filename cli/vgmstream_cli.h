@@ -7,6 +7,8 @@
 #define CLI_PATH_LIMIT 4096
 #define CLI_MAX_FLAGS 32  //only up to first N args, probably not that many
 
+typedef struct cli_jobs_t cli_jobs_t;
+
 typedef struct {
     const char* infilename;
 
@@ -31,6 +33,12 @@ typedef struct {
     // subsongs
     int subsong_index;
     int subsong_end;
+    int jobs;
+    int layer_threads;
+    int max_open_segments;
+    int open_threads;
+    const char* key_cache_filename;
+    const char* seek_cache_path;
 
     // wav config
     bool write_lwav;
@@ -48,17 +56,31 @@ typedef struct {
 
     // debug stuff
     bool decode_only;
+    bool use_mmap;
+    int read_cache_kb;
+    int read_ahead_kb;
+    int decode_ahead_samples;
     bool test_reset;
     bool validate_extensions;
     int seek_samples1;
     int seek_samples2;
     int downmix_channels;
     int stereo_track;
+    bool print_timings;
 
 
     // not quite config but eh
     int subsong_current_index;
     int subsong_current_end;
+    cli_jobs_t* jobs_ctx; // set when converting subsongs in parallel
+
+    // timings (seconds)
+    double time_open;
+    double time_decode;
+    double time_seek;
+    int64_t samples_done;
+    double time_open_total;
+    int files_opened;
 
     // to detect flags from filenames in argv
     bool flag_index[CLI_MAX_FLAGS];
@@ -71,6 +93,16 @@ void print_info(libvgmstream_t* vgmstream, cli_config_t* cfg);
 void print_tags(cli_config_t* cfg);
 void print_title(libvgmstream_t* vgmstream, cli_config_t* cfg);
 
+void print_timings(libvgmstream_t* vgmstream, cli_config_t* cfg, bool decoded);
+void print_timings_total(cli_config_t* cfg);
+double cli_get_time(void);
+void cli_sleep(int ms);
+
+typedef bool (*cli_convert_t)(cli_config_t* cfg);
+int cli_jobs_convert_subsongs(cli_config_t* cfg, cli_convert_t convert);
+void cli_jobs_print_start(cli_config_t* cfg);
+void cli_jobs_print_end(cli_config_t* cfg);
+
 void print_json_version(const char* vgmstream_version);
 void print_json_info(libvgmstream_t* vgmstream, cli_config_t* cfg, const char* vgmstream_version);
 
@@ -0,0 +1,220 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "vgmstream_cli.h"
+
+/* Converts a subsong range with N worker threads, each subsong opening its own libvgmstream_t.
+ * Subsongs are handed out in order and each waits
+ * for the previous one before printing its info, so output names/text/result are the same as
+ * converting one by one, only done in parallel. */
+
+#if defined(__EMSCRIPTEN__)
+    #define CLI_JOBS_DISABLED
+#elif defined(WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+
+    typedef HANDLE cli_thread_t;
+    typedef CRITICAL_SECTION cli_mutex_t;
+    typedef int cli_cond_t;
+    #define CLI_THREAD_RESULT DWORD
+    #define CLI_THREAD_CALL WINAPI
+
+    #define cli_mutex_init(m)       InitializeCriticalSection(m)
+    #define cli_mutex_free(m)       DeleteCriticalSection(m)
+    #define cli_mutex_lock(m)       EnterCriticalSection(m)
+    #define cli_mutex_unlock(m)     LeaveCriticalSection(m)
+    // CONDITION_VARIABLE is Vista+ (builds target XP), so just poll; waits are short and rare
+    #define cli_cond_init(c)        /* nothing */
+    #define cli_cond_free(c)        /* nothing */
+    #define cli_cond_wait(c, m)     do { LeaveCriticalSection(m); Sleep(1); EnterCriticalSection(m); } while (0)
+    #define cli_cond_broadcast(c)   /* nothing */
+#else
+    #include <pthread.h>
+
+    typedef pthread_t cli_thread_t;
+    typedef pthread_mutex_t cli_mutex_t;
+    typedef pthread_cond_t cli_cond_t;
+    #define CLI_THREAD_RESULT void*
+    #define CLI_THREAD_CALL
+
+    #define cli_mutex_init(m)       pthread_mutex_init(m, NULL)
+    #define cli_mutex_free(m)       pthread_mutex_destroy(m)
+    #define cli_mutex_lock(m)       pthread_mutex_lock(m)
+    #define cli_mutex_unlock(m)     pthread_mutex_unlock(m)
+    #define cli_cond_init(c)        pthread_cond_init(c, NULL)
+    #define cli_cond_free(c)        pthread_cond_destroy(c)
+    #define cli_cond_wait(c, m)     pthread_cond_wait(c, m)
+    #define cli_cond_broadcast(c)   pthread_cond_broadcast(c)
+#endif
+
+#define CLI_JOBS_MAX 64
+
+
+#ifndef CLI_JOBS_DISABLED
+
+struct cli_jobs_t {
+    cli_mutex_t mutex;
+    cli_cond_t cond;
+
+    const cli_config_t* base_cfg;
+    cli_convert_t convert;
+
+    int next_index;     // next subsong to convert
+    int next_print;     // subsong allowed to print
+    int end_index;      // last subsong (inclusive)
+
+    // results
+    int ko_count;
+    double time_open_total;
+    int files_opened;
+};
+
+static bool start_thread(cli_thread_t* thread, CLI_THREAD_RESULT (CLI_THREAD_CALL *func)(void*), void* arg) {
+#ifdef WIN32
+    *thread = CreateThread(NULL, 0, func, arg, 0, NULL);
+    return *thread != NULL;
+#else
+    return pthread_create(thread, NULL, func, arg) == 0;
+#endif
+}
+
+static void join_thread(cli_thread_t thread) {
+#ifdef WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+void cli_jobs_print_start(cli_config_t* cfg) {
+    cli_jobs_t* jobs = cfg->jobs_ctx;
+    if (!jobs)
+        return;
+
+    cli_mutex_lock(&jobs->mutex);
+    while (jobs->next_print < cfg->subsong_current_index) {
+        cli_cond_wait(&jobs->cond, &jobs->mutex);
+    }
+    cli_mutex_unlock(&jobs->mutex);
+}
+
+void cli_jobs_print_end(cli_config_t* cfg) {
+    cli_jobs_t* jobs = cfg->jobs_ctx;
+    if (!jobs)
+        return;
+
+    fflush(stdout);
+
+    cli_mutex_lock(&jobs->mutex);
+    if (jobs->next_print == cfg->subsong_current_index) {
+        jobs->next_print++;
+        cli_cond_broadcast(&jobs->cond);
+    }
+    cli_mutex_unlock(&jobs->mutex);
+}
+
+static CLI_THREAD_RESULT CLI_THREAD_CALL job_worker(void* arg) {
+    cli_jobs_t* jobs = arg;
+
+    while (true) {
+        cli_mutex_lock(&jobs->mutex);
+        int index = jobs->next_index;
+        if (index <= jobs->end_index)
+            jobs->next_index++;
+        cli_mutex_unlock(&jobs->mutex);
+
+        if (index > jobs->end_index)
+            break;
+
+        // fresh config per subsong (convert may modify it), so results don't depend on which worker gets what
+        cli_config_t cfg = *jobs->base_cfg;
+        cfg.subsong_current_index = index;
+        cfg.time_open_total = 0;
+        cfg.files_opened = 0;
+        cfg.jobs_ctx = jobs;
+
+        bool res = jobs->convert(&cfg);
+
+        // subsongs that failed before printing must still pass the turn (no-op if already done)
+        cli_jobs_print_start(&cfg);
+        cli_jobs_print_end(&cfg);
+
+        cli_mutex_lock(&jobs->mutex);
+        if (!res)
+            jobs->ko_count++;
+        jobs->time_open_total += cfg.time_open_total;
+        jobs->files_opened += cfg.files_opened;
+        cli_mutex_unlock(&jobs->mutex);
+    }
+
+    return 0;
+}
+
+int cli_jobs_convert_subsongs(cli_config_t* cfg, cli_convert_t convert) {
+    cli_thread_t threads[CLI_JOBS_MAX];
+    cli_jobs_t jobs = {0};
+    int threads_count = 0;
+
+    jobs.base_cfg = cfg;
+    jobs.convert = convert;
+    jobs.next_index = cfg->subsong_current_index;
+    jobs.next_print = cfg->subsong_current_index;
+    jobs.end_index = cfg->subsong_current_end;
+
+    int max_jobs = cfg->jobs;
+    if (max_jobs > CLI_JOBS_MAX)
+        max_jobs = CLI_JOBS_MAX;
+    if (max_jobs > jobs.end_index - jobs.next_index + 1)
+        max_jobs = jobs.end_index - jobs.next_index + 1;
+
+    cli_mutex_init(&jobs.mutex);
+    cli_cond_init(&jobs.cond);
+
+    for (int i = 0; i < max_jobs; i++) {
+        if (!start_thread(&threads[threads_count], job_worker, &jobs))
+            break;
+        threads_count++;
+    }
+
+    // can't make threads: do the remaining work here
+    if (threads_count == 0) {
+        job_worker(&jobs);
+    }
+
+    for (int i = 0; i < threads_count; i++) {
+        join_thread(threads[i]);
+    }
+
+    cli_cond_free(&jobs.cond);
+    cli_mutex_free(&jobs.mutex);
+
+    cfg->time_open_total += jobs.time_open_total;
+    cfg->files_opened += jobs.files_opened;
+    return jobs.ko_count;
+}
+
+#else
+
+void cli_jobs_print_start(cli_config_t* cfg) {
+}
+
+void cli_jobs_print_end(cli_config_t* cfg) {
+}
+
+int cli_jobs_convert_subsongs(cli_config_t* cfg, cli_convert_t convert) {
+    int ko_count = 0;
+
+    // no threads: same as regular conversion
+    while (cfg->subsong_current_index < cfg->subsong_current_end + 1) {
+        bool res = convert(cfg);
+        if (!res) ko_count++;
+
+        cfg->subsong_current_index++;
+    }
+
+    return ko_count;
+}
+
+#endif
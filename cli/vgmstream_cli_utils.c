@@ -1,10 +1,16 @@
 #include <string.h>
 #include <inttypes.h>
 #include <stdio.h>
+#include <time.h>
 #include "vgmstream_cli.h"
 #include "vjson.h"
 #include "../src/libvgmstream.h"
 
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
 
 static void clean_filename(char* dst, int clean_paths) {
     for (int i = 0; i < strlen(dst); i++) {
@@ -290,3 +296,94 @@ void print_json_info(libvgmstream_t* v, cli_config_t* cfg, const char* vgmstream
 
     printf("%s\n", buf);
 }
+
+/* wall clock in seconds (only meaningful as a difference) */
+double cli_get_time(void) {
+#ifdef WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+void cli_sleep(int ms) {
+#ifdef WIN32
+    Sleep(ms);
+#else
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000 };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+void print_timings(libvgmstream_t* vgmstream, cli_config_t* cfg, bool decoded) {
+    if (!cfg->print_timings)
+        return;
+    /* don't mix with wav data */
+    FILE* out = cfg->play_sdtout ? stderr : stdout;
+    char line[2048];
+    int pos;
+
+    /* printed at once to avoid mixing lines with parallel jobs */
+    const libvgmstream_stats_t* stats = libvgmstream_get_stats(vgmstream);
+    pos = snprintf(line, sizeof(line), "open time: %.3f ms (%i file reads while probing)\n", cfg->time_open * 1000.0, stats ? stats->probe_reads : 0);
+    if (stats && stats->index_cache_hits + stats->index_cache_misses > 0 && pos > 0 && pos < sizeof(line)) {
+        pos += snprintf(line + pos, sizeof(line) - pos, "index cache: %i hits, %i misses, %i evictions (%i KB)\n",
+                stats->index_cache_hits, stats->index_cache_misses, stats->index_cache_evictions, (int)(stats->index_cache_size / 1024));
+    }
+    if (stats && pos > 0 && pos < sizeof(line)) {
+        pos += snprintf(line + pos, sizeof(line) - pos, "memory: %i KB\n", (int)(stats->memory_size / 1024));
+    }
+    if (stats && stats->entry_count > 0 && stats->entry_open_times && pos > 0 && pos < sizeof(line)) {
+        double total = 0, max = 0;
+        int max_entry = 0;
+        for (int i = 0; i < stats->entry_count; i++) {
+            total += stats->entry_open_times[i];
+            if (max < stats->entry_open_times[i]) {
+                max = stats->entry_open_times[i];
+                max_entry = i;
+            }
+        }
+        pos += snprintf(line + pos, sizeof(line) - pos, "entry open times: %.3f ms total, %.3f ms average, %.3f ms max (entry %i)\n",
+                total * 1000.0, total * 1000.0 / stats->entry_count, max * 1000.0, max_entry + 1);
+    }
+    if (decoded && (cfg->seek_samples1 >= 0 || cfg->seek_samples2 >= 0) && pos > 0 && pos < sizeof(line)) {
+        pos += snprintf(line + pos, sizeof(line) - pos, "seek time: %.3f ms\n", cfg->time_seek * 1000.0);
+    }
+    if (decoded && pos > 0 && pos < sizeof(line)) {
+        double samples_per_second = cfg->time_decode > 0 ? cfg->samples_done / cfg->time_decode : 0;
+        pos += snprintf(line + pos, sizeof(line) - pos, "decode time: %.3f ms (%"PRId64" samples, %.0f samples/s)\n",
+                cfg->time_decode * 1000.0, cfg->samples_done, samples_per_second);
+    }
+    if (decoded && stats && stats->read_cache_served_bytes > 0 && pos > 0 && pos < sizeof(line)) {
+        pos += snprintf(line + pos, sizeof(line) - pos, "read cache: %"PRId64" KB read from file, %"PRId64" KB served\n",
+                stats->read_cache_file_bytes / 1024, stats->read_cache_served_bytes / 1024);
+    }
+    if (decoded && cfg->decode_ahead_samples > 0 && stats && pos > 0 && pos < sizeof(line)) {
+        pos += snprintf(line + pos, sizeof(line) - pos, "decode ahead: %i underruns\n", stats->decode_ahead_underruns);
+    }
+    if (decoded && stats && stats->layer_count > 0 && pos > 0 && pos < sizeof(line)) {
+        pos += snprintf(line + pos, sizeof(line) - pos, "layer times (ms):");
+        for (int i = 0; i < stats->layer_count && pos > 0 && pos < sizeof(line); i++) {
+            pos += snprintf(line + pos, sizeof(line) - pos, " %.1f", stats->layer_times[i] * 1000.0);
+        }
+        if (pos > 0 && pos < sizeof(line))
+            snprintf(line + pos, sizeof(line) - pos, "\n");
+    }
+    fputs(line, out);
+}
+
+void print_timings_total(cli_config_t* cfg) {
+    if (!cfg->print_timings || cfg->files_opened <= 1)
+        return;
+    FILE* out = cfg->play_sdtout ? stderr : stdout;
+
+    fprintf(out, "opened %i files in %.3f ms (%.3f ms per file)\n",
+            cfg->files_opened, cfg->time_open_total * 1000.0, cfg->time_open_total * 1000.0 / cfg->files_opened);
+}
@@ -0,0 +1,311 @@
+#include "api_internal.h"
+#include "mixing.h"
+#include "render.h"
+#include "../util/threads.h"
+
+/* Decode-ahead mode: a background thread keeps a ring of output samples filled, so _render/_fill
+ * only copy what's ready and don't stall the caller (useful for real-time callbacks and slow codecs).
+ *
+ * The ring is single producer (decoder thread) / single consumer (caller), using free-running sample
+ * positions so neither side needs locks to pass data. Only the decoder touches the VGMSTREAM once started:
+ * seeks are requested to it (caller waits until done) and stats that need the VGMSTREAM are published by
+ * it after each chunk, so the caller never waits for a whole chunk to be rendered unless seeking. */
+
+#define AHEAD_MIN_SAMPLES  (INTERNAL_BUF_SAMPLES * 2)
+#define AHEAD_MAX_BYTES    0x10000000 /* ring offsets in bytes must fit an int (max channels * float = 256MB is ~1M samples) */
+#define AHEAD_STATS_COUNT  3
+
+struct api_ahead_t {
+    libvgmstream_priv_t* priv;
+
+    /* ring (positions only grow, index = pos & (ring_samples - 1)) */
+    uint8_t* ring;
+    int ring_samples;
+    int frame_size;
+    vgm_atomic_t write_pos;     /* set by decoder */
+    vgm_atomic_t read_pos;      /* set by caller */
+    vgm_atomic_t done;          /* decoder reached the end */
+
+    /* decoder */
+    void* buf;
+    int buf_samples;
+    int64_t current;
+    vgm_thread_t thread;
+    vgm_event_t wake;
+    vgm_atomic_t waiting;
+    vgm_atomic_t quit;
+
+    /* seek/reset handoff (sample < 0 = reset) */
+    int64_t seek_sample;        /* set by caller before seek_request */
+    int64_t seek_position;      /* set by decoder before seek_done */
+    vgm_atomic_t seek_request;
+    vgm_event_t seek_done;
+
+    /* VGMSTREAM stats as 32-bit halves, guarded by a sequence number (odd while being written) */
+    vgm_atomic_t stats_seq;
+    vgm_atomic_t stats[AHEAD_STATS_COUNT * 2];
+
+    /* caller */
+    int64_t position;
+    int underruns;
+};
+
+
+static int get_free_samples(api_ahead_t* ahead) {
+    unsigned write_pos = vgm_atomic_get(&ahead->write_pos);
+    unsigned read_pos = vgm_atomic_get(&ahead->read_pos);
+    return ahead->ring_samples - (int)(write_pos - read_pos);
+}
+
+static void publish_stats(api_ahead_t* ahead) {
+    int64_t values[AHEAD_STATS_COUNT];
+    api_get_vgmstream_stats(ahead->priv->vgmstream, &values[0], &values[1], &values[2]);
+
+    int seq = vgm_atomic_get(&ahead->stats_seq);
+    vgm_atomic_set(&ahead->stats_seq, seq + 1);
+    for (int i = 0; i < AHEAD_STATS_COUNT; i++) {
+        vgm_atomic_set(&ahead->stats[i * 2 + 0], (int)(uint32_t)(values[i] >> 0));
+        vgm_atomic_set(&ahead->stats[i * 2 + 1], (int)(uint32_t)(values[i] >> 32));
+    }
+    vgm_atomic_set(&ahead->stats_seq, seq + 2);
+}
+
+/* seeks (or resets) and drops ready samples; caller is waiting so it won't touch the ring meanwhile */
+static void do_seek(api_ahead_t* ahead) {
+    libvgmstream_priv_t* priv = ahead->priv;
+
+    if (ahead->seek_sample < 0)
+        reset_vgmstream(priv->vgmstream);
+    else
+        seek_vgmstream(priv->vgmstream, ahead->seek_sample);
+
+    ahead->current = priv->vgmstream->pstate.play_position;
+    ahead->seek_position = ahead->current;
+    vgm_atomic_set(&ahead->write_pos, 0);
+    vgm_atomic_set(&ahead->read_pos, 0);
+    vgm_atomic_set(&ahead->done, 0);
+    publish_stats(ahead);
+
+    vgm_atomic_set(&ahead->seek_request, 0);
+    vgm_event_set(&ahead->seek_done);
+}
+
+/* renders a chunk into the ring */
+static void decode_chunk(api_ahead_t* ahead) {
+    libvgmstream_priv_t* priv = ahead->priv;
+
+    int to_get = ahead->buf_samples;
+    if (!priv->pos.play_forever && to_get + ahead->current > priv->pos.play_samples)
+        to_get = priv->pos.play_samples - ahead->current;
+    if (to_get <= 0) {
+        vgm_atomic_set(&ahead->done, 1);
+        return;
+    }
+
+    sbuf_t ssrc;
+    sfmt_t sfmt = mixing_get_input_sample_type(priv->vgmstream);
+    sbuf_init(&ssrc, sfmt, ahead->buf, to_get, priv->vgmstream->channels);
+
+    int decoded = render_main(&ssrc, priv->vgmstream);
+
+    /* copy to ring, in 2 parts if it wraps around */
+    unsigned write_pos = vgm_atomic_get(&ahead->write_pos);
+    int ring_index = write_pos & (ahead->ring_samples - 1);
+    int part1 = ahead->ring_samples - ring_index;
+    if (part1 > decoded)
+        part1 = decoded;
+    int part2 = decoded - part1;
+
+    memcpy(ahead->ring + ring_index * ahead->frame_size, ahead->buf, part1 * ahead->frame_size);
+    memcpy(ahead->ring, (uint8_t*)ahead->buf + part1 * ahead->frame_size, part2 * ahead->frame_size);
+
+    vgm_atomic_set(&ahead->write_pos, write_pos + decoded);
+
+    if (!priv->pos.play_forever) {
+        ahead->current += decoded;
+        if (ahead->current >= priv->pos.play_samples || decoded <= 0)
+            vgm_atomic_set(&ahead->done, 1);
+    }
+}
+
+static void ahead_worker(void* arg) {
+    api_ahead_t* ahead = arg;
+
+    while (!vgm_atomic_get(&ahead->quit)) {
+
+        if (vgm_atomic_get(&ahead->seek_request)) {
+            do_seek(ahead);
+            continue;
+        }
+
+        /* sleep until caller reads (or seeks, which also sets the event) */
+        if (get_free_samples(ahead) < ahead->buf_samples || vgm_atomic_get(&ahead->done)) {
+            vgm_atomic_set(&ahead->waiting, 1);
+            /* recheck as caller may have read before seeing the flag */
+            if (get_free_samples(ahead) < ahead->buf_samples || vgm_atomic_get(&ahead->done))
+                vgm_event_wait(&ahead->wake);
+            vgm_atomic_set(&ahead->waiting, 0);
+            continue;
+        }
+
+        decode_chunk(ahead);
+        publish_stats(ahead);
+    }
+}
+
+static void wake_worker(api_ahead_t* ahead) {
+    if (vgm_atomic_get(&ahead->waiting))
+        vgm_event_set(&ahead->wake);
+}
+
+
+bool api_ahead_start(libvgmstream_priv_t* priv) {
+    if (priv->ahead)
+        return true;
+    if (priv->ahead_failed)
+        return false;
+    priv->ahead_failed = true; /* until done */
+
+    api_ahead_t* ahead = calloc(1, sizeof(api_ahead_t));
+    if (!ahead) return false;
+
+    ahead->priv = priv;
+    ahead->frame_size = priv->buf.sample_size * priv->buf.channels;
+    ahead->buf_samples = priv->buf.max_samples;
+    ahead->current = priv->pos.current;
+    ahead->position = priv->vgmstream->pstate.play_position;
+
+    /* capped by bytes, as frames may be big (many channels) */
+    ahead->ring_samples = AHEAD_MIN_SAMPLES;
+    while (ahead->ring_samples < priv->cfg.decode_ahead_samples
+            && (size_t)ahead->ring_samples * 2 * ahead->frame_size <= AHEAD_MAX_BYTES) {
+        ahead->ring_samples *= 2;
+    }
+
+    /* render buf must fit input samples before mixing, like the regular buf */
+    ahead->buf = malloc(priv->buf.max_bytes);
+    ahead->ring = malloc((size_t)ahead->ring_samples * ahead->frame_size);
+    if (!ahead->buf || !ahead->ring)
+        goto fail;
+
+    /* thread isn't running yet */
+    publish_stats(ahead);
+
+    if (!vgm_event_init(&ahead->wake))
+        goto fail;
+    if (!vgm_event_init(&ahead->seek_done)) {
+        vgm_event_free(&ahead->wake);
+        goto fail;
+    }
+    if (!vgm_thread_start(&ahead->thread, ahead_worker, ahead)) {
+        vgm_event_free(&ahead->seek_done);
+        vgm_event_free(&ahead->wake);
+        goto fail;
+    }
+
+    priv->ahead = ahead;
+    priv->ahead_failed = false;
+    return true;
+fail:
+    free(ahead->buf);
+    free(ahead->ring);
+    free(ahead);
+    return false; /* regular decoding is used instead */
+}
+
+void api_ahead_stop(libvgmstream_priv_t* priv) {
+    api_ahead_t* ahead = priv->ahead;
+    if (!ahead)
+        return;
+
+    vgm_atomic_set(&ahead->quit, 1);
+    vgm_event_set(&ahead->wake);
+    vgm_thread_join(&ahead->thread);
+    vgm_event_free(&ahead->seek_done);
+    vgm_event_free(&ahead->wake);
+
+    free(ahead->buf);
+    free(ahead->ring);
+    free(ahead);
+    priv->ahead = NULL;
+    priv->ahead_failed = false;
+}
+
+/* copies ready samples to priv's buf without waiting (may be 0 if decoder is behind) */
+void api_ahead_render(libvgmstream_priv_t* priv) {
+    api_ahead_t* ahead = priv->ahead;
+
+    /* done before positions, so it's only trusted if the last samples were already written */
+    bool done = vgm_atomic_get(&ahead->done);
+    unsigned write_pos = vgm_atomic_get(&ahead->write_pos);
+    unsigned read_pos = vgm_atomic_get(&ahead->read_pos);
+    int ready = (int)(write_pos - read_pos);
+
+    int to_copy = ready;
+    if (to_copy > priv->buf.max_samples)
+        to_copy = priv->buf.max_samples;
+    if (to_copy == 0 && !done)
+        ahead->underruns++;
+
+    int ring_index = read_pos & (ahead->ring_samples - 1);
+    int part1 = ahead->ring_samples - ring_index;
+    if (part1 > to_copy)
+        part1 = to_copy;
+    int part2 = to_copy - part1;
+
+    memcpy(priv->buf.data, ahead->ring + ring_index * ahead->frame_size, part1 * ahead->frame_size);
+    memcpy((uint8_t*)priv->buf.data + part1 * ahead->frame_size, ahead->ring, part2 * ahead->frame_size);
+
+    vgm_atomic_set(&ahead->read_pos, read_pos + to_copy);
+    wake_worker(ahead);
+
+    ahead->position += to_copy;
+
+    priv->buf.samples = to_copy;
+    priv->buf.bytes = to_copy * ahead->frame_size;
+    priv->pos.current += to_copy;
+    priv->decode_done = done && ready == to_copy;
+}
+
+/* seeks (or resets if sample < 0) and drops ready samples, waiting until the decoder has done it */
+void api_ahead_seek(libvgmstream_priv_t* priv, int64_t sample) {
+    api_ahead_t* ahead = priv->ahead;
+
+    ahead->seek_sample = sample;
+    vgm_atomic_set(&ahead->seek_request, 1);
+    vgm_event_set(&ahead->wake);
+    vgm_event_wait(&ahead->seek_done);
+
+    ahead->position = ahead->seek_position;
+}
+
+int64_t api_ahead_get_position(libvgmstream_priv_t* priv) {
+    return priv->ahead->position;
+}
+
+void api_ahead_get_stats(libvgmstream_priv_t* priv, int* p_underruns, int* p_ready) {
+    api_ahead_t* ahead = priv->ahead;
+    *p_underruns = ahead ? ahead->underruns : 0;
+    *p_ready = ahead ? ahead->ring_samples - get_free_samples(ahead) : 0;
+}
+
+/* last stats published by the decoder (VGMSTREAM may be changing meanwhile) */
+void api_ahead_get_vgmstream_stats(libvgmstream_priv_t* priv, int64_t* p_file_bytes, int64_t* p_served_bytes, int64_t* p_memory_size) {
+    api_ahead_t* ahead = priv->ahead;
+    int64_t values[AHEAD_STATS_COUNT];
+    int seq;
+
+    /* retry if the decoder wrote while reading (rare and short) */
+    do {
+        seq = vgm_atomic_get(&ahead->stats_seq);
+        for (int i = 0; i < AHEAD_STATS_COUNT; i++) {
+            uint32_t lo = (uint32_t)vgm_atomic_get(&ahead->stats[i * 2 + 0]);
+            uint32_t hi = (uint32_t)vgm_atomic_get(&ahead->stats[i * 2 + 1]);
+            values[i] = (int64_t)(((uint64_t)hi << 32) | lo);
+        }
+    } while ((seq & 1) || seq != vgm_atomic_get(&ahead->stats_seq));
+
+    *p_file_bytes = values[0];
+    *p_served_bytes = values[1];
+    *p_memory_size = values[2];
+}
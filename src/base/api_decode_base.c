@@ -50,8 +50,10 @@ LIBVGMSTREAM_API void libvgmstream_free(libvgmstream_t* lib) {
 
     libvgmstream_priv_t* priv = lib->priv;
     if (priv) {
+        api_ahead_stop(priv);
         close_vgmstream(priv->vgmstream);
         free(priv->buf.data);
+        free(priv->layer_times);
     }
 
     free(priv);
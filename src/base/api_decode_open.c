@@ -2,6 +2,7 @@
 #include "sbuf.h"
 #include "mixing.h"
 #include "info.h"
+#include "../layout/layout.h"
 
 
 static void apply_config(libvgmstream_priv_t* priv) {
@@ -34,9 +35,13 @@ static void apply_config(libvgmstream_priv_t* priv) {
         vcfg.loop_count = 0;
 
     vgmstream_apply_config(priv->vgmstream, &vcfg);
+
+    if (cfg->layer_threads > 1) {
+        layered_set_threads(priv->vgmstream, cfg->layer_threads);
+    }
 }
 
-static void prepare_mixing(libvgmstream_priv_t* priv) {
+static bool prepare_mixing(libvgmstream_priv_t* priv) {
     libvgmstream_config_t* cfg = &priv->cfg;
 
     /* enable after config but before outbuf */
@@ -73,7 +78,7 @@ static void prepare_mixing(libvgmstream_priv_t* priv) {
         mixing_macro_output_sample_format(priv->vgmstream, force_sfmt);
     }
 
-    vgmstream_mixing_enable(priv->vgmstream, INTERNAL_BUF_SAMPLES, NULL /*&input_channels*/, NULL /*&output_channels*/);
+    return vgmstream_mixing_enable(priv->vgmstream, INTERNAL_BUF_SAMPLES, NULL /*&input_channels*/, NULL /*&output_channels*/);
 }
 
 static void update_position(libvgmstream_priv_t* priv) {
@@ -123,20 +128,27 @@ static void update_format_info(libvgmstream_priv_t* priv) {
     }
 }
 
-// apply config if data + config is loaded and not already loaded
-void api_apply_config(libvgmstream_priv_t* priv) {
+// apply config if data + config is loaded and not already loaded; false if it can't be rendered
+bool api_apply_config(libvgmstream_priv_t* priv) {
     if (priv->setup_done)
-        return;
+        return !priv->setup_failed;
     if (!priv->vgmstream)
-        return;
+        return false;
 
     apply_config(priv);
-    prepare_mixing(priv);
+    if (!prepare_mixing(priv))
+        priv->setup_failed = true;
 
     update_position(priv);
     update_format_info(priv);
 
+    // after info, as it may need all segments open (bitrate; segments already closed while opening aren't counted)
+    if (priv->cfg.max_open_segments > 0) {
+        segmented_set_max_open(priv->vgmstream, priv->cfg.max_open_segments);
+    }
+
     priv->setup_done = true;
+    return !priv->setup_failed;
 }
 
 static void load_vgmstream(libvgmstream_priv_t* priv, libstreamfile_t* libsf, int subsong_index) {
@@ -144,9 +156,19 @@ static void load_vgmstream(libvgmstream_priv_t* priv, libstreamfile_t* libsf, in
     if (!sf_api)
         return;
 
+    // opened files are reopened from this one, so all get read-ahead
+    if (priv->config_loaded && priv->cfg.read_ahead_size > 0) {
+        sf_api = open_readahead_streamfile_f(sf_api, priv->cfg.read_ahead_size);
+        if (!sf_api)
+            return;
+    }
+
     //TODO: handle format_id
 
     sf_api->stream_index = subsong_index;
+    // lets segmented formats close segments while opening, rather than all being open until config is applied
+    if (priv->config_loaded)
+        sf_api->max_open_segments = priv->cfg.max_open_segments;
     priv->vgmstream = init_vgmstream_from_STREAMFILE(sf_api);
     close_streamfile(sf_api);
 }
@@ -168,7 +190,10 @@ LIBVGMSTREAM_API int libvgmstream_open_stream(libvgmstream_t* lib, libstreamfile
 
     // apply now if possible to update format info
     if (priv->config_loaded) {
-        api_apply_config(priv);
+        if (!api_apply_config(priv)) {
+            libvgmstream_close_stream(lib);
+            return LIBVGMSTREAM_ERROR_GENERIC;
+        }
     }
     else {
         // no config: just update info (apply_config will be called later)
@@ -186,9 +211,11 @@ LIBVGMSTREAM_API void libvgmstream_close_stream(libvgmstream_t* lib) {
 
     libvgmstream_priv_t* priv = lib->priv;
 
+    api_ahead_stop(priv);
     close_vgmstream(priv->vgmstream);
     priv->vgmstream = NULL;
     priv->setup_done = false;
+    priv->setup_failed = false;
     //priv->config_loaded = false; // loaded config still applies (_close is also called on _open)
 
     libvgmstream_priv_reset(priv, true);
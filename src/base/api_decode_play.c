@@ -34,8 +34,8 @@ static bool reset_buf(libvgmstream_priv_t* priv) {
     priv->buf.sample_size = output_sample_size;
     priv->buf.channels = output_channels;
 
-    int max_bytes = priv->buf.max_samples * max_sample_size * max_channels;
-    priv->buf.data = malloc(max_bytes);
+    priv->buf.max_bytes = priv->buf.max_samples * max_sample_size * max_channels;
+    priv->buf.data = malloc(priv->buf.max_bytes);
     if (!priv->buf.data) return false;
 
     priv->buf.initialized = true;
@@ -73,9 +73,8 @@ LIBVGMSTREAM_API int libvgmstream_render(libvgmstream_t* lib) {
 
     // setup if not called (mainly to make sure mixing is enabled) //TODO: handle internally
     // (for cases where _open_stream is called but not _setup)
-    if (!priv->setup_done) {
-        api_apply_config(priv);
-    }
+    if (!api_apply_config(priv))
+        return LIBVGMSTREAM_ERROR_GENERIC;
 
     if (priv->decode_done)
         return LIBVGMSTREAM_ERROR_GENERIC;
@@ -83,6 +82,13 @@ LIBVGMSTREAM_API int libvgmstream_render(libvgmstream_t* lib) {
     if (!reset_buf(priv))
         return LIBVGMSTREAM_ERROR_GENERIC;
 
+    // copy what the decode-ahead thread has ready (falls back to regular decoding if it can't start)
+    if (priv->cfg.decode_ahead_samples > 0 && api_ahead_start(priv)) {
+        api_ahead_render(priv);
+        update_decoder_info(priv);
+        return LIBVGMSTREAM_OK;
+    }
+
     int to_get = priv->buf.max_samples;
     if (!priv->pos.play_forever && to_get + priv->pos.current > priv->pos.play_samples)
         to_get = priv->pos.play_samples - priv->pos.current;
@@ -107,6 +113,7 @@ LIBVGMSTREAM_API int libvgmstream_fill(libvgmstream_t* lib, void* buf, int buf_s
     libvgmstream_priv_t* priv = lib->priv;
 
     bool done = false;
+    bool underrun = false;
     int buf_copied = 0;
     while (buf_copied < buf_samples) {
 
@@ -119,6 +126,12 @@ LIBVGMSTREAM_API int libvgmstream_fill(libvgmstream_t* lib, void* buf, int buf_s
 
             int err = libvgmstream_render(lib);
             if (err < 0) return err;
+
+            // decode-ahead had nothing ready: don't wait (rest is blanked below)
+            if (priv->buf.samples == 0 && !priv->decode_done) {
+                underrun = true;
+                break;
+            }
         }
 
         // copy from partial decode src to partial dst
@@ -149,7 +162,7 @@ LIBVGMSTREAM_API int libvgmstream_fill(libvgmstream_t* lib, void* buf, int buf_s
     priv->dec.done = done;
 
     // since _fill is used mainly for fixed bufs, blank samples after EOF in case caller only handles exactly buf_samples
-    if (done) {
+    if (done || underrun) {
         int buf_left = buf_samples - buf_copied;
         int bytes_bytes = buf_left * priv->buf.sample_size * priv->buf.channels;
         memset( ((uint8_t*)buf) + (priv->dec.buf_bytes), 0, bytes_bytes);
@@ -167,6 +180,10 @@ LIBVGMSTREAM_API int64_t libvgmstream_get_play_position(libvgmstream_t* lib) {
     if (!priv->vgmstream)
         return LIBVGMSTREAM_ERROR_GENERIC;
 
+    // vgmstream's position is ahead of what was returned
+    if (priv->ahead)
+        return api_ahead_get_position(priv);
+
     return priv->vgmstream->pstate.play_position;
 }
 
@@ -179,9 +196,14 @@ LIBVGMSTREAM_API void libvgmstream_seek(libvgmstream_t* lib, int64_t sample) {
     if (!priv->vgmstream)
         return;
 
-    seek_vgmstream(priv->vgmstream, sample);
-
-    priv->pos.current = priv->vgmstream->pstate.play_position;
+    if (priv->ahead) {
+        api_ahead_seek(priv, sample);
+        priv->pos.current = api_ahead_get_position(priv);
+    }
+    else {
+        seek_vgmstream(priv->vgmstream, sample);
+        priv->pos.current = priv->vgmstream->pstate.play_position;
+    }
 
     // update flags just in case
     update_buf(priv, 0);
@@ -194,7 +216,10 @@ LIBVGMSTREAM_API void libvgmstream_reset(libvgmstream_t* lib) {
         return;
 
     libvgmstream_priv_t* priv = lib->priv;
-    if (priv->vgmstream) {
+    if (priv->ahead) {
+        api_ahead_seek(priv, -1);
+    }
+    else if (priv->vgmstream) {
         reset_vgmstream(priv->vgmstream);
     }
     libvgmstream_priv_reset(priv, false);
@@ -1,5 +1,10 @@
 #include "api_internal.h"
 #include "info.h"
+#include "index_cache.h"
+#include "key_cache.h"
+#include "seek_table.h"
+#include "../layout/layout.h"
+#include "../meta/txtp.h"
 
 
 static int get_internal_log_level(libvgmstream_loglevel_t level) {
@@ -56,6 +61,140 @@ LIBVGMSTREAM_API int libvgmstream_format_describe(libvgmstream_t* lib, char* dst
 }
 
 
+/* channels of one file share one cache, so only the first is checked */
+static void get_read_cache_stats(VGMSTREAM* vgmstream, int64_t* p_file_bytes, int64_t* p_served_bytes) {
+    if (!vgmstream)
+        return;
+
+    if (vgmstream->layout_type == layout_layered) {
+        layered_layout_data* data = vgmstream->layout_data;
+        for (int i = 0; i < data->layer_count; i++) {
+            get_read_cache_stats(data->layers[i], p_file_bytes, p_served_bytes);
+        }
+        return;
+    }
+
+    if (vgmstream->layout_type == layout_segmented) {
+        segmented_layout_data* data = vgmstream->layout_data;
+        for (int i = 0; i < data->segment_count; i++) {
+            get_read_cache_stats(data->segments[i], p_file_bytes, p_served_bytes); /* may be closed */
+        }
+        return;
+    }
+
+    int64_t file_bytes, served_bytes;
+    if (vgmstream->channels > 0 && get_cache_streamfile_stats(vgmstream->ch[0].streamfile, &file_bytes, &served_bytes)) {
+        *p_file_bytes += file_bytes;
+        *p_served_bytes += served_bytes;
+    }
+}
+
+/* stats that walk the VGMSTREAM, so only the thread decoding it may call this */
+void api_get_vgmstream_stats(VGMSTREAM* vgmstream, int64_t* p_file_bytes, int64_t* p_served_bytes, int64_t* p_memory_size) {
+    *p_file_bytes = 0;
+    *p_served_bytes = 0;
+    get_read_cache_stats(vgmstream, p_file_bytes, p_served_bytes);
+
+    *p_memory_size = vgmstream_get_memory_size(vgmstream);
+}
+
+LIBVGMSTREAM_API const libvgmstream_stats_t* libvgmstream_get_stats(libvgmstream_t* lib) {
+    if (!lib || !lib->priv)
+        return NULL;
+
+    libvgmstream_priv_t* priv = lib->priv;
+    if (!priv->vgmstream)
+        return NULL;
+
+    // refreshed on each call as some values may change during decode
+    libvgmstream_stats_t* stats = &priv->stats;
+    stats->probe_reads = priv->vgmstream->probe_reads;
+
+    index_cache_stats_t cache_stats;
+    index_cache_get_stats(&cache_stats);
+    stats->index_cache_hits = cache_stats.hits;
+    stats->index_cache_misses = cache_stats.misses;
+    stats->index_cache_evictions = cache_stats.evictions;
+    stats->index_cache_size = cache_stats.size;
+
+    stats->layer_count = 0;
+    stats->layer_times = NULL;
+    if (priv->vgmstream->layout_type == layout_layered) {
+        layered_layout_data* data = priv->vgmstream->layout_data;
+
+        if (priv->layer_times_count != data->layer_count) {
+            free(priv->layer_times);
+            priv->layer_times_count = 0;
+            priv->layer_times = malloc(data->layer_count * sizeof(double));
+            if (priv->layer_times)
+                priv->layer_times_count = data->layer_count;
+        }
+
+        if (priv->layer_times) {
+            layered_get_layer_times(data, priv->layer_times);
+            stats->layer_count = priv->layer_times_count;
+            stats->layer_times = priv->layer_times;
+        }
+    }
+
+    // may be changing in the decode-ahead thread, that publishes them instead
+    if (priv->ahead)
+        api_ahead_get_vgmstream_stats(priv, &stats->read_cache_file_bytes, &stats->read_cache_served_bytes, &stats->memory_size);
+    else
+        api_get_vgmstream_stats(priv->vgmstream, &stats->read_cache_file_bytes, &stats->read_cache_served_bytes, &stats->memory_size);
+
+    stats->entry_count = priv->vgmstream->entry_count;
+    stats->entry_open_times = priv->vgmstream->entry_times;
+
+    api_ahead_get_stats(priv, &stats->decode_ahead_underruns, &stats->decode_ahead_ready);
+
+    return stats;
+}
+
+
+LIBVGMSTREAM_API void libvgmstream_set_index_cache(int64_t max_size) {
+    if (max_size < 0)
+        max_size = 0;
+    index_cache_set_max_size(max_size);
+}
+
+LIBVGMSTREAM_API void libvgmstream_set_read_cache(int64_t max_size) {
+    if (max_size < 0)
+        max_size = 0;
+    set_cache_streamfile_max_size(max_size);
+}
+
+LIBVGMSTREAM_API void libvgmstream_set_open_threads(int threads) {
+    if (threads < 1)
+        threads = 1;
+    txtp_set_open_threads(threads);
+}
+
+LIBVGMSTREAM_API void libvgmstream_set_key_cache(const char* filename) {
+    key_cache_set_file(filename);
+}
+
+LIBVGMSTREAM_API void libvgmstream_set_seek_cache(const char* path) {
+    seek_table_set_cache_dir(path);
+}
+
+LIBVGMSTREAM_API bool libvgmstream_build_seek_table(libvgmstream_t* lib) {
+    if (!lib || !lib->priv)
+        return false;
+
+    libvgmstream_priv_t* priv = lib->priv;
+    if (!priv->vgmstream)
+        return false;
+
+    // decodes the whole stream, restarted from the beginning after
+    api_ahead_stop(priv);
+
+    bool ok = seek_table_build(priv->vgmstream);
+    libvgmstream_priv_reset(priv, false);
+    return ok;
+}
+
+
 LIBVGMSTREAM_API bool libvgmstream_is_valid(const char* filename, libvgmstream_valid_t* cfg) {
     if (!filename)
         return false;
@@ -23,6 +23,7 @@ typedef struct {
 
     /* config (output values channels/size after mixing, though buf may be as big as input size) */
     int max_samples;
+    int max_bytes;      /* for input or output */
     int channels;       /* */
     int sample_size;    
 
@@ -40,11 +41,14 @@ typedef struct {
     int64_t current;
 } libvgmstream_priv_position_t;
 
+typedef struct api_ahead_t api_ahead_t;
+
 // vgmstream context/handle
 typedef struct {
     // externally exposed to API
     libvgmstream_format_t fmt; 
     libvgmstream_decoder_t dec;
+    libvgmstream_stats_t stats;
 
     // internals
     libvgmstream_config_t cfg;
@@ -52,18 +56,33 @@ typedef struct {
     VGMSTREAM* vgmstream;
     libvgmstream_priv_buf_t buf;
     libvgmstream_priv_position_t pos;
+    api_ahead_t* ahead;         // decode-ahead thread if enabled and started
+    double* layer_times;        // stats copy (layers may be decoding in other threads)
+    int layer_times_count;
 
     bool config_loaded;
     bool setup_done;
     bool decode_done;
+    bool ahead_failed;
+    bool setup_failed;          // config/mixing couldn't be applied (can't render)
 } libvgmstream_priv_t;
 
 
 void libvgmstream_priv_reset(libvgmstream_priv_t* priv, bool full);
 libvgmstream_sfmt_t api_get_output_sample_type(libvgmstream_priv_t* priv);
 int api_get_sample_size(libvgmstream_sfmt_t sample_format);
-void api_apply_config(libvgmstream_priv_t* priv);
+bool api_apply_config(libvgmstream_priv_t* priv);
+
+bool api_ahead_start(libvgmstream_priv_t* priv);
+void api_ahead_stop(libvgmstream_priv_t* priv);
+void api_ahead_render(libvgmstream_priv_t* priv);
+void api_ahead_seek(libvgmstream_priv_t* priv, int64_t sample);
+int64_t api_ahead_get_position(libvgmstream_priv_t* priv);
+void api_ahead_get_stats(libvgmstream_priv_t* priv, int* p_underruns, int* p_ready);
+void api_ahead_get_vgmstream_stats(libvgmstream_priv_t* priv, int64_t* p_file_bytes, int64_t* p_served_bytes, int64_t* p_memory_size);
+void api_get_vgmstream_stats(VGMSTREAM* vgmstream, int64_t* p_file_bytes, int64_t* p_served_bytes, int64_t* p_memory_size);
 
 STREAMFILE* open_api_streamfile(libstreamfile_t* libsf);
+STREAMFILE* libstreamfile_get_streamfile(libstreamfile_t* libsf);
 
 #endif
@@ -764,10 +764,7 @@ void decode_vgmstream(sbuf_t* sdst, VGMSTREAM* vgmstream, int samples_to_do) {
             }
             break;
         case coding_NGC_DSP:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ngc_dsp(&vgmstream->ch[ch], buffer+ch,
-                        vgmstream->channels, vgmstream->samples_into_block, samples_to_do);
-            }
+            decode_ngc_dsp_mc(vgmstream, buffer, vgmstream->samples_into_block, samples_to_do);
             break;
         case coding_NGC_DSP_subint:
             for (ch = 0; ch < vgmstream->channels; ch++) {
@@ -938,18 +935,12 @@ void decode_vgmstream(sbuf_t* sdst, VGMSTREAM* vgmstream, int samples_to_do) {
             break;
         }
         case coding_PSX:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_psx(&vgmstream->ch[ch], buffer+ch,
-                        vgmstream->channels, vgmstream->samples_into_block, samples_to_do,
-                        0, vgmstream->codec_config);
-            }
+            decode_psx_mc(vgmstream, buffer, vgmstream->samples_into_block, samples_to_do,
+                    0, vgmstream->codec_config);
             break;
         case coding_PSX_badflags:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_psx(&vgmstream->ch[ch], buffer+ch,
-                        vgmstream->channels, vgmstream->samples_into_block, samples_to_do,
-                        1, vgmstream->codec_config);
-            }
+            decode_psx_mc(vgmstream, buffer, vgmstream->samples_into_block, samples_to_do,
+                    1, vgmstream->codec_config);
             break;
         case coding_PSX_cfg:
             for (ch = 0; ch < vgmstream->channels; ch++) {
@@ -1410,6 +1401,20 @@ void decode_vgmstream(sbuf_t* sdst, VGMSTREAM* vgmstream, int samples_to_do) {
     }
 }
 
+/* Decoders that can handle any number of contiguous frames per call (within a block), rather than up to one frame. */
+static bool decode_is_multiframe(VGMSTREAM* vgmstream) {
+    switch (vgmstream->coding_type) {
+        case coding_PSX:
+        case coding_PSX_badflags:
+        case coding_NGC_DSP:
+        case coding_IMA_mono:
+        case coding_DVI_IMA_mono:
+            return true;
+        default:
+            return false;
+    }
+}
+
 /* Calculate number of consecutive samples we can decode. Takes into account hitting
  * a loop start or end, or going past a single frame. */
 int decode_get_samples_to_do(int samples_this_block, int samples_per_frame, VGMSTREAM* vgmstream) {
@@ -1436,8 +1441,8 @@ int decode_get_samples_to_do(int samples_this_block, int samples_per_frame, VGMS
         }
     }
 
-    /* if it's a framed encoding don't do more than one frame */
-    if (samples_per_frame > 1 && (vgmstream->samples_into_block % samples_per_frame) + samples_to_do > samples_per_frame)
+    /* if it's a framed encoding don't do more than one frame (unless decoder handles them) */
+    if (samples_per_frame > 1 && !decode_is_multiframe(vgmstream) && (vgmstream->samples_into_block % samples_per_frame) + samples_to_do > samples_per_frame)
         samples_to_do = samples_per_frame - (vgmstream->samples_into_block % samples_per_frame);
 
     return samples_to_do;
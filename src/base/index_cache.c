@@ -0,0 +1,210 @@
+#include "index_cache.h"
+#include "../util/sf_utils.h"
+#include "../util/threads.h"
+#include "../util/vgmstream_limits.h"
+
+#define INDEX_CACHE_DEFAULT_MAX_SIZE  (32 * 1024 * 1024)
+#define INDEX_CACHE_FINGERPRINT_SIZE  0x1000
+
+typedef struct index_entry_t {
+    struct index_entry_t* next; /* list in LRU order, first is most recent */
+
+    /* file identity (strings are allocated after the entry) */
+    char* filename;
+    size_t file_size;
+    uint32_t fingerprint;
+    char* key;
+
+    void* data;
+    size_t data_size;
+    int refs;
+} index_entry_t;
+
+typedef struct {
+    index_entry_t* list;
+    size_t size;
+    size_t max_size;
+
+    index_cache_stats_t stats;
+} index_cache_t;
+
+static vgm_mutex_t cache_mutex = VGM_MUTEX_INIT;
+static index_cache_t cache = { .max_size = INDEX_CACHE_DEFAULT_MAX_SIZE };
+
+
+/* name/size aren't always enough (subfiles in a bigfile may share both) so also hash the start of data */
+static uint32_t get_fingerprint(STREAMFILE* sf) {
+    uint8_t buf[INDEX_CACHE_FINGERPRINT_SIZE];
+    uint32_t hash = 0x811c9dc5; /* FNV-1a */
+
+    int bytes = read_streamfile(buf, 0x00, sizeof(buf), sf);
+    for (int i = 0; i < bytes; i++) {
+        hash = (hash ^ buf[i]) * 0x01000193;
+    }
+    return hash;
+}
+
+static void free_entry(index_entry_t* entry) {
+    free(entry->data);
+    free(entry);
+}
+
+/* must be called with the mutex held */
+static void evict_entries(size_t max_size) {
+    while (cache.size > max_size) {
+        index_entry_t* prev = NULL;
+        index_entry_t* prev_unused = NULL;
+        index_entry_t* unused = NULL;
+
+        /* find least recently used entry (last in list) not currently in use */
+        for (index_entry_t* entry = cache.list; entry != NULL; entry = entry->next) {
+            if (entry->refs == 0) {
+                unused = entry;
+                prev_unused = prev;
+            }
+            prev = entry;
+        }
+
+        if (!unused)
+            break;
+
+        if (prev_unused)
+            prev_unused->next = unused->next;
+        else
+            cache.list = unused->next;
+        cache.size -= unused->data_size;
+        cache.stats.evictions++;
+        free_entry(unused);
+    }
+}
+
+
+const void* index_cache_get(STREAMFILE* sf, const char* key, size_t* p_size) {
+    char filename[PATH_LIMIT];
+    void* data = NULL;
+
+    if (!sf || !key)
+        return NULL;
+
+    get_streamfile_name(sf, filename, sizeof(filename));
+    size_t file_size = get_streamfile_size(sf);
+    uint32_t fingerprint = get_fingerprint(sf);
+
+    vgm_mutex_lock(&cache_mutex);
+
+    index_entry_t* prev = NULL;
+    for (index_entry_t* entry = cache.list; entry != NULL; entry = entry->next) {
+        bool found = entry->file_size == file_size && entry->fingerprint == fingerprint
+            && strcmp(entry->key, key) == 0 && strcmp(entry->filename, filename) == 0;
+        if (found) {
+            /* move to front */
+            if (prev) {
+                prev->next = entry->next;
+                entry->next = cache.list;
+                cache.list = entry;
+            }
+
+            entry->refs++;
+            data = entry->data;
+            if (p_size)
+                *p_size = entry->data_size;
+            break;
+        }
+        prev = entry;
+    }
+
+    if (data)
+        cache.stats.hits++;
+    else
+        cache.stats.misses++;
+
+    vgm_mutex_unlock(&cache_mutex);
+    return data;
+}
+
+const void* index_cache_add(STREAMFILE* sf, const char* key, void* data, size_t size) {
+    char filename[PATH_LIMIT];
+    index_entry_t* entry = NULL;
+
+    if (!sf || !key || !data)
+        return data;
+
+    get_streamfile_name(sf, filename, sizeof(filename));
+
+    size_t filename_len = strlen(filename) + 1;
+    size_t key_len = strlen(key) + 1;
+
+    entry = calloc(1, sizeof(index_entry_t) + filename_len + key_len);
+    if (!entry) goto fail;
+
+    entry->filename = (char*)(entry + 1);
+    entry->key = entry->filename + filename_len;
+    memcpy(entry->filename, filename, filename_len);
+    memcpy(entry->key, key, key_len);
+    entry->file_size = get_streamfile_size(sf);
+    entry->fingerprint = get_fingerprint(sf);
+    entry->data = data;
+    entry->data_size = size;
+    entry->refs = 1;
+
+    vgm_mutex_lock(&cache_mutex);
+    if (size > cache.max_size) {
+        /* not cacheable (or disabled), data is freed on release */
+        vgm_mutex_unlock(&cache_mutex);
+        goto fail;
+    }
+
+    /* another thread may have added the same thing meanwhile, but it's harmless (oldest is evicted eventually) */
+    entry->next = cache.list;
+    cache.list = entry;
+    cache.size += size;
+    evict_entries(cache.max_size);
+    vgm_mutex_unlock(&cache_mutex);
+
+    return data;
+fail:
+    if (entry) {
+        entry->data = NULL;
+        free_entry(entry);
+    }
+    return data;
+}
+
+void index_cache_release(const void* data) {
+    bool found = false;
+
+    if (!data)
+        return;
+
+    vgm_mutex_lock(&cache_mutex);
+    for (index_entry_t* entry = cache.list; entry != NULL; entry = entry->next) {
+        if (entry->data == data) {
+            entry->refs--;
+            found = true;
+            break;
+        }
+    }
+
+    /* entries over budget but in use couldn't be evicted before */
+    if (found)
+        evict_entries(cache.max_size);
+    vgm_mutex_unlock(&cache_mutex);
+
+    /* uncached data */
+    if (!found)
+        free((void*)data);
+}
+
+void index_cache_set_max_size(size_t max_size) {
+    vgm_mutex_lock(&cache_mutex);
+    cache.max_size = max_size;
+    evict_entries(max_size);
+    vgm_mutex_unlock(&cache_mutex);
+}
+
+void index_cache_get_stats(index_cache_stats_t* stats) {
+    vgm_mutex_lock(&cache_mutex);
+    *stats = cache.stats;
+    stats->size = cache.size;
+    vgm_mutex_unlock(&cache_mutex);
+}
@@ -0,0 +1,43 @@
+#ifndef _INDEX_CACHE_H_
+#define _INDEX_CACHE_H_
+
+#include "../streamfile.h"
+
+/* Process-wide cache of parsed container indexes (subsong tables, names, offsets, etc).
+ * Banks with thousands of subsongs are reopened once per subsong, so parsers that need to read
+ * the whole header to set up one subsong can keep their parsed results here and reuse them.
+ *
+ * Entries are keyed by file (name + size + start of data) plus a parser-defined key, and
+ * are evicted in LRU order once over the memory budget. Usage:
+ *   data = index_cache_get(sf, key, NULL);
+ *   if (!data) {
+ *       data = (build)
+ *       data = index_cache_add(sf, key, data, size);
+ *   }
+ *   (use data)
+ *   index_cache_release(data);
+ */
+
+/* Returns cached data for sf+key (read-only), or NULL if not found. */
+const void* index_cache_get(STREAMFILE* sf, const char* key, size_t* p_size);
+
+/* Adds malloc'd data, that now belongs to the cache (freed on release if it can't be cached).
+ * Returns the same data, that must be released as if returned by _get. */
+const void* index_cache_add(STREAMFILE* sf, const char* key, void* data, size_t size);
+
+/* Signals data isn't used anymore (NULL is ignored). */
+void index_cache_release(const void* data);
+
+/* Sets memory budget in bytes; 0 disables the cache and frees unused entries. */
+void index_cache_set_max_size(size_t max_size);
+
+typedef struct {
+    int hits;
+    int misses;
+    int evictions;
+    size_t size;
+} index_cache_stats_t;
+
+void index_cache_get_stats(index_cache_stats_t* stats);
+
+#endif
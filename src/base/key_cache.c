@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "key_cache.h"
+#include "../util/threads.h"
+#include "../util/vgmstream_limits.h"
+
+/* Few games need more than a handful of keys, so a small MRU list is enough */
+#define KEY_CACHE_MAX_ENTRIES  256
+#define KEY_CACHE_TYPE_SIZE  8
+
+typedef struct {
+    char type[KEY_CACHE_TYPE_SIZE];
+    uint64_t fingerprint;
+    uint64_t key;
+} key_entry_t;
+
+typedef struct {
+    key_entry_t entries[KEY_CACHE_MAX_ENTRIES]; /* first is most recent */
+    int count;
+    char filename[PATH_LIMIT];
+} key_cache_t;
+
+static vgm_mutex_t cache_mutex = VGM_MUTEX_INIT;
+static key_cache_t cache;
+
+
+uint64_t key_cache_hash(uint64_t hash, const uint8_t* buf, int buf_size) {
+    for (int i = 0; i < buf_size; i++) {
+        hash = (hash ^ buf[i]) * 0x100000001b3;
+    }
+    return hash;
+}
+
+/* must be called with the mutex held; returns true if the entry is new */
+static bool add_entry(const char* type, uint64_t fingerprint, uint64_t key) {
+    int pos = cache.count;
+    bool is_new = true;
+
+    /* fingerprints may collide, so keep one entry per fingerprint+key */
+    for (int i = 0; i < cache.count; i++) {
+        key_entry_t* entry = &cache.entries[i];
+        if (entry->fingerprint == fingerprint && entry->key == key && strcmp(entry->type, type) == 0) {
+            is_new = false;
+            pos = i;
+            break;
+        }
+    }
+
+    /* move everything before the entry (or all, removing the oldest if full) down and put it first */
+    if (pos == KEY_CACHE_MAX_ENTRIES)
+        pos--;
+    else if (pos == cache.count)
+        cache.count++;
+    memmove(&cache.entries[1], &cache.entries[0], pos * sizeof(key_entry_t));
+
+    key_entry_t* entry = &cache.entries[0];
+    snprintf(entry->type, sizeof(entry->type), "%s", type);
+    entry->fingerprint = fingerprint;
+    entry->key = key;
+    return is_new;
+}
+
+bool key_cache_find(const char* type, uint64_t fingerprint, uint64_t* p_key) {
+    bool found = false;
+
+    vgm_mutex_lock(&cache_mutex);
+    for (int i = 0; i < cache.count; i++) {
+        key_entry_t* entry = &cache.entries[i];
+        if (entry->fingerprint == fingerprint && strcmp(entry->type, type) == 0) {
+            *p_key = entry->key;
+            found = true;
+            break;
+        }
+    }
+    vgm_mutex_unlock(&cache_mutex);
+
+    return found;
+}
+
+int key_cache_get_recent(const char* type, uint64_t* keys, int max) {
+    int count = 0;
+
+    vgm_mutex_lock(&cache_mutex);
+    for (int i = 0; i < cache.count && count < max; i++) {
+        key_entry_t* entry = &cache.entries[i];
+        if (strcmp(entry->type, type) != 0)
+            continue;
+
+        bool repeated = false;
+        for (int j = 0; j < count; j++) {
+            if (keys[j] == entry->key) {
+                repeated = true;
+                break;
+            }
+        }
+        if (!repeated)
+            keys[count++] = entry->key;
+    }
+    vgm_mutex_unlock(&cache_mutex);
+
+    return count;
+}
+
+void key_cache_add(const char* type, uint64_t fingerprint, uint64_t key) {
+    vgm_mutex_lock(&cache_mutex);
+    bool is_new = add_entry(type, fingerprint, key);
+
+    if (is_new && cache.filename[0]) {
+        FILE* file = fopen(cache.filename, "a");
+        if (file) {
+            fprintf(file, "%s %016llx %016llx\n", type, (unsigned long long)fingerprint, (unsigned long long)key);
+            fclose(file);
+        }
+    }
+    vgm_mutex_unlock(&cache_mutex);
+}
+
+void key_cache_set_file(const char* filename) {
+    char line[0x100];
+
+    vgm_mutex_lock(&cache_mutex);
+    if (!filename || !filename[0] || strlen(filename) >= sizeof(cache.filename)) {
+        cache.filename[0] = '\0';
+        vgm_mutex_unlock(&cache_mutex);
+        return;
+    }
+
+    snprintf(cache.filename, sizeof(cache.filename), "%s", filename);
+
+    /* lines are "(type) (fingerprint) (key)" in hex, last ones being the most recent */
+    FILE* file = fopen(filename, "r");
+    if (file) {
+        while (fgets(line, sizeof(line), file)) {
+            char type[KEY_CACHE_TYPE_SIZE];
+            unsigned long long fingerprint, key;
+
+            int n = sscanf(line, "%7s %llx %llx", type, &fingerprint, &key);
+            if (n != 3)
+                continue;
+            add_entry(type, fingerprint, key);
+        }
+        fclose(file);
+    }
+    vgm_mutex_unlock(&cache_mutex);
+}
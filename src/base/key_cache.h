@@ -0,0 +1,34 @@
+#ifndef _KEY_CACHE_H_
+#define _KEY_CACHE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Process-wide cache of decryption keys found by testing key lists (slow with big lists).
+ * Files from the same game normally share a key, so parsers can try recently found keys first,
+ * and reopening the same file (identified by a parser-defined fingerprint of its header) can skip
+ * the search entirely. Found keys are optionally saved to a text file so they persist between runs
+ * (nothing is written unless a file is set). Usage:
+ *   if (!key_cache_find("xxx", fingerprint, &key)) {
+ *       (try key_cache_get_recent keys, then search list)
+ *       key_cache_add("xxx", fingerprint, key);
+ *   }
+ * Keys should still be validated when possible, as fingerprints may collide. */
+
+/* Gets the key most recently found for a file. */
+bool key_cache_find(const char* type, uint64_t fingerprint, uint64_t* p_key);
+
+/* Gets up to max distinct keys of some type, most recently found first. Returns count. */
+int key_cache_get_recent(const char* type, uint64_t* keys, int max);
+
+/* Registers a found key (and appends it to the cache file if set). */
+void key_cache_add(const char* type, uint64_t fingerprint, uint64_t key);
+
+/* Sets a file to load keys from and save new keys to (NULL stops saving). */
+void key_cache_set_file(const char* filename);
+
+/* FNV-1a 64-bit, to make fingerprints. */
+uint64_t key_cache_hash(uint64_t hash, const uint8_t* buf, int buf_size);
+#define KEY_CACHE_HASH_INIT  0xcbf29ce484222325
+
+#endif
@@ -12,7 +12,7 @@
  * with simplicity in mind rather than performance. Process:
  * - detect if mixing applies at current moment or exit (mini performance optimization)
  * - copy/upgrade buf to float mixbuf if needed
- * - do mixing ops
+ * - do mixing ops (consecutive simple ops are folded into one matrix op on first use)
  * - copy/downgrade mixbuf to original buf if needed
  * 
  * Mixing ops are added by a meta (ex. TXTP) or plugins through API. Non-sensical config
@@ -29,7 +29,7 @@ mixer_t* mixer_init(int channels) {
     mixer_t* mixer = calloc(1, sizeof(mixer_t));
     if (!mixer) goto fail;
 
-    mixer->chain_size = VGMSTREAM_MAX_MIXING; /* fixed array for now */
+    /* chain is allocated when adding ops (most streams have none) */
     mixer->mixing_channels = channels;
     mixer->output_channels = channels;
     mixer->input_channels = channels;
@@ -44,6 +44,8 @@ fail:
 void mixer_free(mixer_t* mixer) {
     if (!mixer) return;
 
+    mixer_free_stages(mixer);
+    free(mixer->chain);
     free(mixer->mixbuf);
     free(mixer);
 }
@@ -70,6 +72,26 @@ bool mixer_is_active(mixer_t* mixer) {
     return false;
 }
 
+size_t mixer_get_memory_size(mixer_t* mixer) {
+    if (!mixer) return 0;
+
+    size_t size = sizeof(mixer_t);
+    size += mixer->chain_size * sizeof(mix_op_t);
+    if (mixer->mixbuf)
+        size += mixer->mixbuf_size;
+    for (int i = 0; i < mixer->stages_count; i++) {
+        mix_stage_t* stage = &mixer->stages[i];
+        size += sizeof(mix_stage_t);
+        if (stage->terms)
+            size += stage->output_channels * (sizeof(int) + stage->input_channels * sizeof(mix_term_t));
+        if (stage->gains)
+            size += 4 * stage->output_channels * sizeof(float);
+    }
+    if (mixer->mixframe)
+        size += mixer->mixing_channels * sizeof(float); /* approximate */
+    return size;
+}
+
 // TODO: probably could be pre-initialized
 static void setup_mixbuf(mixer_t* mixer, sbuf_t* sbuf) {
     sbuf_t* smix = &mixer->smix;
@@ -99,6 +121,26 @@ static void setup_outbuf(mixer_t* mixer, sbuf_t* sbuf) {
     sbuf_copy_segments(sbuf, smix, smix->filled);
 }
 
+static void apply_ops(mixer_t* mixer, int op_start, int op_count) {
+    for (int m = op_start; m < op_start + op_count; m++) {
+        mix_op_t* mix = &mixer->chain[m];
+
+        //TO-DO: set callback
+        switch(mix->type) {
+            case MIX_SWAP:      mixer_op_swap(mixer, mix); break;
+            case MIX_ADD:       mixer_op_add(mixer, mix); break;
+            case MIX_VOLUME:    mixer_op_volume(mixer, mix); break;
+            case MIX_LIMIT:     mixer_op_limit(mixer, mix); break;
+            case MIX_UPMIX:     mixer_op_upmix(mixer, mix); break;
+            case MIX_DOWNMIX:   mixer_op_downmix(mixer, mix); break;
+            case MIX_KILLMIX:   mixer_op_killmix(mixer, mix); break;
+            case MIX_FADE:      mixer_op_fade(mixer, mix);
+            default:
+                break;
+        }
+    }
+}
+
 void mixer_process(mixer_t* mixer, sbuf_t* sbuf, int32_t current_pos) {
 
     // external
@@ -123,26 +165,32 @@ void mixer_process(mixer_t* mixer, sbuf_t* sbuf, int32_t current_pos) {
 
     mixer->current_subpos = current_pos;
 
+    // allocated in mixing_setup, that fails otherwise
+    if (!mixer->mixbuf)
+        return;
+
     setup_mixbuf(mixer, sbuf);
 
+    // group ops on first use (chain can't change once active)
+    if (!mixer->stages_done) {
+        mixer->stages_done = true;
+        mixer_setup_stages(mixer); // on failure ops are applied one by one
+    }
+
     // apply mixing ops in order. channels in mixers may increase or decrease per op (set in sbuf)
     // - 2ch w/ "1+2,1u" = ch1+ch2, ch1(add and push rest) = 3ch: ch1' ch1+ch2 ch2
     // - 2ch w/ "1u"     = downmix to 1ch (current_channels decreases once)
-    for (int m = 0; m < mixer->chain_count; m++) {
-        mix_op_t* mix = &mixer->chain[m];
-
-        //TO-DO: set callback
-        switch(mix->type) {
-            case MIX_SWAP:      mixer_op_swap(mixer, mix); break;
-            case MIX_ADD:       mixer_op_add(mixer, mix); break;
-            case MIX_VOLUME:    mixer_op_volume(mixer, mix); break;
-            case MIX_LIMIT:     mixer_op_limit(mixer, mix); break;
-            case MIX_UPMIX:     mixer_op_upmix(mixer, mix); break;
-            case MIX_DOWNMIX:   mixer_op_downmix(mixer, mix); break;
-            case MIX_KILLMIX:   mixer_op_killmix(mixer, mix); break;
-            case MIX_FADE:      mixer_op_fade(mixer, mix);
-            default:
-                break;
+    if (!mixer->stages) {
+        apply_ops(mixer, 0, mixer->chain_count);
+    }
+    else {
+        for (int i = 0; i < mixer->stages_count; i++) {
+            mix_stage_t* stage = &mixer->stages[i];
+
+            if (stage->terms && stage->input_channels == mixer->smix.channels)
+                mixer_op_matrix(mixer, stage);
+            else
+                apply_ops(mixer, stage->op_start, stage->op_count);
         }
     }
 
@@ -13,5 +13,6 @@ void mixer_free(mixer_t* mixer);
 void mixer_update_channel(mixer_t* mixer);
 void mixer_process(mixer_t* mixer, sbuf_t* sbuf, int32_t current_pos);
 bool mixer_is_active(mixer_t* mixer);
+size_t mixer_get_memory_size(mixer_t* mixer);
 
 #endif
@@ -0,0 +1,306 @@
+#include "mixer_priv.h"
+#include "../util/simd.h"
+#include <string.h>
+
+/* TXTP and API mixing may chain many simple ops (ex. a layout macro + several volumes), each being
+ * a full pass over the buffer. Since swap/add/volume/upmix/downmix/killmix are all linear, consecutive
+ * ones can be folded on setup into a single output x input gain matrix (saved as non-zero terms per
+ * output channel), so the buffer is only passed once. Limits and fades aren't linear or change over
+ * time, so they stay as separate stages and split runs.
+ *
+ * Folded results may differ a tiny bit from applying ops one by one (float rounding order),
+ * so a lone op is still applied as-is. A matrix reads its inputs indirectly, so a few cheap ops
+ * (ex. 2 adds) may be faster than one dense matrix, and runs are only folded when that isn't the case
+ * (checked with codec_check's matrix mode). */
+
+static bool is_linear_op(mix_type_t type) {
+    switch(type) {
+        case MIX_SWAP:
+        case MIX_ADD:
+        case MIX_VOLUME:
+        case MIX_UPMIX:
+        case MIX_DOWNMIX:
+        case MIX_KILLMIX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* applies op to the matrix rows (one per current channel); returns new row count or -1 if op can't be folded */
+static int fold_op(float* matrix, int rows, int rows_max, int cols, mix_op_t* op) {
+    size_t row_size = cols * sizeof(float);
+
+    switch(op->type) {
+        case MIX_SWAP: {
+            if (op->ch_dst >= rows || op->ch_src >= rows)
+                return -1;
+            float* row_dst = matrix + op->ch_dst * cols;
+            float* row_src = matrix + op->ch_src * cols;
+            for (int i = 0; i < cols; i++) {
+                float temp_f = row_dst[i];
+                row_dst[i] = row_src[i];
+                row_src[i] = temp_f;
+            }
+            return rows;
+        }
+
+        case MIX_ADD: {
+            if (op->ch_dst >= rows || op->ch_src >= rows)
+                return -1;
+            float* row_dst = matrix + op->ch_dst * cols;
+            float* row_src = matrix + op->ch_src * cols;
+            for (int i = 0; i < cols; i++) {
+                row_dst[i] = row_dst[i] + row_src[i] * op->vol;
+            }
+            return rows;
+        }
+
+        case MIX_VOLUME:
+            if (op->ch_dst < 0) {
+                for (int i = 0; i < rows * cols; i++) {
+                    matrix[i] = matrix[i] * op->vol;
+                }
+            }
+            else {
+                if (op->ch_dst >= rows)
+                    return -1;
+                float* row_dst = matrix + op->ch_dst * cols;
+                for (int i = 0; i < cols; i++) {
+                    row_dst[i] = row_dst[i] * op->vol;
+                }
+            }
+            return rows;
+
+        case MIX_UPMIX:
+            if (op->ch_dst > rows || rows + 1 > rows_max)
+                return -1;
+            memmove(matrix + (op->ch_dst + 1) * cols, matrix + op->ch_dst * cols, (rows - op->ch_dst) * row_size);
+            memset(matrix + op->ch_dst * cols, 0, row_size); // inserted as silent
+            return rows + 1;
+
+        case MIX_DOWNMIX:
+            if (op->ch_dst >= rows)
+                return -1;
+            memmove(matrix + op->ch_dst * cols, matrix + (op->ch_dst + 1) * cols, (rows - op->ch_dst - 1) * row_size);
+            return rows - 1;
+
+        case MIX_KILLMIX:
+            if (op->ch_dst > rows)
+                return -1;
+            return op->ch_dst;
+
+        default:
+            return -1;
+    }
+}
+
+/* rough per-frame cost of an op (samples moved or multiplied) */
+static int get_op_cost(mix_op_t* op, int channels) {
+    switch(op->type) {
+        case MIX_SWAP:      return 2;
+        case MIX_ADD:       return 1;
+        case MIX_VOLUME:    return op->ch_dst < 0 ? channels : 1;
+        case MIX_UPMIX:     return channels + 1;
+        case MIX_DOWNMIX:   return channels - 1;
+        case MIX_KILLMIX:   return op->ch_dst;
+        default:            return 0;
+    }
+}
+
+/* sets stage's matrix, or leaves it unset if applying ops one by one should be faster */
+static bool setup_matrix_stage(mix_stage_t* stage, mix_op_t* ops, int rows_max) {
+    int cols = stage->input_channels;
+    int rows = cols;
+    int ops_cost = 0;
+
+    float* matrix = calloc(rows_max * cols, sizeof(float));
+    if (!matrix) goto fail;
+
+    for (int ch = 0; ch < cols; ch++) {
+        matrix[ch * cols + ch] = 1.0f;
+    }
+
+    for (int i = 0; i < stage->op_count; i++) {
+        ops_cost += get_op_cost(&ops[i], rows);
+        rows = fold_op(matrix, rows, rows_max, cols, &ops[i]);
+        if (rows < 0) goto fail;
+    }
+    stage->output_channels = rows;
+
+    stage->term_counts = calloc(rows, sizeof(int));
+    stage->terms = calloc(rows * cols, sizeof(mix_term_t));
+    if (!stage->term_counts || !stage->terms) goto fail;
+
+    /* only non-zero gains are used, so most outputs end up with 1 or 2 terms */
+    bool is_gain = (rows == cols);
+    int terms_count = 0;
+    for (int ch = 0; ch < rows; ch++) {
+        mix_term_t* terms = stage->terms + ch * cols;
+        int count = 0;
+        for (int i = 0; i < cols; i++) {
+            float vol = matrix[ch * cols + i];
+            if (vol == 0.0f)
+                continue;
+            terms[count].ch_src = i;
+            terms[count].vol = vol;
+            count++;
+        }
+        stage->term_counts[ch] = count;
+        terms_count += count;
+
+        if (count > 1 || (count == 1 && terms[0].ch_src != ch))
+            is_gain = false;
+    }
+
+    /* per-channel volumes only, repeated for 4 frames so vectors always line up with the gains */
+    if (is_gain) {
+        stage->gains = malloc(4 * rows * sizeof(float));
+        if (!stage->gains) goto fail;
+        for (int i = 0; i < 4 * rows; i++) {
+            int ch = i % rows;
+            stage->gains[i] = stage->term_counts[ch] ? stage->terms[ch * cols].vol : 0.0f;
+        }
+    }
+    else if (2 * terms_count + cols >= ops_cost) {
+        /* each term is a load + multiply-add, plus copying the input frame */
+        free(stage->term_counts);
+        free(stage->terms);
+        stage->term_counts = NULL;
+        stage->terms = NULL;
+    }
+
+    free(matrix);
+    return true;
+fail:
+    free(matrix);
+    return false;
+}
+
+static int get_op_channels(mix_op_t* op, int channels) {
+    switch(op->type) {
+        case MIX_UPMIX:     return channels + 1;
+        case MIX_DOWNMIX:   return channels - 1;
+        case MIX_KILLMIX:   return op->ch_dst < channels ? op->ch_dst : channels;
+        default:            return channels;
+    }
+}
+
+bool mixer_setup_stages(mixer_t* mixer) {
+    int channels = mixer->input_channels;
+    int max_channels = mixer->mixing_channels > channels ? mixer->mixing_channels : channels;
+
+    mixer->stages = calloc(mixer->chain_count, sizeof(mix_stage_t));
+    if (!mixer->stages) goto fail;
+
+    int pos = 0;
+    while (pos < mixer->chain_count) {
+        mix_stage_t* stage = &mixer->stages[mixer->stages_count];
+
+        int count = 1;
+        if (is_linear_op(mixer->chain[pos].type)) {
+            while (pos + count < mixer->chain_count && is_linear_op(mixer->chain[pos + count].type)) {
+                count++;
+            }
+        }
+
+        stage->op_start = pos;
+        stage->op_count = count;
+        stage->input_channels = channels;
+        for (int i = 0; i < count; i++) {
+            channels = get_op_channels(&mixer->chain[pos + i], channels);
+            if (max_channels < channels)
+                max_channels = channels;
+        }
+        stage->output_channels = channels;
+        mixer->stages_count++;
+
+        if (count > 1 && !setup_matrix_stage(stage, &mixer->chain[pos], max_channels))
+            goto fail;
+
+        pos += count;
+    }
+
+    mixer->mixframe = malloc(max_channels * sizeof(float));
+    if (!mixer->mixframe) goto fail;
+
+    return true;
+fail:
+    mixer_free_stages(mixer);
+    return false;
+}
+
+void mixer_free_stages(mixer_t* mixer) {
+    for (int i = 0; i < mixer->stages_count; i++) {
+        free(mixer->stages[i].term_counts);
+        free(mixer->stages[i].terms);
+        free(mixer->stages[i].gains);
+    }
+    free(mixer->stages);
+    free(mixer->mixframe);
+
+    mixer->stages = NULL;
+    mixer->stages_count = 0;
+    mixer->mixframe = NULL;
+}
+
+
+static void apply_gains(mixer_t* mixer, mix_stage_t* stage) {
+    sbuf_t* smix = &mixer->smix;
+    float* buf = smix->buf;
+    int total = smix->filled * smix->channels;
+    int s = 0;
+
+#ifdef VGM_SIMD
+    /* 4 frames at a time = N vectors, matching the 4-frame gains */
+    int block = 4 * smix->channels;
+    for (; s + block <= total; s += block) {
+        for (int i = 0; i < block; i += 4) {
+            v4f_store(buf + s + i, v4f_mul(v4f_load(buf + s + i), v4f_load(stage->gains + i)));
+        }
+    }
+#endif
+
+    for (; s < total; s++) {
+        buf[s] = buf[s] * stage->gains[s % smix->channels];
+    }
+}
+
+void mixer_op_matrix(mixer_t* mixer, mix_stage_t* stage) {
+    sbuf_t* smix = &mixer->smix;
+    float* frame = mixer->mixframe;
+    int in_channels = stage->input_channels;
+    int out_channels = stage->output_channels;
+
+    if (stage->gains) {
+        apply_gains(mixer, stage);
+        return;
+    }
+
+    /* done in place: front to back when channels decrease, otherwise back to front
+     * (like up/downmix) so frames aren't overwritten before being read */
+    int start = 0, end = smix->filled, step = 1;
+    if (out_channels > in_channels) {
+        start = smix->filled - 1;
+        end = -1;
+        step = -1;
+    }
+
+    for (int s = start; s != end; s += step) {
+        float* src = (float*)smix->buf + s * in_channels;
+        float* dst = (float*)smix->buf + s * out_channels;
+
+        memcpy(frame, src, in_channels * sizeof(float));
+
+        for (int ch = 0; ch < out_channels; ch++) {
+            mix_term_t* terms = stage->terms + ch * in_channels;
+            float sample = 0.0f;
+            for (int i = 0; i < stage->term_counts[ch]; i++) {
+                sample += frame[terms[i].ch_src] * terms[i].vol;
+            }
+            dst[ch] = sample;
+        }
+    }
+
+    smix->channels = out_channels;
+}
@@ -34,6 +34,24 @@ typedef struct {
     int32_t time_post;  /* position after time_end where vol_end applies (-1 = end) */
 } mix_op_t;
 
+typedef struct {
+    int ch_src;
+    float vol;
+} mix_term_t;
+
+/* consecutive linear ops (swap/add/volume/upmix/downmix/killmix) folded into a single channel matrix,
+ * or a single op that is applied as-is (fades, limits, lone ops) */
+typedef struct {
+    int op_start;           /* first op in chain */
+    int op_count;           /* ops in this stage (>1 = folded if terms are set) */
+
+    int input_channels;
+    int output_channels;
+    int* term_counts;       /* per output channel */
+    mix_term_t* terms;      /* per output channel, input_channels max each */
+    float* gains;           /* if only per-channel volumes: gains for 4 frames (for simple vector ops), else NULL */
+} mix_stage_t;
+
 struct mixer_t {
     int input_channels;     /* starting channels before mixing */
     int output_channels;    /* resulting channels after mixing */
@@ -42,14 +60,20 @@ struct mixer_t {
     bool active;            /* mixing working */
 
     int chain_count;        /* op number */
-    size_t chain_size;      /* max ops */
-    mix_op_t chain[VGMSTREAM_MAX_MIXING]; /* effects to apply (could be alloc'ed but to simplify...) */
+    size_t chain_size;      /* allocated ops (grows as needed, up to VGMSTREAM_MAX_MIXING) */
+    mix_op_t* chain;        /* effects to apply */
 
     /* fades only apply at some points, other mixes are active */
     bool has_non_fade;
     bool has_fade;
 
+    mix_stage_t* stages;    // chain grouped in stages, set on first process
+    int stages_count;
+    bool stages_done;
+    float* mixframe;        // temp frame for matrix stages
+
     float* mixbuf;          // internal mixing buffer
+    size_t mixbuf_size;
     sbuf_t smix;            // temp sbuf
     int32_t current_subpos; // state: current sample pos in the stream
 
@@ -64,5 +88,8 @@ void mixer_op_upmix(mixer_t* mixer, mix_op_t* op);
 void mixer_op_downmix(mixer_t* mixer, mix_op_t* op);
 void mixer_op_killmix(mixer_t* mixer, mix_op_t* op);
 void mixer_op_fade(mixer_t* mixer, mix_op_t* op);
+void mixer_op_matrix(mixer_t* mixer, mix_stage_t* stage);
+bool mixer_setup_stages(mixer_t* mixer);
+void mixer_free_stages(mixer_t* mixer);
 bool mixer_op_fade_is_active(mixer_t* mixer, int32_t current_start, int32_t current_end);
 #endif
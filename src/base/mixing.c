@@ -94,33 +94,41 @@ done:
 }
 
 
-void mixing_setup(VGMSTREAM* vgmstream, int32_t max_sample_count) {
+bool mixing_setup(VGMSTREAM* vgmstream, int32_t max_sample_count) {
     mixer_t* mixer = vgmstream->mixer;
 
     if (!mixer)
-        return;
+        return true;
 
     /* special value to not actually enable anything (used to query values) */
     if (max_sample_count <= 0)
-        return;
+        return true;
 
-    /* create or alter internal buffer */
-    float* mixbuf_re = realloc(mixer->mixbuf, max_sample_count * mixer->mixing_channels * sizeof(float));
-    if (!mixbuf_re) goto fail;
+    size_t mixbuf_size = max_sample_count * mixer->mixing_channels * sizeof(float);
+    if (mixer->mixbuf_size != mixbuf_size) {
+        free(mixer->mixbuf);
+        mixer->mixbuf = NULL;
+        mixer->mixbuf_size = mixbuf_size;
+    }
 
-    mixer->mixbuf = mixbuf_re;
     mixer->active = true;
 
+    /* internal buffer only if it will mix (many segments/layers have a mixer without ops) */
+    if (mixer_is_active(mixer) && !mixer->mixbuf) {
+        mixer->mixbuf = malloc(mixer->mixbuf_size);
+        if (!mixer->mixbuf) {
+            mixer->active = false;
+            return false;
+        }
+    }
+
     fix_channel_layout(vgmstream);
 
     /* since data exists on its own memory and pointer is already set
      * there is no need to propagate to start_vgmstream */
 
     /* segments/layers are independant from external buffers and may always mix */
-
-    return;
-fail:
-    return;
+    return true;
 }
 
 void mixing_info(VGMSTREAM* vgmstream, int* p_input_channels, int* p_output_channels) {
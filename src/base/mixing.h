@@ -11,8 +11,9 @@ void mix_vgmstream(sbuf_t* sbuf, VGMSTREAM* vgmstream);
 
 /* Call to let vgmstream apply mixing, which must handle input/output_channels.
  * Once mixing is active any new mixes are ignored (to avoid the possibility
- * of down/upmixing without querying input/output_channels). */
-void mixing_setup(VGMSTREAM* vgmstream, int32_t max_sample_count);
+ * of down/upmixing without querying input/output_channels).
+ * Returns false if the mixing buffer can't be allocated (mixing is left disabled). */
+bool mixing_setup(VGMSTREAM* vgmstream, int32_t max_sample_count);
 
 /* gets current mixing info */
 void mixing_info(VGMSTREAM* vgmstream, int* input_channels, int* output_channels);
@@ -17,8 +17,21 @@ static bool add_mixing(VGMSTREAM* vgmstream, mix_op_t* op) {
     }
 
     if (mixer->chain_count + 1 > mixer->chain_size) {
-        VGM_LOG("MIX: too many mixes\n");
-        return false;
+        if (mixer->chain_size >= VGMSTREAM_MAX_MIXING) {
+            VGM_LOG("MIX: too many mixes\n");
+            return false;
+        }
+
+        /* macros usually add a bunch of ops at once */
+        size_t chain_size = mixer->chain_size ? mixer->chain_size * 2 : 16;
+        if (chain_size > VGMSTREAM_MAX_MIXING)
+            chain_size = VGMSTREAM_MAX_MIXING;
+
+        mix_op_t* chain = realloc(mixer->chain, chain_size * sizeof(mix_op_t));
+        if (!chain) return false;
+
+        mixer->chain = chain;
+        mixer->chain_size = chain_size;
     }
 
     mixer->chain[mixer->chain_count] = *op; /* memcpy */
@@ -155,11 +155,12 @@ void vgmstream_get_title(char* buf, int buf_len, const char* filename, VGMSTREAM
 /* MIXING: modifies vgmstream output          */
 /* ****************************************** */
 
-void vgmstream_mixing_enable(VGMSTREAM* vgmstream, int32_t max_sample_count, int* input_channels, int* output_channels) {
-    mixing_setup(vgmstream, max_sample_count);
+bool vgmstream_mixing_enable(VGMSTREAM* vgmstream, int32_t max_sample_count, int* input_channels, int* output_channels) {
+    bool ok = mixing_setup(vgmstream, max_sample_count);
     mixing_info(vgmstream, input_channels, output_channels);
 
     setup_vgmstream(vgmstream);
+    return ok;
 }
 
 void vgmstream_mixing_autodownmix(VGMSTREAM* vgmstream, int max_channels) {
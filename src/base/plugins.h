@@ -111,8 +111,8 @@ void vgmstream_tags_close(VGMSTREAM_TAGS* tags);
 /* Enables mixing effects, with max outbuf samples as a hint. Once active, plugin
  * must use returned input_channels to create outbuf and output_channels to output audio.
  * max_sample_count may be 0 if you only need to query values and not actually enable it.
- * Needs to be enabled last after adding effects. */
-void vgmstream_mixing_enable(VGMSTREAM* vgmstream, int32_t max_sample_count, int *input_channels, int *output_channels);
+ * Needs to be enabled last after adding effects. Returns false on errors (can't allocate buffers). */
+bool vgmstream_mixing_enable(VGMSTREAM* vgmstream, int32_t max_sample_count, int *input_channels, int *output_channels);
 
 /* sets automatic downmixing if vgmstream's channels are higher than max_channels */
 void vgmstream_mixing_autodownmix(VGMSTREAM* vgmstream, int max_channels);
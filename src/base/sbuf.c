@@ -3,6 +3,7 @@
 #include "../util.h"
 #include "sbuf.h"
 #include "../util/log.h"
+#include "../util/simd.h"
 
 // float-to-int modes
 //#define PCM16_ROUNDING_LRINT  // rounding down, potentially faster in some systems/compilers and much slower in others (also affects rounding)
@@ -236,6 +237,29 @@ typedef void (*sbuf_copy_t)(void* vsrc, void* vdst, int src_pos, int dst_pos, in
         } \
     }
 
+#if defined(VGM_SIMD) && !defined(PCM16_ROUNDING_HALF) && !defined(PCM16_ROUNDING_LRINT)
+// Float to s16 is done for every float codec, so it's vectorized (same truncation + clamp as above)
+#define DEFINE_SBUF_COPY_S16(suffix, scale, func) \
+    static void sbuf_copy_##suffix(void* vsrc, void* vdst, int src_pos, int dst_pos, int src_max) { \
+        float* src = vsrc; \
+        int16_t* dst = vdst; \
+        v4f_t vscale = v4f_set1(scale); \
+        while (src_pos + 8 <= src_max) { \
+            v4f_t a = v4f_mul(v4f_load(src + src_pos + 0), vscale); \
+            v4f_t b = v4f_mul(v4f_load(src + src_pos + 4), vscale); \
+            v4f_store_s16x2(dst + dst_pos, a, b); \
+            src_pos += 8; \
+            dst_pos += 8; \
+        } \
+        while (src_pos < src_max) { \
+            dst[dst_pos++] = func(src[src_pos++]); \
+        } \
+    }
+#else
+#define DEFINE_SBUF_COPY_S16(suffix, scale, func) \
+    DEFINE_SBUF_COPY(suffix, float, int16_t, func)
+#endif
+
 DEFINE_SBUF_COPY(s16_s16, int16_t, int16_t, CONV_NOOP);
 DEFINE_SBUF_COPY(s16_f16, int16_t, float,   CONV_NOOP);
 DEFINE_SBUF_COPY(s16_flt, int16_t, float,   CONV_S16_FLT);
@@ -243,14 +267,14 @@ DEFINE_SBUF_COPY(s16_s24, int16_t, int32_t, CONV_S16_S24);
 DEFINE_SBUF_COPY(s16_s32, int16_t, int32_t, CONV_S16_S32);
 DEFINE_SBUF_CP24(s16_o24, int16_t, uint8_t, CONV_S16_S24);
 
-DEFINE_SBUF_COPY(f16_s16, float,   int16_t, CONV_F16_S16);
+DEFINE_SBUF_COPY_S16(f16_s16, 1.0f, CONV_F16_S16);
 DEFINE_SBUF_COPY(f16_f16, float,   float,   CONV_NOOP);
 DEFINE_SBUF_COPY(f16_flt, float,   float,   CONV_F16_FLT);
 DEFINE_SBUF_COPY(f16_s24, float,   int32_t, CONV_F16_S24);
 DEFINE_SBUF_COPY(f16_s32, float,   int32_t, CONV_F16_S32);
 DEFINE_SBUF_CP24(f16_o24, float,   uint8_t, CONV_F16_S24);
 
-DEFINE_SBUF_COPY(flt_s16, float,   int16_t, CONV_FLT_S16);
+DEFINE_SBUF_COPY_S16(flt_s16, 32767.0f, CONV_FLT_S16);
 DEFINE_SBUF_COPY(flt_f16, float,   float,   CONV_FLT_F16);
 DEFINE_SBUF_COPY(flt_flt, float,   float,   CONV_NOOP);
 DEFINE_SBUF_COPY(flt_s24, float,   int32_t, CONV_FLT_S24);
@@ -1,3 +1,4 @@
+#include <math.h>
 #include "../vgmstream.h"
 #include "../layout/layout.h"
 #include "render.h"
@@ -6,6 +7,7 @@
 #include "plugins.h"
 #include "sbuf.h"
 #include "codec_info.h"
+#include "seek_table.h"
 
 
 /* Seeking in vgmstream can be divided into:
@@ -24,24 +26,227 @@
  *  decode:                |    body    |  body-begin |  body-loop  |
  */
 
+/* Fixed-frame ADPCM in flat/interleave layouts finds frame offsets from samples_into_block, so it can jump
+ * to any frame directly. ADPCM history at that point is unknown though, so it's cleared and rebuilt by
+ * decoding some frames before the target. This is approximate: history errors fade as the codec's filter
+ * decays, so output becomes identical after the pre-roll for usual coefs, but files with coefs that decay
+ * too slowly (or not at all, ex. DSP with coef2 = -1.0) use a full decode instead.
+ * Codecs with history in frame headers need no pre-roll, so seeking is exact. */
+#define SEEK_PREROLL_SAMPLES  1024
+#define SEEK_MAX_PREROLL_SAMPLES  16384
+
+/* Samples needed for history errors in a 2-pole filter (y = coef1 * hist1 + coef2 * hist2) to go
+ * below 1/2^24 of their size, from the largest pole radius, or -1 if they may not decay. */
+static int get_filter_decay_samples(double coef1, double coef2) {
+    double radius;
+    double disc = coef1 * coef1 + 4.0 * coef2;
+    if (disc < 0) {
+        radius = sqrt(-coef2);
+    }
+    else {
+        double root = sqrt(disc);
+        radius = fmax(fabs(coef1 + root), fabs(coef1 - root)) / 2.0;
+    }
+
+    if (radius < 0.000001)
+        return 0;
+    if (radius >= 0.999)
+        return -1;
+    return (int)ceil(log(1.0 / (1 << 24)) / log(radius));
+}
+
+/* pre-roll for codecs with per-file coefs (all sets as frames may use any), or -1 if too long */
+static int get_coef_preroll_samples(VGMSTREAM* vgmstream, double coef_scale) {
+    int preroll = SEEK_PREROLL_SAMPLES;
+
+    for (int ch = 0; ch < vgmstream->channels; ch++) {
+        const int16_t* coefs = vgmstream->ch[ch].adpcm_coef;
+        for (int i = 0; i < 16; i += 2) {
+            int samples = get_filter_decay_samples(coefs[i + 0] / coef_scale, coefs[i + 1] / coef_scale);
+            if (samples < 0 || samples > SEEK_MAX_PREROLL_SAMPLES)
+                return -1;
+            if (preroll < samples)
+                preroll = samples;
+        }
+    }
+
+    return preroll;
+}
+
+/* returns frames to decode before target, or -1 if codec can't jump */
+static int get_seek_preroll_frames(VGMSTREAM* vgmstream, int samples_per_frame) {
+    int preroll;
+
+    switch(vgmstream->coding_type) {
+        /* fixed PS-ADPCM/XA filters, slowest (pole radius ~0.968) decays in ~500 samples */
+        case coding_PSX:
+        case coding_PSX_badflags:
+        case coding_PSX_cfg:
+        case coding_XA:
+        case coding_XA8:
+            preroll = SEEK_PREROLL_SAMPLES;
+            break;
+
+        case coding_NGC_DSP:
+            preroll = get_coef_preroll_samples(vgmstream, 2048.0);
+            break;
+        case coding_CRI_ADX:
+        case coding_CRI_ADX_fixed:
+        case coding_CRI_ADX_exp:
+            preroll = get_coef_preroll_samples(vgmstream, 4096.0);
+            break;
+
+        case coding_XBOX_IMA:
+        case coding_XBOX_IMA_mono:
+            return 0;
+
+        default:
+            return -1;
+    }
+
+    if (preroll < 0)
+        return -1;
+    return (preroll + samples_per_frame - 1) / samples_per_frame;
+}
+
+/* don't skip loop points, as decoder must save/restore state there (callers seek to loop start first) */
+static bool can_jump(VGMSTREAM* vgmstream, int32_t target_sample) {
+    if (vgmstream->loop_flag) {
+        if (!vgmstream->hit_loop && target_sample > vgmstream->loop_start_sample)
+            return false;
+        if (target_sample >= vgmstream->loop_end_sample)
+            return false;
+    }
+    return true;
+}
+
+/* Moves the decoder forward to a frame close to current + samples without decoding.
+ * Returns samples left to decode to reach the target. */
+static int seek_frame_jump(VGMSTREAM* vgmstream, int samples) {
+    bool is_interleave = vgmstream->layout_type == layout_interleave;
+    if (vgmstream->layout_type != layout_none && !is_interleave)
+        return samples;
+    if (vgmstream->codec_internal_updates)
+        return samples;
+
+    int samples_per_frame = decode_get_samples_per_frame(vgmstream);
+    if (samples_per_frame <= 0)
+        return samples;
+    int preroll_frames = get_seek_preroll_frames(vgmstream, samples_per_frame);
+    if (preroll_frames < 0)
+        return samples;
+
+    int32_t target_sample = vgmstream->current_sample + samples;
+    if (!can_jump(vgmstream, target_sample))
+        return samples;
+
+    /* samples_into_block is relative to the current interleave block's start (or stream start in flat layouts) */
+    int samples_this_block = 0;
+    if (is_interleave && vgmstream->interleave_block_size) {
+        int frame_size = decode_get_frame_size(vgmstream);
+        if (vgmstream->interleave_first_block_size || frame_size <= 0)
+            return samples;
+        samples_this_block = vgmstream->interleave_block_size / frame_size * samples_per_frame;
+        if (samples_this_block <= 0)
+            return samples;
+    }
+
+    int32_t target_into = vgmstream->samples_into_block + samples;
+    int32_t jump_into = (target_into / samples_per_frame - preroll_frames) * samples_per_frame;
+    if (jump_into <= vgmstream->samples_into_block + samples_per_frame) /* not worth it */
+        return samples;
+
+    int32_t block_skip = 0;
+    if (samples_this_block) {
+        block_skip = jump_into / samples_this_block;
+
+        /* last block may be smaller, let the layout handle it */
+        int32_t block_start = vgmstream->current_sample - vgmstream->samples_into_block + block_skip * samples_this_block;
+        if (vgmstream->interleave_last_block_size && block_start + samples_this_block > vgmstream->num_samples)
+            return samples;
+    }
+
+    int32_t jump_samples = jump_into - vgmstream->samples_into_block;
+    for (int ch = 0; ch < vgmstream->channels; ch++) {
+        VGMSTREAMCHANNEL* stream = &vgmstream->ch[ch];
+        stream->offset += block_skip * vgmstream->interleave_block_size * vgmstream->channels;
+        stream->adpcm_history1_16 = 0;
+        stream->adpcm_history2_16 = 0;
+        stream->adpcm_history1_32 = 0;
+        stream->adpcm_history2_32 = 0;
+    }
+    vgmstream->samples_into_block = jump_into - block_skip * samples_this_block;
+    vgmstream->current_sample += jump_samples;
+
+    //;VGM_LOG("SEEK: frame jump %i, preroll %i\n", jump_samples, samples - jump_samples);
+    return samples - jump_samples;
+}
+
+/* Blocked layouts move to an indexed block before target (see blocked.c), then pre-roll like above. */
+static int seek_block_jump(VGMSTREAM* vgmstream, int samples) {
+    if (vgmstream->codec_internal_updates)
+        return samples;
+
+    int samples_per_frame = decode_get_samples_per_frame(vgmstream);
+    if (samples_per_frame <= 0)
+        return samples;
+    int preroll_frames = get_seek_preroll_frames(vgmstream, samples_per_frame);
+    if (preroll_frames < 0)
+        return samples;
+
+    int32_t target_sample = vgmstream->current_sample + samples;
+    if (!can_jump(vgmstream, target_sample))
+        return samples;
+
+    int32_t block_sample = blocked_seek_block(vgmstream, target_sample - preroll_frames * samples_per_frame, vgmstream->current_sample);
+    if (block_sample < 0)
+        return samples;
+
+    //;VGM_LOG("SEEK: block jump to %i, preroll %i\n", block_sample, target_sample - block_sample);
+    return target_sample - block_sample;
+}
+
+/* Codecs with seek tables built before (seek cache, Wwise Vorbis only for now) can move to the closest entry
+ * + discard, which is mostly the same as decoding up to target. Tables from the file itself aren't used here
+ * so regular seeking doesn't change. Returns samples left to decode. */
+static int seek_table_jump(VGMSTREAM* vgmstream, int samples) {
+    if (vgmstream->layout_type != layout_none)
+        return samples;
+    if (!seek_table_is_cached(vgmstream))
+        return samples;
+
+    const codec_info_t* codec_info = codec_get_info(vgmstream);
+    if (!codec_info || !codec_info->seek || !codec_info->seekable || !codec_info->seekable(vgmstream))
+        return samples;
+
+    int32_t target_sample = vgmstream->current_sample + samples;
+    if (!can_jump(vgmstream, target_sample))
+        return samples;
+
+    decode_seek(vgmstream, target_sample);
+    vgmstream->current_sample = target_sample;
+    vgmstream->samples_into_block += samples;
+    //;VGM_LOG("SEEK: table jump to %i\n", target_sample);
+    return 0;
+}
+
 static void seek_force_render(VGMSTREAM* vgmstream, int samples) {
+    if (!samples)
+        return;
+
+    samples = seek_frame_jump(vgmstream, samples);
+    if (!samples)
+        return;
+    samples = seek_block_jump(vgmstream, samples);
+    if (!samples)
+        return;
+    samples = seek_table_jump(vgmstream, samples);
     if (!samples)
         return;
     //;VGM_LOG("SEEK: force render %i\n", samples);
 
-#if 0
-    // TODO: issues trim with loops enabled
-    // TODO: detect 'render' vs 'decode'
-    // use fast seek if possible
-    const codec_info_t* codec_info = codec_get_info(vgmstream);
-    if (/*!vgmstream->loop_flag &&*/ codec_info && codec_info->seekable(vgmstream)) {
-        // reset needed?
-        decode_seek(vgmstream, vgmstream->current_sample + samples);
-        vgmstream->current_sample = samples;
-        ;VGM_LOG("RENDER [trim]: codec seek\n");
+    if (!vgmstream_alloc_tmpbuf(vgmstream))
         return;
-    }
-#endif
 
     void* tmpbuf = vgmstream->tmpbuf;
     int buf_samples = vgmstream->tmpbuf_size / vgmstream->channels / sizeof(float); /* base decoder channels, no need to apply mixing */
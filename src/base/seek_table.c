@@ -1,16 +1,39 @@
+#include <stdio.h>
 #include "seek_table.h"
+#include "render.h"
+#include "sbuf.h"
+#include "mixing.h"
+#include "key_cache.h"
 #include "../util/log.h"
+#include "../util/reader_get.h"
+#include "../util/reader_put.h"
+#include "../util/threads.h"
+#include "../util/vgmstream_limits.h"
 
 #define GROWTH_FACTOR 2
 #define GROWTH_BASE 1024 //typical files have 1000~4000 frames
 
+#define SEEK_CACHE_VERSION  1
+#define SEEK_CACHE_HEADER_SIZE  0x20
+#define SEEK_CACHE_HASH_SIZE  0x1000
+#define SEEK_RECORD_INTERVAL  4096 // samples between recorded entries (Wwise uses similar-ish)
+
 struct seek_table_t {
     int count;
     int capacity;
     bool reset_decoder;
     seek_entry_t* entries;
+
+    // seek cache
+    bool cached;        // entries loaded from or built for the cache (only ones used for seek jumps)
+    bool recording;
+    bool has_key;
+    uint64_t file_key;
 };
 
+static vgm_mutex_t cache_mutex = VGM_MUTEX_INIT;
+static char cache_dir[PATH_LIMIT];
+
 
 static bool init_table(VGMSTREAM* v) {
     if (!v->seek_table) {
@@ -143,3 +166,237 @@ void seek_table_free(VGMSTREAM* v) {
     free(table->entries);
     free(table);
 }
+
+size_t seek_table_get_memory_size(VGMSTREAM* v) {
+    seek_table_t* table = v->seek_table;
+    if (!table)
+        return 0;
+    return sizeof(seek_table_t) + table->capacity * sizeof(seek_entry_t);
+}
+
+
+/* ************************************************************************* */
+
+void seek_table_set_cache_dir(const char* path) {
+    vgm_mutex_lock(&cache_mutex);
+    if (!path || strlen(path) + 0x30 >= sizeof(cache_dir)) // + key filename
+        cache_dir[0] = '\0';
+    else
+        snprintf(cache_dir, sizeof(cache_dir), "%s", path);
+    vgm_mutex_unlock(&cache_mutex);
+}
+
+static bool get_cache_filename(seek_table_t* table, int subsong, char* buf, int buf_size) {
+    vgm_mutex_lock(&cache_mutex);
+    bool enabled = cache_dir[0] != '\0';
+    if (enabled) {
+        int len = strlen(cache_dir);
+        const char* separator = (cache_dir[len - 1] == '/' || cache_dir[len - 1] == '\\') ? "" : "/";
+        snprintf(buf, buf_size, "%s%s%016llx_%i.vgmseek", cache_dir, separator, (unsigned long long)table->file_key, subsong);
+    }
+    vgm_mutex_unlock(&cache_mutex);
+
+    return enabled;
+}
+
+/* identifies file data (names may change): size + start/end */
+static uint64_t get_file_key(STREAMFILE* sf) {
+    uint8_t buf[SEEK_CACHE_HASH_SIZE];
+    uint64_t hash = KEY_CACHE_HASH_INIT;
+    uint64_t file_size = get_streamfile_size(sf);
+
+    put_u32le(buf + 0x00, (uint32_t)(file_size >> 0));
+    put_u32le(buf + 0x04, (uint32_t)(file_size >> 32));
+    hash = key_cache_hash(hash, buf, 0x08);
+
+    int bytes = read_streamfile(buf, 0, sizeof(buf), sf);
+    hash = key_cache_hash(hash, buf, bytes);
+
+    if (file_size > sizeof(buf)) {
+        bytes = read_streamfile(buf, file_size - sizeof(buf), sizeof(buf), sf);
+        hash = key_cache_hash(hash, buf, bytes);
+    }
+
+    return hash;
+}
+
+/* format (LE): id, version, file key, subsong, num_samples, flags, count, entries (sample + offset) */
+void seek_table_load_cache(VGMSTREAM* v, STREAMFILE* sf) {
+    char filename[PATH_LIMIT];
+    uint8_t header[SEEK_CACHE_HEADER_SIZE];
+    FILE* file = NULL;
+    seek_entry_t* entries = NULL;
+
+    if (!v || !sf)
+        return;
+
+    vgm_mutex_lock(&cache_mutex);
+    bool enabled = cache_dir[0] != '\0';
+    vgm_mutex_unlock(&cache_mutex);
+    if (!enabled)
+        return;
+
+    if (!init_table(v))
+        return;
+    seek_table_t* table = v->seek_table;
+
+    table->file_key = get_file_key(sf);
+    table->has_key = true;
+
+    if (!get_cache_filename(table, v->stream_index, filename, sizeof(filename)))
+        return;
+
+    file = fopen(filename, "rb");
+    if (!file)
+        return;
+
+    if (fread(header, 1, sizeof(header), file) != sizeof(header))
+        goto fail;
+    if (get_u32be(header + 0x00) != get_id32be("VSKT") || get_u32le(header + 0x04) != SEEK_CACHE_VERSION)
+        goto fail;
+    if (get_u64le(header + 0x08) != table->file_key || get_s32le(header + 0x14) != v->num_samples)
+        goto fail;
+
+    uint32_t flags = get_u32le(header + 0x18);
+    int count = get_s32le(header + 0x1c);
+    if (count <= 0 || count > v->num_samples)
+        goto fail;
+
+    entries = malloc(count * sizeof(seek_entry_t));
+    if (!entries)
+        goto fail;
+
+    for (int i = 0; i < count; i++) {
+        uint8_t entry[0x08];
+        if (fread(entry, 1, sizeof(entry), file) != sizeof(entry))
+            goto fail;
+        entries[i].sample = get_s32le(entry + 0x00);
+        entries[i].offset = get_u32le(entry + 0x04);
+        if (entries[i].sample < 0 || (i > 0 && entries[i].sample < entries[i - 1].sample))
+            goto fail;
+    }
+
+    /* replaces entries from the file itself (if any) */
+    free(table->entries);
+    table->entries = entries;
+    table->count = count;
+    table->capacity = count;
+    table->reset_decoder = (flags & 1);
+    table->cached = true;
+    fclose(file);
+    return;
+fail:
+    VGM_LOG("SEEK-TABLE: ignored bad cache file %s\n", filename);
+    free(entries);
+    fclose(file);
+}
+
+static bool save_cache(VGMSTREAM* v) {
+    char filename[PATH_LIMIT];
+    uint8_t header[SEEK_CACHE_HEADER_SIZE] = {0};
+    seek_table_t* table = v->seek_table;
+
+    if (!get_cache_filename(table, v->stream_index, filename, sizeof(filename)))
+        return false;
+
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+        return false;
+
+    put_u32be(header + 0x00, get_id32be("VSKT"));
+    put_u32le(header + 0x04, SEEK_CACHE_VERSION);
+    put_u32le(header + 0x08, (uint32_t)(table->file_key >> 0));
+    put_u32le(header + 0x0c, (uint32_t)(table->file_key >> 32));
+    put_s32le(header + 0x10, v->stream_index);
+    put_s32le(header + 0x14, v->num_samples);
+    put_u32le(header + 0x18, table->reset_decoder ? 1 : 0);
+    put_s32le(header + 0x1c, table->count);
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    for (int i = 0; i < table->count && ok; i++) {
+        uint8_t entry[0x08];
+        put_s32le(entry + 0x00, table->entries[i].sample);
+        put_u32le(entry + 0x04, table->entries[i].offset);
+        ok = fwrite(entry, 1, sizeof(entry), file) == sizeof(entry);
+    }
+
+    if (fclose(file) != 0)
+        ok = false;
+    if (!ok)
+        remove(filename);
+    return ok;
+}
+
+bool seek_table_build(VGMSTREAM* v) {
+    if (!v || !v->seek_table)
+        return false;
+    seek_table_t* table = v->seek_table;
+    if (!table->has_key)
+        return false;
+
+    /* already has one from cache */
+    if (table->cached)
+        return true;
+
+    if (!vgmstream_alloc_tmpbuf(v))
+        return false;
+
+    /* record into an empty table, keeping entries from the file to restore on failure */
+    seek_table_t file_table = *table;
+    table->entries = NULL;
+    table->count = 0;
+    table->capacity = 0;
+
+    int buf_samples = v->tmpbuf_size / v->channels / sizeof(float);
+    sbuf_t sbuf_tmp;
+    sbuf_init(&sbuf_tmp, mixing_get_input_sample_type(v), v->tmpbuf, buf_samples, v->channels);
+
+    /* decode once without loops, decoder records entries meanwhile */
+    int loop_flag = v->loop_flag;
+    reset_vgmstream(v);
+    v->loop_flag = 0;
+    table->recording = true;
+
+    int32_t samples = v->num_samples;
+    while (samples > 0) {
+        int to_do = samples;
+        if (to_do > buf_samples)
+            to_do = buf_samples;
+        sbuf_tmp.filled = 0;
+        sbuf_tmp.samples = to_do;
+        render_layout(&sbuf_tmp, v);
+        samples -= to_do;
+    }
+
+    table->recording = false;
+    v->loop_flag = loop_flag;
+    reset_vgmstream(v);
+
+    if (table->count == 0) {
+        free(table->entries);
+        table->entries = file_table.entries;
+        table->count = file_table.count;
+        table->capacity = file_table.capacity;
+        return false;
+    }
+
+    free(file_table.entries);
+    table->reset_decoder = true;
+    table->cached = true;
+    return save_cache(v);
+}
+
+void seek_table_record_entry(VGMSTREAM* v, int32_t sample, uint32_t offset) {
+    seek_table_t* table = v->seek_table;
+    if (!table || !table->recording)
+        return;
+
+    if (table->count > 0 && sample < table->entries[table->count - 1].sample + SEEK_RECORD_INTERVAL)
+        return;
+    seek_table_add_entry(v, sample, offset);
+}
+
+bool seek_table_is_cached(VGMSTREAM* v) {
+    seek_table_t* table = v->seek_table;
+    return table && table->cached && table->count > 0;
+}
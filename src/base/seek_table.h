@@ -39,5 +39,29 @@ bool seek_table_get_reset_decoder(VGMSTREAM* v);
 
 
 void seek_table_free(VGMSTREAM* vgmstream);
+size_t seek_table_get_memory_size(VGMSTREAM* vgmstream);
+
+
+/* Seek tables may also be built by decoding the whole stream once (for decoders that record entries,
+ * currently Wwise Vorbis only) and saved to a cache dir, keyed by file data and subsong, so they are
+ * loaded on next opens. Only these tables are used to jump when seeking. */
+
+/* Sets the seek table cache dir (NULL to disable). */
+void seek_table_set_cache_dir(const char* path);
+
+/* Loads a saved seek table for the file, if cache is enabled (called on open). */
+void seek_table_load_cache(VGMSTREAM* v, STREAMFILE* sf);
+
+/* Decodes the whole stream recording entries and saves them to the cache (v is reset after).
+ * Returns false if the codec doesn't record entries or table can't be saved. */
+bool seek_table_build(VGMSTREAM* v);
+
+/* For decoders: adds an entry while building tables (ignored otherwise).
+ * Entries mean "after resetting the decoder at offset, output starts at sample". */
+void seek_table_record_entry(VGMSTREAM* v, int32_t sample, uint32_t offset);
+
+/* Returns true if table entries were loaded from or built for the cache (tables from the file itself aren't
+ * used for seek jumps, as decoders handle those on their own). */
+bool seek_table_is_cached(VGMSTREAM* v);
 
 #endif
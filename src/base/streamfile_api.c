@@ -10,6 +10,7 @@ typedef struct {
 
     libstreamfile_t* libsf;
     bool external_libsf; //TODO: improve
+    STREAMFILE* inner_sf; /* when libsf is a default implementation */
 } API_STREAMFILE;
 
 static size_t api_read(API_STREAMFILE* sf, uint8_t* dst, offv_t offset, size_t length) {
@@ -18,6 +19,10 @@ static size_t api_read(API_STREAMFILE* sf, uint8_t* dst, offv_t offset, size_t l
     return sf->libsf->read(user_data, dst, offset, length);
 }
 
+static const uint8_t* api_read_span(API_STREAMFILE* sf, offv_t offset, size_t length, size_t* p_size) {
+    return sf->inner_sf->read_span(sf->inner_sf, offset, length, p_size);
+}
+
 static size_t api_get_size(API_STREAMFILE* sf) {
     void* user_data = sf->libsf->user_data;
 
@@ -82,6 +87,11 @@ static STREAMFILE* open_api_streamfile_internal(libstreamfile_t* libsf, bool ext
     this_sf->libsf = libsf;
     this_sf->external_libsf = external_libsf;
 
+    /* internal SFs may lend their buffer, while external libsf can only copy */
+    this_sf->inner_sf = libstreamfile_get_streamfile(libsf);
+    if (this_sf->inner_sf && this_sf->inner_sf->read_span)
+        this_sf->vt.read_span = (void*)api_read_span;
+
     return &this_sf->vt;
 }
 
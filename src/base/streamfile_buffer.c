@@ -84,6 +84,15 @@ static size_t buffer_read(BUFFER_STREAMFILE* sf, uint8_t* dst, offv_t offset, si
     return read_total;
 }
 
+static const uint8_t* buffer_read_span(BUFFER_STREAMFILE* sf, offv_t offset, size_t length, size_t* p_size) {
+    if (offset < sf->buf_offset || offset + length > sf->buf_offset + sf->valid_size)
+        return NULL; /* regular read will refill */
+
+    sf->offset = offset + length;
+    *p_size = sf->buf_offset + sf->valid_size - offset;
+    return sf->buf + (offset - sf->buf_offset);
+}
+
 static size_t buffer_get_size(BUFFER_STREAMFILE* sf) {
     return sf->file_size; /* cache */
 }
@@ -126,7 +135,9 @@ STREAMFILE* open_buffer_streamfile(STREAMFILE* sf, size_t buf_size) {
     this_sf->vt.get_name = (void*)buffer_get_name;
     this_sf->vt.open = (void*)buffer_open;
     this_sf->vt.close = (void*)buffer_close;
+    this_sf->vt.read_span = (void*)buffer_read_span;
     this_sf->vt.stream_index = sf->stream_index;
+    this_sf->vt.max_open_segments = sf->max_open_segments;
 
     this_sf->inner_sf = sf;
     this_sf->buf_size = buf_size;
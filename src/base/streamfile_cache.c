@@ -0,0 +1,339 @@
+#include "../streamfile.h"
+#include "../util/vgmstream_limits.h"
+#include "../util/log.h"
+#include "../util/threads.h"
+#include <limits.h>
+
+/* A STREAMFILE that keeps fixed-size pages of a file, shared by all SFs reopened from it (one per channel
+ * in some layouts). Channels often read close or overlapping data (blocked layouts, small-ish interleaves
+ * in many-channel files), and separate buffers would re-read the same parts of the file once per channel.
+ * Pages are evicted in LRU order once over the memory budget. */
+
+#define CACHE_PAGE_SIZE     STREAMFILE_DEFAULT_BUFFER_SIZE
+#define CACHE_MIN_PAGES     2
+#define CACHE_DEFAULT_SIZE  0x200000
+
+/* may be set while other threads open files (int is enough for a per-file budget) */
+static vgm_atomic_t cache_max_size = { CACHE_DEFAULT_SIZE };
+
+typedef struct {
+    uint8_t* data;
+    offv_t offset;          /* page start */
+    size_t valid_size;      /* less than page size at EOF */
+    uint32_t last_use;      /* LRU tick */
+    bool loading;           /* being read by some SF (data not ready, can't be evicted) */
+} cache_page_t;
+
+/* shared between SFs of the same file */
+typedef struct {
+    STREAMFILE* inner_sf;
+    size_t file_size;
+    int refs;
+    vgm_mutex_t lock;       /* for the fields below, only held for short periods */
+    vgm_event_t io_gate;    /* signaled when inner SF is free: waited before reading and set after */
+
+    cache_page_t* pages;
+    int pages_count;
+    int pages_max;
+    uint32_t tick;
+
+    int64_t inner_bytes;    /* read from inner SF */
+    int64_t served_bytes;   /* returned to callers */
+} cache_data_t;
+
+typedef struct {
+    STREAMFILE vt;
+
+    cache_data_t* cache;
+    offv_t offset;          /* last read offset (info) */
+} CACHE_STREAMFILE;
+
+static STREAMFILE* open_cache_streamfile_by_cache(cache_data_t* cache);
+
+
+static void free_cache(cache_data_t* cache) {
+    if (!cache) return;
+
+    for (int i = 0; i < cache->pages_count; i++) {
+        free(cache->pages[i].data);
+    }
+    free(cache->pages);
+    close_streamfile(cache->inner_sf);
+    vgm_mutex_free(&cache->lock);
+    vgm_event_free(&cache->io_gate);
+    free(cache);
+}
+
+static void release_cache(cache_data_t* cache) {
+    vgm_mutex_lock(&cache->lock);
+    int refs = --cache->refs;
+    vgm_mutex_unlock(&cache->lock);
+    if (refs > 0)
+        return;
+
+    free_cache(cache);
+}
+
+/* Waits until the current read of the inner SF is done (so a page marked as loading is ready or
+ * other pages can be reused). Called without the lock; the gate blocks rather than spinning. */
+static void wait_io(cache_data_t* cache) {
+    vgm_event_wait(&cache->io_gate);
+    vgm_event_set(&cache->io_gate);
+}
+
+/* Reads the page from the inner SF. Called with the lock, which is released during the read so other SFs
+ * may use ready pages meanwhile (the page is marked as loading). Reads are done one at a time. */
+static void load_page(cache_data_t* cache, cache_page_t* page, offv_t page_offset) {
+    page->offset = page_offset;
+    page->valid_size = 0;
+    page->loading = true;
+    vgm_mutex_unlock(&cache->lock);
+
+    vgm_event_wait(&cache->io_gate);
+    size_t bytes = read_streamfile(page->data, page_offset, CACHE_PAGE_SIZE, cache->inner_sf);
+
+    vgm_mutex_lock(&cache->lock);
+    page->valid_size = bytes;
+    page->loading = false;
+    cache->inner_bytes += bytes;
+    vgm_event_set(&cache->io_gate);
+}
+
+/* returns page with the offset (read from the inner SF if needed), or NULL on errors or if the page
+ * (or a free page) isn't ready yet, setting *p_busy; must hold the lock */
+static cache_page_t* get_page(cache_data_t* cache, offv_t offset, bool* p_busy) {
+    offv_t page_offset = offset - (offset % CACHE_PAGE_SIZE);
+    cache_page_t* page = NULL;
+
+    cache->tick++;
+
+    for (int i = 0; i < cache->pages_count; i++) {
+        if (cache->pages[i].offset == page_offset) {
+            page = &cache->pages[i];
+            if (page->loading) {
+                *p_busy = true;
+                return NULL;
+            }
+            page->last_use = cache->tick;
+            return page;
+        }
+    }
+
+    /* new page if allowed, otherwise reuse the least recently used one */
+    if (cache->pages_count < cache->pages_max) {
+        uint8_t* data = malloc(CACHE_PAGE_SIZE);
+        if (data) {
+            page = &cache->pages[cache->pages_count];
+            page->data = data;
+            cache->pages_count++;
+        }
+    }
+
+    if (!page) {
+        for (int i = 0; i < cache->pages_count; i++) {
+            if (cache->pages[i].loading)
+                continue;
+            if (!page || cache->pages[i].last_use < page->last_use)
+                page = &cache->pages[i];
+        }
+
+        if (!page) {
+            *p_busy = cache->pages_count > 0; /* all pages are loading */
+            return NULL;
+        }
+    }
+
+    load_page(cache, page, page_offset);
+    page->last_use = cache->tick;
+
+    return page;
+}
+
+static size_t cache_read(CACHE_STREAMFILE* sf, uint8_t* dst, offv_t offset, size_t length) {
+    cache_data_t* cache = sf->cache;
+    size_t read_total = 0;
+
+    if (!dst || length <= 0 || offset < 0)
+        return 0;
+
+    vgm_mutex_lock(&cache->lock);
+
+    while (length > 0) {
+        /* ignore requests at EOF */
+        if (offset >= cache->file_size) {
+            VGM_ASSERT_ONCE(offset > cache->file_size, "CACHE: reading over file_size 0x%x @ 0x%x + 0x%x\n", cache->file_size, (uint32_t)offset, length);
+            break;
+        }
+
+        bool busy = false;
+        cache_page_t* page = get_page(cache, offset, &busy);
+        if (busy) {
+            vgm_mutex_unlock(&cache->lock);
+            wait_io(cache);
+            vgm_mutex_lock(&cache->lock);
+            continue;
+        }
+        if (!page)
+            break;
+
+        size_t page_into = offset - page->offset;
+        if (page_into >= page->valid_size)
+            break; /* partial read (EOF) */
+
+        size_t to_copy = page->valid_size - page_into;
+        if (to_copy > length)
+            to_copy = length;
+
+        memcpy(dst, page->data + page_into, to_copy);
+        read_total += to_copy;
+        length -= to_copy;
+        offset += to_copy;
+        dst += to_copy;
+    }
+
+    cache->served_bytes += read_total;
+    vgm_mutex_unlock(&cache->lock);
+
+    sf->offset = offset; /* last read offset */
+    return read_total;
+}
+
+static size_t cache_get_size(CACHE_STREAMFILE* sf) {
+    return sf->cache->file_size;
+}
+
+static offv_t cache_get_offset(CACHE_STREAMFILE* sf) {
+    return sf->offset;
+}
+
+static void cache_get_name(CACHE_STREAMFILE* sf, char* name, size_t name_size) {
+    cache_data_t* cache = sf->cache;
+    cache->inner_sf->get_name(cache->inner_sf, name, name_size); /* default */
+}
+
+static STREAMFILE* cache_open(CACHE_STREAMFILE* sf, const char* const filename, size_t buf_size) {
+    cache_data_t* cache = sf->cache;
+    char name[PATH_LIMIT];
+
+    if (!filename)
+        return NULL;
+
+    /* same file: share the cache */
+    cache->inner_sf->get_name(cache->inner_sf, name, sizeof(name));
+    if (strcmp(name, filename) == 0) {
+        vgm_mutex_lock(&cache->lock);
+        cache->refs++;
+        vgm_mutex_unlock(&cache->lock);
+
+        STREAMFILE* new_sf = open_cache_streamfile_by_cache(cache);
+        if (!new_sf)
+            release_cache(cache);
+        return new_sf;
+    }
+
+    return cache->inner_sf->open(cache->inner_sf, filename, buf_size);
+}
+
+static void cache_close(CACHE_STREAMFILE* sf) {
+    release_cache(sf->cache);
+    free(sf);
+}
+
+static STREAMFILE* open_cache_streamfile_by_cache(cache_data_t* cache) {
+    CACHE_STREAMFILE* this_sf = calloc(1, sizeof(CACHE_STREAMFILE));
+    if (!this_sf) return NULL;
+
+    this_sf->vt.read = (void*)cache_read;
+    this_sf->vt.get_size = (void*)cache_get_size;
+    this_sf->vt.get_offset = (void*)cache_get_offset;
+    this_sf->vt.get_name = (void*)cache_get_name;
+    this_sf->vt.open = (void*)cache_open;
+    this_sf->vt.close = (void*)cache_close;
+    this_sf->vt.stream_index = cache->inner_sf->stream_index;
+    this_sf->vt.max_open_segments = cache->inner_sf->max_open_segments;
+
+    this_sf->cache = cache;
+
+    return &this_sf->vt;
+}
+
+STREAMFILE* open_cache_streamfile(STREAMFILE* sf, size_t max_size) {
+    cache_data_t* cache = NULL;
+    STREAMFILE* new_sf = NULL;
+
+    if (!sf) goto fail;
+
+    if (max_size == 0)
+        max_size = get_cache_streamfile_max_size();
+
+    cache = calloc(1, sizeof(cache_data_t));
+    if (!cache) goto fail;
+
+    if (!vgm_mutex_init(&cache->lock)) {
+        free(cache);
+        cache = NULL;
+        goto fail;
+    }
+    if (!vgm_event_init(&cache->io_gate)) {
+        vgm_mutex_free(&cache->lock);
+        free(cache);
+        cache = NULL;
+        goto fail;
+    }
+    vgm_event_set(&cache->io_gate); /* inner SF starts free */
+
+    cache->inner_sf = sf;
+    cache->file_size = get_streamfile_size(sf);
+    cache->refs = 1;
+
+    cache->pages_max = max_size / CACHE_PAGE_SIZE;
+    if (cache->pages_max < CACHE_MIN_PAGES)
+        cache->pages_max = CACHE_MIN_PAGES;
+    /* no need for more pages than the file has */
+    if (cache->pages_max > cache->file_size / CACHE_PAGE_SIZE + 1)
+        cache->pages_max = cache->file_size / CACHE_PAGE_SIZE + 1;
+
+    cache->pages = calloc(cache->pages_max, sizeof(cache_page_t));
+    if (!cache->pages) goto fail;
+
+    new_sf = open_cache_streamfile_by_cache(cache);
+    if (!new_sf) goto fail;
+
+    return new_sf;
+
+fail:
+    if (cache) {
+        cache->inner_sf = NULL; /* not closed here */
+        free_cache(cache);
+    }
+    return NULL;
+}
+
+STREAMFILE* open_cache_streamfile_f(STREAMFILE* sf, size_t max_size) {
+    STREAMFILE* new_sf = open_cache_streamfile(sf, max_size);
+    if (!new_sf)
+        close_streamfile(sf);
+    return new_sf;
+}
+
+void set_cache_streamfile_max_size(size_t max_size) {
+    if (max_size > INT_MAX)
+        max_size = INT_MAX;
+    vgm_atomic_set(&cache_max_size, (int)max_size);
+}
+
+size_t get_cache_streamfile_max_size(void) {
+    return vgm_atomic_get(&cache_max_size);
+}
+
+bool get_cache_streamfile_stats(STREAMFILE* sf, int64_t* p_inner_bytes, int64_t* p_served_bytes) {
+    if (!sf || sf->read != (void*)cache_read)
+        return false;
+
+    cache_data_t* cache = ((CACHE_STREAMFILE*)sf)->cache;
+    vgm_mutex_lock(&cache->lock);
+    *p_inner_bytes = cache->inner_bytes;
+    *p_served_bytes = cache->served_bytes;
+    vgm_mutex_unlock(&cache->lock);
+    return true;
+}
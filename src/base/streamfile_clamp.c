@@ -23,6 +23,16 @@ static size_t clamp_read(CLAMP_STREAMFILE* sf, uint8_t* dst, offv_t offset, size
     return sf->inner_sf->read(sf->inner_sf, dst, inner_offset, clamp_length);
 }
 
+static const uint8_t* clamp_read_span(CLAMP_STREAMFILE* sf, offv_t offset, size_t length, size_t* p_size) {
+    if (!sf->inner_sf->read_span || offset < 0 || offset + length > sf->size)
+        return NULL;
+
+    const uint8_t* span = sf->inner_sf->read_span(sf->inner_sf, sf->start + offset, length, p_size);
+    if (span && *p_size > sf->size - offset)
+        *p_size = sf->size - offset;
+    return span;
+}
+
 static size_t clamp_get_size(CLAMP_STREAMFILE* sf) {
     return sf->size;
 }
@@ -72,7 +82,9 @@ STREAMFILE* open_clamp_streamfile(STREAMFILE* sf, offv_t start, size_t size) {
     this_sf->vt.get_name = (void*)clamp_get_name;
     this_sf->vt.open = (void*)clamp_open;
     this_sf->vt.close = (void*)clamp_close;
+    this_sf->vt.read_span = (void*)clamp_read_span;
     this_sf->vt.stream_index = sf->stream_index;
+    this_sf->vt.max_open_segments = sf->max_open_segments;
 
     this_sf->inner_sf = sf;
     this_sf->start = start;
@@ -0,0 +1,257 @@
+#include "../streamfile.h"
+#include "../util/vgmstream_limits.h"
+#include "../util/log.h"
+#include "../util/threads.h"
+
+/* A STREAMFILE that reads from a memory-mapped file. Reopening the same file (as done for each channel)
+ * shares the mapping, so there are no per-SF buffers nor file reads, just copies from the mapped pages
+ * (the OS handles caching/read-ahead). Files that can't be mapped (pipes, virtual files, 32-bit
+ * address space limits, etc) use regular stdio instead.
+ *
+ * Only for trusted local files that won't change while open, so it's opt-in (never used by default):
+ * on POSIX, reading pages past the end of a file truncated after mapping raises SIGBUS, and the library
+ * can't detect that or recover (size checks would still race with the truncation). Windows doesn't allow
+ * truncating mapped files. */
+
+#if defined(_WIN32) || defined(WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #define USE_MMAP_WIN32
+#elif !defined(__EMSCRIPTEN__)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #define USE_MMAP_POSIX
+#endif
+
+#if defined(USE_MMAP_WIN32) || defined(USE_MMAP_POSIX)
+
+/* shared between SFs of the same file */
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    int refs;
+#ifdef USE_MMAP_WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} mmap_data_t;
+
+typedef struct {
+    STREAMFILE vt;
+
+    mmap_data_t* map;
+    char name[PATH_LIMIT];
+    int name_len;
+    offv_t offset;          /* last read offset (info) */
+} MMAP_STREAMFILE;
+
+static vgm_mutex_t refs_mutex = VGM_MUTEX_INIT;
+
+static STREAMFILE* open_mmap_streamfile_by_map(mmap_data_t* map, const char* filename);
+
+
+static mmap_data_t* map_file(const char* filename) {
+    mmap_data_t* map = calloc(1, sizeof(mmap_data_t));
+    if (!map) return NULL;
+
+#ifdef USE_MMAP_WIN32
+    HANDLE file;
+  #ifdef VGM_STDIO_UNICODE
+    wchar_t wpath[PATH_LIMIT];
+    if (MultiByteToWideChar(CP_UTF8, 0, filename, -1, wpath, PATH_LIMIT) <= 0)
+        goto fail;
+    file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  #else
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  #endif
+    if (file == INVALID_HANDLE_VALUE)
+        goto fail;
+    map->file = file;
+
+    if (GetFileType(file) != FILE_TYPE_DISK)
+        goto fail;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 || (uint64_t)size.QuadPart > (size_t)-1)
+        goto fail;
+    map->size = (size_t)size.QuadPart;
+
+    map->mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!map->mapping)
+        goto fail;
+
+    map->data = MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!map->data)
+        goto fail;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        goto fail;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 || (uint64_t)st.st_size > (size_t)-1) {
+        close(fd);
+        goto fail;
+    }
+    map->size = (size_t)st.st_size;
+
+    void* data = mmap(NULL, map->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); /* mapping stays valid */
+    if (data == MAP_FAILED)
+        goto fail;
+    map->data = data;
+#endif
+
+    map->refs = 1;
+    return map;
+fail:
+#ifdef USE_MMAP_WIN32
+    if (map->mapping) CloseHandle(map->mapping);
+    if (map->file && map->file != INVALID_HANDLE_VALUE) CloseHandle(map->file);
+#endif
+    free(map);
+    return NULL;
+}
+
+static void unmap_file(mmap_data_t* map) {
+    if (!map) return;
+
+    vgm_mutex_lock(&refs_mutex);
+    int refs = --map->refs;
+    vgm_mutex_unlock(&refs_mutex);
+    if (refs > 0)
+        return;
+
+#ifdef USE_MMAP_WIN32
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+#else
+    munmap((void*)map->data, map->size);
+#endif
+    free(map);
+}
+
+
+static size_t mmap_read(MMAP_STREAMFILE* sf, uint8_t* dst, offv_t offset, size_t length) {
+    if (!dst || length <= 0 || offset < 0)
+        return 0;
+
+    /* ignore requests at EOF */
+    if (offset >= sf->map->size) {
+        VGM_ASSERT_ONCE(offset > sf->map->size, "MMAP: reading over file_size 0x%x @ 0x%x + 0x%x\n", sf->map->size, (uint32_t)offset, length);
+        return 0;
+    }
+
+    if (length > sf->map->size - offset)
+        length = sf->map->size - offset;
+
+    memcpy(dst, sf->map->data + offset, length);
+    sf->offset = offset + length;
+    return length;
+}
+
+static const uint8_t* mmap_read_span(MMAP_STREAMFILE* sf, offv_t offset, size_t length, size_t* p_size) {
+    if (offset < 0 || offset + length > sf->map->size)
+        return NULL;
+
+    sf->offset = offset + length;
+    *p_size = sf->map->size - offset;
+    return sf->map->data + offset;
+}
+
+static size_t mmap_get_size(MMAP_STREAMFILE* sf) {
+    return sf->map->size;
+}
+
+static offv_t mmap_get_offset(MMAP_STREAMFILE* sf) {
+    return sf->offset;
+}
+
+static void mmap_get_name(MMAP_STREAMFILE* sf, char* name, size_t name_size) {
+    int copy_size = sf->name_len + 1;
+    if (copy_size > name_size)
+        copy_size = name_size;
+
+    memcpy(name, sf->name, copy_size);
+    name[copy_size - 1] = '\0';
+}
+
+static STREAMFILE* mmap_open(MMAP_STREAMFILE* sf, const char* const filename, size_t buf_size) {
+    if (!filename)
+        return NULL;
+
+    /* same file: share the mapping */
+    if (!strcmp(sf->name, filename)) {
+        vgm_mutex_lock(&refs_mutex);
+        sf->map->refs++;
+        vgm_mutex_unlock(&refs_mutex);
+
+        STREAMFILE* new_sf = open_mmap_streamfile_by_map(sf->map, filename);
+        if (!new_sf)
+            unmap_file(sf->map);
+        return new_sf;
+    }
+
+    return open_mmap_streamfile(filename);
+}
+
+static void mmap_close(MMAP_STREAMFILE* sf) {
+    unmap_file(sf->map);
+    free(sf);
+}
+
+static STREAMFILE* open_mmap_streamfile_by_map(mmap_data_t* map, const char* filename) {
+    MMAP_STREAMFILE* this_sf = calloc(1, sizeof(MMAP_STREAMFILE));
+    if (!this_sf) return NULL;
+
+    this_sf->vt.read = (void*)mmap_read;
+    this_sf->vt.get_size = (void*)mmap_get_size;
+    this_sf->vt.get_offset = (void*)mmap_get_offset;
+    this_sf->vt.get_name = (void*)mmap_get_name;
+    this_sf->vt.open = (void*)mmap_open;
+    this_sf->vt.close = (void*)mmap_close;
+    this_sf->vt.read_span = (void*)mmap_read_span;
+
+    this_sf->map = map;
+
+    this_sf->name_len = strlen(filename);
+    if (this_sf->name_len >= sizeof(this_sf->name)) {
+        free(this_sf);
+        return NULL;
+    }
+    memcpy(this_sf->name, filename, this_sf->name_len);
+    this_sf->name[this_sf->name_len] = '\0';
+
+    return &this_sf->vt;
+}
+
+STREAMFILE* open_mmap_streamfile(const char* filename) {
+    if (!filename)
+        return NULL;
+    if (strlen(filename) >= PATH_LIMIT)
+        return NULL;
+
+    mmap_data_t* map = map_file(filename);
+    if (!map) {
+        //;VGM_LOG("MMAP: can't map %s, using stdio\n", filename);
+        return open_stdio_streamfile(filename);
+    }
+
+    STREAMFILE* sf = open_mmap_streamfile_by_map(map, filename);
+    if (!sf) {
+        unmap_file(map);
+        return NULL;
+    }
+    return sf;
+}
+
+#else
+
+STREAMFILE* open_mmap_streamfile(const char* filename) {
+    return open_stdio_streamfile(filename);
+}
+
+#endif
@@ -0,0 +1,134 @@
+#include "../streamfile.h"
+
+/* STREAMFILE used while detecting formats, that keeps the start and end of the file in memory.
+ * Parsers mostly peek at headers (and sometimes footers), so with this most of their reads don't
+ * reach the base SF, whose buffer would otherwise be refilled when jumping between both ends. */
+
+#define PROBE_DEFAULT_CACHE_SIZE 0x8000
+
+typedef struct {
+    STREAMFILE vt;
+
+    STREAMFILE* inner_sf;
+    size_t file_size;       /* cached */
+
+    uint8_t* head;          /* file start */
+    size_t head_size;
+    uint8_t* tail;          /* file end (may be NULL if head has the whole file) */
+    offv_t tail_offset;
+    size_t tail_size;
+
+    int inner_reads;        /* reads that reached inner_sf (info) */
+} PROBE_STREAMFILE;
+
+
+static size_t probe_read(PROBE_STREAMFILE* sf, uint8_t* dst, offv_t offset, size_t length) {
+    if (!dst || length <= 0 || offset < 0)
+        return 0;
+
+    if (offset + length <= sf->head_size) {
+        memcpy(dst, sf->head + offset, length);
+        return length;
+    }
+
+    if (sf->tail && offset >= sf->tail_offset && offset + length <= sf->tail_offset + sf->tail_size) {
+        memcpy(dst, sf->tail + (offset - sf->tail_offset), length);
+        return length;
+    }
+
+    /* in the middle or past EOF: let inner_sf handle it as usual */
+    sf->inner_reads++;
+    return sf->inner_sf->read(sf->inner_sf, dst, offset, length);
+}
+
+static size_t probe_get_size(PROBE_STREAMFILE* sf) {
+    return sf->file_size;
+}
+
+static offv_t probe_get_offset(PROBE_STREAMFILE* sf) {
+    return sf->inner_sf->get_offset(sf->inner_sf); /* default */
+}
+
+static void probe_get_name(PROBE_STREAMFILE* sf, char* name, size_t name_size) {
+    sf->inner_sf->get_name(sf->inner_sf, name, name_size); /* default */
+}
+
+static STREAMFILE* probe_open(PROBE_STREAMFILE* sf, const char* const filename, size_t buf_size) {
+    /* reopened SFs are used to decode, no need to cache */
+    return sf->inner_sf->open(sf->inner_sf, filename, buf_size);
+}
+
+static void probe_close(PROBE_STREAMFILE* sf) {
+    //sf->inner_sf->close(sf->inner_sf); /* don't close, detection's caller owns it */
+    free(sf->head);
+    free(sf->tail);
+    free(sf);
+}
+
+
+STREAMFILE* open_probe_streamfile(STREAMFILE* sf, size_t cache_size) {
+    PROBE_STREAMFILE* this_sf = NULL;
+
+    if (!sf) return NULL;
+
+    if (cache_size == 0)
+        cache_size = PROBE_DEFAULT_CACHE_SIZE;
+
+    this_sf = calloc(1, sizeof(PROBE_STREAMFILE));
+    if (!this_sf) goto fail;
+
+    /* set callbacks and internals */
+    this_sf->vt.read = (void*)probe_read;
+    this_sf->vt.get_size = (void*)probe_get_size;
+    this_sf->vt.get_offset = (void*)probe_get_offset;
+    this_sf->vt.get_name = (void*)probe_get_name;
+    this_sf->vt.open = (void*)probe_open;
+    this_sf->vt.close = (void*)probe_close;
+    this_sf->vt.stream_index = sf->stream_index;
+    this_sf->vt.max_open_segments = sf->max_open_segments;
+
+    this_sf->inner_sf = sf;
+    this_sf->file_size = sf->get_size(sf);
+
+    /* small files are loaded fully into head */
+    {
+        size_t head_size = this_sf->file_size;
+        if (head_size > cache_size * 2)
+            head_size = cache_size;
+
+        this_sf->head = malloc(head_size + 1); /* +1 to allow 0-size files */
+        if (!this_sf->head) goto fail;
+
+        this_sf->inner_reads++;
+        this_sf->head_size = sf->read(sf, this_sf->head, 0x00, head_size);
+    }
+
+    if (this_sf->head_size < this_sf->file_size) {
+        size_t tail_size = cache_size;
+        offv_t tail_offset = this_sf->file_size - tail_size;
+
+        this_sf->tail = malloc(tail_size);
+        if (!this_sf->tail) goto fail;
+
+        this_sf->inner_reads++;
+        this_sf->tail_offset = tail_offset;
+        this_sf->tail_size = sf->read(sf, this_sf->tail, tail_offset, tail_size);
+    }
+
+    return &this_sf->vt;
+
+fail:
+    if (this_sf) {
+        free(this_sf->head);
+        free(this_sf->tail);
+    }
+    free(this_sf);
+    return NULL;
+}
+
+int get_probe_streamfile_reads(STREAMFILE* sf) {
+    PROBE_STREAMFILE* this_sf = (PROBE_STREAMFILE*)sf;
+    if (!sf)
+        return 0;
+    return this_sf->inner_reads;
+}
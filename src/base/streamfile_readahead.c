@@ -0,0 +1,249 @@
+#include "../streamfile.h"
+#include "../util/log.h"
+#include "../util/threads.h"
+
+/* A STREAMFILE that reads the next window of data in a background thread while the current one is used,
+ * once reads look sequential (a window starts where the previous one ended). Meant for slow IO like
+ * network storage, where each synchronous refill stalls decoding. Non-sequential reads (seeks, jumping
+ * between headers) are done synchronously as usual, and threads are only started when needed. */
+
+#define READAHEAD_MIN_SIZE  STREAMFILE_DEFAULT_BUFFER_SIZE
+
+typedef struct {
+    STREAMFILE vt;
+
+    STREAMFILE* inner_sf;
+    offv_t offset;          /* last read offset (info) */
+    size_t file_size;
+    size_t buf_size;        /* window size */
+
+    /* current window */
+    uint8_t* buf;
+    offv_t buf_offset;
+    size_t valid_size;
+
+    /* next window, filled by the worker */
+    uint8_t* next_buf;
+    offv_t next_offset;
+    size_t next_valid_size;
+    bool next_pending;      /* requested, worker may be using inner_sf (wait for done before anything else) */
+    bool next_ready;
+
+    vgm_thread_t thread;
+    vgm_event_t wake;
+    vgm_event_t done;
+    bool thread_started;
+    bool thread_failed;
+    bool quit;
+} READAHEAD_STREAMFILE;
+
+
+static void readahead_worker(void* arg) {
+    READAHEAD_STREAMFILE* sf = arg;
+
+    while (true) {
+        vgm_event_wait(&sf->wake);
+        if (sf->quit)
+            break;
+
+        sf->next_valid_size = read_streamfile(sf->next_buf, sf->next_offset, sf->buf_size, sf->inner_sf);
+        vgm_event_set(&sf->done);
+    }
+}
+
+static bool start_thread(READAHEAD_STREAMFILE* sf) {
+    if (sf->thread_started)
+        return true;
+    if (sf->thread_failed)
+        return false;
+
+    sf->thread_failed = true;
+    sf->next_buf = malloc(sf->buf_size);
+    if (!sf->next_buf)
+        return false;
+    if (!vgm_event_init(&sf->wake))
+        return false;
+    if (!vgm_event_init(&sf->done)) {
+        vgm_event_free(&sf->wake);
+        return false;
+    }
+    if (!vgm_thread_start(&sf->thread, readahead_worker, sf)) {
+        vgm_event_free(&sf->wake);
+        vgm_event_free(&sf->done);
+        return false;
+    }
+
+    sf->thread_failed = false;
+    sf->thread_started = true;
+    return true;
+}
+
+/* makes sure the worker isn't using inner_sf or next_buf */
+static void wait_pending(READAHEAD_STREAMFILE* sf) {
+    if (!sf->next_pending)
+        return;
+    vgm_event_wait(&sf->done);
+    sf->next_pending = false;
+    sf->next_ready = true;
+}
+
+static void request_next(READAHEAD_STREAMFILE* sf) {
+    offv_t next_offset = sf->buf_offset + sf->valid_size;
+    if (sf->valid_size < sf->buf_size || next_offset >= sf->file_size)
+        return; /* EOF */
+    if (!start_thread(sf))
+        return;
+
+    sf->next_offset = next_offset;
+    sf->next_ready = false;
+    sf->next_pending = true;
+    vgm_event_set(&sf->wake);
+}
+
+/* loads the window with offset into buf, from the prefetched one if possible */
+static void load_window(READAHEAD_STREAMFILE* sf, offv_t offset) {
+    bool is_sequential = sf->valid_size > 0 && offset >= sf->buf_offset + sf->valid_size
+            && offset < sf->buf_offset + sf->valid_size + sf->buf_size;
+
+    wait_pending(sf);
+
+    if (sf->next_ready && offset >= sf->next_offset && offset < sf->next_offset + sf->next_valid_size) {
+        uint8_t* buf = sf->buf;
+        sf->buf = sf->next_buf;
+        sf->next_buf = buf;
+        sf->buf_offset = sf->next_offset;
+        sf->valid_size = sf->next_valid_size;
+    }
+    else {
+        sf->buf_offset = offset;
+        sf->valid_size = read_streamfile(sf->buf, offset, sf->buf_size, sf->inner_sf);
+    }
+    sf->next_ready = false;
+
+    if (is_sequential)
+        request_next(sf);
+}
+
+static size_t readahead_read(READAHEAD_STREAMFILE* sf, uint8_t* dst, offv_t offset, size_t length) {
+    size_t read_total = 0;
+
+    if (!dst || length <= 0 || offset < 0)
+        return 0;
+
+    while (length > 0) {
+        /* ignore requests at EOF */
+        if (offset >= sf->file_size) {
+            VGM_ASSERT_ONCE(offset > sf->file_size, "READAHEAD: reading over file_size 0x%x @ 0x%x + 0x%x\n", sf->file_size, (uint32_t)offset, length);
+            break;
+        }
+
+        if (offset < sf->buf_offset || offset >= sf->buf_offset + sf->valid_size) {
+            load_window(sf, offset);
+            if (offset >= sf->buf_offset + sf->valid_size)
+                break; /* partial read (EOF) */
+        }
+
+        size_t buf_into = offset - sf->buf_offset;
+        size_t to_copy = sf->valid_size - buf_into;
+        if (to_copy > length)
+            to_copy = length;
+
+        memcpy(dst, sf->buf + buf_into, to_copy);
+        read_total += to_copy;
+        length -= to_copy;
+        offset += to_copy;
+        dst += to_copy;
+    }
+
+    sf->offset = offset; /* last read offset */
+    return read_total;
+}
+
+static const uint8_t* readahead_read_span(READAHEAD_STREAMFILE* sf, offv_t offset, size_t length, size_t* p_size) {
+    if (offset < sf->buf_offset || offset + length > sf->buf_offset + sf->valid_size)
+        return NULL; /* regular read will load the window */
+
+    sf->offset = offset + length;
+    *p_size = sf->buf_offset + sf->valid_size - offset;
+    return sf->buf + (offset - sf->buf_offset);
+}
+
+static size_t readahead_get_size(READAHEAD_STREAMFILE* sf) {
+    return sf->file_size;
+}
+
+static offv_t readahead_get_offset(READAHEAD_STREAMFILE* sf) {
+    return sf->offset;
+}
+
+static void readahead_get_name(READAHEAD_STREAMFILE* sf, char* name, size_t name_size) {
+    wait_pending(sf); /* inner SF may not be thread-safe */
+    sf->inner_sf->get_name(sf->inner_sf, name, name_size); /* default */
+}
+
+static STREAMFILE* readahead_open(READAHEAD_STREAMFILE* sf, const char* const filename, size_t buf_size) {
+    wait_pending(sf);
+    STREAMFILE* new_inner_sf = sf->inner_sf->open(sf->inner_sf, filename, buf_size);
+    return open_readahead_streamfile_f(new_inner_sf, sf->buf_size);
+}
+
+static void readahead_close(READAHEAD_STREAMFILE* sf) {
+    if (sf->thread_started) {
+        wait_pending(sf);
+        sf->quit = true;
+        vgm_event_set(&sf->wake);
+        vgm_thread_join(&sf->thread);
+        vgm_event_free(&sf->wake);
+        vgm_event_free(&sf->done);
+    }
+
+    sf->inner_sf->close(sf->inner_sf);
+    free(sf->buf);
+    free(sf->next_buf);
+    free(sf);
+}
+
+
+STREAMFILE* open_readahead_streamfile(STREAMFILE* sf, size_t buf_size) {
+    READAHEAD_STREAMFILE* this_sf = NULL;
+
+    if (!sf) goto fail;
+
+    if (buf_size < READAHEAD_MIN_SIZE)
+        buf_size = READAHEAD_MIN_SIZE;
+
+    this_sf = calloc(1, sizeof(READAHEAD_STREAMFILE));
+    if (!this_sf) goto fail;
+
+    /* set callbacks and internals */
+    this_sf->vt.read = (void*)readahead_read;
+    this_sf->vt.read_span = (void*)readahead_read_span;
+    this_sf->vt.get_size = (void*)readahead_get_size;
+    this_sf->vt.get_offset = (void*)readahead_get_offset;
+    this_sf->vt.get_name = (void*)readahead_get_name;
+    this_sf->vt.open = (void*)readahead_open;
+    this_sf->vt.close = (void*)readahead_close;
+    this_sf->vt.stream_index = sf->stream_index;
+    this_sf->vt.max_open_segments = sf->max_open_segments;
+
+    this_sf->inner_sf = sf;
+    this_sf->buf_size = buf_size;
+    this_sf->buf = malloc(buf_size);
+    if (!this_sf->buf) goto fail;
+
+    this_sf->file_size = sf->get_size(sf);
+
+    return &this_sf->vt;
+
+fail:
+    if (this_sf) free(this_sf->buf);
+    free(this_sf);
+    return NULL;
+}
+
+STREAMFILE* open_readahead_streamfile_f(STREAMFILE* sf, size_t buf_size) {
+    STREAMFILE* new_sf = open_readahead_streamfile(sf, buf_size);
+    if (!new_sf)
+        close_streamfile(sf);
+    return new_sf;
+}
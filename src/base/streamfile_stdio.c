@@ -20,9 +20,17 @@
  *
  * Keep it for other systems since this is (probably) kinda useful, though a more sensible approach would be
  * redoing SF/FILE/buffer handling to avoid re-opening as much. */
-#if !defined (_MSC_VER) && !defined (__ANDROID__) && !defined (__APPLE__)
+#if !defined (_MSC_VER) && !defined (__ANDROID__) && !defined (__APPLE__) && !defined(_WIN32)
     #define USE_STDIO_FDUP 1
 #endif
+
+/* Dupe'd FILEs also share the file position, so reading SFs of the same file from different threads
+ * (parallel layers, read-ahead, TXTP opens) could fseek+fread at the wrong place. Positioned reads avoid that.
+ * Windows (MinGW) has no pread, so FDUP is disabled there too and each SF gets its own FILE. */
+#if defined(USE_STDIO_FDUP)
+    #define USE_STDIO_PREAD 1
+    #include <errno.h>
+#endif
  
 /* For (rarely needed) +2GB file support we use fseek64/ftell64. Those are usually available
  * but may depend on compiler.
@@ -102,6 +110,30 @@ typedef struct {
 static STREAMFILE* open_stdio_streamfile_buffer(const char* const filename, size_t buf_size);
 static STREAMFILE* open_stdio_streamfile_buffer_by_file(FILE *infile, const char* const filename, size_t buf_size);
 
+#ifdef USE_STDIO_PREAD
+static size_t pread_full(FILE* infile, uint8_t* buf, size_t size, offv_t offset) {
+    int fd = fileno(infile);
+    size_t total = 0;
+
+    /* pread may return less than requested (signals, network filesystems) */
+    while (total < size) {
+        /* off_t may be 32-bit (32-bit systems without _FILE_OFFSET_BITS=64), same limit as fseeko */
+        offv_t pos = offset + total;
+        if ((off_t)pos != pos)
+            break;
+
+        ssize_t bytes = pread(fd, buf + total, size - total, pos);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes <= 0)
+            break;
+        total += bytes;
+    }
+
+    return total;
+}
+#endif
+
 static size_t stdio_read(STDIO_STREAMFILE* sf, uint8_t* dst, offv_t offset, size_t length) {
     size_t read_total = 0;
 
@@ -160,6 +192,11 @@ static size_t stdio_read(STDIO_STREAMFILE* sf, uint8_t* dst, offv_t offset, size
             break;
         }
 
+#ifdef USE_STDIO_PREAD
+        /* fill the buffer (offset now is beyond buf_offset) */
+        sf->buf_offset = offset;
+        sf->valid_size = pread_full(sf->infile, sf->buf, sf->buf_size, offset);
+#else
         /* position to new offset */
         if (fseek_v(sf->infile, offset, SEEK_SET)) {
             break; /* this shouldn't happen in our code */
@@ -173,6 +210,7 @@ static size_t stdio_read(STDIO_STREAMFILE* sf, uint8_t* dst, offv_t offset, size
         /* fill the buffer (offset now is beyond buf_offset) */
         sf->buf_offset = offset;
         sf->valid_size = fread(sf->buf, sizeof(uint8_t), sf->buf_size, sf->infile);
+#endif
         //;VGM_LOG("stdio: read buf %lx + %x\n", sf->buf_offset, sf->valid_size);
 
         /* decide how much must be read this time */
@@ -202,6 +240,15 @@ static size_t stdio_read(STDIO_STREAMFILE* sf, uint8_t* dst, offv_t offset, size
 #endif
 }
 
+static const uint8_t* stdio_read_span(STDIO_STREAMFILE* sf, offv_t offset, size_t length, size_t* p_size) {
+    if (offset < sf->buf_offset || offset + length > sf->buf_offset + sf->valid_size)
+        return NULL; /* regular read will refill */
+
+    sf->offset = offset + length;
+    *p_size = sf->buf_offset + sf->valid_size - offset;
+    return sf->buf + (offset - sf->buf_offset);
+}
+
 static size_t stdio_get_size(STDIO_STREAMFILE* sf) {
     return sf->file_size;
 }
@@ -274,6 +321,7 @@ static STREAMFILE* open_stdio_streamfile_buffer_by_file(FILE* infile, const char
     this_sf->vt.get_name = (void*)stdio_get_name;
     this_sf->vt.open = (void*)stdio_open;
     this_sf->vt.close = (void*)stdio_close;
+    this_sf->vt.read_span = (void*)stdio_read_span;
 
     this_sf->infile = infile;
     this_sf->buf_size = buf_size;
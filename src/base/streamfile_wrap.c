@@ -13,6 +13,11 @@ typedef struct {
 static size_t wrap_read(WRAP_STREAMFILE* sf, uint8_t* dst, offv_t offset, size_t length) {
     return sf->inner_sf->read(sf->inner_sf, dst, offset, length); /* default */
 }
+static const uint8_t* wrap_read_span(WRAP_STREAMFILE* sf, offv_t offset, size_t length, size_t* p_size) {
+    if (!sf->inner_sf->read_span)
+        return NULL;
+    return sf->inner_sf->read_span(sf->inner_sf, offset, length, p_size); /* default */
+}
 static size_t wrap_get_size(WRAP_STREAMFILE* sf) {
     return sf->inner_sf->get_size(sf->inner_sf); /* default */
 }
@@ -47,7 +52,9 @@ STREAMFILE* open_wrap_streamfile(STREAMFILE* sf) {
     this_sf->vt.get_name = (void*)wrap_get_name;
     this_sf->vt.open = (void*)wrap_open;
     this_sf->vt.close = (void*)wrap_close;
+    this_sf->vt.read_span = (void*)wrap_read_span;
     this_sf->vt.stream_index = sf->stream_index;
+    this_sf->vt.max_open_segments = sf->max_open_segments;
 
     this_sf->inner_sf = sf;
 
@@ -56,6 +56,7 @@ int xbox_check_format(STREAMFILE* sf, uint32_t offset, uint32_t max, int channel
 
 /* ngc_dsp_decoder */
 void decode_ngc_dsp(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do);
+void decode_ngc_dsp_mc(VGMSTREAM* v, sample_t* outbuf, int32_t first_sample, int32_t samples_to_do);
 void decode_ngc_dsp_subint(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel, int interleave);
 size_t dsp_bytes_to_samples(size_t bytes, int channels);
 int32_t dsp_nibbles_to_samples(int32_t nibbles);
@@ -105,6 +106,7 @@ void decode_alaw(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing,
 
 /* psx_decoder */
 void decode_psx(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int is_badflags, int config);
+void decode_psx_mc(VGMSTREAM* v, sample_t* outbuf, int32_t first_sample, int32_t samples_to_do, int is_badflags, int config);
 void decode_psx_configurable(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int frame_size, int config);
 void decode_psx_pivotal(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int frame_size);
 bool ps_find_loop_offsets(STREAMFILE* sf, off_t start_offset, size_t data_size, int channels, size_t interleave, int32_t* out_loop_start, int32_t* out_loop_end);
@@ -342,7 +344,10 @@ typedef struct {
     uint32_t start_offset;
 } hca_keytest_t;
 
-void test_hca_key(hca_codec_data* data, hca_keytest_t* hk);
+/* Tests hk->key and updates best key/score, returning key's score. */
+int test_hca_key(hca_codec_data* data, hca_keytest_t* hk);
+/* Updates best key/score as if hk->key was tested and got score. */
+void update_hca_key(hca_keytest_t* hk, int score);
 void hca_set_encryption_key(hca_codec_data* data, uint64_t keycode, uint64_t subkey);
 
 STREAMFILE* hca_get_streamfile(hca_codec_data* data);
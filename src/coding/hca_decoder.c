@@ -275,7 +275,7 @@ static int test_hca_score(hca_codec_data* data, hca_keytest_t* hk) {
     return total_score;
 }
 
-void test_hca_key(hca_codec_data* data, hca_keytest_t* hk) {
+int test_hca_key(hca_codec_data* data, hca_keytest_t* hk) {
     int score;
 
     score = test_hca_score(data, hk);
@@ -283,6 +283,11 @@ void test_hca_key(hca_codec_data* data, hca_keytest_t* hk) {
     //;VGM_LOG("HCA: test key=%08x%08x, subkey=%04x, score=%i\n",
     //        (uint32_t)((hk->key >> 32) & 0xFFFFFFFF), (uint32_t)(hk->key & 0xFFFFFFFF), hk->subkey, score);
 
+    update_hca_key(hk, score);
+    return score;
+}
+
+void update_hca_key(hca_keytest_t* hk, int score) {
     /* wrong key */
     if (score < 0)
         return;
@@ -46,9 +46,13 @@ static const int8_t ima_index_table[16] = {
 };
 
 
+/* Nibble expansions. All variations are IMA with minor changes in delta calcs, hist clamping or output,
+ * so they expand one code at a time (updating hist and step index) and return the output sample,
+ * and are selected per codec by the frame expander below. */
+
 /* Original IMA expansion, using shift+ADDs to avoid MULs (slow back then) */
-static void std_ima_expand_nibble_data(uint8_t byte, int shift, int32_t* hist1, int32_t* index) {
-    int code, sample, step, delta;
+static inline int std_ima_expand_code(int code, int32_t* hist1, int* index) {
+    int sample, step, delta;
 
     /* simplified through math from:
      *  - diff = (code + 1/2) * (step / 4)
@@ -56,7 +60,6 @@ static void std_ima_expand_nibble_data(uint8_t byte, int shift, int32_t* hist1,
      *    > diff = (step * nibble / 4) + (step / 8)
      * final diff = [signed] (step / 8) + (step / 4) + (step / 2) + (step) [when code = 4+2+1] */
 
-    code = (byte >> shift) & 0xf;
     sample = *hist1; /* predictor value */
     step = ima_step_size_table[*index]; /* current step */
 
@@ -71,38 +74,13 @@ static void std_ima_expand_nibble_data(uint8_t byte, int shift, int32_t* hist1,
     *index += ima_index_table[code];
     if (*index < 0) *index = 0;
     if (*index > 88) *index = 88;
-}
-
-static void std_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
-    uint8_t byte = read_u8(byte_offset,stream->streamfile);
-    std_ima_expand_nibble_data(byte, nibble_shift, hist1, step_index);
-}
-
-/* Apple's IMA variation. Exactly the same except it uses 16b history (probably more sensitive to overflow/sign extend?) */
-static void std_ima_expand_nibble_16(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int16_t * hist1, int32_t * step_index) {
-    int sample_nibble, sample_decoded, step, delta;
-
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf;
-    sample_decoded = *hist1;
-    step = ima_step_size_table[*step_index];
-
-    delta = step >> 3;
-    if (sample_nibble & 1) delta += step >> 2;
-    if (sample_nibble & 2) delta += step >> 1;
-    if (sample_nibble & 4) delta += step;
-    if (sample_nibble & 8) delta = -delta;
-    sample_decoded += delta;
-
-    *hist1 = clamp16(sample_decoded); /* no need for this, actually */
-    *step_index += ima_index_table[sample_nibble];
-    if (*step_index < 0) *step_index=0;
-    if (*step_index > 88) *step_index=88;
+    return *hist1;
 }
 
 /* Original IMA expansion, but using MULs rather than shift+ADDs (faster for newer processors).
  * There is minor rounding difference between ADD and MUL expansions, noticeable/propagated in non-headered IMAs. */
-static void std_ima_expand_nibble_mul(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
-    int sample_nibble, sample_decoded, step, delta;
+static inline int std_ima_expand_code_mul(int code, int32_t* hist1, int* index) {
+    int sample, step, delta;
 
     /* simplified through math from:
      *  - diff = (code + 1/2) * (step / 4)
@@ -110,161 +88,159 @@ static void std_ima_expand_nibble_mul(VGMSTREAMCHANNEL * stream, off_t byte_offs
      *    > diff = (code + 1/2) * 2 * step / 8
      * final diff = [signed] ((code * 2 + 1) * step) / 8 */
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf;
-    sample_decoded = *hist1;
-    step = ima_step_size_table[*step_index];
+    sample = *hist1;
+    step = ima_step_size_table[*index];
 
-    delta = (sample_nibble & 0x7);
+    delta = (code & 0x7);
     delta = ((delta * 2 + 1) * step) >> 3;
-    if (sample_nibble & 8) delta = -delta;
-    sample_decoded += delta;
+    if (code & 8) delta = -delta;
+    sample += delta;
 
-    *hist1 = clamp16(sample_decoded);
-    *step_index += ima_index_table[sample_nibble];
-    if (*step_index < 0) *step_index=0;
-    if (*step_index > 88) *step_index=88;
+    *hist1 = clamp16(sample);
+    *index += ima_index_table[code];
+    if (*index < 0) *index = 0;
+    if (*index > 88) *index = 88;
+    return *hist1;
 }
 
 /* Camelot IMA (Mario Golf, Mario Tennis; maybe other Camelot games) */
-static void camelot_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
-    int sample_nibble, sample_decoded, step, delta;
+static inline int camelot_ima_expand_code(int code, int32_t* hist1, int* index) {
+    int sample, step, delta;
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf;
-    sample_decoded = *hist1;
-    step = ima_step_size_table[*step_index];
+    sample = *hist1;
+    step = ima_step_size_table[*index];
 
-    sample_decoded = sample_decoded << 3;
-    delta = (sample_nibble & 0x07);
+    sample = sample << 3;
+    delta = (code & 0x07);
     delta = step * delta * 2 + step; /* custom */
-    if (sample_nibble & 8) delta = -delta;
-    sample_decoded += delta;
-    sample_decoded = sample_decoded >> 3;
-
-    *hist1 = clamp16(sample_decoded);
-    *step_index += ima_index_table[sample_nibble];
-    if (*step_index < 0) *step_index=0;
-    if (*step_index > 88) *step_index=88;
+    if (code & 8) delta = -delta;
+    sample += delta;
+    sample = sample >> 3;
+
+    *hist1 = clamp16(sample);
+    *index += ima_index_table[code];
+    if (*index < 0) *index = 0;
+    if (*index > 88) *index = 88;
+    return *hist1;
 }
 
 /* The Incredibles PC, updates step_index before doing current sample, reverse engineered from the .exe
  * (has no apparent name, files are raw data with .WAV extension but are inside a 'SNDS' folder).
  * A few voices show slight drifting but tables and algo look fine, encoder issue? */
-static void snds_ima_expand_nibble(VGMSTREAMCHANNEL* stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
+static inline int snds_ima_expand_code(int code, int32_t* hist1, int* index) {
     int sample, step, delta;
 
-    uint8_t code = (read_u8(byte_offset,stream->streamfile) >> nibble_shift)&0xf;
     sample = *hist1;
 
     int code_pos = code & 7;
-    *step_index += ima_index_table[code_pos]; //OG table doesn't have negative indexes
-    if (*step_index < 0) *step_index = 0;
-    if (*step_index > 88) *step_index = 88;
+    *index += ima_index_table[code_pos]; //OG table doesn't have negative indexes
+    if (*index < 0) *index = 0;
+    if (*index > 88) *index = 88;
 
-    step = ima_step_size_table[*step_index];
+    step = ima_step_size_table[*index];
 
     delta = (step >> 3) + ((step * code_pos) >> 2);
     if (code & 8) delta = -delta;
     sample += delta;
 
     *hist1 = clamp16(sample);
+    return *hist1;
 }
 
 /* Omikron: The Nomad Soul, algorithm from the .exe */
-static void otns_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
-    int sample_nibble, sample_decoded, step, delta;
+static inline int otns_ima_expand_code(int code, int32_t* hist1, int* index) {
+    int sample, step, delta;
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf;
-    sample_decoded = *hist1;
-    step = ima_step_size_table[*step_index];
+    sample = *hist1;
+    step = ima_step_size_table[*index];
 
     delta = 0;
-    if(sample_nibble & 4) delta = step * 4;
-    if(sample_nibble & 2) delta += step * 2;
-    if(sample_nibble & 1) delta += step;
+    if (code & 4) delta = step * 4;
+    if (code & 2) delta += step * 2;
+    if (code & 1) delta += step;
     delta >>= 2;
-    if (sample_nibble & 8) delta = -delta;
-    sample_decoded += delta;
+    if (code & 8) delta = -delta;
+    sample += delta;
 
-    *hist1 = clamp16(sample_decoded);
-    *step_index += ima_index_table[sample_nibble];
-    if (*step_index < 0) *step_index=0;
-    if (*step_index > 88) *step_index=88;
+    *hist1 = clamp16(sample);
+    *index += ima_index_table[code];
+    if (*index < 0) *index = 0;
+    if (*index > 88) *index = 88;
+    return *hist1;
 }
 
 /* Fairly OddParents (PC) .WV6: minor variation, reverse engineered from the .exe */
-static void wv6_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
-    int sample_nibble, sample_decoded, step, delta;
+static inline int wv6_ima_expand_code(int code, int32_t* hist1, int* index) {
+    int sample, step, delta;
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf;
-    sample_decoded = *hist1;
-    step = ima_step_size_table[*step_index];
+    sample = *hist1;
+    step = ima_step_size_table[*index];
 
-    delta = (sample_nibble & 0x7);
+    delta = (code & 0x7);
     delta = ((delta * step) >> 3) + ((delta * step) >> 2);
-    if (sample_nibble & 8) delta = -delta;
-    sample_decoded += delta;
+    if (code & 8) delta = -delta;
+    sample += delta;
 
-    *hist1 = clamp16(sample_decoded);
-    *step_index += ima_index_table[sample_nibble];
-    if (*step_index < 0) *step_index=0;
-    if (*step_index > 88) *step_index=88;
+    *hist1 = clamp16(sample);
+    *index += ima_index_table[code];
+    if (*index < 0) *index = 0;
+    if (*index > 88) *index = 88;
+    return *hist1;
 }
 
 /* High Voltage variation, reverse engineered from .exes [Lego Racers (PC), NBA Hangtime (PC)] */
-static void hv_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
-    int sample_nibble, sample_decoded, step, delta;
+static inline int hv_ima_expand_code(int code, int32_t* hist1, int* index) {
+    int sample, step, delta;
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf;
-    sample_decoded = *hist1;
-    step = ima_step_size_table[*step_index];
+    sample = *hist1;
+    step = ima_step_size_table[*index];
 
-    delta = (sample_nibble & 0x7);
+    delta = (code & 0x7);
     delta = (delta * step) >> 2;
-    if (sample_nibble & 8) delta = -delta;
-    sample_decoded += delta;
+    if (code & 8) delta = -delta;
+    sample += delta;
 
-    *hist1 = clamp16(sample_decoded);
-    *step_index += ima_index_table[sample_nibble];
-    if (*step_index < 0) *step_index=0;
-    if (*step_index > 88) *step_index=88;
+    *hist1 = clamp16(sample);
+    *index += ima_index_table[code];
+    if (*index < 0) *index = 0;
+    if (*index > 88) *index = 88;
+    return *hist1;
 }
 
 /* FFTA2 IMA, different hist and sample rounding, reverse engineered from the ROM */
-static void ffta2_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index, int16_t *out_sample) {
-    int sample_nibble, sample_decoded, step, delta;
+static inline int ffta2_ima_expand_code(int code, int32_t* hist1, int* index) {
+    int sample, step, delta;
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf; /* ADPCM code */
-    sample_decoded = *hist1; /* predictor value */
-    step = ima_step_size_table[*step_index] * 0x100; /* current step (table in ROM is pre-multiplied though) */
+    sample = *hist1; /* predictor value */
+    step = ima_step_size_table[*index] * 0x100; /* current step (table in ROM is pre-multiplied though) */
 
     delta = step >> 3;
-    if (sample_nibble & 1) delta += step >> 2;
-    if (sample_nibble & 2) delta += step >> 1;
-    if (sample_nibble & 4) delta += step;
-    if (sample_nibble & 8) delta = -delta;
-    sample_decoded += delta;
+    if (code & 1) delta += step >> 2;
+    if (code & 2) delta += step >> 1;
+    if (code & 4) delta += step;
+    if (code & 8) delta = -delta;
+    sample += delta;
 
     /* custom clamp16 */
-    if (sample_decoded > 0x7FFF00)
-        sample_decoded = 0x7FFF00;
-    else if (sample_decoded < -0x800000)
-        sample_decoded = -0x800000;
+    if (sample > 0x7FFF00)
+        sample = 0x7FFF00;
+    else if (sample < -0x800000)
+        sample = -0x800000;
 
-    *hist1 = sample_decoded;
-    *out_sample = (short)((sample_decoded + 128) / 256); /* int16 sample rounding, hist is kept as int32 */
+    *hist1 = sample;
 
-    *step_index += ima_index_table[sample_nibble];
-    if (*step_index < 0) *step_index=0;
-    if (*step_index > 88) *step_index=88;
+    *index += ima_index_table[code];
+    if (*index < 0) *index = 0;
+    if (*index > 88) *index = 88;
+    return (short)((sample + 128) / 256); /* int16 sample rounding, hist is kept as int32 */
 }
 
 /* Yet another IMA expansion, from the exe */
-static void blitz_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
-    int sample_nibble, sample_decoded, step, delta;
+static inline int blitz_ima_expand_code(int code, int32_t* hist1, int* index) {
+    int sample, step, delta;
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf; /* ADPCM code */
-    sample_decoded = *hist1; /* predictor value */
-    step = ima_step_size_table[*step_index]; /* current step */
+    sample = *hist1; /* predictor value */
+    step = ima_step_size_table[*index]; /* current step */
 
     /* table has 2 different values, not enough to bother adding the full table */
     if (step == 22385)
@@ -272,37 +248,38 @@ static void blitz_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset
     else if (step == 24623)
         step = 24633;
 
-    delta = (sample_nibble & 0x07);
-    if (sample_nibble & 8) delta = -delta;
+    delta = (code & 0x07);
+    if (code & 8) delta = -delta;
     delta = (step >> 1) + delta * step; /* custom */
-    sample_decoded += delta;
+    sample += delta;
 
     /* in Zapper somehow the exe tries to clamp hist but actually doesn't (bug? not in Lilo & Stitch),
      * seems the pcm buffer must be clamped outside though to fix some scratchiness */
-    *hist1 = sample_decoded;//clamp16(sample_decoded);
-    *step_index += ima_index_table[sample_nibble];
-    if (*step_index < 0) *step_index=0;
-    if (*step_index > 88) *step_index=88;
+    *hist1 = sample;//clamp16(sample);
+    *index += ima_index_table[code];
+    if (*index < 0) *index = 0;
+    if (*index > 88) *index = 88;
+    return clamp16(sample);
 }
 
 static const int CIMAADPCM_INDEX_TABLE[16] = {8,  6,  4,  2,  -1, -1, -1, -1,
                                              -1, -1, -1, -1, 2,  4,  6,  8};
 
 /* Capcom's MT Framework modified IMA, reverse engineered from the exe */
-static void mtf_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
-    int sample_nibble, sample_decoded, step, delta;
+static inline int mtf_ima_expand_code(int code, int32_t* hist1, int* index) {
+    int sample, step, delta;
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift) & 0xf;
-    sample_decoded = *hist1;
-    step = ima_step_size_table[*step_index];
+    sample = *hist1;
+    step = ima_step_size_table[*index];
 
-    delta = step * (2 * sample_nibble - 15);
-    sample_decoded += delta;
+    delta = step * (2 * code - 15);
+    sample += delta;
 
-    *hist1 = sample_decoded;
-    *step_index += CIMAADPCM_INDEX_TABLE[sample_nibble];
-    if (*step_index < 0) *step_index=0;
-    if (*step_index > 88) *step_index=88;
+    *hist1 = sample;
+    *index += CIMAADPCM_INDEX_TABLE[code];
+    if (*index < 0) *index = 0;
+    if (*index > 88) *index = 88;
+    return clamp16(sample >> 4);
 }
 
 /* IMA table pre-modified like this:
@@ -342,11 +319,10 @@ static const int16_t mul_delta_table[16] = {
 
 
 /* Crystal Dynamics IMA, reverse engineered from the exe, also info: https://github.com/sephiroth99/MulDeMu */
-static void cd_ima_expand_nibble(uint8_t byte, int shift, int32_t* hist1, int32_t* index) {
-    int code, sample, step, delta;
+static inline int cd_ima_expand_code(int code, int32_t* hist1, int* index) {
+    int sample, step, delta;
 
     /* could do the above table calcs during decode too */
-    code = (byte >> shift) & 0xf;
     sample = *hist1;
     step = mul_adpcm_table[*index];
 
@@ -355,8 +331,105 @@ static void cd_ima_expand_nibble(uint8_t byte, int shift, int32_t* hist1, int32_
 
     *hist1 = clamp16(sample);
     *index += ima_index_table[code];
-    if (*index < 0) *index=0;
-    if (*index > 88) *index=88;
+    if (*index < 0) *index = 0;
+    if (*index > 88) *index = 88;
+    return *hist1;
+}
+
+typedef enum {
+    IMA_EXPAND_STD,
+    IMA_EXPAND_MUL,
+    IMA_EXPAND_CAMELOT,
+    IMA_EXPAND_SNDS,
+    IMA_EXPAND_OTNS,
+    IMA_EXPAND_WV6,
+    IMA_EXPAND_HV,
+    IMA_EXPAND_FFTA2,
+    IMA_EXPAND_BLITZ,
+    IMA_EXPAND_MTF,
+    IMA_EXPAND_CD,
+} ima_expand_t;
+
+static inline int ima_expand_code(ima_expand_t expand, int code, int32_t* hist1, int* index) {
+    switch (expand) {
+        case IMA_EXPAND_MUL:        return std_ima_expand_code_mul(code, hist1, index);
+        case IMA_EXPAND_CAMELOT:    return camelot_ima_expand_code(code, hist1, index);
+        case IMA_EXPAND_SNDS:       return snds_ima_expand_code(code, hist1, index);
+        case IMA_EXPAND_OTNS:       return otns_ima_expand_code(code, hist1, index);
+        case IMA_EXPAND_WV6:        return wv6_ima_expand_code(code, hist1, index);
+        case IMA_EXPAND_HV:         return hv_ima_expand_code(code, hist1, index);
+        case IMA_EXPAND_FFTA2:      return ffta2_ima_expand_code(code, hist1, index);
+        case IMA_EXPAND_BLITZ:      return blitz_ima_expand_code(code, hist1, index);
+        case IMA_EXPAND_MTF:        return mtf_ima_expand_code(code, hist1, index);
+        case IMA_EXPAND_CD:         return cd_ima_expand_code(code, hist1, index);
+        case IMA_EXPAND_STD:
+        default:                    return std_ima_expand_code(code, hist1, index);
+    }
+}
+
+/* Where a channel's nibbles are. Nibbles are in chunks of chunk_size bytes every chunk_stride bytes (when
+ * mixed with other channels), or all in a row if chunk_size is 0. Byte-interleaved stereo has one nibble
+ * of the channel per byte instead (at byte_shift). */
+typedef struct {
+    int chunk_size;
+    int chunk_stride;
+    int high_first;     /* nibble order in each byte */
+    ima_expand_t expand;
+    int byte_nibble;    /* one nibble per byte */
+    int byte_shift;
+} ima_layout_t;
+
+/* Expands nibbles n_start..n_end of a chunk (data has the chunk's bytes from byte_start), advancing outbuf */
+static inline sample_t* ima_expand_chunk(const uint8_t* data, int byte_start, int n_start, int n_end, const ima_layout_t* layout,
+        int32_t* hist1, int* step_index, sample_t* outbuf, int channelspacing) {
+    int32_t hist = *hist1;
+    int index = *step_index;
+    int high_shift = layout->high_first ? 0 : 4; /* shift for odd nibbles */
+
+    for (int n = n_start; n < n_end; n++) {
+        int code = layout->byte_nibble ?
+                (data[n - byte_start] >> layout->byte_shift) & 0xf :
+                (data[n / 2 - byte_start] >> ((n & 1) ? high_shift : 4 - high_shift)) & 0xf;
+        int sample = ima_expand_code(layout->expand, code, &hist, &index);
+
+        if (outbuf) {
+            *outbuf = (short)sample;
+            outbuf += channelspacing;
+        }
+    }
+
+    *hist1 = hist;
+    *step_index = index;
+    return outbuf;
+}
+
+/* Expands a run of IMA nibbles from a channel's frame data, reading whole chunks at once rather than
+ * one byte per nibble. If outbuf is NULL nibbles only update hist (for skipping). */
+static void ima_expand_frame(sf_span_t* span, off_t offset, const ima_layout_t* layout, int first_nibble, int nibbles,
+        int32_t* hist1, int32_t* step_index, sample_t* outbuf, int channelspacing) {
+    int nibbles_per_byte = layout->byte_nibble ? 1 : 2;
+    int chunk_nibbles = layout->chunk_size ? layout->chunk_size * nibbles_per_byte : SF_SPAN_SIZE * nibbles_per_byte;
+    int chunk_stride = layout->chunk_size ? layout->chunk_stride : SF_SPAN_SIZE;
+    int index = *step_index;
+    int pos = first_nibble;
+    int end = first_nibble + nibbles;
+
+    while (pos < end) {
+        int chunk_pos = pos % chunk_nibbles;
+        int count = chunk_nibbles - chunk_pos;
+        if (count > end - pos)
+            count = end - pos;
+
+        int byte_start = chunk_pos / nibbles_per_byte;
+        int byte_end = (chunk_pos + count - 1) / nibbles_per_byte;
+        const uint8_t* data = sf_span_get(span, offset + (pos / chunk_nibbles) * chunk_stride + byte_start, byte_end - byte_start + 1);
+
+        outbuf = ima_expand_chunk(data, byte_start, chunk_pos, chunk_pos + count, layout, hist1, &index, outbuf, channelspacing);
+
+        pos += count;
+    }
+
+    *step_index = index;
 }
 
 /* ************************************ */
@@ -367,9 +440,10 @@ static void cd_ima_expand_nibble(uint8_t byte, int shift, int32_t* hist1, int32_
  * Configurable: stereo or mono/interleave nibbles, and high or low nibble first.
  * For vgmstream, low nibble is called "IMA ADPCM" and high nibble is "DVI IMA ADPCM" (same thing though). */
 void decode_standard_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel, int is_stereo, int is_high_first) {
-    int i, sample_count = 0;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     /* external interleave */
 
@@ -377,17 +451,13 @@ void decode_standard_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int chann
     if (step_index < 0) step_index=0;
     if (step_index > 88) step_index=88;
 
-    /* decode nibbles (layout: varies) */
-    for (i = first_sample; i < first_sample + samples_to_do; i++, sample_count += channelspacing) {
-        off_t byte_offset = is_stereo ?
-                stream->offset + i :    /* stereo: one nibble per channel */
-                stream->offset + i/2;   /* mono: consecutive nibbles */
+    /* mono: consecutive nibbles; stereo: one nibble per channel */
+    {
         int nibble_shift = is_high_first ?
-                is_stereo ? (!(channel&1) ? 4:0) : (!(i&1) ? 4:0) : /* even = high, odd = low */
-                is_stereo ? (!(channel&1) ? 0:4) : (!(i&1) ? 0:4);  /* even = low, odd = high */
-
-        std_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1);
+                (!(channel&1) ? 4:0) : /* even = high, odd = low */
+                (!(channel&1) ? 0:4);  /* even = low, odd = high */
+        ima_layout_t layout = {0, 0, is_high_first, IMA_EXPAND_STD, is_stereo, nibble_shift};
+        ima_expand_frame(&span, stream->offset, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
     }
 
     stream->adpcm_history1_32 = hist1;
@@ -395,9 +465,10 @@ void decode_standard_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int chann
 }
 
 void decode_mtf_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel, int is_stereo) {
-    int i, sample_count = 0;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     /* external interleave */
 
@@ -405,17 +476,10 @@ void decode_mtf_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspa
     if (step_index < 0) step_index=0;
     if (step_index > 88) step_index=88;
 
-    /* decode nibbles (layout: varies) */
-    for (i = first_sample; i < first_sample + samples_to_do; i++, sample_count += channelspacing) {
-        off_t byte_offset = is_stereo ?
-                stream->offset + i :    /* stereo: one nibble per channel */
-                stream->offset + i/2;   /* mono: consecutive nibbles */
-        int nibble_shift = is_stereo ?
-                ((channel&1) ? 0:4) :
-                ((i&1) ? 0:4);
-
-        mtf_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = clamp16(hist1 >> 4);
+    /* decode nibbles (layout: stereo one nibble per channel, mono consecutive nibbles, high first) */
+    {
+        ima_layout_t layout = {0, 0, 1, IMA_EXPAND_MTF, is_stereo, (channel&1) ? 0:4};
+        ima_expand_frame(&span, stream->offset, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
     }
 
     stream->adpcm_history1_32 = hist1;
@@ -423,21 +487,17 @@ void decode_mtf_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspa
 }
 
 void decode_camelot_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     //external interleave
 
     //no header
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        off_t byte_offset = stream->offset + i/2;
-        int nibble_shift = (i&1?4:0); //low nibble order
-
-        camelot_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1);
-    }
+    ima_layout_t layout = {0, 0, 0, IMA_EXPAND_CAMELOT}; /* low nibble first */
+    ima_expand_frame(&span, stream->offset, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_step_index = step_index;
@@ -445,6 +505,8 @@ void decode_camelot_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channe
 
 void decode_snds_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
     bool is_stereo = channelspacing > 1;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     int32_t hist1 = stream->adpcm_history1_32; // starts at 0
     int step_index = stream->adpcm_step_index; // starts at 0
@@ -453,42 +515,27 @@ void decode_snds_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelsp
 
     //no header
 
-    int sample_count = 0;
-    for (int i = first_sample; i < first_sample + samples_to_do; i++) {
-        off_t byte_offset = is_stereo ?
-                stream->offset + i :    // stereo: one nibble per channel
-                stream->offset + i/2;   // mono: consecutive nibbles
-        int nibble_shift = is_stereo ?
-                ((channel&1) ? 4:0) : //high nibble first
-                ((i&1) ? 4:0);
-
-        snds_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1);
-        sample_count += channelspacing;
-    }
+    // stereo: one nibble per channel, mono: consecutive nibbles (low first)
+    ima_layout_t layout = {0, 0, 0, IMA_EXPAND_SNDS, is_stereo, (channel&1) ? 4:0};
+    ima_expand_frame(&span, stream->offset, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_step_index = step_index;
 }
 
 void decode_otns_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
-    int i, sample_count;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     //internal/byte interleave
 
     //no header
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        off_t byte_offset = stream->offset + (vgmstream->channels==1 ? i/2 : i); //one nibble per channel if stereo
-        int nibble_shift = (vgmstream->channels==1) ? //todo simplify
-                    (i&1?0:4) : //high nibble first(?)
-                    (channel==0?4:0); //low=ch0, high=ch1 (this is correct compared to vids)
-
-        otns_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1);
-    }
+    //one nibble per channel if stereo (high=ch0, low=ch1, this is correct compared to vids), high nibble first(?) if mono
+    ima_layout_t layout = {0, 0, 1, IMA_EXPAND_OTNS, vgmstream->channels != 1, channel==0?4:0};
+    ima_expand_frame(&span, stream->offset, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_step_index = step_index;
@@ -496,21 +543,17 @@ void decode_otns_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample_t
 
 /* WV6 IMA, DVI IMA with custom nibble expand */
 void decode_wv6_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     //external interleave
 
     //no header
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        off_t byte_offset = stream->offset + i/2;
-        int nibble_shift = (i&1?0:4); //high nibble first
-
-        wv6_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1);
-    }
+    ima_layout_t layout = {0, 0, 1, IMA_EXPAND_WV6}; /* high nibble first */
+    ima_expand_frame(&span, stream->offset, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_step_index = step_index;
@@ -518,21 +561,17 @@ void decode_wv6_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspa
 
 /* High Voltage's DVI IMA with simplified nibble expand */
 void decode_hv_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     //external interleave
 
     //no header
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        off_t byte_offset = stream->offset + i/2;
-        int nibble_shift = (i&1?0:4); //high nibble first
-
-        hv_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1);
-    }
+    ima_layout_t layout = {0, 0, 1, IMA_EXPAND_HV}; /* high nibble first */
+    ima_expand_frame(&span, stream->offset, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_step_index = step_index;
@@ -540,22 +579,17 @@ void decode_hv_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspac
 
 /* FFTA2 IMA, DVI IMA with custom nibble expand/rounding */
 void decode_sqex_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
-    int16_t out_sample;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     //external interleave
 
     //no header
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        off_t byte_offset = stream->offset + i/2;
-        int nibble_shift = (i&1?0:4); //high nibble first
-
-        ffta2_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index, &out_sample);
-        outbuf[sample_count] = out_sample;
-    }
+    ima_layout_t layout = {0, 0, 1, IMA_EXPAND_FFTA2}; /* high nibble first */
+    ima_expand_frame(&span, stream->offset, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_step_index = step_index;
@@ -563,21 +597,17 @@ void decode_sqex_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelsp
 
 /* Blitz IMA, IMA with custom nibble expand */
 void decode_blitz_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     //external interleave
 
     //no header
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        off_t byte_offset = stream->offset + i/2;
-        int nibble_shift = (i&1?4:0); //low nibble first
-
-        blitz_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)clamp16(hist1);
-    }
+    ima_layout_t layout = {0, 0, 0, IMA_EXPAND_BLITZ}; /* low nibble first */
+    ima_expand_frame(&span, stream->offset, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_step_index = step_index;
@@ -591,11 +621,13 @@ void decode_blitz_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channels
  * so to simplify calcs this decodes full frames, thus hist doesn't need to be mantained.
  * Officially defined in "Microsoft Multimedia Standards Update" doc (RIFFNEW.pdf). */
 void decode_ms_ima(VGMSTREAM* vgmstream, VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
-    int i, samples_read = 0, samples_done = 0, max_samples;
+    int samples_done = 0;
     int32_t hist1;// = stream->adpcm_history1_32;
     int step_index;// = stream->adpcm_step_index;
     int frame_channels = vgmstream->codec_config ? 1 : vgmstream->channels; /* mono or mch modes */
     int frame_channel =  vgmstream->codec_config ? 0 : channel;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     /* internal interleave (configurable size), mixed channels */
     int block_samples = ((vgmstream->frame_size - 0x04*frame_channels) * 2 / frame_channels) + 1;
@@ -605,39 +637,31 @@ void decode_ms_ima(VGMSTREAM* vgmstream, VGMSTREAMCHANNEL* stream, sample_t* out
     { //if (first_sample == 0) {
         off_t header_offset = stream->offset + 0x04*frame_channel;
 
-        hist1 =   read_s16le(header_offset+0x00,stream->streamfile);
-        step_index = read_u8(header_offset+0x02,stream->streamfile); /* 0x03: reserved */
+        hist1 =   sf_span_s16le(&span, header_offset+0x00);
+        step_index = sf_span_u8(&span, header_offset+0x02); /* 0x03: reserved */
         if (step_index < 0) step_index = 0;
         if (step_index > 88) step_index = 88;
 
         /* write header sample (odd samples per block) */
-        if (samples_read >= first_sample && samples_done < samples_to_do) {
-            outbuf[samples_done * channelspacing] = (short)hist1;
+        if (first_sample == 0 && samples_to_do > 0) {
+            outbuf[0] = (short)hist1;
             samples_done++;
         }
-        samples_read++;
     }
 
-    max_samples = (block_samples - samples_read);
-    if (max_samples > samples_to_do + first_sample - samples_done)
-        max_samples = samples_to_do + first_sample - samples_done; /* for smaller last block */
-
-    /* decode nibbles (layout: alternates 4 bytes/4*2 nibbles per channel) */
-    for (i = 0; i < max_samples; i++) {
-        off_t byte_offset = stream->offset + 0x04*frame_channels + 0x04*frame_channel + 0x04*frame_channels*(i/8) + (i%8)/2;
-        int nibble_shift = (i&1?4:0); /* low nibble first */
-
-        std_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index); /* original expand */
+    /* decode nibbles (layout: alternates 4 bytes/4*2 nibbles per channel), from the start as hist isn't kept */
+    {
+        ima_layout_t layout = {0x04, 0x04*frame_channels, 0, IMA_EXPAND_STD};
+        off_t nibbles_offset = stream->offset + 0x04*frame_channels + 0x04*frame_channel;
+        int start = first_sample > 0 ? first_sample - 1 : 0;
+        int end = (first_sample + samples_to_do < block_samples ? first_sample + samples_to_do : block_samples) - 1;
 
-        if (samples_read >= first_sample && samples_done < samples_to_do) {
-            outbuf[samples_done * channelspacing] = (short)(hist1);
-            samples_done++;
-        }
-        samples_read++;
+        ima_expand_frame(&span, nibbles_offset, &layout, 0, start, &hist1, &step_index, NULL, 0);
+        ima_expand_frame(&span, nibbles_offset, &layout, start, end - start, &hist1, &step_index, outbuf + samples_done * channelspacing, channelspacing);
     }
 
     /* internal interleave: increment offset on complete frame */
-    if (first_sample + samples_done == block_samples)  {
+    if (first_sample + samples_to_do >= block_samples)  {
         stream->offset += vgmstream->frame_size;
     }
 
@@ -647,9 +671,11 @@ void decode_ms_ima(VGMSTREAM* vgmstream, VGMSTREAMCHANNEL* stream, sample_t* out
 
 /* Reflection's MS-IMA with custom nibble layout (some info from XA2WAV by Deniz Oezmen) */
 void decode_ref_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
-    int i, samples_read = 0, samples_done = 0, max_samples;
+    int samples_done = 0;
     int32_t hist1;// = stream->adpcm_history1_32;
     int step_index;// = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     /* internal interleave (configurable size), mixed channels */
     int block_channel_size = (vgmstream->interleave_block_size - 0x04*vgmstream->channels) / vgmstream->channels;
@@ -660,39 +686,31 @@ void decode_ref_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample_t *
     { //if (first_sample == 0) {
         off_t header_offset = stream->offset + 0x04*channel;
 
-        hist1 =   read_16bitLE(header_offset+0x00,stream->streamfile);
-        step_index = read_8bit(header_offset+0x02,stream->streamfile);
+        hist1 =   sf_span_s16le(&span, header_offset+0x00);
+        step_index = sf_span_s8(&span, header_offset+0x02);
         if (step_index < 0) step_index = 0;
         if (step_index > 88) step_index = 88;
 
         /* write header sample */
-        if (samples_read >= first_sample && samples_done < samples_to_do) {
-            outbuf[samples_done * channelspacing] = (short)hist1;
+        if (first_sample == 0 && samples_to_do > 0) {
+            outbuf[0] = (short)hist1;
             samples_done++;
         }
-        samples_read++;
     }
 
-    max_samples = (block_samples - samples_read);
-    if (max_samples > samples_to_do + first_sample - samples_done)
-        max_samples = samples_to_do + first_sample - samples_done; /* for smaller last block */
-
-    /* decode nibbles (layout: all nibbles from one channel, then other channels) */
-    for (i = 0; i < max_samples; i++) {
-        off_t byte_offset = stream->offset + 0x04*vgmstream->channels + block_channel_size*channel + i/2;
-        int nibble_shift = (i&1?4:0); /* low nibble first */
-
-        std_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+    /* decode nibbles (layout: all nibbles from one channel, then other channels), from the start as hist isn't kept */
+    {
+        ima_layout_t layout = {0, 0, 0, IMA_EXPAND_STD};
+        off_t nibbles_offset = stream->offset + 0x04*vgmstream->channels + block_channel_size*channel;
+        int start = first_sample > 0 ? first_sample - 1 : 0;
+        int end = (first_sample + samples_to_do < block_samples ? first_sample + samples_to_do : block_samples) - 1;
 
-        if (samples_read >= first_sample && samples_done < samples_to_do) {
-            outbuf[samples_done * channelspacing] = (short)(hist1);
-            samples_done++;
-        }
-        samples_read++;
+        ima_expand_frame(&span, nibbles_offset, &layout, 0, start, &hist1, &step_index, NULL, 0);
+        ima_expand_frame(&span, nibbles_offset, &layout, start, end - start, &hist1, &step_index, outbuf + samples_done * channelspacing, channelspacing);
     }
 
     /* internal interleave: increment offset on complete frame */
-    if (first_sample + samples_done == block_samples)  {
+    if (first_sample + samples_to_do >= block_samples)  {
         stream->offset += vgmstream->interleave_block_size;
     }
 
@@ -707,10 +725,12 @@ void decode_ref_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample_t *
 /* MS-IMA with fixed frame size, and outputs an even number of samples per frame (skips last nibble).
  * Defined in Xbox's SDK. Usable in mono or stereo modes (both suitable for interleaved multichannel). */
 void decode_xbox_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel, int is_stereo) {
-    int i, frames_in, sample_pos = 0, block_samples, frame_size;
+    int frames_in, sample_pos = 0, block_samples, frame_size;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
     off_t frame_offset;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     /* external interleave (fixed size), stereo/mono */
     block_samples = (0x24 - 0x4) * 2;
@@ -726,8 +746,8 @@ void decode_xbox_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelsp
                 frame_offset + 0x04*(channel % 2) :
                 frame_offset + 0x00;
 
-        hist1   = read_16bitLE(header_offset+0x00,stream->streamfile);
-        step_index = read_8bit(header_offset+0x02,stream->streamfile);
+        hist1   = sf_span_s16le(&span, header_offset+0x00);
+        step_index = sf_span_s8(&span, header_offset+0x02);
         if (step_index < 0) step_index=0;
         if (step_index > 88) step_index=88;
 
@@ -739,18 +759,15 @@ void decode_xbox_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelsp
     }
 
     /* decode nibbles (layout: straight in mono or 4 bytes per channel in stereo) */
-    for (i = first_sample; i < first_sample + samples_to_do; i++) {
-        off_t byte_offset = is_stereo ?
-                frame_offset + 0x04*2 + 0x04*(channel % 2) + 0x04*2*((i-1)/8) + ((i-1)%8)/2 :
-                frame_offset + 0x04   + (i-1)/2;
-        int nibble_shift = (!((i-1)&1)   ? 0:4);   /* low first */
-
+    {
+        ima_layout_t layout = {is_stereo ? 0x04 : 0, is_stereo ? 0x04*2 : 0, 0, IMA_EXPAND_STD};
+        off_t nibbles_offset = is_stereo ?
+                frame_offset + 0x04*2 + 0x04*(channel % 2) :
+                frame_offset + 0x04;
         /* must skip last nibble per spec, rarely needed though (ex. Gauntlet Dark Legacy) */
-        if (i < block_samples) {
-            std_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-            outbuf[sample_pos] = (short)(hist1);
-            sample_pos += channelspacing;
-        }
+        int end = first_sample + samples_to_do < block_samples ? first_sample + samples_to_do : block_samples;
+
+        ima_expand_frame(&span, nibbles_offset, &layout, first_sample - 1, end - first_sample, &hist1, &step_index, outbuf + sample_pos, channelspacing);
     }
 
     stream->adpcm_history1_32 = hist1;
@@ -759,9 +776,11 @@ void decode_xbox_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelsp
 
 /* Multichannel XBOX-IMA ADPCM, with all channels mixed in the same block (equivalent to multichannel MS-IMA; seen in .rsd XADP). */
 void decode_xbox_ima_mch(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
-    int i, sample_count = 0, num_frame;
+    int sample_count = 0, num_frame;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     /* external interleave (fixed size), multichannel */
     int block_samples = (0x24 - 0x4) * 2;
@@ -772,8 +791,8 @@ void decode_xbox_ima_mch(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int chann
     if (first_sample == 0) {
         off_t header_offset = stream->offset + 0x24*channelspacing*num_frame + 0x04*channel;
 
-        hist1   = read_16bitLE(header_offset+0x00,stream->streamfile);
-        step_index = read_8bit(header_offset+0x02,stream->streamfile);
+        hist1   = sf_span_s16le(&span, header_offset+0x00);
+        step_index = sf_span_s8(&span, header_offset+0x02);
         if (step_index < 0) step_index=0;
         if (step_index > 88) step_index=88;
 
@@ -785,16 +804,13 @@ void decode_xbox_ima_mch(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int chann
     }
 
     /* decode nibbles (layout: alternates 4 bytes/4*2 nibbles per channel) */
-    for (i = first_sample; i < first_sample + samples_to_do; i++) {
-        off_t byte_offset = (stream->offset + 0x24*channelspacing*num_frame + 0x04*channelspacing) + 0x04*channel + 0x04*channelspacing*((i-1)/8) + ((i-1)%8)/2;
-        int nibble_shift = ((i-1)&1?4:0); /* low nibble first */
-
+    {
+        ima_layout_t layout = {0x04, 0x04*channelspacing, 0, IMA_EXPAND_STD};
+        off_t nibbles_offset = (stream->offset + 0x24*channelspacing*num_frame + 0x04*channelspacing) + 0x04*channel;
         /* must skip last nibble per spec, rarely needed though */
-        if (i < block_samples) {
-            std_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-            outbuf[sample_count] = (short)(hist1);
-            sample_count += channelspacing;
-        }
+        int end = first_sample + samples_to_do < block_samples ? first_sample + samples_to_do : block_samples;
+
+        ima_expand_frame(&span, nibbles_offset, &layout, first_sample - 1, end - first_sample, &hist1, &step_index, outbuf + sample_count, channelspacing);
     }
 
     stream->adpcm_history1_32 = hist1;
@@ -805,9 +821,10 @@ void decode_xbox_ima_mch(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int chann
  * Apparently clamps to -32767 unlike standard's -32768 (probably not noticeable).
  * Info here: http://problemkaputt.de/gbatek.htm#dssoundnotes */
 void decode_nds_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     /* external interleave (configurable size), mono */
 
@@ -815,20 +832,17 @@ void decode_nds_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspa
     if (first_sample == 0) {
         off_t header_offset = stream->offset;
 
-        hist1 = read_16bitLE(header_offset,stream->streamfile);
-        step_index = read_16bitLE(header_offset+2,stream->streamfile);
+        hist1 = sf_span_s16le(&span, header_offset);
+        step_index = sf_span_s16le(&span, header_offset+2);
         if (step_index < 0) step_index=0; /* probably pre-adjusted */
         if (step_index > 88) step_index=88;
     }
 
-    /* decode nibbles (layout: all nibbles from the channel) */
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        off_t byte_offset = stream->offset + 0x04 + i/2;
-        int nibble_shift = (i&1?4:0); /* low nibble first */
-
+    /* decode nibbles (layout: all nibbles from the channel, low nibble first) */
+    {
+        ima_layout_t layout = {0, 0, 0, IMA_EXPAND_STD};
         //todo waveform has minor deviations using known expands
-        std_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1);
+        ima_expand_frame(&span, stream->offset + 0x04, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
     }
 
     stream->adpcm_history1_32 = hist1;
@@ -836,9 +850,10 @@ void decode_nds_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspa
 }
 
 void decode_dat4_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count;
     int32_t hist1 = stream->adpcm_history1_16;//todo unneeded 16?
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     //external interleave
 
@@ -846,17 +861,15 @@ void decode_dat4_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelsp
     if (first_sample == 0) {
         off_t header_offset = stream->offset;
 
-        hist1 = read_16bitLE(header_offset,stream->streamfile);
-        step_index = read_8bit(header_offset+2,stream->streamfile);
+        hist1 = sf_span_s16le(&span, header_offset);
+        step_index = sf_span_s8(&span, header_offset+2);
         step_index = _clamp_s32(step_index, 0, 88); /* probably pre-adjusted */
     }
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        off_t byte_offset = stream->offset + 4 + i/2;
-        int nibble_shift = (i&1?0:4); //high nibble first
-
-        std_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1);
+    //high nibble first
+    {
+        ima_layout_t layout = {0, 0, 1, IMA_EXPAND_STD};
+        ima_expand_frame(&span, stream->offset + 4, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
     }
 
     stream->adpcm_history1_16 = hist1;
@@ -864,9 +877,10 @@ void decode_dat4_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelsp
 }
 
 void decode_rad_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do,int channel) {
-    int i, sample_count;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     //internal interleave (configurable size), mixed channels (4 byte per ch)
     int block_samples = (vgmstream->interleave_block_size - 4*vgmstream->channels) * 2 / vgmstream->channels;
@@ -876,31 +890,30 @@ void decode_rad_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample_t *
     if (first_sample == 0) {
         off_t header_offset = stream->offset + 4*channel;
 
-        step_index = read_16bitLE(header_offset,stream->streamfile);
-        hist1 = read_16bitLE(header_offset+2,stream->streamfile);
+        step_index = sf_span_s16le(&span, header_offset);
+        hist1 = sf_span_s16le(&span, header_offset+2);
         if (step_index < 0) step_index=0;
         if (step_index > 88) step_index=88;
     }
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        off_t byte_offset = stream->offset + 4*vgmstream->channels + channel + i/2*vgmstream->channels;
-        int nibble_shift = (i&1?4:0); //low nibble first
-
-        std_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1);
+    //low nibble first, 1 byte per channel
+    {
+        ima_layout_t layout = {1, vgmstream->channels, 0, IMA_EXPAND_STD};
+        ima_expand_frame(&span, stream->offset + 4*vgmstream->channels + channel, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
     }
 
     //internal interleave: increment offset on complete frame
-    if (i == block_samples) stream->offset += vgmstream->interleave_block_size;
+    if (first_sample + samples_to_do == block_samples) stream->offset += vgmstream->interleave_block_size;
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_step_index = step_index;
 }
 
 void decode_rad_ima_mono(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     //semi-external interleave?
     int block_samples = 0x14 * 2;
@@ -910,18 +923,16 @@ void decode_rad_ima_mono(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int chann
     if (first_sample == 0) {
         off_t header_offset = stream->offset;
 
-        step_index = read_16bitLE(header_offset,stream->streamfile);
-        hist1 = read_16bitLE(header_offset+2,stream->streamfile);
+        step_index = sf_span_s16le(&span, header_offset);
+        hist1 = sf_span_s16le(&span, header_offset+2);
         if (step_index < 0) step_index=0;
         if (step_index > 88) step_index=88;
     }
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        off_t byte_offset = stream->offset + 4 + i/2;
-        int nibble_shift = (i&1?4:0); //low nibble first
-
-        std_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1);
+    //low nibble first
+    {
+        ima_layout_t layout = {0, 0, 0, IMA_EXPAND_STD};
+        ima_expand_frame(&span, stream->offset + 4, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
     }
 
     stream->adpcm_history1_32 = hist1;
@@ -930,9 +941,11 @@ void decode_rad_ima_mono(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int chann
 
 /* Apple's IMA4, a.k.a QuickTime IMA. 2 byte header and header sample is not written (setup only). */
 void decode_apple_ima4(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count, num_frame;
-    int16_t hist1 = stream->adpcm_history1_16;//todo unneeded 16?
+    int num_frame;
+    int32_t hist1 = stream->adpcm_history1_16;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     //external interleave
     int block_samples = (0x22 - 0x2) * 2;
@@ -943,18 +956,16 @@ void decode_apple_ima4(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channel
     if (first_sample == 0) {
         off_t header_offset = stream->offset + 0x22*num_frame;
 
-        hist1 = (int16_t)((uint16_t)read_16bitBE(header_offset,stream->streamfile) & 0xff80);
-        step_index = read_8bit(header_offset+1,stream->streamfile) & 0x7f;
+        hist1 = (int16_t)((uint16_t)sf_span_s16be(&span, header_offset) & 0xff80);
+        step_index = sf_span_s8(&span, header_offset+1) & 0x7f;
         if (step_index < 0) step_index=0;
         if (step_index > 88) step_index=88;
     }
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        off_t byte_offset = (stream->offset + 0x22*num_frame + 0x2) + i/2;
-        int nibble_shift = (i&1?4:0); //low nibble first
-
-        std_ima_expand_nibble_16(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1);
+    //low nibble first (samples are clamped so 16b history works the same)
+    {
+        ima_layout_t layout = {0, 0, 0, IMA_EXPAND_STD};
+        ima_expand_frame(&span, stream->offset + 0x22*num_frame + 0x2, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
     }
 
     stream->adpcm_history1_16 = hist1;
@@ -963,9 +974,11 @@ void decode_apple_ima4(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channel
 
 /* XBOX-IMA with modified data layout */
 void decode_fsb_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do,int channel) {
-    int i, sample_count = 0;
+    int sample_count = 0;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     /* internal interleave (configurable size), mixed channels */
     int block_samples = (0x24 - 0x4) * 2;
@@ -976,8 +989,8 @@ void decode_fsb_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample_t *
         off_t hist_offset = stream->offset + 0x02*channel + 0x00;
         off_t step_offset = stream->offset + 0x02*channel + 0x02*vgmstream->channels;
 
-        hist1   = read_16bitLE(hist_offset,stream->streamfile);
-        step_index = read_8bit(step_offset,stream->streamfile);
+        hist1   = sf_span_s16le(&span, hist_offset);
+        step_index = sf_span_s8(&span, step_offset);
         if (step_index < 0) step_index=0;
         if (step_index > 88) step_index=88;
 
@@ -989,20 +1002,17 @@ void decode_fsb_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample_t *
     }
 
     /* decode nibbles (layout: 2 bytes/2*2 nibbles per channel) */
-    for (i = first_sample; i < first_sample + samples_to_do; i++) {
-        off_t byte_offset = stream->offset + 0x04*vgmstream->channels + 0x02*channel + (i-1)/4*2*vgmstream->channels + ((i-1)%4)/2;
-        int nibble_shift = ((i-1)&1?4:0); /* low nibble first */
-
+    {
+        ima_layout_t layout = {0x02, 0x02*vgmstream->channels, 0, IMA_EXPAND_STD};
+        off_t nibbles_offset = stream->offset + 0x04*vgmstream->channels + 0x02*channel;
         /* must skip last nibble per official decoder, probably not needed though */
-        if (i < block_samples) {
-            std_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-            outbuf[sample_count] = (short)(hist1);
-            sample_count += channelspacing;
-        }
+        int end = first_sample + samples_to_do < block_samples ? first_sample + samples_to_do : block_samples;
+
+        ima_expand_frame(&span, nibbles_offset, &layout, first_sample - 1, end - first_sample, &hist1, &step_index, outbuf + sample_count, channelspacing);
     }
 
     /* internal interleave: increment offset on complete frame */
-    if (i == block_samples) {
+    if (first_sample + samples_to_do == block_samples) {
         stream->offset += 0x24*vgmstream->channels;
     }
 
@@ -1012,9 +1022,11 @@ void decode_fsb_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample_t *
 
 /* mono XBOX-IMA with header endianness and alt nibble expand (verified vs AK test demos) */
 void decode_wwise_ima(VGMSTREAM* vgmstream, VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count = 0, num_frame;
+    int sample_count = 0, num_frame;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     /* external interleave (fixed size), mono */
     int block_samples = (0x24 - 0x4) * 2;
@@ -1023,11 +1035,10 @@ void decode_wwise_ima(VGMSTREAM* vgmstream, VGMSTREAMCHANNEL* stream, sample_t*
 
     /* normal header (hist+step+reserved), single channel */
     if (first_sample == 0) {
-        int16_t (*read_16bit)(off_t,STREAMFILE*) = vgmstream->codec_endian ? read_16bitBE : read_16bitLE;
         off_t header_offset = stream->offset + 0x24*num_frame;
 
-        hist1 = read_16bit(header_offset,stream->streamfile);
-        step_index = read_8bit(header_offset+2,stream->streamfile);
+        hist1 = vgmstream->codec_endian ? sf_span_s16be(&span, header_offset) : sf_span_s16le(&span, header_offset);
+        step_index = sf_span_s8(&span, header_offset+2);
         if (step_index < 0) step_index=0;
         if (step_index > 88) step_index=88;
 
@@ -1038,17 +1049,13 @@ void decode_wwise_ima(VGMSTREAM* vgmstream, VGMSTREAMCHANNEL* stream, sample_t*
         samples_to_do -= 1;
     }
 
-    /* decode nibbles (layout: all nibbles from one channel) */
-    for (i = first_sample; i < first_sample + samples_to_do; i++) {
-        off_t byte_offset = (stream->offset + 0x24*num_frame + 0x4) + (i-1)/2;
-        int nibble_shift = ((i-1)&1?4:0); /* low nibble first */
-
+    /* decode nibbles (layout: all nibbles from one channel, low nibble first) */
+    {
+        ima_layout_t layout = {0, 0, 0, IMA_EXPAND_MUL};
         /* must skip last nibble like other XBOX-IMAs, often needed (ex. Bayonetta 2 sfx) */
-        if (i < block_samples) {
-            std_ima_expand_nibble_mul(stream, byte_offset,nibble_shift, &hist1, &step_index);
-            outbuf[sample_count] = (short)(hist1);
-            sample_count += channelspacing;
-        }
+        int end = first_sample + samples_to_do < block_samples ? first_sample + samples_to_do : block_samples;
+
+        ima_expand_frame(&span, stream->offset + 0x24*num_frame + 0x4, &layout, first_sample - 1, end - first_sample, &hist1, &step_index, outbuf + sample_count, channelspacing);
     }
 
     stream->adpcm_history1_32 = hist1;
@@ -1057,7 +1064,8 @@ void decode_wwise_ima(VGMSTREAM* vgmstream, VGMSTREAMCHANNEL* stream, sample_t*
 
 /* MS-IMA with possibly the XBOX-IMA model of even number of samples per block (more tests are needed) */
 void decode_awc_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
@@ -1070,22 +1078,20 @@ void decode_awc_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspa
     if (first_sample == 0) {
         off_t header_offset = stream->offset;
 
-        step_index = read_16bitLE(header_offset,stream->streamfile);
-        hist1 = read_16bitLE(header_offset+2,stream->streamfile);
+        step_index = sf_span_s16le(&span, header_offset);
+        hist1 = sf_span_s16le(&span, header_offset+2);
         if (step_index < 0) step_index=0;
         if (step_index > 88) step_index=88;
     }
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        off_t byte_offset = stream->offset + 4 + i/2;
-        int nibble_shift = (i&1?4:0); //low nibble first
-
-        std_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1);
+    //low nibble first
+    {
+        ima_layout_t layout = {0, 0, 0, IMA_EXPAND_STD};
+        ima_expand_frame(&span, stream->offset + 4, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
     }
 
     //internal interleave: increment offset on complete frame
-    if (i == block_samples) stream->offset += 0x800;
+    if (first_sample + samples_to_do == block_samples) stream->offset += 0x800;
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_step_index = step_index;
@@ -1094,7 +1100,7 @@ void decode_awc_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspa
 
 /* DVI stereo/mono with some mini header and sample output */
 void decode_ubi_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
-    int i, sample_count = 0;
+    int sample_count = 0;
     STREAMFILE* sf = stream->streamfile;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -1176,16 +1182,14 @@ void decode_ubi_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspa
     if (step_index < 0) step_index = 0;
     if (step_index > 88) step_index = 88;
 
-    for (i = first_sample; i < first_sample + samples_to_do; i++, sample_count += channelspacing) {
-        off_t byte_offset = channelspacing == 1 ?
-                stream->offset + i/2 :  /* mono mode */
-                stream->offset + i;     /* stereo mode */
-        int nibble_shift = channelspacing == 1 ?
-                (!(i%2) ? 4:0) :        /* mono mode (high first) */
-                (channel==0 ? 4:0);     /* stereo mode (high=L,low=R) */
+    /* after header reads, as they would invalidate the span */
+    sf_span_t span;
+    sf_span_init(&span, sf);
 
-        std_ima_expand_nibble_mul(stream, byte_offset, nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1); /* all samples are written */
+    /* mono mode (high first) or stereo mode (high=L,low=R), all samples are written */
+    if (first_sample >= 0) {
+        ima_layout_t layout = {0, 0, 1, IMA_EXPAND_MUL, channelspacing != 1, channel==0 ? 4:0};
+        ima_expand_frame(&span, stream->offset, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf + sample_count, channelspacing);
     }
 
     stream->adpcm_history1_32 = hist1;
@@ -1194,7 +1198,8 @@ void decode_ubi_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspa
 
 /* standard IMA but with a tweak for Ubi's encoder bug with step index (see blocked_ubi_sce.c) */
 void decode_ubi_sce_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
-    int i, sample_count = 0;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
@@ -1204,17 +1209,9 @@ void decode_ubi_sce_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channe
     if (step_index < 0) step_index = 0;
     if (step_index > 89) step_index = 89;
 
-    for (i = first_sample; i < first_sample + samples_to_do; i++, sample_count += channelspacing) {
-        off_t byte_offset = channelspacing == 1 ?
-                stream->offset + i/2 :  /* mono mode */
-                stream->offset + i;     /* stereo mode */
-        int nibble_shift = channelspacing == 1 ?
-                (!(i%2) ? 4:0) :        /* mono mode (high first) */
-                (channel==0 ? 4:0);     /* stereo mode (high=L,low=R) */
-
-        std_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-        outbuf[sample_count] = (short)(hist1); /* all samples are written */
-    }
+    /* mono mode (high first) or stereo mode (high=L,low=R), all samples are written */
+    ima_layout_t layout = {0, 0, 1, IMA_EXPAND_STD, channelspacing != 1, channel==0 ? 4:0};
+    ima_expand_frame(&span, stream->offset, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf, channelspacing);
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_step_index = step_index;
@@ -1225,11 +1222,13 @@ void decode_ubi_sce_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channe
  * tables mapping all standard IMA combinations (to optimize calculations), but decodes the same.
  * Based on HCS's and Nisto's reverse engineering in h4m_audio_decode. */
 void decode_h4m_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel, uint16_t frame_format) {
-    int i, samples_done = 0;
+    int samples_done = 0;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
     size_t header_size;
     int is_stereo = (channelspacing > 1);
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     /* external interleave (blocked, should call 1 frame) */
 
@@ -1238,12 +1237,12 @@ void decode_h4m_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspa
         int channel_pos = is_stereo ? (1 - channel) : channel; /* R hist goes first */
         switch(frame_format) {
             case 1: /* combined hist+index */
-                hist1   = read_16bitBE(stream->offset + 0x02*channel_pos + 0x00,stream->streamfile) & 0xFFFFFF80;
-                step_index = (uint8_t)read_8bit(stream->offset + 0x02*channel_pos + 0x01,stream->streamfile) & 0x7f;
+                hist1   = sf_span_s16be(&span, stream->offset + 0x02*channel_pos + 0x00) & 0xFFFFFF80;
+                step_index = (uint8_t)sf_span_s8(&span, stream->offset + 0x02*channel_pos + 0x01) & 0x7f;
                 break;
             case 3: /* separate hist+index */
-                hist1   = read_16bitBE(stream->offset + 0x03*channel_pos + 0x00,stream->streamfile);
-                step_index = (uint8_t)read_8bit(stream->offset + 0x03*channel_pos + 0x02,stream->streamfile);
+                hist1   = sf_span_s16be(&span, stream->offset + 0x03*channel_pos + 0x00);
+                step_index = (uint8_t)sf_span_s8(&span, stream->offset + 0x03*channel_pos + 0x02);
                 break;
             case 2:  /* no hist/index (continues from previous frame) */
             default:
@@ -1275,20 +1274,9 @@ void decode_h4m_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspa
         default: header_size = 0; break;
     }
 
-    /* decode block nibbles */
-    for (i = first_sample; i < first_sample + samples_to_do; i++) {
-        off_t byte_offset = is_stereo ?
-                stream->offset + header_size + i :      /* stereo: one nibble per channel */
-                stream->offset + header_size + i/2;     /* mono: consecutive nibbles */
-        int nibble_shift = is_stereo ?
-                (!(channel&1) ? 0:4) :                  /* stereo: L=low, R=high */
-                (!(i&1) ? 0:4);                         /* mono: low first */
-
-        std_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
-
-        outbuf[samples_done * channelspacing] = (short)(hist1);
-        samples_done++;
-    }
+    /* decode block nibbles (stereo: one nibble per channel, L=low, R=high; mono: consecutive nibbles, low first) */
+    ima_layout_t layout = {0, 0, 0, IMA_EXPAND_STD, is_stereo, !(channel&1) ? 0:4};
+    ima_expand_frame(&span, stream->offset + header_size, &layout, first_sample, samples_to_do, &hist1, &step_index, outbuf + samples_done * channelspacing, channelspacing);
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_step_index = step_index;
@@ -1299,7 +1287,7 @@ void decode_h4m_ima(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspa
  * Has another table with delta_table MMX combos, and uses header sample (first nibble is always 0). */
 void decode_cd_ima(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
     uint8_t frame[0x24] = {0};
-    int i, frames_in, sample_pos = 0, block_samples, frame_size;
+    int frames_in, sample_pos = 0, block_samples, frame_size;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
     off_t frame_offset;
@@ -1326,15 +1314,9 @@ void decode_cd_ima(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacin
         samples_to_do -= 1;
     }
 
-    /* decode nibbles (layout: straight in mono) */
-    for (i = first_sample; i < first_sample + samples_to_do; i++) {
-        int pos = 0x04 + (i/2);
-        int shift = (i&1 ? 4:0); /* low first, but first low nibble is skipped */
-
-        cd_ima_expand_nibble(frame[pos], shift, &hist1, &step_index);
-        outbuf[sample_pos] = (short)(hist1);
-        sample_pos += channelspacing;
-    }
+    /* decode nibbles (layout: straight in mono, low first, but first low nibble is skipped) */
+    ima_layout_t layout = {0, 0, 0, IMA_EXPAND_CD};
+    ima_expand_chunk(frame + 0x04, 0, first_sample, first_sample + samples_to_do, &layout, &hist1, &step_index, outbuf + sample_pos, channelspacing);
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_step_index = step_index;
@@ -1343,7 +1325,7 @@ void decode_cd_ima(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacin
 /* Crankcase Audio IMA, from libs (internally CrankcaseAudio::ADPCM and revadpcm) */
 void decode_crankcase_ima(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
     uint8_t frame[0x23] = {0};
-    int i, frames_in, sample_pos = 0, block_samples, frame_size;
+    int frames_in, block_samples, frame_size;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
     uint32_t frame_offset;
@@ -1364,15 +1346,9 @@ void decode_crankcase_ima(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channe
         step_index = _clamp_s32(step_index, 0, 88);
     }
 
-    /* decode nibbles (layout: straight in mono) */
-    for (i = first_sample; i < first_sample + samples_to_do; i++) {
-        int pos = 0x03 + (i/2);
-        int shift = (i & 1 ? 4:0); /* low first */
-
-        std_ima_expand_nibble_data(frame[pos], shift, &hist1, &step_index);
-        outbuf[sample_pos] = (short)(hist1); /* internally output to float using "sample / 32767.0" */
-        sample_pos += channelspacing;
-    }
+    /* decode nibbles (layout: straight in mono, low first); internally output to float using "sample / 32767.0" */
+    ima_layout_t layout = {0, 0, 0, IMA_EXPAND_STD};
+    ima_expand_chunk(frame + 0x03, 0, first_sample, first_sample + samples_to_do, &layout, &hist1, &step_index, outbuf, channelspacing);
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_step_index = step_index;
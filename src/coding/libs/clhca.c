@@ -29,6 +29,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <memory.h>
+#include "../../util/simd.h"
 
 /* CRI libs may only accept last version in some cases/modes, though most decoding takes older versions
  * into account. Lib is identified with "HCA Decoder (Float)" + version string. Some known versions:
@@ -351,6 +352,24 @@ void clHCA_ReadSamples16(clHCA* hca, short* samples) {
 
 void clHCA_ReadSamples(clHCA* hca, float* samples) {
 
+#ifdef VGM_SIMD
+    /* common stereo case */
+    if (hca->channels == 2) {
+        for (int i = 0; i < HCA_SUBFRAMES; i++) {
+            const float* wave_l = hca->channel[0].wave[i];
+            const float* wave_r = hca->channel[1].wave[i];
+            for (int j = 0; j < HCA_SAMPLES_PER_SUBFRAME; j += 4) {
+                v4f_t l = v4f_load(wave_l + j);
+                v4f_t r = v4f_load(wave_r + j);
+                v4f_store(samples + 0, v4f_zip_lo(l, r));
+                v4f_store(samples + 4, v4f_zip_hi(l, r));
+                samples += 8;
+            }
+        }
+        return;
+    }
+#endif
+
     /* interleave output */
     for (int i = 0; i < HCA_SUBFRAMES; i++) {
         for (int j = 0; j < HCA_SAMPLES_PER_SUBFRAME; j++) {
@@ -1566,8 +1585,19 @@ static void dequantize_coefficients(stChannel* ch, clData* br, int subframe) {
             qc = hcatbdecoder_read_val_table[index];
         }
 
-        /* dequantize coef with gain */
-        ch->spectra[subframe][i] = ch->gain[i] * qc;
+        ch->spectra[subframe][i] = qc;
+    }
+
+    /* dequantize coefs with gain */
+    i = 0;
+#ifdef VGM_SIMD
+    for (; i + 4 <= cc_count; i += 4) {
+        v4f_t qc = v4f_load(&ch->spectra[subframe][i]);
+        v4f_store(&ch->spectra[subframe][i], v4f_mul(v4f_load(&ch->gain[i]), qc));
+    }
+#endif
+    for (; i < cc_count; i++) {
+        ch->spectra[subframe][i] = ch->gain[i] * ch->spectra[subframe][i];
     }
 
     /* clean rest of spectra */
@@ -1920,7 +1950,21 @@ static void imdct_transform(stChannel* ch, int subframe) {
             float* d2 = &temp2[count2];
 
             for (j = 0; j < count1; j++) {
-                for (k = 0; k < count2; k++) {
+                k = 0;
+#ifdef VGM_SIMD
+                for (; k + 4 <= count2; k += 4) {
+                    v4f_t ab1 = v4f_load(temp1 + 0);
+                    v4f_t ab2 = v4f_load(temp1 + 4);
+                    v4f_t a = v4f_even(ab1, ab2);
+                    v4f_t b = v4f_odd(ab1, ab2);
+                    v4f_store(d1, v4f_add(a, b));
+                    v4f_store(d2, v4f_sub(a, b));
+                    temp1 += 8;
+                    d1 += 4;
+                    d2 += 4;
+                }
+#endif
+                for (; k < count2; k++) {
                     float a = *(temp1++);
                     float b = *(temp1++);
                     *(d1++) = a + b;
@@ -1954,7 +1998,24 @@ static void imdct_transform(stChannel* ch, int subframe) {
             const float* s2 = &temp1[count2];
 
             for (j = 0; j < count1; j++) {
-                for (k = 0; k < count2; k++) {
+                k = 0;
+#ifdef VGM_SIMD
+                for (; k + 4 <= count2; k += 4) {
+                    v4f_t a = v4f_load(s1);
+                    v4f_t b = v4f_load(s2);
+                    v4f_t sin = v4f_load(sin_table);
+                    v4f_t cos = v4f_load(cos_table);
+                    v4f_store(d1, v4f_sub(v4f_mul(a, sin), v4f_mul(b, cos)));
+                    v4f_store(d2 - 3, v4f_reverse(v4f_add(v4f_mul(a, cos), v4f_mul(b, sin)))); /* d2 goes backwards */
+                    s1 += 4;
+                    s2 += 4;
+                    sin_table += 4;
+                    cos_table += 4;
+                    d1 += 4;
+                    d2 -= 4;
+                }
+#endif
+                for (; k < count2; k++) {
                     float a = *(s1++);
                     float b = *(s2++);
                     float sin = *(sin_table++);
@@ -1988,7 +2049,28 @@ static void imdct_transform(stChannel* ch, int subframe) {
         const float* dct = &ch->spectra[subframe][0]; //ch->dct;
         const float* prev = &ch->imdct_previous[0];
 
-        for (i = 0; i < half; i++) {
+        i = 0;
+#ifdef VGM_SIMD
+        /* same as below, reversed indexes load and reverse 4 values */
+        for (; i < half; i += 4) {
+            v4f_t prev_lo = v4f_load(&prev[i]);
+            v4f_t prev_hi = v4f_load(&prev[i + half]);
+            v4f_t window_lo = v4f_load(&hcaimdct_window_float[i]);
+            v4f_t window_hi = v4f_load(&hcaimdct_window_float[i + half]);
+            v4f_t window_lo_rev = v4f_reverse(v4f_load(&hcaimdct_window_float[size - 4 - i]));
+            v4f_t window_hi_rev = v4f_reverse(v4f_load(&hcaimdct_window_float[half - 4 - i]));
+            v4f_t dct_lo = v4f_load(&dct[i]);
+            v4f_t dct_hi = v4f_load(&dct[i + half]);
+            v4f_t dct_lo_rev = v4f_reverse(v4f_load(&dct[half - 4 - i]));
+            v4f_t dct_hi_rev = v4f_reverse(v4f_load(&dct[size - 4 - i]));
+
+            v4f_store(&ch->wave[subframe][i], v4f_add(v4f_mul(window_lo, dct_hi), prev_lo));
+            v4f_store(&ch->wave[subframe][i + half], v4f_sub(v4f_mul(window_hi, dct_hi_rev), prev_hi));
+            v4f_store(&ch->imdct_previous[i], v4f_mul(window_lo_rev, dct_lo_rev));
+            v4f_store(&ch->imdct_previous[i + half], v4f_mul(window_hi_rev, dct_lo));
+        }
+#endif
+        for (; i < half; i++) {
             ch->wave[subframe][i] = hcaimdct_window_float[i] * dct[i + half] + prev[i];
             ch->wave[subframe][i + half] = hcaimdct_window_float[i + half] * dct[size - 1 - i] - prev[i + half];
             ch->imdct_previous[i] = hcaimdct_window_float[size - 1 - i] * dct[half - i - 1];
@@ -82,7 +82,8 @@ static int16_t msadpcm_adpcm_expand_nibble_div(VGMSTREAMCHANNEL* stream, uint8_t
 
 void decode_msadpcm_stereo(VGMSTREAM* vgmstream, sample_t* outbuf, int32_t first_sample, int32_t samples_to_do) {
     VGMSTREAMCHANNEL *stream1, *stream2;
-    uint8_t frame[MSADPCM_MAX_BLOCK_SIZE] = {0};
+    uint8_t frame_buf[MSADPCM_MAX_BLOCK_SIZE];
+    const uint8_t* frame;
     int i, frames_in;
     size_t bytes_per_frame, samples_per_frame;
     off_t frame_offset;
@@ -97,7 +98,7 @@ void decode_msadpcm_stereo(VGMSTREAM* vgmstream, sample_t* outbuf, int32_t first
     first_sample = first_sample % samples_per_frame;
 
     frame_offset = stream1->offset + frames_in * bytes_per_frame;
-    read_streamfile(frame, frame_offset, bytes_per_frame, stream1->streamfile); /* ignore EOF errors */
+    frame = read_streamfile_span(frame_buf, frame_offset, bytes_per_frame, stream1->streamfile); /* ignore EOF errors */
 
     /* parse frame header (ADPCMBLOCKHEADER) */
     if (first_sample == 0) {
@@ -140,7 +141,8 @@ void decode_msadpcm_stereo(VGMSTREAM* vgmstream, sample_t* outbuf, int32_t first
 
 void decode_msadpcm_mono(VGMSTREAM* vgmstream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel, int config) {
     VGMSTREAMCHANNEL* stream = &vgmstream->ch[channel];
-    uint8_t frame[MSADPCM_MAX_BLOCK_SIZE] = {0};
+    uint8_t frame_buf[MSADPCM_MAX_BLOCK_SIZE];
+    const uint8_t* frame;
     int i, frames_in;
     size_t bytes_per_frame, samples_per_frame;
     off_t frame_offset;
@@ -153,7 +155,7 @@ void decode_msadpcm_mono(VGMSTREAM* vgmstream, sample_t* outbuf, int channelspac
     first_sample = first_sample % samples_per_frame;
 
     frame_offset = stream->offset + frames_in * bytes_per_frame;
-    read_streamfile(frame, frame_offset, bytes_per_frame, stream->streamfile); /* ignore EOF errors */
+    frame = read_streamfile_span(frame_buf, frame_offset, bytes_per_frame, stream->streamfile); /* ignore EOF errors */
 
     /* parse frame header */
     if (first_sample == 0) {
@@ -194,7 +196,8 @@ void decode_msadpcm_mono(VGMSTREAM* vgmstream, sample_t* outbuf, int channelspac
  * (their tools may convert to float/others but internally it's all PCM16). */
 void decode_msadpcm_ck(VGMSTREAM* vgmstream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
     VGMSTREAMCHANNEL* stream = &vgmstream->ch[channel];
-    uint8_t frame[MSADPCM_MAX_BLOCK_SIZE] = {0};
+    uint8_t frame_buf[MSADPCM_MAX_BLOCK_SIZE];
+    const uint8_t* frame;
     int i, frames_in;
     size_t bytes_per_frame, samples_per_frame;
     off_t frame_offset;
@@ -206,7 +209,7 @@ void decode_msadpcm_ck(VGMSTREAM* vgmstream, sample_t* outbuf, int channelspacin
     first_sample = first_sample % samples_per_frame;
 
     frame_offset = stream->offset + frames_in * bytes_per_frame;
-    read_streamfile(frame, frame_offset, bytes_per_frame, stream->streamfile); /* ignore EOF errors */
+    frame = read_streamfile_span(frame_buf, frame_offset, bytes_per_frame, stream->streamfile); /* ignore EOF errors */
 
     /* parse frame header */
     if (first_sample == 0) {
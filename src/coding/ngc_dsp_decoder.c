@@ -1,9 +1,12 @@
 #include "coding.h"
 #include "../util.h"
+#include "../util/simd.h"
 
 
+/* Layouts may ask for many frames at once (up to a full interleave block). */
 void decode_ngc_dsp(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    uint8_t frame[0x08] = {0};
+    uint8_t frame_buf[0x08];
+    const uint8_t* frame;
     off_t frame_offset;
     int i, frames_in, sample_count = 0;
     size_t bytes_per_frame, samples_per_frame;
@@ -18,46 +21,165 @@ void decode_ngc_dsp(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspa
     frames_in = first_sample / samples_per_frame;
     first_sample = first_sample % samples_per_frame;
 
-    /* parse frame header */
-    frame_offset = stream->offset + bytes_per_frame * frames_in;
-    read_streamfile(frame, frame_offset, bytes_per_frame, stream->streamfile); /* ignore EOF errors */
-    scale = 1 << ((frame[0] >> 0) & 0xf);
-    coef_index  = (frame[0] >> 4) & 0xf;
+    while (samples_to_do > 0) {
+        int samples_frame = samples_per_frame - first_sample;
+        if (samples_frame > samples_to_do)
+            samples_frame = samples_to_do;
 
-    VGM_ASSERT_ONCE(coef_index > 8, "DSP: incorrect coefs at %x\n", (uint32_t)frame_offset);
-    //if (coef_index > 8) //todo not correctly clamped in original decoder?
-    //    coef_index = 8;
+        /* parse frame header */
+        frame_offset = stream->offset + bytes_per_frame * frames_in;
+        frame = read_streamfile_span(frame_buf, frame_offset, bytes_per_frame, stream->streamfile); /* ignore EOF errors */
+        scale = 1 << ((frame[0] >> 0) & 0xf);
+        coef_index  = (frame[0] >> 4) & 0xf;
 
-    coef1 = stream->adpcm_coef[coef_index*2 + 0];
-    coef2 = stream->adpcm_coef[coef_index*2 + 1];
+        VGM_ASSERT_ONCE(coef_index > 8, "DSP: incorrect coefs at %x\n", (uint32_t)frame_offset);
+        //if (coef_index > 8) //todo not correctly clamped in original decoder?
+        //    coef_index = 8;
 
+        coef1 = stream->adpcm_coef[coef_index*2 + 0];
+        coef2 = stream->adpcm_coef[coef_index*2 + 1];
 
-    /* decode nibbles */
-    for (i = first_sample; i < first_sample + samples_to_do; i++) {
-        int32_t sample = 0;
-        uint8_t nibbles = frame[0x01 + i/2];
 
-        sample = i&1 ? /* high nibble first */
-                get_low_nibble_signed(nibbles) :
-                get_high_nibble_signed(nibbles);
-        sample = ((sample * scale) << 11);
-        sample = (sample + 1024 + coef1*hist1 + coef2*hist2) >> 11;
-        sample = clamp16(sample);
+        /* decode nibbles */
+        for (i = first_sample; i < first_sample + samples_frame; i++) {
+            int32_t sample = 0;
+            uint8_t nibbles = frame[0x01 + i/2];
 
-        outbuf[sample_count] = sample;
-        sample_count += channelspacing;
+            sample = i&1 ? /* high nibble first */
+                    get_low_nibble_signed(nibbles) :
+                    get_high_nibble_signed(nibbles);
+            sample = ((sample * scale) << 11);
+            sample = (sample + 1024 + coef1*hist1 + coef2*hist2) >> 11;
+            sample = clamp16(sample);
 
-        hist2 = hist1;
-        hist1 = sample;
+            outbuf[sample_count] = sample;
+            sample_count += channelspacing;
+
+            hist2 = hist1;
+            hist1 = sample;
+        }
+
+        samples_to_do -= samples_frame;
+        first_sample = 0;
+        frames_in++;
     }
 
     stream->adpcm_history1_16 = hist1;
     stream->adpcm_history2_16 = hist2;
 }
 
+#ifdef VGM_SIMD
+/* Decodes 2-4 channels at once, one per vector lane. Channels are independent but decode the same
+ * samples of their frames, so nibbles are expanded per channel and then the serial hist part is done
+ * for all lanes together. Same results as decode_ngc_dsp. */
+static void decode_ngc_dsp_lanes(VGMSTREAM* v, sample_t* outbuf, int ch_start, int lanes, int32_t first_sample, int32_t samples_to_do) {
+    int32_t terms[14][4] = {0}; /* scaled nibbles + rounding, per sample and lane */
+    int16_t coefs1[4] = {0}, coefs2[4] = {0};
+    int16_t hists1[4] = {0}, hists2[4] = {0};
+    int16_t samples[4];
+    int channels = v->channels;
+
+    int frames_in = first_sample / 14;
+    first_sample = first_sample % 14;
+
+    for (int l = 0; l < lanes; l++) {
+        hists1[l] = v->ch[ch_start + l].adpcm_history1_16;
+        hists2[l] = v->ch[ch_start + l].adpcm_history2_16;
+    }
+    /* hists are clamped samples and coefs are int16, so both taps are done as int16 pairs in one op */
+    v4s_t hist1 = v4s_load(hists1);
+    v4s_t hist2 = v4s_load(hists2);
+
+    while (samples_to_do > 0) {
+        int samples_frame = 14 - first_sample;
+        if (samples_frame > samples_to_do)
+            samples_frame = samples_to_do;
+
+        for (int l = 0; l < lanes; l++) {
+            VGMSTREAMCHANNEL* stream = &v->ch[ch_start + l];
+            uint8_t frame_buf[0x08];
+
+            off_t frame_offset = stream->offset + 0x08 * frames_in;
+            const uint8_t* frame = read_streamfile_span(frame_buf, frame_offset, 0x08, stream->streamfile); /* ignore EOF errors */
+            int scale = 1 << ((frame[0] >> 0) & 0xf);
+            int coef_index = (frame[0] >> 4) & 0xf;
+
+            VGM_ASSERT_ONCE(coef_index > 8, "DSP: incorrect coefs at %x\n", (uint32_t)frame_offset);
+
+            coefs1[l] = stream->adpcm_coef[coef_index*2 + 0];
+            coefs2[l] = stream->adpcm_coef[coef_index*2 + 1];
+
+            for (int i = 0; i < samples_frame; i++) {
+                int pos = first_sample + i;
+                uint8_t nibbles = frame[0x01 + pos/2];
+                int32_t sample = pos&1 ?
+                        get_low_nibble_signed(nibbles) :
+                        get_high_nibble_signed(nibbles);
+                terms[i][l] = ((sample * scale) << 11) + 1024;
+            }
+        }
+
+        v4p_t coefs = v4s_zip(v4s_load(coefs1), v4s_load(coefs2));
+        v4p_t hists = v4s_zip(hist1, hist2);
+
+        for (int i = 0; i < samples_frame; i++) {
+            v4i_t sample = v4i_sra(v4i_add(v4i_load(terms[i]), v4p_madd(coefs, hists)), 11);
+            v4s_t sample16 = v4i_to_v4s(sample);
+
+            /* channels are consecutive in the output */
+            sample_t* out = outbuf + i * channels + ch_start;
+            if (lanes == 4) {
+                v4s_store(out, sample16);
+            }
+            else {
+                v4s_store(samples, sample16);
+                for (int l = 0; l < lanes; l++) {
+                    out[l] = samples[l];
+                }
+            }
+
+            hist2 = hist1;
+            hist1 = sample16;
+            hists = v4s_zip(hist1, hist2);
+        }
+
+        outbuf += samples_frame * channels;
+        samples_to_do -= samples_frame;
+        first_sample = 0;
+        frames_in++;
+    }
+
+    v4s_store(hists1, hist1);
+    v4s_store(hists2, hist2);
+    for (int l = 0; l < lanes; l++) {
+        v->ch[ch_start + l].adpcm_history1_16 = hists1[l];
+        v->ch[ch_start + l].adpcm_history2_16 = hists2[l];
+    }
+}
+#endif
+
+/* decodes all channels (like calling decode_ngc_dsp for each), several at once if possible */
+void decode_ngc_dsp_mc(VGMSTREAM* v, sample_t* outbuf, int32_t first_sample, int32_t samples_to_do) {
+    int ch = 0;
+
+#ifdef VGM_SIMD
+    /* stereo only fills half a vector and isn't faster than scalar */
+    for (; v->channels >= 4 && ch + 1 < v->channels; ch += 4) {
+        int lanes = v->channels - ch;
+        if (lanes > 4)
+            lanes = 4;
+        decode_ngc_dsp_lanes(v, outbuf, ch, lanes, first_sample, samples_to_do);
+    }
+#endif
+
+    for (; ch < v->channels; ch++) {
+        decode_ngc_dsp(&v->ch[ch], outbuf + ch, v->channels, first_sample, samples_to_do);
+    }
+}
+
 
 /* read from memory rather than a file */
-static void decode_ngc_dsp_subint_internal(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, uint8_t * frame) {
+static void decode_ngc_dsp_subint_internal(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, const uint8_t * frame) {
     int i, sample_count = 0;
     size_t bytes_per_frame, samples_per_frame;
     int coef_index, scale, coef1, coef2;
@@ -109,15 +231,17 @@ void decode_ngc_dsp_subint(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int cha
     uint8_t frame[0x08];
     int i;
     int frames_in = first_sample / 14;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     for (i = 0; i < 0x08; i++) {
         /* base + current frame + subint section + subint byte + channel adjust */
-        frame[i] = read_8bit(
+        frame[i] = sf_span_u8(&span,
                 stream->offset
                 + frames_in*(0x08*channelspacing)
                 + i/interleave * interleave * channelspacing
                 + i%interleave
-                + interleave * channel, stream->streamfile);
+                + interleave * channel);
     }
 
     decode_ngc_dsp_subint_internal(stream, outbuf, channelspacing, first_sample, samples_to_do, frame);
@@ -8,54 +8,65 @@
 void decode_pcm16le(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
     int i;
     int32_t sample_count;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        outbuf[sample_count]=read_16bitLE(stream->offset+i*2,stream->streamfile);
+        outbuf[sample_count]=sf_span_s16le(&span, stream->offset+i*2);
     }
 }
 
 void decode_pcm16be(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
     int i;
     int32_t sample_count;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        outbuf[sample_count]=read_16bitBE(stream->offset+i*2,stream->streamfile);
+        outbuf[sample_count]=sf_span_s16be(&span, stream->offset+i*2);
     }
 }
 
 void decode_pcm16_int(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int big_endian) {
     int i, sample_count;
-    int16_t (*read_16bit)(off_t,STREAMFILE*) = big_endian ? read_16bitBE : read_16bitLE;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        outbuf[sample_count]=read_16bit(stream->offset+i*2*channelspacing,stream->streamfile);
+        outbuf[sample_count]=big_endian ? sf_span_s16be(&span, stream->offset+i*2*channelspacing) : sf_span_s16le(&span, stream->offset+i*2*channelspacing);
     }
 }
 
 void decode_pcm8(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
     int i;
     int32_t sample_count;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        outbuf[sample_count]=read_8bit(stream->offset+i,stream->streamfile)*0x100;
+        outbuf[sample_count]=sf_span_s8(&span, stream->offset+i)*0x100;
     }
 }
 
 void decode_pcm8_int(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
     int i;
     int32_t sample_count;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        outbuf[sample_count]=read_8bit(stream->offset+i*channelspacing,stream->streamfile)*0x100;
+        outbuf[sample_count]=sf_span_s8(&span, stream->offset+i*channelspacing)*0x100;
     }
 }
 
 void decode_pcm8_unsigned(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
     int i;
     int32_t sample_count;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        int16_t v = (uint8_t)read_8bit(stream->offset+i,stream->streamfile);
+        int16_t v = sf_span_u8(&span, stream->offset+i);
         outbuf[sample_count] = v*0x100 - 0x8000;
     }
 }
@@ -63,9 +74,11 @@ void decode_pcm8_unsigned(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channe
 void decode_pcm8_unsigned_int(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
     int i;
     int32_t sample_count;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        int16_t v = (uint8_t)read_8bit(stream->offset+i*channelspacing,stream->streamfile);
+        int16_t v = sf_span_u8(&span, stream->offset+i*channelspacing);
         outbuf[sample_count] = v*0x100 - 0x8000;
     }
 }
@@ -73,9 +86,11 @@ void decode_pcm8_unsigned_int(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int ch
 void decode_pcm8_sb(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
     int i;
     int32_t sample_count;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        int16_t v = (uint8_t)read_8bit(stream->offset+i,stream->streamfile);
+        int16_t v = sf_span_u8(&span, stream->offset+i);
         if (v&0x80) v = 0-(v&0x7f);
         outbuf[sample_count] = v*0x100;
     }
@@ -86,6 +101,8 @@ void decode_pcm4(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL* stream, sample_t* outb
     int32_t sample_count;
     int16_t v;
     off_t byte_offset;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     is_high_first = (vgmstream->codec_config & 1);
     is_stereo = (vgmstream->channels != 1);
@@ -98,7 +115,7 @@ void decode_pcm4(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL* stream, sample_t* outb
                 is_stereo ? (!(channel&1) ? 4:0) : (!(i&1) ? 4:0) : /* even = high, odd = low */
                 is_stereo ? (!(channel&1) ? 0:4) : (!(i&1) ? 0:4);  /* even = low, odd = high */
 
-        v = (int16_t)read_8bit(byte_offset, stream->streamfile);
+        v = (int16_t)sf_span_s8(&span, byte_offset);
         v = (v >> nibble_shift) & 0x0F;
         outbuf[sample_count] = v*0x11*0x100;
     }
@@ -109,6 +126,8 @@ void decode_pcm4_unsigned(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL* stream, sampl
     int32_t sample_count;
     int16_t v;
     off_t byte_offset;
+    sf_span_t span;
+    sf_span_init(&span, stream->streamfile);
 
     is_high_first = (vgmstream->codec_config & 1);
     is_stereo = (vgmstream->channels != 1);
@@ -121,7 +140,7 @@ void decode_pcm4_unsigned(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL* stream, sampl
                 is_stereo ? (!(channel&1) ? 4:0) : (!(i&1) ? 4:0) : /* even = high, odd = low */
                 is_stereo ? (!(channel&1) ? 0:4) : (!(i&1) ? 0:4);  /* even = low, odd = high */
 
-        v = (int16_t)read_8bit(byte_offset, stream->streamfile);
+        v = (int16_t)sf_span_s8(&span, byte_offset);
         v = (v >> nibble_shift) & 0x0F;
         outbuf[sample_count] = v*0x11*0x100 - 0x8000;
     }
@@ -1,4 +1,5 @@
 #include "coding.h"
+#include "../util/simd.h"
 
 
 /* PS-ADPCM table, defined as rational numbers (as in the spec) */
@@ -54,27 +55,18 @@ static const int ps_adpcm_coefs_i[5][2] = {
  * depend on platform, PS3 games use floats, etc). There are rounding diffs between implementations.
  */
 
-/* standard PS-ADPCM (float math version) */
-void decode_psx(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int is_badflags, int config) {
-    uint8_t frame[0x10] = {0};
-    off_t frame_offset;
-    int i, frames_in, sample_count = 0;
-    size_t bytes_per_frame, samples_per_frame;
-    uint8_t coef_index, shift_factor, flag;
-    int32_t hist1 = stream->adpcm_history1_32;
-    int32_t hist2 = stream->adpcm_history2_32;
-    int extended_mode = (config == 1);
+#define PSX_FRAME_SIZE      0x10
+#define PSX_FRAME_SAMPLES   28
+#define PSX_BATCH_FRAMES    0x40 /* frames read at once (may decode whole interleave blocks per call) */
 
-
-    /* external interleave (fixed size), mono */
-    bytes_per_frame = 0x10;
-    samples_per_frame = (bytes_per_frame - 0x02) * 2; /* always 28 */
-    frames_in = first_sample / samples_per_frame;
-    first_sample = first_sample % samples_per_frame;
+static void decode_psx_frame(const uint8_t* frame, off_t frame_offset, sample_t* outbuf, int channelspacing, int first_sample, int samples_to_do,
+        int32_t* p_hist1, int32_t* p_hist2, int is_badflags, int extended_mode) {
+    int i, sample_count = 0;
+    uint8_t coef_index, shift_factor, flag;
+    int32_t hist1 = *p_hist1;
+    int32_t hist2 = *p_hist2;
 
     /* parse frame header */
-    frame_offset = stream->offset + bytes_per_frame * frames_in;
-    read_streamfile(frame, frame_offset, bytes_per_frame, stream->streamfile); /* ignore EOF errors */
     coef_index   = (frame[0] >> 4) & 0xf;
     shift_factor = (frame[0] >> 0) & 0xf;
     flag = frame[1]; /* only lower nibble needed */
@@ -93,20 +85,31 @@ void decode_psx(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing,
     VGM_ASSERT_ONCE(flag > 7,"PS-ADPCM: unknown flag at %x\n", (uint32_t)frame_offset); /* meta should use PSX-badflags */
 
 
+    if (flag >= 0x07) { /* with flag 0x07 decoded sample must be 0 (unknown flags too) */
+        for (i = 0; i < samples_to_do; i++) {
+            outbuf[sample_count] = 0;
+            sample_count += channelspacing;
+        }
+        *p_hist1 = 0;
+        *p_hist2 = samples_to_do > 1 ? 0 : hist1;
+        return;
+    }
+
     shift_factor = 20 - shift_factor;
+    /* pre-scaled by 256 (exact for floats, so same result as scaling the sum) */
+    const float coef1 = ps_adpcm_coefs_f[coef_index][0] * 256.0f;
+    const float coef2 = ps_adpcm_coefs_f[coef_index][1] * 256.0f;
+
     /* decode nibbles */
     for (i = first_sample; i < first_sample + samples_to_do; i++) {
-        int32_t sample = 0;
+        uint8_t nibbles = frame[0x02 + i/2];
+        int32_t sample;
 
-        if (flag < 0x07) { /* with flag 0x07 decoded sample must be 0 */
-            uint8_t nibbles = frame[0x02 + i/2];
-            
-            sample = (i&1 ? /* low nibble first */
-                    get_high_nibble_signed(nibbles):
-                    get_low_nibble_signed(nibbles)) << shift_factor; /*scale*/
-            sample = sample + (int32_t)((ps_adpcm_coefs_f[coef_index][0]*hist1 + ps_adpcm_coefs_f[coef_index][1]*hist2) * 256.0f);
-            sample >>= 8;
-        }
+        sample = (i&1 ? /* low nibble first */
+                get_high_nibble_signed(nibbles):
+                get_low_nibble_signed(nibbles)) << shift_factor; /*scale*/
+        sample = sample + (int32_t)(coef1*hist1 + coef2*hist2);
+        sample >>= 8;
 
         outbuf[sample_count] = clamp16(sample); /*clamping*/
         sample_count += channelspacing;
@@ -115,10 +118,195 @@ void decode_psx(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing,
         hist1 = sample;
     }
 
+    *p_hist1 = hist1;
+    *p_hist2 = hist2;
+}
+
+/* standard PS-ADPCM (float math version)
+ * Layouts may ask for many frames at once (up to a full interleave block), read in batches. */
+void decode_psx(VGMSTREAMCHANNEL* stream, sample_t* outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int is_badflags, int config) {
+    uint8_t frames[PSX_FRAME_SIZE * PSX_BATCH_FRAMES];
+    int frames_in;
+    int32_t hist1 = stream->adpcm_history1_32;
+    int32_t hist2 = stream->adpcm_history2_32;
+    int extended_mode = (config == 1);
+
+
+    /* external interleave (fixed size), mono */
+    frames_in = first_sample / PSX_FRAME_SAMPLES;
+    first_sample = first_sample % PSX_FRAME_SAMPLES;
+
+    while (samples_to_do > 0) {
+        off_t frame_offset = stream->offset + PSX_FRAME_SIZE * frames_in;
+        int frames_count = (first_sample + samples_to_do + PSX_FRAME_SAMPLES - 1) / PSX_FRAME_SAMPLES;
+        if (frames_count > PSX_BATCH_FRAMES)
+            frames_count = PSX_BATCH_FRAMES;
+
+        size_t bytes = read_streamfile(frames, frame_offset, PSX_FRAME_SIZE * frames_count, stream->streamfile);
+        if (bytes < PSX_FRAME_SIZE * frames_count) /* ignore EOF errors */
+            memset(frames + bytes, 0, PSX_FRAME_SIZE * frames_count - bytes);
+
+        for (int i = 0; i < frames_count; i++) {
+            int samples_frame = PSX_FRAME_SAMPLES - first_sample;
+            if (samples_frame > samples_to_do)
+                samples_frame = samples_to_do;
+
+            decode_psx_frame(frames + PSX_FRAME_SIZE * i, frame_offset + PSX_FRAME_SIZE * i, outbuf, channelspacing, first_sample, samples_frame,
+                    &hist1, &hist2, is_badflags, extended_mode);
+
+            outbuf += samples_frame * channelspacing;
+            samples_to_do -= samples_frame;
+            first_sample = 0;
+        }
+
+        frames_in += frames_count;
+    }
+
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_history2_32 = hist2;
 }
 
+#ifdef VGM_SIMD
+/* Decodes 2-4 channels at once, one per vector lane. Channels are independent but decode the same
+ * samples of their frames, so frame headers and nibbles are handled per channel and then the serial
+ * hist part is done for all lanes together. Same results as decode_psx (this file is built without FMA
+ * contraction, see build scripts, so its float math matches the lanes). */
+static void decode_psx_lanes(VGMSTREAM* v, sample_t* outbuf, int ch_start, int lanes, int32_t first_sample, int32_t samples_to_do, int is_badflags, int config) {
+    uint8_t frames[4][PSX_FRAME_SIZE * PSX_BATCH_FRAMES];
+    int32_t terms[PSX_FRAME_SAMPLES][4] = {0}; /* scaled nibbles, per sample and lane */
+    float coefs1[4] = {0}, coefs2[4] = {0};
+    int32_t masks[4] = {0}; /* 0 = lane outputs silence (flag 0x07) */
+    int32_t hists1[4] = {0}, hists2[4] = {0};
+    int16_t samples[4];
+    int channels = v->channels;
+    int extended_mode = (config == 1);
+
+    int frames_in = first_sample / PSX_FRAME_SAMPLES;
+    first_sample = first_sample % PSX_FRAME_SAMPLES;
+
+    for (int l = 0; l < lanes; l++) {
+        hists1[l] = v->ch[ch_start + l].adpcm_history1_32;
+        hists2[l] = v->ch[ch_start + l].adpcm_history2_32;
+    }
+    v4i_t hist1 = v4i_load(hists1);
+    v4i_t hist2 = v4i_load(hists2);
+
+    while (samples_to_do > 0) {
+        int frames_count = (first_sample + samples_to_do + PSX_FRAME_SAMPLES - 1) / PSX_FRAME_SAMPLES;
+        if (frames_count > PSX_BATCH_FRAMES)
+            frames_count = PSX_BATCH_FRAMES;
+
+        /* copied rather than borrowed since channels may share a SF */
+        for (int l = 0; l < lanes; l++) {
+            VGMSTREAMCHANNEL* stream = &v->ch[ch_start + l];
+            off_t frame_offset = stream->offset + PSX_FRAME_SIZE * frames_in;
+            size_t bytes = read_streamfile(frames[l], frame_offset, PSX_FRAME_SIZE * frames_count, stream->streamfile);
+            if (bytes < PSX_FRAME_SIZE * frames_count) /* ignore EOF errors */
+                memset(frames[l] + bytes, 0, PSX_FRAME_SIZE * frames_count - bytes);
+        }
+
+        for (int f = 0; f < frames_count; f++) {
+            int samples_frame = PSX_FRAME_SAMPLES - first_sample;
+            if (samples_frame > samples_to_do)
+                samples_frame = samples_to_do;
+
+            /* parse frame headers (see decode_psx_frame) */
+            for (int l = 0; l < lanes; l++) {
+                const uint8_t* frame = frames[l] + PSX_FRAME_SIZE * f;
+                uint8_t coef_index   = (frame[0] >> 4) & 0xf;
+                uint8_t shift_factor = (frame[0] >> 0) & 0xf;
+                uint8_t flag = frame[1];
+
+                if (!extended_mode) {
+                    VGM_ASSERT_ONCE(coef_index > 5 || shift_factor > 12, "PS-ADPCM: incorrect coefs/shift at %x\n",
+                            (uint32_t)(v->ch[ch_start + l].offset + PSX_FRAME_SIZE * (frames_in + f)));
+                    if (coef_index > 5)
+                        coef_index = 0;
+                    if (shift_factor > 12)
+                        shift_factor = 9;
+                }
+
+                if (is_badflags)
+                    flag = 0;
+                VGM_ASSERT_ONCE(flag > 7,"PS-ADPCM: unknown flag at %x\n",
+                        (uint32_t)(v->ch[ch_start + l].offset + PSX_FRAME_SIZE * (frames_in + f)));
+
+                /* silent frames output 0 and keep feeding 0s to hist, same as the regular decoder */
+                masks[l] = flag >= 0x07 ? 0 : -1;
+
+                shift_factor = 20 - shift_factor;
+                coefs1[l] = ps_adpcm_coefs_f[coef_index][0] * 256.0f;
+                coefs2[l] = ps_adpcm_coefs_f[coef_index][1] * 256.0f;
+
+                for (int i = 0; i < samples_frame; i++) {
+                    int pos = first_sample + i;
+                    uint8_t nibbles = frame[0x02 + pos/2];
+                    terms[i][l] = (pos&1 ?
+                            get_high_nibble_signed(nibbles):
+                            get_low_nibble_signed(nibbles)) << shift_factor;
+                }
+            }
+
+            v4f_t coef1 = v4f_load(coefs1);
+            v4f_t coef2 = v4f_load(coefs2);
+            v4i_t mask = v4i_load(masks);
+
+            for (int i = 0; i < samples_frame; i++) {
+                v4f_t pred = v4f_add(v4f_mul(coef1, v4i_to_v4f(hist1)), v4f_mul(coef2, v4i_to_v4f(hist2)));
+                v4i_t sample = v4i_sra(v4i_add(v4i_load(terms[i]), v4f_to_v4i(pred)), 8);
+                sample = v4i_and(sample, mask);
+
+                /* channels are consecutive in the output */
+                sample_t* out = outbuf + i * channels + ch_start;
+                if (lanes == 4) {
+                    v4i_store_s16(out, sample);
+                }
+                else {
+                    v4i_store_s16(samples, sample);
+                    for (int l = 0; l < lanes; l++) {
+                        out[l] = samples[l];
+                    }
+                }
+
+                hist2 = hist1;
+                hist1 = sample;
+            }
+
+            outbuf += samples_frame * channels;
+            samples_to_do -= samples_frame;
+            first_sample = 0;
+        }
+
+        frames_in += frames_count;
+    }
+
+    v4i_store(hists1, hist1);
+    v4i_store(hists2, hist2);
+    for (int l = 0; l < lanes; l++) {
+        v->ch[ch_start + l].adpcm_history1_32 = hists1[l];
+        v->ch[ch_start + l].adpcm_history2_32 = hists2[l];
+    }
+}
+#endif
+
+/* decodes all channels (like calling decode_psx for each), several at once if possible */
+void decode_psx_mc(VGMSTREAM* v, sample_t* outbuf, int32_t first_sample, int32_t samples_to_do, int is_badflags, int config) {
+    int ch = 0;
+
+#ifdef VGM_SIMD
+    for (; ch + 1 < v->channels; ch += 4) {
+        int lanes = v->channels - ch;
+        if (lanes > 4)
+            lanes = 4;
+        decode_psx_lanes(v, outbuf, ch, lanes, first_sample, samples_to_do, is_badflags, config);
+    }
+#endif
+
+    for (; ch < v->channels; ch++) {
+        decode_psx(&v->ch[ch], outbuf + ch, v->channels, first_sample, samples_to_do, is_badflags, config);
+    }
+}
+
 
 /* PS-ADPCM with configurable frame size and no flag (int math version).
  * Found in some PC/PS3 games (FF XI in sizes 0x3/0x5/0x9/0x41, Afrika in size 0x4, Blur/James Bond in size 0x33, etc).
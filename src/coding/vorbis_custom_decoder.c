@@ -188,6 +188,8 @@ static int copy_samples(VGMSTREAM* v) {
     // mark consumed samples from the buffer
     //  (non-consumed samples are returned in next vorbis_synthesis_pcmout calls)
     vorbis_synthesis_read(&data->vd, samples);
+    if (data->samples_done >= 0)
+        data->samples_done += samples;
 
     // TODO: useful?
     //data->op.granulepos += samples; // not actually needed
@@ -201,11 +203,20 @@ static int copy_samples(VGMSTREAM* v) {
 }
 
 static bool decode_frame_vorbis_custom(VGMSTREAM* v) {
+    vorbis_custom_codec_data* data = v->codec_data;
+
     // vorbis may hold samples, return them first
     int ret = copy_samples(v);
     if (ret < 0) return false;
     if (ret > 0) return true;
 
+    // after reset at last packet (which outputs no samples) output would start at current samples
+    if (data->type == VORBIS_WWISE && data->samples_done >= 0) {
+        if (data->prev_packet_offset)
+            seek_table_record_entry(v, data->samples_done, data->prev_packet_offset);
+        data->prev_packet_offset = v->ch[0].offset;
+    }
+
     // handle new frame
     bool read = read_packet(v);
     if (!read) {
@@ -230,6 +241,8 @@ static void reset_vorbis_custom(void* priv_data) {
 
     vorbis_synthesis_restart(&data->vd);
     data->current_discard = 0;
+    data->samples_done = 0;
+    data->prev_packet_offset = 0;
 
     // OOR/OggS state
     data->current_packet = 0;
@@ -260,6 +273,7 @@ static void seek_vorbis_custom(VGMSTREAM* v, int32_t num_sample) {
             reset_vorbis_custom(data);
 
         data->current_discard = skip_samples;
+        data->samples_done = -1;
 
         v->ch[0].offset = seek.offset;
         if (v->loop_ch)
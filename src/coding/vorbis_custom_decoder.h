@@ -27,6 +27,8 @@ struct vorbis_custom_codec_data {
     float* fbuf;
 
     int current_discard;        /* for looping purposes */
+    int32_t samples_done;       /* output samples since reset, for seek table building (-1 if unknown) */
+    uint32_t prev_packet_offset;
 
     vorbis_custom_t type;        /* Vorbis subtype */
     vorbis_custom_config config; /* config depending on the mode */
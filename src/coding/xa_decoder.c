@@ -41,7 +41,7 @@ static const int16_t EA_TABLE[16][2] = {
  * See end for accuracy information and layout info. */
 
 typedef struct {
-    uint8_t frame[0x80];
+    const uint8_t* frame;
     int16_t* sbuf;
     int channels;
     int32_t hist1;
@@ -153,9 +153,10 @@ void decode_xa(VGMSTREAM* v, sample_t* outbuf, int32_t samples_to_do) {
     STREAMFILE* sf = v->ch[0].streamfile;
 
     int ch;
-    int frames_in, bytes, samples_per_frame;
+    int frames_in, samples_per_frame;
     uint32_t frame_offset, bytes_per_frame;
     int32_t first_sample = v->samples_into_block;
+    uint8_t frame_buf[0x80];
     xa_t xa;
 
     xa.channels = v->channels > 1 ? 2 : 1; /* only stereo/mono modes */
@@ -164,16 +165,14 @@ void decode_xa(VGMSTREAM* v, sample_t* outbuf, int32_t samples_to_do) {
     xa.subframes = (xa.is_xa8) ? 4 : 8;
 
     /* external interleave (fixed size), mono/stereo */
-    bytes_per_frame = sizeof(xa.frame);
+    bytes_per_frame = sizeof(frame_buf);
     samples_per_frame = 28 * xa.subframes / v->channels;
     frames_in = first_sample / samples_per_frame;
     first_sample = first_sample % samples_per_frame;
 
     /* parse frame header */
     frame_offset = offset + bytes_per_frame * frames_in;
-    bytes = read_streamfile(xa.frame, frame_offset, bytes_per_frame, sf);
-    if (bytes != sizeof(xa.frame)) /* ignore EOF errors */
-        memset(xa.frame + bytes, 0, bytes_per_frame - bytes);
+    xa.frame = read_streamfile_span(frame_buf, frame_offset, bytes_per_frame, sf); /* ignore EOF errors */
 
     /* headers should repeat in pairs, except in EA's modified XA */
     VGM_ASSERT_ONCE(!xa.is_ea &&
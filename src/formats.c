@@ -1574,6 +1574,8 @@ static const char* get_layout_name(layout_t layout_type) {
 
 static bool has_sublayouts(VGMSTREAM** vgmstreams, int count) {
     for (int i = 0; i < count; i++) {
+        if (!vgmstreams[i]) /* closed segment (never a sublayout) */
+            continue;
         if (vgmstreams[i]->layout_type == layout_segmented || vgmstreams[i]->layout_type == layout_layered)
             return true;
     }
@@ -1598,6 +1600,9 @@ static int get_layout_mixed_description(VGMSTREAM* vgmstream, char* dst, int dst
     int count, done = 0;
     VGMSTREAM** vgmstreams = NULL;
 
+    if (!vgmstream)
+        return 0;
+
     if (vgmstream->layout_type == layout_layered) {
         layered_layout_data* data = vgmstream->layout_data;
         vgmstreams = data->layers;
@@ -4,39 +4,38 @@
 #include "../base/sbuf.h"
 #include "../coding/coding.h"
 
+#define BLOCKED_INDEX_INTERVAL 4096 /* min samples between indexed blocks */
+#define BLOCKED_INDEX_GROWTH 256
+
+/* samples in the current block, as decoded by the layout */
+int blocked_get_block_samples(VGMSTREAM* vgmstream) {
+    if (vgmstream->current_block_samples)
+        return vgmstream->current_block_samples;
+
+    int frame_size = decode_get_frame_size(vgmstream);
+    int samples_per_frame = decode_get_samples_per_frame(vgmstream);
+    if (frame_size == 0) {
+        //TO-DO: this case doesn't seem possible, codecs that return frame_size 0 (should) set current_block_samples
+        return vgmstream->current_block_size * 2 * samples_per_frame;
+    }
+    return vgmstream->current_block_size / frame_size * samples_per_frame;
+}
+
 
 /* Decodes samples for blocked streams.
  * Data is divided into headered blocks with a bunch of data. The layout calls external helper functions
  * when a block is decoded, and those must parse the new block and move offsets accordingly. */
 void render_vgmstream_blocked(sbuf_t* sdst, VGMSTREAM* vgmstream) {
 
-    int frame_size = decode_get_frame_size(vgmstream);
     int samples_per_frame = decode_get_samples_per_frame(vgmstream);
-    int samples_this_block = 0;
-
-    if (vgmstream->current_block_samples) {
-        samples_this_block = vgmstream->current_block_samples;
-    }
-    else if (frame_size == 0) {
-        //TO-DO: this case doesn't seem possible, codecs that return frame_size 0 (should) set current_block_samples
-        samples_this_block = vgmstream->current_block_size * 2 * samples_per_frame;
-    }
-    else {
-        samples_this_block = vgmstream->current_block_size / frame_size * samples_per_frame;
-    }
+    int samples_this_block = blocked_get_block_samples(vgmstream);
 
     while (sdst->filled < sdst->samples) {
         int samples_to_do; 
 
         if (vgmstream->loop_flag && decode_do_loop(vgmstream)) {
             /* handle looping, readjust back to loop start values */
-            if (vgmstream->current_block_samples) {
-                samples_this_block = vgmstream->current_block_samples;
-            } else if (frame_size == 0) { /* assume 4 bit */
-                samples_this_block = vgmstream->current_block_size * 2 * samples_per_frame;
-            } else {
-                samples_this_block = vgmstream->current_block_size / frame_size * samples_per_frame;
-            }
+            samples_this_block = blocked_get_block_samples(vgmstream);
             continue;
         }
 
@@ -69,21 +68,15 @@ void render_vgmstream_blocked(sbuf_t* sdst, VGMSTREAM* vgmstream) {
         /* move to next block when all samples are consumed */
         if (vgmstream->samples_into_block == samples_this_block
                 /*&& vgmstream->current_sample < vgmstream->num_samples*/) { /* don't go past last block */ //todo
-            block_update(vgmstream->next_block_offset, vgmstream);
+            off_t block_offset = vgmstream->next_block_offset;
+            size_t full_block_size = vgmstream->full_block_size;
+
+            block_update(block_offset, vgmstream);
+            blocked_index_add(vgmstream, vgmstream->current_sample, block_offset, full_block_size);
 
             /* update since these may change each block */
-            frame_size = decode_get_frame_size(vgmstream);
             samples_per_frame = decode_get_samples_per_frame(vgmstream);
-            if (vgmstream->current_block_samples) {
-                samples_this_block = vgmstream->current_block_samples;
-            }
-            else if (frame_size == 0) {
-                //TO-DO: this case doesn't seem possible, codecs that return frame_size 0 (should) set current_block_samples
-                samples_this_block = vgmstream->current_block_size * 2 * samples_per_frame;
-            }
-            else {
-                samples_this_block = vgmstream->current_block_size / frame_size * samples_per_frame;
-            }
+            samples_this_block = blocked_get_block_samples(vgmstream);
 
             vgmstream->samples_into_block = 0;
         }
@@ -218,3 +211,175 @@ void block_update(off_t block_offset, VGMSTREAM* vgmstream) {
             break;
     }
 }
+
+
+/* Block index: first sample and offset of blocks every few samples, recorded while counting samples on open,
+ * while playing, or by walking block headers when seeking. Seeking can then parse the block before the target
+ * again (as if the layout had reached it) instead of decoding everything up to it. */
+
+typedef struct {
+    int32_t sample;
+    off_t offset;
+    size_t full_block_size;     /* before parsing the block (some layouts find the next block with it) */
+} block_entry_t;
+
+typedef struct {
+    block_entry_t* entries;
+    int count;
+    int capacity;
+} block_index_t;
+
+static bool is_blocked(VGMSTREAM* vgmstream) {
+    return vgmstream->layout_type > layout_interleave && vgmstream->layout_type < layout_segmented;
+}
+
+void blocked_index_add(VGMSTREAM* vgmstream, int32_t sample, off_t block_offset, size_t full_block_size) {
+    block_index_t* index = vgmstream->block_index;
+
+    /* entries are ordered (blocks after loops/seeks are ignored) */
+    if (index && index->count > 0 && sample < index->entries[index->count - 1].sample + BLOCKED_INDEX_INTERVAL)
+        return;
+    if (sample <= 0 || block_offset < 0)
+        return;
+
+    if (!index) {
+        index = calloc(1, sizeof(block_index_t));
+        if (!index) return;
+
+        /* also for resets, as start_vgmstream is restored then */
+        vgmstream->block_index = index;
+        if (vgmstream->start_vgmstream)
+            ((VGMSTREAM*)vgmstream->start_vgmstream)->block_index = index;
+    }
+
+    if (index->count >= index->capacity) {
+        int new_capacity = index->capacity + BLOCKED_INDEX_GROWTH;
+        block_entry_t* new_entries = realloc(index->entries, new_capacity * sizeof(block_entry_t));
+        if (!new_entries) return;
+
+        index->entries = new_entries;
+        index->capacity = new_capacity;
+    }
+
+    block_entry_t* entry = &index->entries[index->count];
+    entry->sample = sample;
+    entry->offset = block_offset;
+    entry->full_block_size = full_block_size;
+    index->count++;
+}
+
+void blocked_index_free(VGMSTREAM* vgmstream) {
+    block_index_t* index = vgmstream->block_index;
+    if (!index)
+        return;
+
+    free(index->entries);
+    free(index);
+}
+
+size_t blocked_index_get_memory_size(VGMSTREAM* vgmstream) {
+    block_index_t* index = vgmstream->block_index;
+    if (!index)
+        return 0;
+    return sizeof(block_index_t) + index->capacity * sizeof(block_entry_t);
+}
+
+/* parses block headers from the last indexed block up to the one with target_sample, adding them to the index */
+static void walk_blocks(VGMSTREAM* vgmstream, int32_t target_sample) {
+    block_index_t* index = vgmstream->block_index;
+    off_t max_offset = get_streamfile_size(vgmstream->ch[0].streamfile);
+    int32_t sample;
+
+    if (index && index->count > 0) {
+        block_entry_t* entry = &index->entries[index->count - 1];
+        if (target_sample < entry->sample + BLOCKED_INDEX_INTERVAL)
+            return; /* can't add closer entries */
+
+        vgmstream->full_block_size = entry->full_block_size;
+        block_update(entry->offset, vgmstream);
+        sample = entry->sample;
+    }
+    else {
+        VGMSTREAM* start = vgmstream->start_vgmstream;
+
+        vgmstream->current_block_offset = start->current_block_offset;
+        vgmstream->current_block_size = start->current_block_size;
+        vgmstream->current_block_samples = start->current_block_samples;
+        vgmstream->next_block_offset = start->next_block_offset;
+        vgmstream->full_block_size = start->full_block_size;
+        sample = 0;
+    }
+
+    while (true) {
+        int block_samples = blocked_get_block_samples(vgmstream);
+        if (block_samples < 0 || vgmstream->current_block_offset < 0 || vgmstream->current_block_offset == 0xFFFFFFFF)
+            break;
+        if (sample + block_samples > target_sample)
+            break;
+
+        off_t block_offset = vgmstream->next_block_offset;
+        size_t full_block_size = vgmstream->full_block_size;
+        if (block_offset <= vgmstream->current_block_offset || block_offset >= max_offset)
+            break;
+
+        block_update(block_offset, vgmstream);
+        sample += block_samples;
+        blocked_index_add(vgmstream, sample, block_offset, full_block_size);
+    }
+}
+
+/* Moves to the start of the last indexed block at or before target_sample, if it's after min_sample.
+ * ADPCM history is cleared before parsing the block (which may set it), for codecs that rebuild it.
+ * Returns the block's first sample, or -1 if the layout didn't move. */
+int32_t blocked_seek_block(VGMSTREAM* vgmstream, int32_t target_sample, int32_t min_sample) {
+    if (!is_blocked(vgmstream))
+        return -1;
+
+    /* walking changes the current block, restored after as it may not find a block to move to */
+    VGMSTREAMCHANNEL* ch = malloc(sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+    if (!ch) return -1;
+    memcpy(ch, vgmstream->ch, sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+    off_t current_block_offset = vgmstream->current_block_offset;
+    size_t current_block_size = vgmstream->current_block_size;
+    int32_t current_block_samples = vgmstream->current_block_samples;
+    off_t next_block_offset = vgmstream->next_block_offset;
+    size_t full_block_size = vgmstream->full_block_size;
+
+    walk_blocks(vgmstream, target_sample);
+
+    memcpy(vgmstream->ch, ch, sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+    free(ch);
+    vgmstream->current_block_offset = current_block_offset;
+    vgmstream->current_block_size = current_block_size;
+    vgmstream->current_block_samples = current_block_samples;
+    vgmstream->next_block_offset = next_block_offset;
+    vgmstream->full_block_size = full_block_size;
+
+
+    block_index_t* index = vgmstream->block_index;
+    if (!index)
+        return -1;
+
+    block_entry_t* entry = NULL;
+    for (int i = 0; i < index->count; i++) {
+        if (index->entries[i].sample > target_sample)
+            break;
+        entry = &index->entries[i];
+    }
+    if (!entry || entry->sample <= min_sample)
+        return -1;
+
+    /* same as seek_frame_jump (DSP keeps history in _16, others in _32) */
+    for (int i = 0; i < vgmstream->channels; i++) {
+        vgmstream->ch[i].adpcm_history1_16 = 0;
+        vgmstream->ch[i].adpcm_history2_16 = 0;
+        vgmstream->ch[i].adpcm_history1_32 = 0;
+        vgmstream->ch[i].adpcm_history2_32 = 0;
+    }
+    vgmstream->full_block_size = entry->full_block_size;
+    block_update(entry->offset, vgmstream);
+
+    vgmstream->current_sample = entry->sample;
+    vgmstream->samples_into_block = 0;
+    return entry->sample;
+}
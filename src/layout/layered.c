@@ -5,9 +5,86 @@
 #include "../base/plugins.h"
 #include "../base/sbuf.h"
 #include "../base/render.h"
+#include "../util/threads.h"
 
 #define VGMSTREAM_MAX_LAYERS 255
 #define VGMSTREAM_LAYER_SAMPLE_BUFFER 8192
+#define LAYERED_MAX_THREADS 32
+
+
+/* Parallel mode: each layer renders into its own buffer, with fixed layers per thread (thread N does
+ * layers N, N + threads, ...) and the caller's thread as thread 0. Layers are then copied in order like
+ * usual. Layers are independent VGMSTREAMs, so output is the same as rendering them one by one. */
+typedef struct {
+    vgm_thread_t thread;
+    vgm_event_t start;
+    vgm_event_t done;
+    struct layered_workers_t* workers;
+    int index;
+} layered_worker_t;
+
+typedef struct layered_workers_t {
+    layered_layout_data* data;
+    int count;                  /* threads, including caller's */
+    int started;                /* extra threads */
+    layered_worker_t* list;
+    void** buffers;             /* per layer */
+    sbuf_t* sbufs;              /* per layer */
+    int samples_to_do;
+    bool quit;
+} layered_workers_t;
+
+static void render_layer(layered_layout_data* data, int layer, sbuf_t* ssrc, void* buffer, int samples_to_do) {
+    VGMSTREAM* vl = data->layers[layer];
+    double time_start = vgm_get_time();
+
+    // layers may have their own number of channels/format (buf is as big as needed)
+    sfmt_t format = mixing_get_input_sample_type(vl);
+    sbuf_init(ssrc, format, buffer, samples_to_do, vl->channels);
+
+    render_main(ssrc, vl);
+
+    double time_elapsed = vgm_get_time() - time_start;
+    vgm_mutex_lock(&data->times_lock);
+    data->layer_times[layer] += time_elapsed;
+    vgm_mutex_unlock(&data->times_lock);
+}
+
+static void render_worker_layers(layered_workers_t* workers, int index) {
+    layered_layout_data* data = workers->data;
+
+    for (int layer = index; layer < data->layer_count; layer += workers->count) {
+        render_layer(data, layer, &workers->sbufs[layer], workers->buffers[layer], workers->samples_to_do);
+    }
+}
+
+static void layered_worker(void* arg) {
+    layered_worker_t* worker = arg;
+    layered_workers_t* workers = worker->workers;
+
+    while (true) {
+        vgm_event_wait(&worker->start);
+        if (workers->quit)
+            break;
+
+        render_worker_layers(workers, worker->index);
+        vgm_event_set(&worker->done);
+    }
+}
+
+static void render_layers_parallel(layered_workers_t* workers, int samples_to_do) {
+    workers->samples_to_do = samples_to_do;
+
+    for (int i = 0; i < workers->started; i++) {
+        vgm_event_set(&workers->list[i].start);
+    }
+
+    render_worker_layers(workers, 0);
+
+    for (int i = 0; i < workers->started; i++) {
+        vgm_event_wait(&workers->list[i].done);
+    }
+}
 
 
 /* Decodes samples for layered streams.
@@ -41,18 +118,24 @@ void render_vgmstream_layered(sbuf_t* sdst, VGMSTREAM* vgmstream) {
 
         /* decode all layers */
         ch = 0;
-        for (int current_layer = 0; current_layer < data->layer_count; current_layer++) {
-            VGMSTREAM* vl = data->layers[current_layer];
+        if (data->workers) {
+            render_layers_parallel(data->workers, samples_to_do);
 
-            // layers may have their own number of channels/format (buf is as big as needed)
-            sfmt_t format = mixing_get_input_sample_type(vl);
-            sbuf_init(ssrc, format, data->buffer, samples_to_do, vl->channels);
+            for (int current_layer = 0; current_layer < data->layer_count; current_layer++) {
+                ssrc = &data->workers->sbufs[current_layer];
 
-            render_main(ssrc, vl);
+                sbuf_copy_layers(sdst, ssrc, ch, samples_to_do);
+                ch += ssrc->channels;
+            }
+        }
+        else {
+            for (int current_layer = 0; current_layer < data->layer_count; current_layer++) {
+                render_layer(data, current_layer, ssrc, data->buffer, samples_to_do);
 
-            // mix layer samples to main samples
-            sbuf_copy_layers(sdst, ssrc, ch, samples_to_do);
-            ch += ssrc->channels;
+                // mix layer samples to main samples
+                sbuf_copy_layers(sdst, ssrc, ch, samples_to_do);
+                ch += ssrc->channels;
+            }
         }
 
         sdst->filled += samples_to_do;
@@ -119,9 +202,17 @@ layered_layout_data* init_layout_layered(int layer_count) {
     data = calloc(1, sizeof(layered_layout_data));
     if (!data) goto fail;
 
+    if (!vgm_mutex_init(&data->times_lock)) {
+        free(data);
+        return NULL;
+    }
+
     data->layers = calloc(layer_count, sizeof(VGMSTREAM*));
     if (!data->layers) goto fail;
 
+    data->layer_times = calloc(layer_count, sizeof(double));
+    if (!data->layer_times) goto fail;
+
     data->layer_count = layer_count;
 
     return data;
@@ -177,7 +268,8 @@ bool setup_layout_layered(layered_layout_data* data) {
         /* loops and other values could be mismatched, but should be handled on allocate */
 
         /* init mixing */
-        mixing_setup(data->layers[i], VGMSTREAM_LAYER_SAMPLE_BUFFER);
+        if (!mixing_setup(data->layers[i], VGMSTREAM_LAYER_SAMPLE_BUFFER))
+            goto fail;
 
         /* allow config if set for fine-tuned parts (usually TXTP only) */
         data->layers[i]->config_enabled = data->layers[i]->config.config_set;
@@ -195,7 +287,8 @@ bool setup_layout_layered(layered_layout_data* data) {
 
     /* create internal buffer big enough for mixing all layers */
     free(data->buffer);
-    data->buffer = malloc(VGMSTREAM_LAYER_SAMPLE_BUFFER * max_input_channels * max_sample_size);
+    data->buffer_size = VGMSTREAM_LAYER_SAMPLE_BUFFER * max_input_channels * max_sample_size;
+    data->buffer = malloc(data->buffer_size);
     if (!data->buffer) goto fail;
 
     data->input_channels = max_input_channels;
@@ -206,14 +299,116 @@ fail:
     return false; /* caller is expected to free */
 }
 
+static void free_workers(layered_layout_data* data) {
+    layered_workers_t* workers = data->workers;
+    if (!workers)
+        return;
+
+    workers->quit = true;
+    for (int i = 0; i < workers->started; i++) {
+        vgm_event_set(&workers->list[i].start);
+        vgm_thread_join(&workers->list[i].thread);
+        vgm_event_free(&workers->list[i].start);
+        vgm_event_free(&workers->list[i].done);
+    }
+
+    if (workers->buffers) {
+        for (int i = 0; i < data->layer_count; i++) {
+            free(workers->buffers[i]);
+        }
+    }
+    free(workers->buffers);
+    free(workers->sbufs);
+    free(workers->list);
+    free(workers);
+    data->workers = NULL;
+}
+
+/* Enables parallel decoding of layers with N threads (including caller's), or disables it if 1 or less.
+ * Returns false if layers can't be decoded in parallel (not layered or can't create threads). */
+bool layered_set_threads(VGMSTREAM* vgmstream, int threads) {
+    if (!vgmstream || vgmstream->layout_type != layout_layered)
+        return false;
+    layered_layout_data* data = vgmstream->layout_data;
+
+    free_workers(data);
+
+    if (threads > data->layer_count)
+        threads = data->layer_count;
+    if (threads > LAYERED_MAX_THREADS)
+        threads = LAYERED_MAX_THREADS;
+    if (threads <= 1)
+        return threads == 1;
+
+    layered_workers_t* workers = calloc(1, sizeof(layered_workers_t));
+    if (!workers) goto fail;
+    data->workers = workers;
+
+    workers->data = data;
+    workers->count = threads;
+
+    workers->buffers = calloc(data->layer_count, sizeof(void*));
+    workers->sbufs = calloc(data->layer_count, sizeof(sbuf_t));
+    workers->list = calloc(threads - 1, sizeof(layered_worker_t));
+    if (!workers->buffers || !workers->sbufs || !workers->list) goto fail;
+
+    int sample_size = sfmt_get_sample_size(data->fmt);
+    for (int i = 0; i < data->layer_count; i++) {
+        int input_channels, output_channels;
+        mixing_info(data->layers[i], &input_channels, &output_channels);
+
+        workers->buffers[i] = malloc(VGMSTREAM_LAYER_SAMPLE_BUFFER * input_channels * sample_size);
+        if (!workers->buffers[i]) goto fail;
+    }
+
+    for (int i = 0; i < threads - 1; i++) {
+        layered_worker_t* worker = &workers->list[i];
+        worker->workers = workers;
+        worker->index = i + 1;
+
+        if (!vgm_event_init(&worker->start))
+            break;
+        if (!vgm_event_init(&worker->done)) {
+            vgm_event_free(&worker->start);
+            break;
+        }
+        if (!vgm_thread_start(&worker->thread, layered_worker, worker)) {
+            vgm_event_free(&worker->start);
+            vgm_event_free(&worker->done);
+            break;
+        }
+        workers->started++;
+    }
+
+    /* layers are assigned by thread count, so fix it if some threads couldn't be created */
+    if (workers->started == 0) goto fail;
+    workers->count = workers->started + 1;
+
+    return true;
+fail:
+    free_workers(data);
+    return false;
+}
+
+/* Copies current decode times (workers may be updating them) into 'times' (layer_count doubles). */
+void layered_get_layer_times(layered_layout_data* data, double* times) {
+    vgm_mutex_lock(&data->times_lock);
+    memcpy(times, data->layer_times, data->layer_count * sizeof(double));
+    vgm_mutex_unlock(&data->times_lock);
+}
+
 void free_layout_layered(layered_layout_data* data) {
     if (!data)
         return;
 
+    free_workers(data);
+
     for (int i = 0; i < data->layer_count; i++) {
         close_vgmstream(data->layers[i]);
     }
     free(data->layers);
+    free(data->layer_times);
+    vgm_mutex_free(&data->times_lock);
     free(data->buffer);
     free(data);
 }
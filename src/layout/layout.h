@@ -6,6 +6,7 @@
 #include "../util/reader_sf.h"
 #include "../util/log.h"
 #include "../base/sbuf.h"
+#include "../util/threads.h"
 
 /* basic layouts */
 void render_vgmstream_flat(sbuf_t* sbuf, VGMSTREAM* vgmstream);
@@ -15,15 +16,41 @@ void render_vgmstream_interleave(sbuf_t* sbuf, VGMSTREAM* vgmstream);
 
 /* segmented layout */
 /* for files made of "continuous" segments, one per section of a song (using a complete sub-VGMSTREAM) */
+
+/* segment values needed by the layout, so segments may stay closed (see segmented_set_opener) */
+typedef struct {
+    int32_t samples;        /* play samples after setup */
+    int32_t num_samples;    /* values as opened */
+    int32_t loop_start_sample;
+    int32_t loop_end_sample;
+    int sample_rate;
+    int input_channels;
+    int output_channels;
+    uint32_t channel_layout;
+    sfmt_t fmt;
+    coding_t coding_type;
+    meta_t meta_type;
+} segment_info_t;
+
 typedef struct {
     int segment_count;
     VGMSTREAM** segments;
     int current_segment;
     sample_t* buffer;
+    size_t buffer_size;
     int input_channels;     /* internal buffer channels */
     int output_channels;    /* resulting channels (after mixing, if applied) */
     bool mixed_channels;     /* segments have different number of channels */
     sfmt_t fmt;
+
+    /* optional reopening of segments, so only a few need to stay open (see segmented_set_opener) */
+    VGMSTREAM* (*open_segment)(void* priv, int segment);
+    void (*free_priv)(void* priv);
+    void* priv;
+    bool* can_reopen;       /* segment may be closed (set by caller) */
+    segment_info_t* segment_infos; /* set on setup (or before for segments closed while parsing) */
+    int loop_segment;       /* segment with loop start (kept open) */
+    int max_open;           /* 0 = all segments stay open */
 } segmented_layout_data;
 
 void render_vgmstream_segmented(sbuf_t* sbuf, VGMSTREAM* vgmstream);
@@ -33,6 +60,10 @@ void free_layout_segmented(segmented_layout_data* data);
 void reset_layout_segmented(segmented_layout_data* data);
 void seek_layout_segmented(VGMSTREAM* vgmstream, int32_t seek_sample);
 void loop_layout_segmented(VGMSTREAM* vgmstream, int32_t loop_sample);
+bool segmented_set_opener(segmented_layout_data* data, VGMSTREAM* (*open_segment)(void* priv, int segment), void (*free_priv)(void* priv), void* priv);
+void segmented_set_max_open(VGMSTREAM* vgmstream, int max_open);
+bool segmented_describe_segment(VGMSTREAM* vs, int segment, segment_info_t* info);
+void segmented_release_segment(segmented_layout_data* data, int segment, STREAMFILE* sf);
 
 
 /* layered layout */
@@ -41,11 +72,15 @@ typedef struct {
     int layer_count;
     VGMSTREAM** layers;
     void* buffer;
+    size_t buffer_size;
     int input_channels;     /* internal buffer channels */
     int output_channels;    /* resulting channels (after mixing, if applied) */
     int external_looping;   /* don't loop using per-layer loops, but layout's own looping */
     int curr_layer;         /* helper */
     sfmt_t fmt;
+    double* layer_times;    /* decode time of each layer (stats) */
+    vgm_mutex_t times_lock; /* layer_times are updated by workers and read by the caller */
+    struct layered_workers_t* workers; /* parallel decoding, if enabled */
 } layered_layout_data;
 
 void render_vgmstream_layered(sbuf_t* sbuf, VGMSTREAM* vgmstream);
@@ -55,11 +90,18 @@ void free_layout_layered(layered_layout_data* data);
 void reset_layout_layered(layered_layout_data* data);
 void seek_layout_layered(VGMSTREAM* vgmstream, int32_t seek_sample);
 void loop_layout_layered(VGMSTREAM* vgmstream, int32_t loop_sample);
+bool layered_set_threads(VGMSTREAM* vgmstream, int threads);
+void layered_get_layer_times(layered_layout_data* data, double* times);
 
 
 /* blocked layouts */
 void render_vgmstream_blocked(sbuf_t* sbuf, VGMSTREAM* vgmstream);
 void block_update(off_t block_offset, VGMSTREAM* vgmstream);
+int blocked_get_block_samples(VGMSTREAM* vgmstream);
+void blocked_index_add(VGMSTREAM* vgmstream, int32_t sample, off_t block_offset, size_t full_block_size);
+void blocked_index_free(VGMSTREAM* vgmstream);
+size_t blocked_index_get_memory_size(VGMSTREAM* vgmstream);
+int32_t blocked_seek_block(VGMSTREAM* vgmstream, int32_t target_sample, int32_t min_sample);
 
 void block_update_ast(off_t block_ofset, VGMSTREAM* vgmstream);
 void block_update_mxch(off_t block_ofset, VGMSTREAM* vgmstream);
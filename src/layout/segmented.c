@@ -8,6 +8,127 @@
 
 #define VGMSTREAM_MAX_SEGMENTS 1024
 #define VGMSTREAM_SEGMENT_SAMPLE_BUFFER 8192
+#define SEGMENTED_MIN_OPEN 2
+
+
+/* roughly equivalent to vgmstream.c's init_vgmstream_internal stuff */
+static void prepare_segment(VGMSTREAM* vs, int segment) {
+    /* allow config if set for fine-tuned parts (usually TXTP only) */
+    vs->config_enabled = vs->config.config_set;
+
+    /* disable so that looping is controlled by render_vgmstream_segmented */
+    if (vs->loop_flag != 0) {
+        VGM_LOG("SEGMENTED: segment %i is looped\n", segment);
+
+        /* config allows internal loops */
+        if (!vs->config_enabled) {
+            vs->loop_flag = 0;
+        }
+    }
+}
+
+static bool finish_segment(VGMSTREAM* vs) {
+    /* init mixing */
+    if (!mixing_setup(vs, VGMSTREAM_SEGMENT_SAMPLE_BUFFER))
+        return false;
+
+    /* final setup in case the VGMSTREAM was created manually */
+    setup_vgmstream(vs);
+    return true;
+}
+
+/* Sets up a segment for the layout and gets values the layout needs (false on errors). Segments closed while
+ * parsing (see segmented_release_segment) are described with this, then setup uses the saved info. */
+bool segmented_describe_segment(VGMSTREAM* vs, int segment, segment_info_t* info) {
+    info->num_samples = vs->num_samples;
+    info->loop_start_sample = vs->loop_start_sample;
+    info->loop_end_sample = vs->loop_end_sample;
+    info->sample_rate = vs->sample_rate;
+    info->channel_layout = vs->channel_layout;
+    info->coding_type = vs->coding_type;
+    info->meta_type = vs->meta_type;
+
+    prepare_segment(vs, segment);
+
+    /* different segments may have different input or output channels (in rare cases of using ex. 2ch + 4ch) */
+    mixing_info(vs, &info->input_channels, &info->output_channels);
+    info->fmt = mixing_get_input_sample_type(vs);
+
+    if (!finish_segment(vs))
+        return false;
+
+    info->samples = vgmstream_get_samples(vs);
+    return true;
+}
+
+/* returns segment, reopening it if was closed before */
+static VGMSTREAM* get_segment(segmented_layout_data* data, int segment) {
+    if (data->segments[segment])
+        return data->segments[segment];
+    if (!data->open_segment)
+        return NULL;
+
+    VGMSTREAM* vs = data->open_segment(data->priv, segment);
+    if (!vs) {
+        VGM_LOG("SEGMENTED: can't reopen segment %i\n", segment);
+        return NULL;
+    }
+
+    /* shouldn't happen but buffers and positions depend on this */
+    segment_info_t info;
+    if (!segmented_describe_segment(vs, segment, &info)) {
+        VGM_LOG("SEGMENTED: can't setup reopened segment %i\n", segment);
+        close_vgmstream(vs);
+        return NULL;
+    }
+    if (info.samples != data->segment_infos[segment].samples || info.input_channels > data->input_channels) {
+        VGM_LOG("SEGMENTED: reopened segment %i changed\n", segment);
+        close_vgmstream(vs);
+        return NULL;
+    }
+
+    /* inner layouts were configured on open */
+    segmented_set_max_open(vs, data->max_open);
+
+    data->segments[segment] = vs;
+    return vs;
+}
+
+static bool close_segment(segmented_layout_data* data, int segment) {
+    /* first and loop segments are kept as they are needed on reset/loop */
+    if (!data->segments[segment] || !data->can_reopen[segment] || segment == 0 || segment == data->loop_segment)
+        return false;
+
+    close_vgmstream(data->segments[segment]);
+    data->segments[segment] = NULL;
+    return true;
+}
+
+/* opens the next segment ahead of time and closes others until max open segments is reached */
+static void update_open_segments(segmented_layout_data* data) {
+    if (data->max_open <= 0)
+        return;
+
+    int current = data->current_segment;
+    if (current + 1 < data->segment_count)
+        get_segment(data, current + 1); /* retried on segment change if fails */
+
+    int open = 0;
+    for (int i = 0; i < data->segment_count; i++) {
+        if (data->segments[i])
+            open++;
+    }
+
+    /* segments behind are less likely to be needed soon (only after loops/seeks) */
+    for (int i = 0; i < current && open > data->max_open; i++) {
+        if (close_segment(data, i))
+            open--;
+    }
+    for (int i = data->segment_count - 1; i > current + 1 && open > data->max_open; i--) {
+        if (close_segment(data, i))
+            open--;
+    }
+}
 
 
 /* Decodes samples for segmented streams.
@@ -26,9 +147,10 @@ void render_vgmstream_segmented(sbuf_t* sbuf, VGMSTREAM* vgmstream) {
     }
 
     int current_channels = 0;
-    VGMSTREAM* vs = data->segments[data->current_segment];
+    VGMSTREAM* vs = get_segment(data, data->current_segment);
+    if (!vs) goto decode_fail;
     mixing_info(vs, NULL, &current_channels);
-    int samples_this_block = vgmstream_get_samples(vs);
+    int samples_this_block = data->segment_infos[data->current_segment].samples;
 
     while (sbuf->filled < sbuf->samples) {
         int samples_to_do;
@@ -39,8 +161,9 @@ void render_vgmstream_segmented(sbuf_t* sbuf, VGMSTREAM* vgmstream) {
             /* handle loop end to start (loop_layout_segmented has been called in decode_loop_loop) */
 
             // update temp vars, since state changed in decode_do_loop > loop_layout_segmented
-            vs = data->segments[data->current_segment];
-            samples_this_block = vgmstream_get_samples(vs);
+            vs = get_segment(data, data->current_segment);
+            if (!vs) goto decode_fail;
+            samples_this_block = data->segment_infos[data->current_segment].samples;
             mixing_info(vs, NULL, &current_channels);
 
             ;VGM_LOG("SEGMENTED: loop point\n");
@@ -57,10 +180,12 @@ void render_vgmstream_segmented(sbuf_t* sbuf, VGMSTREAM* vgmstream) {
                 goto decode_fail;
             }
 
-            vs = data->segments[data->current_segment];
+            vs = get_segment(data, data->current_segment);
+            if (!vs) goto decode_fail;
             reset_vgmstream(vs); // in case of looping spanning multiple segments
+            update_open_segments(data);
 
-            samples_this_block = vgmstream_get_samples(vs);
+            samples_this_block = data->segment_infos[data->current_segment].samples;
             mixing_info(vs, NULL, &current_channels);
             vgmstream->samples_into_block = 0;
             continue;
@@ -119,15 +244,18 @@ void seek_layout_segmented(VGMSTREAM* vgmstream, int32_t seek_sample) {
     int segment = 0;
     int total_samples = 0;
     while (total_samples < vgmstream->num_samples) {
-        int32_t segment_samples = vgmstream_get_samples(data->segments[segment]);
+        int32_t segment_samples = data->segment_infos[segment].samples;
 
         /* find if sample falls within segment's samples */
         if (seek_sample >= total_samples && seek_sample < total_samples + segment_samples) {
             int32_t seek_relative = seek_sample - total_samples;
             //;VGM_LOG("SEEK [segmented]: found segment=%i, seek_relative=%i (total=%i, target=%i)\n", segment, seek_relative, total_samples, seek_sample);
 
-            seek_vgmstream(data->segments[segment], seek_relative);
+            VGMSTREAM* vs = get_segment(data, segment);
+            if (vs) /* otherwise render will output silence */
+                seek_vgmstream(vs, seek_relative);
             data->current_segment = segment;
+            update_open_segments(data);
 
             vgmstream->current_sample = seek_sample; 
             vgmstream->samples_into_block = seek_relative; //relative to current segment
@@ -161,8 +289,12 @@ segmented_layout_data* init_layout_segmented(int segment_count) {
     data->segments = calloc(segment_count, sizeof(VGMSTREAM*));
     if (!data->segments) goto fail;
 
+    data->segment_infos = calloc(segment_count, sizeof(segment_info_t));
+    if (!data->segment_infos) goto fail;
+
     data->segment_count = segment_count;
     data->current_segment = 0;
+    data->loop_segment = -1;
 
     return data;
 fail:
@@ -178,67 +310,51 @@ bool setup_layout_segmented(segmented_layout_data* data) {
 
     /* setup each VGMSTREAM (roughly equivalent to vgmstream.c's init_vgmstream_internal stuff) */
     for (int i = 0; i < data->segment_count; i++) {
+        segment_info_t* info = &data->segment_infos[i];
 
         if (data->segments[i] == NULL) {
-            VGM_LOG("SEGMENTED: no vgmstream in segment %i\n", i);
-            return false;
-        }
-
-        if (data->segments[i]->num_samples <= 0) {
-            VGM_LOG("SEGMENTED: no samples in segment %i\n", i);
-            return false;
+            /* closed while parsing, already described */
+            if (!data->open_segment || info->samples <= 0) {
+                VGM_LOG("SEGMENTED: no vgmstream in segment %i\n", i);
+                return false;
+            }
         }
-
-        /* allow config if set for fine-tuned parts (usually TXTP only) */
-        data->segments[i]->config_enabled = data->segments[i]->config.config_set;
-
-        /* disable so that looping is controlled by render_vgmstream_segmented */
-        if (data->segments[i]->loop_flag != 0) {
-            VGM_LOG("SEGMENTED: segment %i is looped\n", i);
-
-            /* config allows internal loops */
-            if (!data->segments[i]->config_enabled) {
-                data->segments[i]->loop_flag = 0;
+        else {
+            if (data->segments[i]->num_samples <= 0) {
+                VGM_LOG("SEGMENTED: no samples in segment %i\n", i);
+                return false;
             }
+
+            if (!segmented_describe_segment(data->segments[i], i, info))
+                return false;
         }
 
-        /* different segments may have different input or output channels (in rare cases of using ex. 2ch + 4ch) */
-        int segment_input_channels, segment_output_channels;
-        mixing_info(data->segments[i], &segment_input_channels, &segment_output_channels);
-        if (max_input_channels < segment_input_channels)
-            max_input_channels = segment_input_channels;
-        if (max_output_channels < segment_output_channels)
-            max_output_channels = segment_output_channels;
+        if (max_input_channels < info->input_channels)
+            max_input_channels = info->input_channels;
+        if (max_output_channels < info->output_channels)
+            max_output_channels = info->output_channels;
 
         if (i > 0) {
-            int prev_output_channels;
+            segment_info_t* prev = &data->segment_infos[i-1];
 
-            mixing_info(data->segments[i-1], NULL, &prev_output_channels);
-            if (segment_output_channels != prev_output_channels) {
+            if (info->output_channels != prev->output_channels) {
                 mixed_channels = true;
-                //VGM_LOG("SEGMENTED: segment %i has wrong channels %i vs prev channels %i\n", i, segment_output_channels, prev_output_channels);
+                //VGM_LOG("SEGMENTED: segment %i has wrong channels %i vs prev channels %i\n", i, info->output_channels, prev->output_channels);
                 //goto fail;
             }
 
             /* a bit weird, but no matter (should resample) */
-            if (data->segments[i]->sample_rate != data->segments[i-1]->sample_rate) {
+            if (info->sample_rate != prev->sample_rate) {
                 VGM_LOG("SEGMENTED: segment %i has different sample rate\n", i);
             }
 
             /* perfectly acceptable */
-            //if (data->segments[i]->coding_type != data->segments[i-1]->coding_type)
+            //if (info->coding_type != prev->coding_type)
             //    goto fail;
         }
 
-        sfmt_t current_sample_type = mixing_get_input_sample_type(data->segments[i]);
-        if (max_sample_type < current_sample_type && max_sample_type != SFMT_FLT) //float has priority
-            max_sample_type = current_sample_type;
-
-        /* init mixing */
-        mixing_setup(data->segments[i], VGMSTREAM_SEGMENT_SAMPLE_BUFFER);
-
-        /* final setup in case the VGMSTREAM was created manually */
-        setup_vgmstream(data->segments[i]);
+        if (max_sample_type < info->fmt && max_sample_type != SFMT_FLT) //float has priority
+            max_sample_type = info->fmt;
     }
 
     if (max_output_channels > VGMSTREAM_MAX_CHANNELS || max_input_channels > VGMSTREAM_MAX_CHANNELS)
@@ -250,7 +366,8 @@ bool setup_layout_segmented(segmented_layout_data* data) {
 
     /* create internal buffer big enough for mixing */
     free(data->buffer);
-    data->buffer = malloc(VGMSTREAM_SEGMENT_SAMPLE_BUFFER * max_input_channels * max_sample_size);
+    data->buffer_size = VGMSTREAM_SEGMENT_SAMPLE_BUFFER * max_input_channels * max_sample_size;
+    data->buffer = malloc(data->buffer_size);
     if (!data->buffer) goto fail;
 
     data->input_channels = max_input_channels;
@@ -269,6 +386,9 @@ void free_layout_segmented(segmented_layout_data* data) {
     for (int i = 0; i < data->segment_count; i++) {
         bool is_repeat = false;
 
+        if (!data->segments[i]) /* closed */
+            continue;
+
         /* segments are allowed to be repeated so don't close the same thing twice */
         for (int j = 0; j < i; j++) {
             if (data->segments[i] == data->segments[j]) {
@@ -283,6 +403,10 @@ void free_layout_segmented(segmented_layout_data* data) {
     }
     free(data->segments);
     free(data->buffer);
+    free(data->segment_infos);
+    free(data->can_reopen);
+    if (data->free_priv)
+        data->free_priv(data->priv);
     free(data);
 }
 
@@ -291,8 +415,106 @@ void reset_layout_segmented(segmented_layout_data* data) {
         return;
 
     for (int i = 0; i < data->segment_count; i++) {
+        if (!data->segments[i]) /* closed, reopened in initial state */
+            continue;
         reset_vgmstream(data->segments[i]);
     }
 
     data->current_segment = 0;
 }
+
+
+/* Sets a callback that reopens segments, so they can be closed when not needed. Caller marks which segments
+ * can be reopened (same config as originally opened) in data->can_reopen after this. priv is freed with the layout. */
+bool segmented_set_opener(segmented_layout_data* data, VGMSTREAM* (*open_segment)(void* priv, int segment), void (*free_priv)(void* priv), void* priv) {
+    if (!data || data->open_segment)
+        return false;
+
+    data->can_reopen = calloc(data->segment_count, sizeof(bool));
+    if (!data->can_reopen)
+        return false;
+
+    data->open_segment = open_segment;
+    data->free_priv = free_priv;
+    data->priv = priv;
+    return true;
+}
+
+/* Limits segments kept open at once to max_open (0 = all open) in segmented layouts that can reopen segments,
+ * including segments/layers inside. Others keep all segments open. */
+void segmented_set_max_open(VGMSTREAM* vgmstream, int max_open) {
+    if (!vgmstream)
+        return;
+
+    if (vgmstream->layout_type == layout_layered) {
+        layered_layout_data* data = vgmstream->layout_data;
+        for (int i = 0; i < data->layer_count; i++) {
+            segmented_set_max_open(data->layers[i], max_open);
+        }
+        return;
+    }
+
+    if (vgmstream->layout_type != layout_segmented)
+        return;
+    segmented_layout_data* data = vgmstream->layout_data;
+
+    for (int i = 0; i < data->segment_count; i++) {
+        segmented_set_max_open(data->segments[i], max_open);
+    }
+
+    if (!data->open_segment)
+        return;
+
+    if (max_open > 0 && max_open < SEGMENTED_MIN_OPEN)
+        max_open = SEGMENTED_MIN_OPEN;
+    data->max_open = max_open;
+
+    for (int i = 0; i < data->segment_count; i++) {
+        VGMSTREAM* vs = data->segments[i];
+        if (!vs)
+            continue;
+
+        /* repeated segments can't be closed separately */
+        for (int j = 0; j < data->segment_count; j++) {
+            if (j != i && data->segments[j] == vs)
+                data->can_reopen[i] = false;
+        }
+    }
+
+    /* keep loop start segment to avoid reopening on every loop */
+    data->loop_segment = -1;
+    if (vgmstream->loop_flag) {
+        int32_t total_samples = 0;
+        for (int i = 0; i < data->segment_count; i++) {
+            if (vgmstream->loop_start_sample < total_samples + data->segment_infos[i].samples) {
+                data->loop_segment = i;
+                break;
+            }
+            total_samples += data->segment_infos[i].samples;
+        }
+    }
+}
+
+/* Parsers with an opener may call this right after opening each segment (and reading what they need from it):
+ * if the SF hints that only a few segments should stay open, the segment is described and closed until first
+ * used, so opening doesn't need all segments at once. The first segment is kept (it's needed right away). */
+void segmented_release_segment(segmented_layout_data* data, int segment, STREAMFILE* sf) {
+    if (!sf || sf->max_open_segments <= 0)
+        return;
+    if (!data->open_segment || !data->can_reopen[segment] || segment == 0 || !data->segments[segment])
+        return;
+
+    VGMSTREAM* vs = data->segments[segment];
+    for (int i = 0; i < data->segment_count; i++) {
+        if (i != segment && data->segments[i] == vs)
+            return;
+    }
+
+    if (vs->num_samples <= 0)
+        return; /* let setup fail */
+
+    if (!segmented_describe_segment(vs, segment, &data->segment_infos[segment]))
+        return; /* kept open, setup describes it again */
+    close_vgmstream(vs);
+    data->segments[segment] = NULL;
+}
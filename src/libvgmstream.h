@@ -54,7 +54,7 @@
  * - only refers to the API itself, changes related to formats/etc don't alter this
  * - vgmstream's features are mostly stable, but this API may be tweaked from time to time
  */
-#define LIBVGMSTREAM_API_VERSION_MAJOR 0x01    // breaking API/ABI changes
+#define LIBVGMSTREAM_API_VERSION_MAJOR 0x02    // breaking API/ABI changes
 #define LIBVGMSTREAM_API_VERSION_MINOR 0x00    // compatible API/ABI changes
 #define LIBVGMSTREAM_API_VERSION_PATCH 0x00    // fixes
 
@@ -65,6 +65,17 @@ LIBVGMSTREAM_API uint32_t libvgmstream_get_version(void);
 
 /* CHANGELOG:
  * - 1.0.0: initial version
+ * - 2.0.0: libvgmstream_config_t is bigger (new fields below); since callers allocate it and _setup copies it whole,
+ *          programs built against 1.x must be rebuilt
+ *          added libvgmstream_get_stats, libvgmstream_set_index_cache, libvgmstream_set_key_cache,
+ *          libvgmstream_set_seek_cache, libvgmstream_build_seek_table, libstreamfile_open_from_mmap,
+ *          libvgmstream_config_t.layer_threads, libvgmstream_stats_t.layer_*,
+ *          libvgmstream_config_t.max_open_segments, libvgmstream_set_read_cache, libvgmstream_stats_t.read_cache_*,
+ *          libvgmstream_config_t.read_ahead_size, libvgmstream_stats_t.memory_size,
+ *          libvgmstream_set_open_threads, libvgmstream_stats_t.entry_*,
+ *          libvgmstream_config_t.decode_ahead_samples, libvgmstream_stats_t.decode_ahead_*
+ *          files read by one reader per channel now share a 2MB read cache by default (more memory per file than 1.x,
+ *          libvgmstream_set_read_cache(0) restores the old behavior)
  */
 
 
@@ -188,6 +199,19 @@ typedef struct {
 
     libvgmstream_sfmt_t force_sfmt;         // forces output buffer to be remixed into some sample format
 
+    int layer_threads;                      // decodes layers of multi-layer files (some multichannel music) using up to N threads
+                                            // ** 0/1 = disabled; output is the same, but uses more CPU cores
+
+    int max_open_segments;                  // keeps at most N segments open in multi-segment files (some playlists/TXTP), reopening as needed
+                                            // ** 0 = all open; lowers memory/open files for files with many segments (min 2)
+
+    int read_ahead_size;                    // reads file data in windows of N bytes, loading the next one in a background thread when reading sequentially
+                                            // ** 0 = disabled; for slow IO (network storage); only applies to next _open_stream
+
+    int decode_ahead_samples;               // decodes up to N samples ahead in a background thread, so _render/_fill only copy ready samples and don't wait
+                                            // ** 0 = disabled; if decoding can't keep up they return fewer or 0 samples (_fill blanks the rest), see stats
+                                            // ** rounded up to a power of 2, and capped at 256MB of samples (so max depends on channels and sample type)
+
   //int format_id;                          // force a format (for example when loading new subsong of the same archive, for a minuscule speed up)
   //                                        // ** only applies when called before _open_stream
 
@@ -250,9 +274,93 @@ LIBVGMSTREAM_API void libvgmstream_reset(libvgmstream_t* lib);
 LIBVGMSTREAM_API libvgmstream_t* libvgmstream_create(libstreamfile_t* libsf, int subsong, libvgmstream_config_t* cfg);
 
 
+/* internal counters of the current song, mainly for performance testing (values are info-only) */
+typedef struct {
+    int probe_reads;                        // reads that reached the file while identifying the format
+
+    /* process-wide (shared by all libvgmstream_t) */
+    int index_cache_hits;                   // bank indexes reused when opening subsongs
+    int index_cache_misses;                 // bank indexes that had to be parsed
+    int index_cache_evictions;              // bank indexes removed to stay within budget
+    int64_t index_cache_size;               // current memory used by the cache
+
+    /* multi-layer files (0/NULL otherwise) */
+    int layer_count;                        // number of layers
+    const double* layer_times;              // total decode time of each layer so far, in seconds (copied on each call)
+
+    /* read cache shared by channels (0 if not used) */
+    int64_t read_cache_file_bytes;          // bytes read from the file
+    int64_t read_cache_served_bytes;        // bytes returned to decoders
+
+    int64_t memory_size;                    // approximate memory held by the song's internal state, including layers/segments
+                                            // (excludes codec libraries and file buffers)
+
+    /* files made of other files, like TXTP (0/NULL otherwise) */
+    int entry_count;                        // number of entries
+    const double* entry_open_times;         // time spent opening each entry, in seconds
+
+    /* decode-ahead (0 if not used) */
+    int decode_ahead_underruns;             // _render calls that found no samples ready
+    int decode_ahead_ready;                 // decoded samples waiting to be returned
+} libvgmstream_stats_t;
+
+/* Gets current song's internal counters
+ * - returns NULL if no song is loaded
+ * - returned struct is owned by libvgmstream and valid until next _open_stream/_close_stream
+ * - values are a snapshot taken on each call (not updated while decoding)
+ */
+LIBVGMSTREAM_API const libvgmstream_stats_t* libvgmstream_get_stats(libvgmstream_t* lib);
+
+
 /*****************************************************************************/
 /* HELPERS */
 
+/* Sets memory budget (in bytes) of the process-wide cache of parsed bank indexes
+ * - some formats with many subsongs must parse a big header to open a subsong, so results are
+ *   cached and reused when opening other subsongs of the same file
+ * - least recently used entries are removed when over budget; 0 disables the cache (and frees it)
+ * - default is 32MB
+ */
+LIBVGMSTREAM_API void libvgmstream_set_index_cache(int64_t max_size);
+
+/* Sets memory budget (in bytes) of the read cache that channels of the same file share (shared by all libvgmstream_t)
+ * - files with many channels or blocks may be read by one reader per channel, that otherwise re-read the same data
+ * - each opened file gets its own cache of up to this size; least recently used parts are removed when over budget
+ * - enabled by default with 2MB; 0 disables it (each channel keeps a separate buffer, like 1.x); applies to next _open_stream
+ * - may be called while other threads open streams
+ */
+LIBVGMSTREAM_API void libvgmstream_set_read_cache(int64_t max_size);
+
+/* Sets threads used to open entries of formats made of other files, currently TXTP (shared by all libvgmstream_t)
+ * - TXTP with many entries (like subsongs of big banks) may be slow to open one by one
+ * - with threads > 1, custom IO (libstreamfile_t) passed to _open_stream is called from those threads, since
+ *   parsers read and open companion files (->open) while opening entries: each handle is only used by one thread
+ *   at a time, but different handles may be opened/read/closed at once, so any state they share must be thread-safe
+ * - default is 1 (no threads); applies to next _open_stream
+ */
+LIBVGMSTREAM_API void libvgmstream_set_open_threads(int threads);
+
+/* Sets a text file to keep decryption keys found by searching key lists (shared by all libvgmstream_t).
+ * - keys in the file are loaded and tried first, and new keys are appended, so next runs skip slow searches
+ * - found keys are always remembered in memory for the current process, this just makes them persistent
+ * - by default no file is used (libvgmstream doesn't write files unless asked); NULL stops saving
+ */
+LIBVGMSTREAM_API void libvgmstream_set_key_cache(const char* filename);
+
+/* Sets a dir to keep seek tables built by libvgmstream_build_seek_table (shared by all libvgmstream_t).
+ * - tables in the dir are loaded on open, so seeking in files without usable frame offsets (currently
+ *   Wwise Vorbis only) doesn't need to decode from the beginning
+ * - by default no dir is used (libvgmstream doesn't write files unless asked); NULL disables it
+ */
+LIBVGMSTREAM_API void libvgmstream_set_seek_cache(const char* path);
+
+/* Decodes the whole stream once to build a seek table and saves it to the seek cache dir (slow).
+ * - returns false if seek cache isn't set or codec can't use built tables; true if it existed or was built
+ * - decoder is reset after this
+ */
+LIBVGMSTREAM_API bool libvgmstream_build_seek_table(libvgmstream_t* lib);
+
+
 typedef enum {
     LIBVGMSTREAM_LOG_LEVEL_ALL      = 0,
     LIBVGMSTREAM_LOG_LEVEL_DEBUG    = 20,
@@ -10,6 +10,10 @@
  *
  * If your case is too different you may still create a partial streamfile: returning a fake filename, only handling "open"
  * that reopens itself (same filename), etc. Simpler formats should work fine.
+ *
+ * A handle is only used by one thread at a time, but with libvgmstream_set_open_threads > 1 different handles
+ * (including ones made with ->open) may be used from several threads at once, so state shared between them
+ * (a parent archive, connection, etc) must be thread-safe in that case.
  */
 
 
@@ -55,6 +59,12 @@ static inline void libstreamfile_close(libstreamfile_t* libsf) {
 /* base libstreamfile using STDIO (cached) */
 LIBVGMSTREAM_API libstreamfile_t* libstreamfile_open_from_stdio(const char* filename);
 
+/* base libstreamfile using a memory-mapped file, shared when vgmstream reopens the same file (no per-channel buffers)
+ * - files that can't be mapped (pipes, etc) use STDIO instead
+ * - only for trusted local files that won't change while open: on POSIX, if the file is truncated
+ *   (ex. overwritten by another program) reading it crashes the process with SIGBUS; use STDIO otherwise */
+LIBVGMSTREAM_API libstreamfile_t* libstreamfile_open_from_mmap(const char* filename);
+
 /* base libstreamfile using a FILE (cached); the filename is needed as metadata */
 LIBVGMSTREAM_API libstreamfile_t* libstreamfile_open_from_file(void* file, const char* filename);
 
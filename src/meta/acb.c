@@ -1,6 +1,7 @@
 #include "meta.h"
 #include "../coding/coding.h"
 #include "../util/cri_utf.h"
+#include "../base/index_cache.h"
 
 
 /* ACB (Atom Cue sheet Binary) - CRI container of memory audio, often together with a .awb wave bank */
@@ -180,6 +181,14 @@ typedef struct  {
 } WaveformExtensionData_t;
 
 
+/* names/config found for a wave */
+typedef struct {
+    int16_t waveform_index;
+    int awbname_count;
+    int16_t awbname_list[ACB_MAX_NAMELIST];
+    char name[ACB_MAX_NAME];
+} acb_wave_t;
+
 typedef struct {
     STREAMFILE* acbFile; /* original reference, don't close */
 
@@ -222,7 +231,6 @@ typedef struct {
 
     /* config */
     int is_memory;
-    int target_waveid;
     int target_port;
 
     /* to avoid infinite/circular references (AtomViewer crashes otherwise) */
@@ -230,12 +238,10 @@ typedef struct {
     int sequence_depth;
 
     /* name/config stuff */
-    int16_t waveform_index;
     int16_t cuename_index;
     const char* cuename_name;
-    int awbname_count;
-    int16_t awbname_list[ACB_MAX_NAMELIST];
-    char name[ACB_MAX_NAME];
+    acb_wave_t** waves; /* per waveid, all found at once so they can be cached */
+    int waves_count;
 } acb_header;
 
 
@@ -277,39 +283,65 @@ static void acb_cpy(char* dst, int dst_max, const char* src) {
     strcpy(dst, src);
 }
 
-static void add_acb_name(acb_header* acb, int8_t Streaming) {
+static void add_acb_name(acb_header* acb, acb_wave_t* wave, int8_t Streaming) {
     if (!acb->cuename_name) {
         //;VGM_LOG("acb: no name\n");
         return;
     }
 
     /* ignore name repeats */
-    if (acb->awbname_count) {
+    if (wave->awbname_count) {
         int i;
-        for (i = 0; i < acb->awbname_count; i++) {
-            if (acb->awbname_list[i] == acb->cuename_index)
+        for (i = 0; i < wave->awbname_count; i++) {
+            if (wave->awbname_list[i] == acb->cuename_index)
                 return;
         }
     }
 
     /* since waveforms can be reused by cues, multiple names are a thing */
-    if (acb->awbname_count) {
-        acb_cat(acb->name, sizeof(acb->name), "; ");
-        acb_cat(acb->name, sizeof(acb->name), acb->cuename_name);
+    if (wave->awbname_count) {
+        acb_cat(wave->name, sizeof(wave->name), "; ");
+        acb_cat(wave->name, sizeof(wave->name), acb->cuename_name);
     }
     else {
-        acb_cpy(acb->name, sizeof(acb->name), acb->cuename_name);
+        acb_cpy(wave->name, sizeof(wave->name), acb->cuename_name);
     }
     if (Streaming == 2 && acb->is_memory) {
-        acb_cat(acb->name, sizeof(acb->name), " [pre]");
+        acb_cat(wave->name, sizeof(wave->name), " [pre]");
     }
 
-    acb->awbname_list[acb->awbname_count] = acb->cuename_index;
-    acb->awbname_count++;
-    if (acb->awbname_count >= ACB_MAX_NAMELIST)
-        acb->awbname_count = ACB_MAX_NAMELIST - 1; /* ??? */
+    wave->awbname_list[wave->awbname_count] = acb->cuename_index;
+    wave->awbname_count++;
+    if (wave->awbname_count >= ACB_MAX_NAMELIST)
+        wave->awbname_count = ACB_MAX_NAMELIST - 1; /* ??? */
 
-    //;VGM_LOG("acb: found cue for waveid=%i: %s\n", acb->target_waveid, acb->cuename_name);
+    //;VGM_LOG("acb: found cue for waveid=%i: %s\n", waveid, acb->cuename_name);
+}
+
+static acb_wave_t* get_acb_wave(acb_header* acb, uint16_t waveid) {
+
+    if (!acb->waves) {
+        int max_id = 0;
+        for (int i = 0; i < acb->Waveform_rows; i++) {
+            if (max_id < acb->Waveform[i].Id)
+                max_id = acb->Waveform[i].Id;
+        }
+
+        acb->waves_count = max_id + 1;
+        acb->waves = calloc(acb->waves_count, sizeof(acb_wave_t*));
+        if (!acb->waves) return NULL;
+    }
+
+    if (waveid >= acb->waves_count)
+        return NULL;
+
+    if (!acb->waves[waveid]) {
+        acb->waves[waveid] = calloc(1, sizeof(acb_wave_t));
+        if (!acb->waves[waveid]) return NULL;
+        acb->waves[waveid]->waveform_index = -1;
+    }
+
+    return acb->waves[waveid];
 }
 
 
@@ -378,10 +410,6 @@ static int load_acb_waveform(acb_header* acb, uint16_t Index) {
     r = &acb->Waveform[Index];
     //;VGM_LOG("acb: Waveform[%i]: Id=%i, PortNo=%i, Streaming=%i\n", Index, r->Id, r->PortNo, r->Streaming);
 
-    /* not found but valid */
-    if (r->Id != acb->target_waveid)
-        return 1;
-
     /* correct AWB port (check ignored if set to -1) */
     if (acb->target_port >= 0 && r->PortNo != 0xFFFF && r->PortNo != acb->target_port)
         return 1;
@@ -390,11 +418,14 @@ static int load_acb_waveform(acb_header* acb, uint16_t Index) {
     if ((acb->is_memory && r->Streaming == 1) || (!acb->is_memory && r->Streaming == 0))
         return 1;
 
+    acb_wave_t* wave = get_acb_wave(acb, r->Id);
+    if (!wave) goto fail;
+
     /* save waveid <> Index translation */
-    acb->waveform_index = Index;
+    wave->waveform_index = Index;
 
     /* aaand finally get name (phew) */
-    add_acb_name(acb, r->Streaming);
+    add_acb_name(acb, wave, r->Streaming);
 
     return 1;
 fail:
@@ -1150,15 +1181,12 @@ fail:
 }
 
 /* for Switch Opus that has loop info in a separate "WaveformExtensionData" table (pointed by a field in Waveform) */
-static int load_acb_loops(acb_header* acb, VGMSTREAM* vgmstream) {
+static int load_acb_loops(acb_header* acb, acb_wave_t* wave, uint32_t* p_loop_start, uint32_t* p_loop_end) {
     Waveform_t* rw;
     WaveformExtensionData_t* r;
-    uint16_t WaveIndex = acb->waveform_index;
+    uint16_t WaveIndex = wave->waveform_index;
     uint16_t ExtensionIndex = -1;
 
-    if (vgmstream->loop_flag)
-        return 0;
-
     /* assumes that will be init'd before while searching for names */
     if (WaveIndex < 0) goto fail;
     //if (!preload_acb_waveform(acb)) goto fail;
@@ -1179,7 +1207,8 @@ static int load_acb_loops(acb_header* acb, VGMSTREAM* vgmstream) {
 
     //;VGM_LOG("acb: WaveformExtensionData[%i]: LoopStart=%i, LoopEnd=%i\n", ExtensionIndex, r->LoopStart, r->LoopEnd);
 
-    vgmstream_force_loop(vgmstream, 1, r->LoopStart, r->LoopEnd);
+    *p_loop_start = r->LoopStart;
+    *p_loop_end = r->LoopEnd;
 
     return 1;
 fail:
@@ -1218,42 +1247,81 @@ fail:
  * per table, meaning it uses a decent chunk of memory, but having to re-read with streamfiles is much slower.
  */
 
-void load_acb_wave_info(STREAMFILE* sf, VGMSTREAM* vgmstream, int waveid, int port, int is_memory, int load_loops) {
+/* info of all waves for one port, as the whole .acb must be read to find a single wave's names
+ * (so it's cached, otherwise loading all subsongs of big .acb+awb would be very slow) */
+typedef struct {
+    uint32_t name_offset;   /* from index start, 0 if not set */
+    uint32_t loop_start;
+    uint32_t loop_end;
+    uint8_t loop_flag;
+} acb_index_entry_t;
 
-    if (!sf || !vgmstream || waveid < 0)
-        return;
+typedef struct {
+    int entries_count;
+    /* entries + names go after this */
+} acb_index_t;
 
-    //;VGM_LOG("acb: find waveid=%i, port=%i\n", waveid, port);
+static acb_index_entry_t* get_acb_index_entries(const acb_index_t* index) {
+    return (acb_index_entry_t*)(index + 1);
+}
+
+static acb_index_t* build_acb_index(STREAMFILE* sf, int port, int is_memory, size_t* p_index_size) {
+    acb_index_t* index = NULL;
+    bool ok = true;
 
     acb_header acb = {0};
     acb.acbFile = sf;
 
     acb.Header = utf_open(acb.acbFile, 0x00, NULL, NULL);
-    if (!acb.Header) return;
+    if (!acb.Header) return NULL;
 
-    acb.target_waveid = waveid;
     acb.target_port = port;
     acb.is_memory = is_memory;
-    acb.waveform_index = -1;
 
     /* read all possible cue names and find which waveids are referenced by it */
     preload_acb_cuename(&acb);
     for (int i = 0; i < acb.CueName_rows; i++) {
-        if (!load_acb_cuename(&acb, i))
-            goto fail;
+        if (!load_acb_cuename(&acb, i)) {
+            ok = false;
+            break;
+        }
     }
 
-    /* meh copy */
-    if (acb.awbname_count > 0) {
-        strncpy(vgmstream->stream_name, acb.name, STREAM_NAME_SIZE);
-        vgmstream->stream_name[STREAM_NAME_SIZE - 1] = '\0';
+    /* on errors nothing is used, but save an empty index to avoid retrying */
+    int entries_count = ok ? acb.waves_count : 0;
+
+    size_t index_size = sizeof(acb_index_t) + entries_count * sizeof(acb_index_entry_t);
+    for (int i = 0; i < entries_count; i++) {
+        acb_wave_t* wave = acb.waves[i];
+        if (wave && wave->awbname_count > 0)
+            index_size += strlen(wave->name) + 1;
     }
 
-    /* uncommon */
-    if (load_loops) {
-        load_acb_loops(&acb, vgmstream);
+    index = calloc(1, index_size);
+    if (!index) goto fail;
+
+    index->entries_count = entries_count;
+
+    acb_index_entry_t* entries = get_acb_index_entries(index);
+    uint32_t name_offset = sizeof(acb_index_t) + entries_count * sizeof(acb_index_entry_t);
+    for (int i = 0; i < entries_count; i++) {
+        acb_wave_t* wave = acb.waves[i];
+        if (!wave)
+            continue;
+
+        if (wave->awbname_count > 0) {
+            size_t name_size = strlen(wave->name) + 1;
+            memcpy((uint8_t*)index + name_offset, wave->name, name_size);
+            entries[i].name_offset = name_offset;
+            name_offset += name_size;
+        }
+
+        /* uncommon */
+        entries[i].loop_flag = load_acb_loops(&acb, wave, &entries[i].loop_start, &entries[i].loop_end);
     }
 
+    *p_index_size = index_size;
+
     /* done */
 fail:
     utf_close(acb.Header);
@@ -1280,4 +1348,48 @@ fail:
     free(acb.Synth);
     free(acb.Waveform);
     free(acb.WaveformExtensionData);
+
+    for (int i = 0; i < acb.waves_count; i++) {
+        free(acb.waves[i]);
+    }
+    free(acb.waves);
+
+    return index;
+}
+
+void load_acb_wave_info(STREAMFILE* sf, VGMSTREAM* vgmstream, int waveid, int port, int is_memory, int load_loops) {
+    char key[32];
+
+    if (!sf || !vgmstream || waveid < 0)
+        return;
+
+    //;VGM_LOG("acb: find waveid=%i, port=%i\n", waveid, port);
+
+    snprintf(key, sizeof(key), "acb:%i:%i", port, is_memory);
+
+    const acb_index_t* index = index_cache_get(sf, key, NULL);
+    if (!index) {
+        size_t index_size = 0;
+        acb_index_t* new_index = build_acb_index(sf, port, is_memory, &index_size);
+        if (!new_index) return;
+
+        index = index_cache_add(sf, key, new_index, index_size);
+    }
+
+    if (waveid < index->entries_count) {
+        const acb_index_entry_t* entry = &get_acb_index_entries(index)[waveid];
+
+        /* meh copy */
+        if (entry->name_offset) {
+            strncpy(vgmstream->stream_name, (const char*)index + entry->name_offset, STREAM_NAME_SIZE);
+            vgmstream->stream_name[STREAM_NAME_SIZE - 1] = '\0';
+        }
+
+        /* uncommon */
+        if (load_loops && entry->loop_flag && !vgmstream->loop_flag) {
+            vgmstream_force_loop(vgmstream, 1, entry->loop_start, entry->loop_end);
+        }
+    }
+
+    index_cache_release(index);
 }
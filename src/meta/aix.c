@@ -183,6 +183,58 @@ fail:
     return NULL;
 }
 
+static VGMSTREAM* build_segment(STREAMFILE* sf, aix_header_t* aix, int segment) {
+    /* build the layered sub-VGMSTREAM */
+    VGMSTREAM* vgmstream = build_layered_vgmstream(sf, aix, segment);
+    if (!vgmstream) return NULL;
+
+    vgmstream->stream_size = aix->segment_sizes[segment];
+
+    vgmstream->num_samples = aix->segment_samples[segment];
+#if 0
+    /* should be the same as layer's */
+    if (aix->segment_samples[segment] != 0) {
+        vgmstream->num_samples = aix->segment_samples[segment];
+    }
+#endif
+    return vgmstream;
+}
+
+/* segments can be rebuilt from the header, so the layout may close them (some AIX have ~100) */
+typedef struct {
+    STREAMFILE* sf;
+    aix_header_t aix;
+} aix_opener_t;
+
+static VGMSTREAM* reopen_segment(void* priv, int segment) {
+    aix_opener_t* opener = priv;
+    return build_segment(opener->sf, &opener->aix, segment);
+}
+
+static void free_opener(void* priv) {
+    aix_opener_t* opener = priv;
+    if (!opener)
+        return;
+    close_streamfile(opener->sf);
+    free(opener);
+}
+
+static void set_opener(segmented_layout_data* data, STREAMFILE* sf, aix_header_t* aix) {
+    aix_opener_t* opener = calloc(1, sizeof(aix_opener_t));
+    if (!opener) return; /* segments stay open */
+
+    opener->aix = *aix; /* memcpy */
+    opener->sf = reopen_streamfile(sf, 0);
+    if (!opener->sf || !segmented_set_opener(data, reopen_segment, free_opener, opener)) {
+        free_opener(opener);
+        return;
+    }
+
+    for (int i = 0; i < data->segment_count; i++) {
+        data->can_reopen[i] = true;
+    }
+}
+
 static VGMSTREAM* build_segmented_vgmstream(STREAMFILE* sf, aix_header_t* aix) {
     VGMSTREAM* vgmstream = NULL;
     segmented_layout_data* data = NULL;
@@ -193,20 +245,13 @@ static VGMSTREAM* build_segmented_vgmstream(STREAMFILE* sf, aix_header_t* aix) {
     data = init_layout_segmented(aix->segment_count);
     if (!data) goto fail;
 
+    set_opener(data, sf, aix);
+
     for (i = 0; i < aix->segment_count; i++) {
-        /* build the layered sub-VGMSTREAM */
-        data->segments[i] = build_layered_vgmstream(sf, aix, i);
+        data->segments[i] = build_segment(sf, aix, i);
         if (!data->segments[i]) goto fail;
 
-        data->segments[i]->stream_size = aix->segment_sizes[i];
-
-        data->segments[i]->num_samples = aix->segment_samples[i];
-#if 0
-        /* should be the same as layer's */
-        if (aix->segment_samples[i] != 0) {
-            data->segments[i]->num_samples = aix->segment_samples[i];
-        }
-#endif
+        segmented_release_segment(data, i, sf);
     }
 
     if (!setup_layout_segmented(data))
@@ -3,56 +3,78 @@
 
 #include <stdlib.h>
 #include "../streamfile.h"
+#include "../util/block_cache.h"
 #include "../util/cipher_xxtea.h"
 #include "../util/companion_files.h"
 #include "../util.h"
 
 #define MAX_BLOCK_SIZE 0x6e4000 // usually 0x80000, observed max for Nch files ~= 8MB
+#define MAX_GROUP_SIZE 0x200000 // blocks after the first are decrypted a few at once (faster) if not too big
+#define GROUP_BLOCKS 4
 
 /* decrypts xxtea blocks */
 typedef struct {
     uint32_t data_offset;   // where encryption data starts
     uint32_t data_size;     // encrypted size
     uint32_t block_size;    // xxtea block chunk size (rather big)
+    uint32_t group_size;    // blocks loaded + decrypted at once
     uint32_t key[4];        // 32-bit x4 decryption key
-    uint8_t* buf;           // decrypted block
-    uint32_t read_offset;   // last read block offset (aligned to data_offset + block_size)
+    block_cache_t* cache;   // decrypted blocks, shared by all SFs reopened from this one (each channel/layer)
 } awcd_io_data;
 
 
-static int awcd_io_init(STREAMFILE* sf, awcd_io_data* data) {
-    /* ktsr keys start with size then random bytes (usually 7), assumed max 0x20 */
+static size_t awcd_load_block(STREAMFILE* sf, uint8_t* buf, offv_t offset, size_t size, void* vdata) {
+    awcd_io_data* data = vdata;
+
+    size_t bytes = read_streamfile(buf, offset, size, sf);
+    if (bytes != size)
+        return 0;
 
-    data->buf = malloc(data->block_size);
-    if (!data->buf)
-        return -1;
-    data->read_offset = -1;
+    // group of blocks, where last one may be smaller
+    int blocks = size / data->block_size;
+    size_t done = blocks * data->block_size;
+    xxtea_decrypt_blocks(buf, data->block_size, blocks, data->key);
+    if (done < size)
+        xxtea_decrypt(buf + done, size - done, data->key);
+    return size;
+}
+
+static int awcd_io_init(STREAMFILE* sf, awcd_io_data* data) {
+    /* first open makes the cache, reopens (data is copied) share it */
+    if (!data->cache) {
+        data->cache = block_cache_init(awcd_load_block, 0);
+        if (!data->cache)
+            return -1;
+    }
+    else {
+        block_cache_ref(data->cache);
+    }
     return 0;
 }
 
 static void awcd_io_close(STREAMFILE* sf, awcd_io_data* data) {
-    free(data->buf);
+    block_cache_free(data->cache);
 }
 
-/* reads from current block; offset/length must be within data_offset + data_size (handled externally) */
+/* reads from current block group; offset/length must be within data_offset + data_size (handled externally) */
 static int read_block(STREAMFILE* sf, uint8_t* dest, off_t offset, size_t length, awcd_io_data* data) {
 
-    // detect if we requested offset falls within current decrypted block, otherwise read + decrypt
-    off_t block_offset = (offset - data->data_offset) / data->block_size * data->block_size + data->data_offset; // closest block
-    int block_read = clamp_u32(data->block_size, 0, data->data_size - (block_offset - data->data_offset)); // last block can be smaller
-    if (data->read_offset != block_offset) {
-        int bytes = read_streamfile(data->buf, block_offset, block_read, sf);
-        if (bytes != block_read)
-            return 0;
-        xxtea_decrypt(data->buf, block_read, data->key);
-        data->read_offset = block_offset;
+    // get decrypted group with requested offset from cache, otherwise read + decrypt once for all SFs.
+    // First block is loaded alone so audio starts after one block, groups start after it.
+    off_t group_offset, group_size;
+    if (offset < data->data_offset + data->block_size) {
+        group_offset = data->data_offset;
+        group_size = data->block_size;
     }
+    else {
+        off_t groups_start = data->data_offset + data->block_size;
+        group_offset = (offset - groups_start) / data->group_size * data->group_size + groups_start; // closest group
+        group_size = data->group_size;
+    }
+    int group_read = clamp_u32(group_size, 0, data->data_size - (group_offset - data->data_offset)); // last group can be smaller
 
-    int buf_pos = offset - block_offset; // within current block
-    int to_do = clamp_u32(length, 0, block_read - buf_pos);
-    memcpy(dest, data->buf + buf_pos, to_do);
-
-    return to_do;
+    int buf_pos = offset - group_offset; // within current group
+    return block_cache_read(data->cache, dest, group_offset, group_read, buf_pos, length, sf, data);
 }
 
 /* xxtea works with big chunks, so depending on requested offset read into buf + decrypt + copy */
@@ -120,6 +142,9 @@ static STREAMFILE* setup_awcd_streamfile(STREAMFILE* sf, uint32_t data_offset, u
     io_data.data_offset = data_offset;
     io_data.data_size = data_size;
     io_data.block_size = block_size;
+    io_data.group_size = block_size;
+    if (block_size * GROUP_BLOCKS <= MAX_GROUP_SIZE)
+        io_data.group_size = block_size * GROUP_BLOCKS;
 
     /* setup subfile */
     new_sf = open_wrap_streamfile(sf);
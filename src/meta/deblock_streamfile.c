@@ -3,6 +3,19 @@
 
 //todo move to utils or something
 
+#define DEBLOCK_CHECKPOINT_INTERVAL 0x20000 /* min logical bytes between checkpoints */
+#define DEBLOCK_CHECKPOINT_GROWTH 64
+
+/* state at the start of a block (before block_callback) */
+struct deblock_checkpoint_t {
+    off_t logical_offset;
+    off_t physical_offset;
+    off_t block_size;
+    off_t skip_size;
+    off_t chunk_size;
+    int step_count;
+};
+
 static void block_callback_default(STREAMFILE* sf, deblock_io_data* data) {
     data->block_size = data->cfg.chunk_size;
     data->skip_size = data->cfg.skip_size;
@@ -11,13 +24,69 @@ static void block_callback_default(STREAMFILE* sf, deblock_io_data* data) {
     //;VGM_LOG("DEBLOCK: of=%lx, bs=%lx, ss=%lx, ds=%lx\n", data->physical_offset, data->block_size, data->skip_size, data->data_size);
 }
 
+static void save_checkpoint(deblock_io_data* data) {
+    /* only moves forward, so checkpoints are ordered */
+    if (data->checkpoints_count > 0 &&
+            data->logical_offset < data->checkpoints[data->checkpoints_count - 1].logical_offset + DEBLOCK_CHECKPOINT_INTERVAL)
+        return;
+    if (data->checkpoints_count == 0 && data->logical_offset < DEBLOCK_CHECKPOINT_INTERVAL)
+        return;
+
+    if (data->checkpoints_count >= data->checkpoints_max) {
+        int new_max = data->checkpoints_max + DEBLOCK_CHECKPOINT_GROWTH;
+        deblock_checkpoint_t* new_checkpoints = realloc(data->checkpoints, new_max * sizeof(deblock_checkpoint_t));
+        if (!new_checkpoints) return;
+
+        data->checkpoints = new_checkpoints;
+        data->checkpoints_max = new_max;
+    }
+
+    deblock_checkpoint_t* cp = &data->checkpoints[data->checkpoints_count];
+    cp->logical_offset = data->logical_offset;
+    cp->physical_offset = data->physical_offset;
+    cp->block_size = data->block_size;
+    cp->skip_size = data->skip_size;
+    cp->chunk_size = data->chunk_size;
+    cp->step_count = data->step_count;
+    data->checkpoints_count++;
+}
+
+/* restores the last saved block state before offset, or returns false if none */
+static bool load_checkpoint(deblock_io_data* data, off_t offset) {
+    deblock_checkpoint_t* cp = NULL;
+
+    /* binary search for last checkpoint <= offset */
+    int lo = 0, hi = data->checkpoints_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (data->checkpoints[mid].logical_offset <= offset) {
+            cp = &data->checkpoints[mid];
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+    if (!cp)
+        return false;
+
+    data->logical_offset = cp->logical_offset;
+    data->physical_offset = cp->physical_offset;
+    data->block_size = cp->block_size;
+    data->skip_size = cp->skip_size;
+    data->chunk_size = cp->chunk_size;
+    data->step_count = cp->step_count;
+    data->data_size = 0;
+    return true;
+}
+
 static size_t deblock_io_read(STREAMFILE* sf, uint8_t* dest, off_t offset, size_t length, deblock_io_data* data) {
     size_t total_read = 0;
 
     //;VGM_LOG("DEBLOCK: of=%lx, sz=%x, po=%lx\n", offset, length, data->physical_offset);
 
-    /* re-start when previous offset (can't map logical<>physical offsets) */
-    if (data->logical_offset < 0 || offset < data->logical_offset) {
+    /* re-start when previous offset (can't map logical<>physical offsets), from the closest checkpoint if possible */
+    if ((data->logical_offset < 0 || offset < data->logical_offset) && !load_checkpoint(data, offset)) {
         //;VGM_LOG("DEBLOCK: restart offset=%lx + %x, po=%lx, lo=%lx\n", offset, length, data->physical_offset, data->logical_offset);
         data->physical_offset = data->cfg.stream_start;
         data->logical_offset = 0x00;
@@ -82,6 +151,7 @@ static size_t deblock_io_read(STREAMFILE* sf, uint8_t* dest, off_t offset, size_
             data->data_size = 0;
 
             data->step_count = data->cfg.step_count;
+            save_checkpoint(data);
             //VGM_LOG("ignore at %lx + %lx, skips=%i\n", data->physical_offset, data->block_size, data->step_count);
             continue;
         }
@@ -116,6 +186,18 @@ static size_t deblock_io_read(STREAMFILE* sf, uint8_t* dest, off_t offset, size_
     return total_read;
 }
 
+static int deblock_io_init(STREAMFILE* sf, deblock_io_data* data) {
+    /* copied from the original SF on reopen, each copy keeps its own */
+    data->checkpoints = NULL;
+    data->checkpoints_count = 0;
+    data->checkpoints_max = 0;
+    return 0;
+}
+
+static void deblock_io_close(STREAMFILE* sf, deblock_io_data* data) {
+    free(data->checkpoints);
+}
+
 static size_t deblock_io_size(STREAMFILE* sf, deblock_io_data* data) {
     uint8_t buf[0x04];
 
@@ -177,7 +259,7 @@ STREAMFILE* open_io_deblock_streamfile_f(STREAMFILE* sf, deblock_config_t *cfg)
     //TODO: other validations
 
     /* setup subfile */
-    new_sf = open_io_streamfile_f(sf, &io_data, sizeof(deblock_io_data), deblock_io_read, deblock_io_size);
+    new_sf = open_io_streamfile_ex_f(sf, &io_data, sizeof(deblock_io_data), deblock_io_read, deblock_io_size, deblock_io_init, deblock_io_close);
     return new_sf;
 fail:
     VGM_LOG("DEBLOCK: bad init\n");
@@ -4,6 +4,7 @@
 
 typedef struct deblock_config_t deblock_config_t;
 typedef struct deblock_io_data deblock_io_data;
+typedef struct deblock_checkpoint_t deblock_checkpoint_t;
 
 struct deblock_config_t {
     /* config (all optional) */
@@ -57,6 +58,11 @@ struct deblock_io_data {
     size_t logical_size;
     size_t physical_size;
     off_t physical_end;
+
+    /* block states saved every few logical bytes, to resume reads there instead of from stream start */
+    deblock_checkpoint_t* checkpoints;
+    int checkpoints_count;
+    int checkpoints_max;
 };
 
 STREAMFILE* open_io_deblock_streamfile_f(STREAMFILE* sf, deblock_config_t* cfg);
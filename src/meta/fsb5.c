@@ -2,6 +2,7 @@
 #include "../coding/coding.h"
 #include "../layout/layout.h"
 #include "../base/seek_table.h"
+#include "../base/index_cache.h"
 #include "fsb5_streamfile.h"
 #include "fsb_fev.h"
 
@@ -38,6 +39,7 @@ typedef struct {
 static void get_name(char* buf, size_t buf_size, int target_subsong, fsb5_header* fsb5, STREAMFILE* sf_fsb);
 static layered_layout_data* build_layered_fsb5(STREAMFILE* sf, STREAMFILE* sb, fsb5_header* fsb5);
 static void read_vorbis_seek(VGMSTREAM* v, STREAMFILE* sf, fsb5_header* fsb5);
+static int get_stream_header_offset(STREAMFILE* sf, fsb5_header* fsb5, int target_subsong, uint32_t* p_offset);
 
 /* FSB5 - Firelight's FMOD Studio SoundBank format */
 VGMSTREAM* init_vgmstream_fsb5(STREAMFILE* sf) {
@@ -92,9 +94,9 @@ VGMSTREAM* init_vgmstream_fsb5(STREAMFILE* sf) {
     if (target_subsong > fsb5.total_subsongs || fsb5.total_subsongs <= 0) goto fail;
 
     /* find target stream header and data offset, and read all needed values for later use
-     *  (reads one by one as the size of a single stream header is variable) */
-    offset = fsb5.base_header_size;
-    for (int i = 0; i < fsb5.total_subsongs; i++) {
+     *  (headers have variable size, so the offset of each is found once and cached for other subsongs) */
+    int start_index = get_stream_header_offset(sf, &fsb5, target_subsong, &offset);
+    for (int i = start_index; i < fsb5.total_subsongs; i++) {
         uint32_t stream_header_size = 0;
         uint32_t data_offset = 0;
         uint64_t sample_mode;
@@ -696,3 +698,60 @@ static void get_name(char* buf, size_t buf_size, int target_subsong, fsb5_header
 
     close_streamfile(sf_fev);
 }
+
+/* walks all stream headers (variable size due to extra flags) and saves where each starts */
+static uint32_t* build_stream_header_offsets(STREAMFILE* sf, fsb5_header* fsb5) {
+    uint32_t* offsets = malloc(fsb5->total_subsongs * sizeof(uint32_t));
+    if (!offsets) return NULL;
+
+    uint32_t offset = fsb5->base_header_size;
+    uint32_t max_offset = fsb5->base_header_size + fsb5->sample_header_size;
+    for (int i = 0; i < fsb5->total_subsongs; i++) {
+        if (offset >= max_offset)
+            goto fail;
+        offsets[i] = offset;
+
+        uint64_t sample_mode = read_u64le(offset + 0x00, sf);
+        offset += 0x08;
+
+        if (sample_mode & 0x01) {
+            uint32_t extraflag;
+            do {
+                extraflag = read_u32le(offset, sf);
+                offset += 0x04 + ((extraflag >> 1) & 0xFFFFFF);
+                if (offset > max_offset)
+                    goto fail;
+            }
+            while (extraflag & 0x01);
+        }
+    }
+
+    return offsets;
+fail:
+    free(offsets);
+    return NULL;
+}
+
+/* returns index and offset of the first stream header to parse (target, or first one if headers look wrong) */
+static int get_stream_header_offset(STREAMFILE* sf, fsb5_header* fsb5, int target_subsong, uint32_t* p_offset) {
+    *p_offset = fsb5->base_header_size;
+    if (target_subsong == 1)
+        return 0;
+
+    size_t size = 0;
+    const uint32_t* offsets = index_cache_get(sf, "fsb5:headers", &size);
+    if (offsets && size != fsb5->total_subsongs * sizeof(uint32_t)) { /* shouldn't happen */
+        index_cache_release(offsets);
+        offsets = NULL;
+    }
+    if (!offsets) {
+        uint32_t* new_offsets = build_stream_header_offsets(sf, fsb5);
+        if (!new_offsets) return 0; /* walked normally */
+
+        offsets = index_cache_add(sf, "fsb5:headers", new_offsets, fsb5->total_subsongs * sizeof(uint32_t));
+    }
+
+    *p_offset = offsets[target_subsong - 1];
+    index_cache_release(offsets);
+    return target_subsong - 1;
+}
@@ -5,6 +5,8 @@
 #include "../util/channel_mappings.h"
 #include "../util/companion_files.h"
 #include "../util/cri_keys.h"
+#include "../util/threads.h"
+#include "../base/key_cache.h"
 
 #ifdef VGM_DEBUG_OUTPUT
   //#define HCA_BRUTEFORCE
@@ -135,12 +137,181 @@ fail:
 }
 
 
+/* Testing the whole list takes a while, so it's split between threads (each with its own HCA
+ * handle) that test keys in parallel. Results are then checked in list order, so the chosen key
+ * is the same as testing one by one (threads stop once a perfect key is found before theirs). */
+#define HCA_KEYSEARCH_MAX_THREADS  8
+#define HCA_KEYSEARCH_RECENT_KEYS  16
+
+typedef struct {
+    hca_codec_data* hca_data;
+    int first;
+    int step;
+    uint16_t subkey;
+    uint32_t start_offset;
+    int* scores;
+    int* stop_index; /* lowest index with a perfect score */
+} hca_keysearch_t;
+
+static vgm_mutex_t keysearch_mutex = VGM_MUTEX_INIT;
+
+static void keysearch_worker(void* arg) {
+    hca_keysearch_t* ks = arg;
+    const int keys_length = sizeof(hcakey_list) / sizeof(hcakey_list[0]);
+    hca_keytest_t hk = {0};
+
+    hk.subkey = ks->subkey;
+    hk.start_offset = ks->start_offset;
+
+    for (int i = ks->first; i < keys_length; i += ks->step) {
+        vgm_mutex_lock(&keysearch_mutex);
+        bool stop = i > *ks->stop_index;
+        vgm_mutex_unlock(&keysearch_mutex);
+        if (stop)
+            break;
+
+        hk.key = hcakey_list[i].key;
+        int score = test_hca_key(ks->hca_data, &hk);
+        ks->scores[i] = score;
+
+        if (score == 1) {
+            vgm_mutex_lock(&keysearch_mutex);
+            if (*ks->stop_index > i)
+                *ks->stop_index = i;
+            vgm_mutex_unlock(&keysearch_mutex);
+            break;
+        }
+    }
+}
+
+/* tests keys from first to end in parallel, returns false if not possible */
+static bool test_hca_keys_threaded(hca_codec_data* hca_data, hca_keytest_t* hk, int first) {
+    const int keys_length = sizeof(hcakey_list) / sizeof(hcakey_list[0]);
+    vgm_thread_t threads[HCA_KEYSEARCH_MAX_THREADS];
+    hca_keysearch_t ks[HCA_KEYSEARCH_MAX_THREADS] = {0};
+    int* scores = NULL;
+    int stop_index = keys_length;
+    int threads_count = 0;
+    bool ok = false;
+
+    int max_threads = vgm_get_cpu_count();
+    if (max_threads > HCA_KEYSEARCH_MAX_THREADS)
+        max_threads = HCA_KEYSEARCH_MAX_THREADS;
+    if (max_threads <= 1)
+        return false;
+
+    scores = malloc(keys_length * sizeof(int));
+    if (!scores) goto fail;
+
+    /* separate handles as they keep decoding state, opened here as reopening SFs may not be thread-safe */
+    for (int i = 0; i < max_threads; i++) {
+        ks[i].hca_data = init_hca(hca_get_streamfile(hca_data));
+        if (!ks[i].hca_data) goto fail;
+
+        ks[i].first = first + i;
+        ks[i].step = max_threads;
+        ks[i].subkey = hk->subkey;
+        ks[i].start_offset = hk->start_offset;
+        ks[i].scores = scores;
+        ks[i].stop_index = &stop_index;
+    }
+
+    for (int i = 0; i < max_threads; i++) {
+        if (!vgm_thread_start(&threads[threads_count], keysearch_worker, &ks[i]))
+            break;
+        threads_count++;
+    }
+
+    /* couldn't start some threads: do their part here */
+    for (int i = threads_count; i < max_threads; i++) {
+        keysearch_worker(&ks[i]);
+    }
+
+    for (int i = 0; i < threads_count; i++) {
+        vgm_thread_join(&threads[i]);
+    }
+
+    /* all keys before the first perfect one are tested, so this is the same as testing sequentially */
+    for (int i = first; i < keys_length; i++) {
+        hk->key = hcakey_list[i].key;
+        update_hca_key(hk, scores[i]);
+        if (hk->best_score == 1)
+            break;
+    }
+
+    ok = true;
+fail:
+    for (int i = 0; i < max_threads; i++) {
+        free_hca(ks[i].hca_data);
+    }
+    free(scores);
+    return ok;
+}
+
+/* identifies a file (and so its key) by its header */
+static uint64_t get_hca_fingerprint(hca_codec_data* hca_data, uint16_t subkey) {
+    STREAMFILE* sf = hca_get_streamfile(hca_data);
+    clHCA_stInfo* hca_info = hca_get_info(hca_data);
+    uint8_t buf[0x400];
+    uint64_t hash = KEY_CACHE_HASH_INIT;
+
+    uint32_t offset = 0x00;
+    while (offset < hca_info->headerSize) {
+        int to_read = sizeof(buf);
+        if (to_read > hca_info->headerSize - offset)
+            to_read = hca_info->headerSize - offset;
+
+        int bytes = read_streamfile(buf, offset, to_read, sf);
+        hash = key_cache_hash(hash, buf, bytes);
+        if (bytes != to_read)
+            break;
+        offset += bytes;
+    }
+
+    put_u16be(buf, subkey);
+    return key_cache_hash(hash, buf, 0x02);
+}
+
+/* keys found before for this file or others (games normally use one key) */
+static bool find_hca_key_cached(hca_codec_data* hca_data, uint64_t* p_keycode, uint16_t subkey, uint64_t fingerprint) {
+    uint64_t keys[HCA_KEYSEARCH_RECENT_KEYS];
+    hca_keytest_t hk = {0};
+
+    hk.subkey = subkey;
+
+    /* same file: accept search's result (may not be perfect) if it still works */
+    uint64_t keycode;
+    if (key_cache_find("hca", fingerprint, &keycode)) {
+        hk.key = keycode;
+        if (test_hca_key(hca_data, &hk) > 0) {
+            *p_keycode = keycode;
+            return true;
+        }
+    }
+
+    /* other files: only if perfect, as the list may have a better key */
+    int keys_count = key_cache_get_recent("hca", keys, HCA_KEYSEARCH_RECENT_KEYS);
+    for (int i = 0; i < keys_count; i++) {
+        hk.key = keys[i];
+        if (test_hca_key(hca_data, &hk) == 1) {
+            *p_keycode = keys[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
 /* try to find the decryption key from a list */
 static int find_hca_key(hca_codec_data* hca_data, uint64_t* p_keycode, uint16_t subkey) {
     const size_t keys_length = sizeof(hcakey_list) / sizeof(hcakey_list[0]);
     int i;
     hca_keytest_t hk = {0};
 
+    uint64_t fingerprint = get_hca_fingerprint(hca_data, subkey);
+    if (find_hca_key_cached(hca_data, p_keycode, subkey, fingerprint))
+        return 1;
+
     hk.best_key = 0xCC55463930DBE1AB; /* defaults to PSO2 key, most common */ 
     hk.subkey = subkey;
 
@@ -151,6 +322,12 @@ static int find_hca_key(hca_codec_data* hca_data, uint64_t* p_keycode, uint16_t
         if (hk.best_score == 1)
             goto done;
 
+        /* first test finds the first non-blank frame, shared by the rest (silent files are too fast to bother) */
+        if (i == 0 && hk.start_offset) {
+            if (test_hca_keys_threaded(hca_data, &hk, i + 1))
+                goto done;
+        }
+
 #if 0
         {
             int j;
@@ -173,5 +350,8 @@ done:
     VGM_ASSERT(hk.best_score > 1, "HCA: best key=%08x%08x (score=%i)\n",
             (uint32_t)((*p_keycode >> 32) & 0xFFFFFFFF), (uint32_t)(*p_keycode & 0xFFFFFFFF), hk.best_score);
     vgm_asserti(hk.best_score <= 0, "HCA: decryption key not found\n");
+
+    if (hk.best_score > 0)
+        key_cache_add("hca", fingerprint, hk.best_key);
     return hk.best_score > 0;
 }
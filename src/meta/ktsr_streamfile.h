@@ -2,16 +2,38 @@
 #define _KTSR_STREAMFILE_H_
 
 #include "../streamfile.h"
+#include "../util.h"
 #include "../util/log.h"
+#include "../util/block_cache.h"
 #include "../util/cipher_blowfish.h"
 
+#define KTSR_BLOCK_SIZE 0x8000
+#define KTSR_CACHE_SIZE 0x80000
+
 /* decrypts blowfish in realtime (as done by games) */
 typedef struct {
     uint8_t key[0x20];
-    uint8_t block[0x08];
     blowfish_ctx* ctx;
+    block_cache_t* cache;   /* decrypted blocks, shared by all SFs reopened from this one (each channel) */
 } ktsr_io_data;
 
+static size_t ktsr_load_block(STREAMFILE* sf, uint8_t* buf, offv_t offset, size_t size, void* vdata) {
+    ktsr_io_data* data = vdata;
+
+    size_t bytes = read_streamfile(buf, offset, size, sf);
+    if (bytes == 0)
+        return 0;
+
+    /* useless since KTSR data is padded and blocks don't work otherwise but for determinability */
+    size_t padded = align_size_to_block(bytes, 0x08);
+    if (bytes < padded)
+        memset(buf + bytes, 0, padded - bytes);
+
+    blowfish_decrypt_ecb_blocks(data->ctx, buf, padded);
+
+    return bytes;
+}
+
 static int ktsr_io_init(STREAMFILE* sf, ktsr_io_data* data) {
     /* ktsr keys start with size then random bytes (usually 7), assumed max 0x20 */
     if (data->key[0] >= sizeof(data->key) - 1)
@@ -20,104 +42,49 @@ static int ktsr_io_init(STREAMFILE* sf, ktsr_io_data* data) {
     data->ctx = blowfish_init_ecb(data->key + 1, data->key[0]);
     if (!data->ctx)
         return -1;
+
+    /* first open makes the cache, reopens (data is copied) share it */
+    if (!data->cache) {
+        data->cache = block_cache_init(ktsr_load_block, KTSR_CACHE_SIZE);
+        if (!data->cache) {
+            blowfish_free(data->ctx);
+            return -1;
+        }
+    }
+    else {
+        block_cache_ref(data->cache);
+    }
     return 0;
 }
 
 static void ktsr_io_close(STREAMFILE* sf, ktsr_io_data* data) {
+    block_cache_free(data->cache);
     blowfish_free(data->ctx);
 }
 
-
-static int read_part(STREAMFILE* sf, uint8_t* dest, off_t offset, size_t length, ktsr_io_data* data) {
-
-    off_t offset_rem = offset % 0x08;
-    offset -= offset_rem;
-
-    if (offset_rem == 0 && length >= 0x08) /* handled in main */
-        return 0;
-
-    /* read one full block, regardless of requested length */
-    int bytes = read_streamfile(data->block, offset, 0x08, sf);
-
-     /* useless since KTSR data is padded and blocks don't work otherwise but for determinability */
-    if (bytes < 0x08)
-        memset(data->block + bytes, 0, 0x08 - bytes);
-
-    blowfish_decrypt_ecb(data->ctx, data->block);
-
-    int max_copy = bytes - offset_rem;
-    if (max_copy > length)
-        max_copy = length;
-
-    memcpy(dest, data->block + offset_rem, max_copy);
-
-    return max_copy;
-}
-
-static int read_main(STREAMFILE* sf, uint8_t* dest, off_t offset, size_t length, ktsr_io_data* data) {
-    int read = 0;
-
-    off_t offset_rem = offset % 0x08;
-    size_t length_rem = length % 0x08;
-    length -= length_rem;
-
-    if (offset_rem != 0 || length == 0) /* handled in part */
-        return 0;
-
-    int bytes = read_streamfile(dest, offset, length, sf);
-    
-    while (read < bytes) {
-        blowfish_decrypt_ecb(data->ctx, dest);
-        dest += 0x08;
-        read += 0x08;
-    }
-    
-    return bytes;
-}
-
-/* blowfish is a 64-bit block cipher, so arbitrary reads will need to handle partial cases. ex
- * - reading 0x00 to 0x20: direct decrypt (4 blocks of 0x08)
- * - reading 0x03 to 0x07: decrypt 0x00 to 0x08 but copy 4 bytes at 0x03
- * - reading 0x03 to 0x22: handle as 0x00 to 0x08 (head, copy 5 at 0x3), 0x08 to 0x20 (body, direct), and 0x20 to 0x28 (tail, copy 2 at 0x0). */
+/* blowfish is a 64-bit block cipher, so arbitrary reads need to handle partial cases. Since each channel
+ * reads the same (interleaved) data, bigger blocks are decrypted once into the cache and copied from there. */
 static size_t ktsr_io_read(STREAMFILE* sf, uint8_t* dest, off_t offset, size_t length, ktsr_io_data* data) {
-    int bytes = 0;
-
-
-    /* head */
-    if (length) {
-        int done = read_part(sf, dest, offset, length, data);
-        dest += done;
-        offset += done;
-        length -= done;
-
-        bytes += done;
-    }
-
-    /* body */
-    if (length) {
-        int done = read_main(sf, dest, offset, length, data);
-        dest += done;
-        offset += done;
-        length -= done;
+    size_t total_bytes = 0;
 
-        bytes += done;
-    }
+    while (length > 0) {
+        off_t block_offset = offset / KTSR_BLOCK_SIZE * KTSR_BLOCK_SIZE;
+        size_t buf_pos = offset - block_offset;
 
-    /* tail */
-    if (length) {
-        int done = read_part(sf, dest, offset, length, data);
-        dest += done;
-        offset += done;
-        length -= done;
+        size_t bytes = block_cache_read(data->cache, dest, block_offset, KTSR_BLOCK_SIZE, buf_pos, length, sf, data);
+        if (bytes == 0)
+            break;
 
-        bytes += done;
+        dest += bytes;
+        offset += bytes;
+        length -= bytes;
+        total_bytes += bytes;
     }
 
-    return bytes;
+    return total_bytes;
 }
 
 
-
 /* Decrypts blowfish KTSR streams */
 static STREAMFILE* setup_ktsr_streamfile(STREAMFILE* sf, uint32_t st_offset, bool is_external, uint32_t subfile_offset, uint32_t subfile_size, const char* extension) {
     STREAMFILE* new_sf = NULL;
@@ -41,6 +41,13 @@ VGMSTREAM* init_vgmstream_txtp(STREAMFILE* sf) {
     vgmstream->config.is_txtp = true;
     vgmstream->config.is_mini_txtp = is_mini_txtp;
 
+    /* stats (entries may be nested in layouts, so kept in the final one) */
+    if (!vgmstream->entry_times) {
+        vgmstream->entry_times = txtp->entry_times;
+        vgmstream->entry_count = txtp->entry_count;
+        txtp->entry_times = NULL;
+    }
+
     txtp_clean(txtp);
     return vgmstream;
 fail:
@@ -58,7 +65,13 @@ void txtp_clean(txtp_header_t* txtp) {
         close_vgmstream(txtp->vgmstream[i]);
     }
 
+    for (int i = 0; i < txtp->snapshot_count; i++) {
+        free(txtp->snapshot[i].data);
+    }
+
     free(txtp->vgmstream);
+    free(txtp->entry_times);
+    free(txtp->snapshot);
     free(txtp->group);
     free(txtp->entry);
     free(txtp);
@@ -125,6 +125,15 @@ typedef struct {
 
 } txtp_group_t;
 
+/* original entry settings, to reopen segments later */
+typedef struct {
+    uint8_t* data;          /* compact txtp_entry_t */
+    VGMSTREAM* vgmstream;   /* as opened from the entry, NULL if modified/closed */
+
+    bool closed;            /* closed after opening (only a few segments may stay open), reopened by the layout */
+    segment_info_t info;    /* values of closed entries */
+} txtp_snapshot_t;
+
 typedef struct {
     txtp_entry_t* entry;
     size_t entry_count;
@@ -138,6 +147,12 @@ typedef struct {
     VGMSTREAM** vgmstream;
     size_t vgmstream_count;
 
+    txtp_snapshot_t* snapshot;
+    size_t snapshot_count;
+    STREAMFILE* sf;         /* .txtp (not owned) */
+
+    double* entry_times;    /* open time of each entry (stats) */
+
     uint32_t loop_start_segment;
     uint32_t loop_end_segment;
     bool is_loop_keep;
@@ -149,12 +164,14 @@ typedef struct {
     bool is_segmented;
     bool is_layered;
     bool is_single;
+    bool is_lazy;           /* entries (except first) closed after opening, for plain segment lists only */
 } txtp_header_t;
 
 txtp_header_t* txtp_parse(STREAMFILE* sf);
 bool txtp_process(txtp_header_t* txtp, STREAMFILE* sf);
 
 void txtp_clean(txtp_header_t* txtp);
+void txtp_set_open_threads(int threads);
 void txtp_add_mixing(txtp_entry_t* entry, txtp_mix_data_t* mix, txtp_mix_t command);
 void txtp_copy_config(play_config_t* dst, play_config_t* src);
 #endif
@@ -6,6 +6,8 @@
 #include "../base/mixing.h"
 #include "../base/plugins.h"
 #include "../util/layout_utils.h"
+#include "../util/threads.h"
+#include "../vgmstream_init.h"
 
 
 /*******************************************************************************/
@@ -219,6 +221,256 @@ static bool is_absolute(const char* fn) {
     return fn[0] == '/' || fn[0] == '\\'  || fn[1] == ':';
 }
 
+static STREAMFILE* open_entry_streamfile(STREAMFILE* sf, txtp_entry_t* entry) {
+    STREAMFILE* temp_sf = NULL;
+    const char* filename = entry->filename;
+
+    /* absolute paths are detected for convenience, but since it's hard to unify all OSs
+     * and plugins, they aren't "officially" supported nor documented, thus may or may not work */
+    if (is_absolute(filename))
+        temp_sf = open_streamfile(sf, filename); /* from path as is */
+    else
+        temp_sf = open_streamfile_by_pathname(sf, filename); /* from current path */
+    if (!temp_sf) {
+        vgm_logi("TXTP: cannot open %s\n", filename);
+        return NULL;
+    }
+    temp_sf->stream_index = entry->subsong;
+
+    return temp_sf;
+}
+
+/* format_id may be passed when other entry of the same file was opened, to skip detection */
+static VGMSTREAM* init_entry(STREAMFILE* temp_sf, txtp_entry_t* entry, int format_id) {
+    VGMSTREAM* vgmstream = detect_vgmstream_format_hint(temp_sf, format_id);
+    if (!vgmstream) {
+        vgm_logi("TXTP: cannot parse %s#%i\n", entry->filename, entry->subsong);
+        return NULL;
+    }
+
+    apply_settings(vgmstream, entry);
+    return vgmstream;
+}
+
+static VGMSTREAM* open_entry(STREAMFILE* sf, txtp_entry_t* entry) {
+    STREAMFILE* temp_sf = open_entry_streamfile(sf, entry);
+    if (!temp_sf)
+        return NULL;
+
+    VGMSTREAM* vgmstream = init_entry(temp_sf, entry, 0);
+    close_streamfile(temp_sf);
+    return vgmstream;
+}
+
+/* entries are big due to the mixing list, so only used mixes are copied: fields up to the list (head) and
+ * from config to the end (tail). Fields must stay arranged so that covers everything but the list. */
+#define ENTRY_HEAD_SIZE  offsetof(txtp_entry_t, mixing)
+#define ENTRY_TAIL_SIZE  (sizeof(txtp_entry_t) - offsetof(txtp_entry_t, config))
+
+typedef char txtp_entry_check_count[(offsetof(txtp_entry_t, mixing_count) < ENTRY_HEAD_SIZE) ? 1 : -1];
+typedef char txtp_entry_check_tail[(offsetof(txtp_entry_t, mixing) + sizeof(((txtp_entry_t*)0)->mixing) == offsetof(txtp_entry_t, config)) ? 1 : -1];
+
+static uint8_t* snapshot_entry(txtp_entry_t* entry) {
+    size_t mixing_size = entry->mixing_count * sizeof(txtp_mix_data_t);
+
+    uint8_t* data = malloc(ENTRY_HEAD_SIZE + ENTRY_TAIL_SIZE + mixing_size);
+    if (!data) return NULL; /* not reopenable, no need to fail */
+
+    memcpy(data, entry, ENTRY_HEAD_SIZE);
+    memcpy(data + ENTRY_HEAD_SIZE, &entry->config, ENTRY_TAIL_SIZE);
+    memcpy(data + ENTRY_HEAD_SIZE + ENTRY_TAIL_SIZE, entry->mixing, mixing_size);
+    return data;
+}
+
+static txtp_entry_t* restore_entry(uint8_t* data) {
+    txtp_entry_t* entry = calloc(1, sizeof(txtp_entry_t));
+    if (!entry) return NULL;
+
+    memcpy(entry, data, ENTRY_HEAD_SIZE);
+    memcpy(&entry->config, data + ENTRY_HEAD_SIZE, ENTRY_TAIL_SIZE);
+    memcpy(entry->mixing, data + ENTRY_HEAD_SIZE + ENTRY_TAIL_SIZE, entry->mixing_count * sizeof(txtp_mix_data_t));
+    return entry;
+}
+
+/* entry's VGMSTREAM was modified or closed, can't be reopened with the original settings */
+static void forget_snapshot(txtp_header_t* txtp, VGMSTREAM* vgmstream) {
+    if (!vgmstream)
+        return;
+
+    for (int i = 0; i < txtp->snapshot_count; i++) {
+        if (txtp->snapshot[i].vgmstream == vgmstream) {
+            txtp->snapshot[i].vgmstream = NULL;
+            free(txtp->snapshot[i].data);
+            txtp->snapshot[i].data = NULL;
+        }
+    }
+}
+
+/* Entries are opened in two passes: first one entry per file, then the rest (like other subsongs of
+ * the same bank) reusing the format detected for that file. Entries may be opened by N threads,
+ * since big TXTP may have hundreds of entries and opening some formats is slow. Each entry's file
+ * is opened beforehand in the calling thread, but parsers in workers still read from it and open
+ * companion files (headers, banks, keys) through its sf->open, so with N threads the base IO must
+ * handle calls on separate handles from several threads at once (see libvgmstream_set_open_threads).
+ * Internal stdio/mmap/cache SFs do; handles are never shared between workers. */
+static int open_threads = 1;
+
+void txtp_set_open_threads(int threads) {
+    open_threads = threads;
+}
+
+typedef struct {
+    txtp_header_t* txtp;
+    STREAMFILE** entry_sfs;
+    int* format_ids;        /* hint per entry, then detected format once opened */
+    int lazy_first;         /* first entry that must stay open (or -1 if not lazy) */
+    int* list;              /* entries to open in current pass */
+    int count;
+    int next;
+    vgm_mutex_t lock;
+} txtp_opener_t;
+
+static void open_entries_worker(void* arg) {
+    txtp_opener_t* opener = arg;
+    txtp_header_t* txtp = opener->txtp;
+
+    while (true) {
+        vgm_mutex_lock(&opener->lock);
+        int pos = opener->next++;
+        vgm_mutex_unlock(&opener->lock);
+        if (pos >= opener->count)
+            break;
+
+        int i = opener->list[pos];
+        double time_start = vgm_get_time();
+        VGMSTREAM* vgmstream = init_entry(opener->entry_sfs[i], &txtp->entry[i], opener->format_ids[i]);
+        txtp->entry_times[i] += vgm_get_time() - time_start;
+        if (!vgmstream)
+            continue;
+        opener->format_ids[i] = vgmstream->format_id;
+
+        /* only values are needed until the final segmented layout opens it again */
+        txtp_snapshot_t* snapshot = &txtp->snapshot[i];
+        if (opener->lazy_first >= 0 && i != opener->lazy_first && snapshot->data && vgmstream->num_samples > 0 &&
+                segmented_describe_segment(vgmstream, i, &snapshot->info)) {
+            snapshot->closed = true;
+            close_vgmstream(vgmstream);
+            continue;
+        }
+
+        txtp->vgmstream[i] = vgmstream;
+    }
+}
+
+static void open_entries_pass(txtp_opener_t* opener) {
+    int threads = open_threads;
+    if (threads > opener->count)
+        threads = opener->count;
+    if (threads > VGMSTREAM_MAX_CHANNELS)
+        threads = VGMSTREAM_MAX_CHANNELS; /* some sane max */
+
+    opener->next = 0;
+
+    vgm_thread_t workers[VGMSTREAM_MAX_CHANNELS];
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (!vgm_thread_start(&workers[started], open_entries_worker, opener))
+            break; /* remaining entries are opened by started threads */
+        started++;
+    }
+
+    open_entries_worker(opener);
+
+    for (int i = 0; i < started; i++) {
+        vgm_thread_join(&workers[i]);
+    }
+}
+
+static bool open_entries(txtp_header_t* txtp, STREAMFILE* sf) {
+    txtp_opener_t opener = {0};
+    bool lock_init = false;
+    bool ok = false;
+
+    opener.txtp = txtp;
+    opener.lazy_first = -1;
+    opener.entry_sfs = calloc(txtp->entry_count, sizeof(STREAMFILE*));
+    opener.format_ids = calloc(txtp->entry_count, sizeof(int));
+    opener.list = calloc(txtp->entry_count, sizeof(int));
+    int* first_entry = calloc(txtp->entry_count, sizeof(int)); /* first entry with the same file */
+    if (!opener.entry_sfs || !opener.format_ids || !opener.list || !first_entry) goto fail;
+
+    lock_init = vgm_mutex_init(&opener.lock);
+    if (!lock_init) goto fail;
+
+    /* open files and find out entries of the same file */
+    for (int i = 0; i < txtp->entry_count; i++) {
+        txtp_entry_t* entry = &txtp->entry[i];
+        if (entry->silent)
+            continue;
+
+        double time_start = vgm_get_time();
+        opener.entry_sfs[i] = open_entry_streamfile(sf, entry);
+        if (!opener.entry_sfs[i]) goto fail;
+        txtp->entry_times[i] = vgm_get_time() - time_start;
+
+        first_entry[i] = i;
+        for (int j = 0; j < i; j++) {
+            if (!txtp->entry[j].silent && strcmp(txtp->entry[j].filename, entry->filename) == 0) {
+                first_entry[i] = j;
+                break;
+            }
+        }
+    }
+
+    /* first entry is kept open for silents and layout info */
+    if (txtp->is_lazy) {
+        for (int i = 0; i < txtp->entry_count; i++) {
+            if (opener.entry_sfs[i]) {
+                opener.lazy_first = i;
+                break;
+            }
+        }
+    }
+
+    /* one entry per file */
+    opener.count = 0;
+    for (int i = 0; i < txtp->entry_count; i++) {
+        if (opener.entry_sfs[i] && first_entry[i] == i)
+            opener.list[opener.count++] = i;
+    }
+    open_entries_pass(&opener);
+
+    /* rest of entries */
+    opener.count = 0;
+    for (int i = 0; i < txtp->entry_count; i++) {
+        if (!opener.entry_sfs[i] || first_entry[i] == i)
+            continue;
+        opener.format_ids[i] = opener.format_ids[first_entry[i]];
+        opener.list[opener.count++] = i;
+    }
+    open_entries_pass(&opener);
+
+    ok = true;
+    for (int i = 0; i < txtp->entry_count; i++) {
+        if (opener.entry_sfs[i] && !txtp->vgmstream[i] && !txtp->snapshot[i].closed)
+            ok = false;
+    }
+
+fail:
+    if (opener.entry_sfs) {
+        for (int i = 0; i < txtp->entry_count; i++) {
+            close_streamfile(opener.entry_sfs[i]);
+        }
+    }
+    if (lock_init)
+        vgm_mutex_free(&opener.lock);
+    free(opener.entry_sfs);
+    free(opener.format_ids);
+    free(opener.list);
+    free(first_entry);
+    return ok;
+}
+
 /* open all entries and apply settings to resulting VGMSTREAMs */
 static bool parse_entries(txtp_header_t* txtp, STREAMFILE* sf) {
     bool has_silents = false;
@@ -232,39 +484,40 @@ static bool parse_entries(txtp_header_t* txtp, STREAMFILE* sf) {
 
     txtp->vgmstream_count = txtp->entry_count;
 
+    txtp->snapshot = calloc(txtp->entry_count, sizeof(txtp_snapshot_t));
+    if (!txtp->snapshot) goto fail;
+
+    txtp->snapshot_count = txtp->entry_count;
+    txtp->sf = sf;
+
+    txtp->entry_times = calloc(txtp->entry_count, sizeof(double));
+    if (!txtp->entry_times) goto fail;
+
 
-    /* open all entry files first as they'll be modified by modes */
     for (int i = 0; i < txtp->vgmstream_count; i++) {
-        STREAMFILE* temp_sf = NULL;
-        const char* filename = txtp->entry[i].filename;
+        txtp_entry_t* entry = &txtp->entry[i];
 
         /* silent entry ignore */
-        if (is_silent(filename)) {
-            txtp->entry[i].silent = true;
+        if (is_silent(entry->filename)) {
+            entry->silent = true;
             has_silents = true;
             continue;
         }
 
-        /* absolute paths are detected for convenience, but since it's hard to unify all OSs
-         * and plugins, they aren't "officially" supported nor documented, thus may or may not work */
-        if (is_absolute(filename))
-            temp_sf = open_streamfile(sf, filename); /* from path as is */
-        else
-            temp_sf = open_streamfile_by_pathname(sf, filename); /* from current path */
-        if (!temp_sf) {
-            vgm_logi("TXTP: cannot open %s\n", filename);
-            goto fail;
-        }
-        temp_sf->stream_index = txtp->entry[i].subsong;
+        /* settings before being modified by apply_settings */
+        txtp->snapshot[i].data = snapshot_entry(entry);
+    }
 
-        txtp->vgmstream[i] = init_vgmstream_from_STREAMFILE(temp_sf);
-        close_streamfile(temp_sf);
-        if (!txtp->vgmstream[i]) {
-            vgm_logi("TXTP: cannot parse %s#%i\n", filename, txtp->entry[i].subsong);
-            goto fail;
-        }
+    /* plain lists of segments (no groups that modify or move entries) may close entries after opening them,
+     * when only a few segments need to stay open */
+    txtp->is_lazy = sf->max_open_segments > 0 && txtp->group_count == 0 && txtp->is_segmented && txtp->entry_count > 1;
 
-        apply_settings(txtp->vgmstream[i], &txtp->entry[i]);
+    /* open all entry files first as they'll be modified by modes */
+    if (!open_entries(txtp, sf))
+        goto fail;
+
+    for (int i = 0; i < txtp->vgmstream_count; i++) {
+        txtp->snapshot[i].vgmstream = txtp->vgmstream[i];
     }
 
     if (has_silents) {
@@ -327,6 +580,99 @@ static bool find_loop_anchors(txtp_header_t* txtp, int position, int count, int*
 }
 
 
+typedef struct {
+    STREAMFILE* sf;         /* .txtp, to open entries from the same path */
+    uint8_t** entries;      /* per segment, NULL if can't be reopened */
+    int count;
+} txtp_reopen_t;
+
+static VGMSTREAM* reopen_segment(void* priv, int segment) {
+    txtp_reopen_t* reopen = priv;
+
+    if (!reopen->entries[segment])
+        return NULL;
+
+    /* copy as apply_settings modifies the entry */
+    txtp_entry_t* entry = restore_entry(reopen->entries[segment]);
+    if (!entry) return NULL;
+
+    VGMSTREAM* vgmstream = open_entry(reopen->sf, entry);
+    free(entry);
+    return vgmstream;
+}
+
+static void free_reopen(void* priv) {
+    txtp_reopen_t* reopen = priv;
+    if (!reopen)
+        return;
+
+    for (int i = 0; i < reopen->count; i++) {
+        free(reopen->entries[i]);
+    }
+    free(reopen->entries);
+    close_streamfile(reopen->sf);
+    free(reopen);
+}
+
+/* segments opened directly from entries can be closed and reopened later if the layout needs to */
+static void set_segment_opener(txtp_header_t* txtp, segmented_layout_data* data, int position) {
+    txtp_reopen_t* reopen = NULL;
+
+    for (int i = 0; i < data->segment_count; i++) {
+        txtp_snapshot_t* snapshot = NULL;
+        if (!data->segments[i] && txtp->is_lazy) {
+            snapshot = &txtp->snapshot[position + i]; /* closed entry, positions are entry indexes without groups */
+        }
+        else {
+            for (int j = 0; j < txtp->snapshot_count; j++) {
+                if (txtp->snapshot[j].vgmstream && txtp->snapshot[j].vgmstream == data->segments[i]) {
+                    snapshot = &txtp->snapshot[j];
+                    break;
+                }
+            }
+        }
+        if (!snapshot || !snapshot->data)
+            continue;
+
+        if (!reopen) {
+            char filename[PATH_LIMIT];
+
+            reopen = calloc(1, sizeof(txtp_reopen_t));
+            if (!reopen) goto fail;
+
+            reopen->count = data->segment_count;
+            reopen->entries = calloc(reopen->count, sizeof(uint8_t*));
+            if (!reopen->entries) goto fail;
+
+            get_streamfile_name(txtp->sf, filename, sizeof(filename));
+            reopen->sf = open_streamfile(txtp->sf, filename);
+            if (!reopen->sf) goto fail;
+        }
+
+        /* moved to layout */
+        reopen->entries[i] = snapshot->data;
+        snapshot->data = NULL;
+        snapshot->vgmstream = NULL;
+        if (snapshot->closed) {
+            data->segment_infos[i] = snapshot->info;
+            snapshot->closed = false;
+        }
+    }
+
+    if (!reopen)
+        return;
+
+    if (!segmented_set_opener(data, reopen_segment, free_reopen, reopen))
+        goto fail;
+
+    for (int i = 0; i < data->segment_count; i++) {
+        data->can_reopen[i] = reopen->entries[i] != NULL;
+    }
+    return;
+fail:
+    free_reopen(reopen); /* segments stay open */
+}
+
 static bool make_group_segment(txtp_header_t* txtp, txtp_group_t* grp, int position, int count) {
     VGMSTREAM* vgmstream = NULL;
     segmented_layout_data* data_s = NULL;
@@ -367,44 +713,48 @@ static bool make_group_segment(txtp_header_t* txtp, txtp_group_t* grp, int posit
     }
 
 
-    /* fix loop keep (do it before init'ing as loops/metadata may be disabled for segments) */
-    int32_t loop_start_sample = 0, loop_end_sample = 0;
-    if (loop_flag && txtp->is_loop_keep) {
-        int32_t current_samples = 0;
-        for (int i = 0; i < count; i++) {
-            if (loop_start == i+1 /*&& txtp->vgmstream[i + position]->loop_start_sample*/) {
-                loop_start_sample = current_samples + txtp->vgmstream[i + position]->loop_start_sample;
-            }
-
-            current_samples += txtp->vgmstream[i + position]->num_samples;
-
-            if (loop_end == i+1 && txtp->vgmstream[i + position]->loop_end_sample) {
-                loop_end_sample = current_samples - txtp->vgmstream[i + position]->num_samples + txtp->vgmstream[i + position]->loop_end_sample;
-            }
-        }
-    }
-
     /* init layout */
     data_s = init_layout_segmented(count);
     if (!data_s) goto fail;
 
-    /* copy each subfile */
+    /* copy each subfile (closed entries get their values when setting the opener) */
     for (int i = 0; i < count; i++) {
         data_s->segments[i] = txtp->vgmstream[i + position];
         txtp->vgmstream[i + position] = NULL; /* will be freed by layout */
     }
 
+    set_segment_opener(txtp, data_s, position);
+
     /* setup VGMSTREAMs */
     if (!setup_layout_segmented(data_s))
         goto fail;
 
+    /* fix loop keep (infos have values before loops/metadata may be disabled for segments) */
+    int32_t loop_start_sample = 0, loop_end_sample = 0;
+    if (loop_flag && txtp->is_loop_keep) {
+        int32_t current_samples = 0;
+        for (int i = 0; i < count; i++) {
+            segment_info_t* info = &data_s->segment_infos[i];
+
+            if (loop_start == i+1 /*&& info->loop_start_sample*/) {
+                loop_start_sample = current_samples + info->loop_start_sample;
+            }
+
+            current_samples += info->num_samples;
+
+            if (loop_end == i+1 && info->loop_end_sample) {
+                loop_end_sample = current_samples - info->num_samples + info->loop_end_sample;
+            }
+        }
+    }
+
     /* build the layout VGMSTREAM */
     vgmstream = allocate_segmented_vgmstream(data_s, loop_flag, loop_start - 1, loop_end - 1);
     if (!vgmstream) goto fail;
 
     /* custom meta name if all parts don't match */
     for (int i = 0; i < count; i++) {
-        if (vgmstream->meta_type != data_s->segments[i]->meta_type) {
+        if (vgmstream->meta_type != data_s->segment_infos[i].meta_type) {
             vgmstream->meta_type = meta_TXTP;
             break;
         }
@@ -535,6 +885,7 @@ static int make_group_random(txtp_header_t* txtp, txtp_group_t* grp, int positio
         vgmstream = txtp->vgmstream[position + selected];
         txtp->vgmstream[position + selected] = NULL;
         for (int i = 0; i < count; i++) {
+            forget_snapshot(txtp, txtp->vgmstream[i + position]);
             close_vgmstream(txtp->vgmstream[i + position]);
         }
 
@@ -618,6 +969,7 @@ static bool parse_groups(txtp_header_t* txtp) {
 
 
         /* group may also have settings (like downmixing) */
+        forget_snapshot(txtp, txtp->vgmstream[grp->position]);
         apply_settings(txtp->vgmstream[grp->position], &grp->entry);
         txtp->entry[grp->position] = grp->entry; /* memcpy old settings for subgroups */
     }
@@ -644,6 +996,7 @@ static bool parse_groups(txtp_header_t* txtp) {
 
     /* apply default settings to the resulting file */
     if (txtp->default_entry_set) {
+        forget_snapshot(txtp, txtp->vgmstream[0]);
         apply_settings(txtp->vgmstream[0], &txtp->default_entry);
     }
 
@@ -3,6 +3,7 @@
 #include "../layout/layout.h"
 #include "../coding/coding.h"
 #include "../util/endianness.h"
+#include "../base/index_cache.h"
 #include "ubi_sb_streamfile.h"
 
 
@@ -1403,9 +1404,73 @@ fail:
     return NULL;
 }
 
+/* segments can be rebuilt from each parsed entry, so the layout may close them (sequences have up to 256) */
+typedef struct {
+    STREAMFILE* sf_index;
+    STREAMFILE* sf;
+    ubi_sb_header sb;           /* sequence config (for bank names) */
+    ubi_sb_header* entries;     /* parsed entry per segment, before init */
+} ubi_sb_opener_t;
+
+static VGMSTREAM* reopen_sequence_segment(void* priv, int segment) {
+    ubi_sb_opener_t* opener = priv;
+    ubi_sb_header temp_sb = opener->entries[segment]; /* memcpy'ed, as init may modify it */
+    STREAMFILE* sf_bank = opener->sf_index;
+    VGMSTREAM* vgmstream;
+    int bank = opener->sb.sequence_banks[segment];
+
+    if (opener->sb.has_numbered_banks && is_other_bank(&opener->sb, opener->sf_index, bank)) {
+        char bank_name[255];
+
+        get_ubi_bank_name(&opener->sb, bank, bank_name);
+        sf_bank = open_streamfile_by_filename(opener->sf, bank_name);
+        if (!sf_bank) return NULL;
+    }
+
+    vgmstream = init_vgmstream_ubi_sb_header(&temp_sb, sf_bank, opener->sf);
+
+    if (sf_bank != opener->sf_index)
+        close_streamfile(sf_bank);
+    return vgmstream;
+}
+
+static void free_sequence_opener(void* priv) {
+    ubi_sb_opener_t* opener = priv;
+    if (!opener)
+        return;
+    close_streamfile(opener->sf_index);
+    close_streamfile(opener->sf);
+    free(opener->entries);
+    free(opener);
+}
+
+/* entries are big, so only kept if the caller asked to limit open segments */
+static ubi_sb_opener_t* set_sequence_opener(segmented_layout_data* data, ubi_sb_header* sb, STREAMFILE* sf_index, STREAMFILE* sf) {
+    ubi_sb_opener_t* opener;
+
+    if (sf->max_open_segments <= 0)
+        return NULL;
+
+    opener = calloc(1, sizeof(ubi_sb_opener_t));
+    if (!opener) return NULL; /* segments stay open */
+
+    opener->sb = *sb; /* memcpy'ed */
+    opener->entries = calloc(data->segment_count, sizeof(ubi_sb_header));
+    opener->sf_index = reopen_streamfile(sf_index, 0);
+    opener->sf = reopen_streamfile(sf, 0);
+    if (!opener->entries || !opener->sf_index || !opener->sf ||
+            !segmented_set_opener(data, reopen_sequence_segment, free_sequence_opener, opener)) {
+        free_sequence_opener(opener);
+        return NULL;
+    }
+
+    return opener;
+}
+
 static VGMSTREAM* init_vgmstream_ubi_sb_sequence(ubi_sb_header* sb, STREAMFILE* sf_index, STREAMFILE* sf) {
     VGMSTREAM* vgmstream = NULL;
     segmented_layout_data* data = NULL;
+    ubi_sb_opener_t* opener = NULL;
     int i;
     STREAMFILE* sf_bank = sf_index;
 
@@ -1416,6 +1481,8 @@ static VGMSTREAM* init_vgmstream_ubi_sb_sequence(ubi_sb_header* sb, STREAMFILE*
     data = init_layout_segmented(sb->sequence_count);
     if (!data) goto fail;
 
+    opener = set_sequence_opener(data, sb, sf_index, sf);
+
     sb->channels = 0;
     sb->num_samples = 0;
 
@@ -1477,6 +1544,12 @@ static VGMSTREAM* init_vgmstream_ubi_sb_sequence(ubi_sb_header* sb, STREAMFILE*
             goto fail; /* not seen, technically ok but too much recursiveness? */
         }
 
+        if (opener) {
+            opener->entries[i] = temp_sb; /* memcpy'ed */
+            opener->entries[i].sf_header = NULL; /* only used when parsing */
+            data->can_reopen[i] = true;
+        }
+
         /* build the layer VGMSTREAM (current sb entry config) */
         data->segments[i] = init_vgmstream_ubi_sb_header(&temp_sb, sf_bank, sf);
         if (!data->segments[i]) goto fail;
@@ -1485,6 +1558,8 @@ static VGMSTREAM* init_vgmstream_ubi_sb_sequence(ubi_sb_header* sb, STREAMFILE*
             sb->loop_start = sb->num_samples;
         sb->num_samples += data->segments[i]->num_samples;
 
+        segmented_release_segment(data, i, sf);
+
         /* save current (silences don't have values, so this ensures they know later, when memcpy'ed) */
         sb->channels = temp_sb.channels;
         sb->sample_rate = temp_sb.sample_rate;
@@ -1501,7 +1576,7 @@ static VGMSTREAM* init_vgmstream_ubi_sb_sequence(ubi_sb_header* sb, STREAMFILE*
     if (!vgmstream) goto fail;
 
     vgmstream->meta_type = meta_UBI_SB;
-    vgmstream->sample_rate = data->segments[0]->sample_rate;
+    vgmstream->sample_rate = data->segment_infos[0].sample_rate;
     vgmstream->num_streams = sb->total_subsongs;
     //vgmstream->stream_size = sb->stream_size; /* auto when getting avg br */
 
@@ -1509,7 +1584,7 @@ static VGMSTREAM* init_vgmstream_ubi_sb_sequence(ubi_sb_header* sb, STREAMFILE*
     vgmstream->loop_start_sample = sb->loop_start;
     vgmstream->loop_end_sample = sb->num_samples;
 
-    vgmstream->coding_type = data->segments[0]->coding_type;
+    vgmstream->coding_type = data->segment_infos[0].coding_type;
     vgmstream->layout_type = layout_segmented;
     vgmstream->layout_data = data;
 
@@ -2527,17 +2602,23 @@ fail:
 }
 
 /* parse a bank and its possible audio headers */
-static int parse_sb(ubi_sb_header* sb, STREAMFILE* sf, int target_subsong) {
+/* Reads the type of each section2 entry. Banks are reopened once per subsong and every open needs to count
+ * all entries, so types are kept in the index cache rather than re-reading the whole section each time. */
+static const uint8_t* get_section2_types(ubi_sb_header* sb, STREAMFILE* sf) {
     int32_t (*read_32bit)(off_t,STREAMFILE*) = sb->big_endian ? read_32bitBE : read_32bitLE;
-    int i;
+    char key[64];
 
-    //;VGM_LOG("UBI SB: s1=%x (%x*%x), s2=%x (%x*%x), sX=%x (%x), s3=%x (%x*%x)\n",
-    //        sb->section1_offset,sb->cfg.section1_entry_size,sb->section1_num,sb->section2_offset,sb->cfg.section2_entry_size,sb->section2_num,
-    //        sb->sectionX_offset,sb->sectionX_size,sb->section3_offset,sb->cfg.section3_entry_size,sb->section3_num);
+    /* maps have many banks in the same file */
+    snprintf(key, sizeof(key), "ubi_sb:%x:%x:%x", (uint32_t)sb->section2_offset, (uint32_t)sb->cfg.section2_entry_size, sb->section2_num);
 
-    /* find target subsong info in section2 and keeps counting */
-    sb->bank_subsongs = 0;
-    for (i = 0; i < sb->section2_num; i++) {
+    const uint8_t* types = index_cache_get(sf, key, NULL);
+    if (types)
+        return types;
+
+    uint8_t* new_types = malloc(sb->section2_num);
+    if (!new_types) return NULL;
+
+    for (int i = 0; i < sb->section2_num; i++) {
         off_t offset = sb->section2_offset + sb->cfg.section2_entry_size*i;
         uint32_t header_type;
 
@@ -2546,9 +2627,35 @@ static int parse_sb(ubi_sb_header* sb, STREAMFILE* sf, int target_subsong) {
 
         if (header_type >= 0x10) {
             VGM_LOG("UBI SB: unknown type %x at %x\n", header_type, (uint32_t)offset);
-            goto fail;
+            free(new_types);
+            return NULL;
         }
 
+        new_types[i] = header_type;
+    }
+
+    return index_cache_add(sf, key, new_types, sb->section2_num);
+}
+
+static int parse_sb(ubi_sb_header* sb, STREAMFILE* sf, int target_subsong) {
+    const uint8_t* types = NULL;
+    int i;
+
+    //;VGM_LOG("UBI SB: s1=%x (%x*%x), s2=%x (%x*%x), sX=%x (%x), s3=%x (%x*%x)\n",
+    //        sb->section1_offset,sb->cfg.section1_entry_size,sb->section1_num,sb->section2_offset,sb->cfg.section2_entry_size,sb->section2_num,
+    //        sb->sectionX_offset,sb->sectionX_size,sb->section3_offset,sb->cfg.section3_entry_size,sb->section3_num);
+
+    if (sb->section2_num > 0) {
+        types = get_section2_types(sb, sf);
+        if (!types) goto fail;
+    }
+
+    /* find target subsong info in section2 and keeps counting */
+    sb->bank_subsongs = 0;
+    for (i = 0; i < sb->section2_num; i++) {
+        off_t offset = sb->section2_offset + sb->cfg.section2_entry_size*i;
+        uint32_t header_type = types[i];
+
         sb->types[header_type]++;
         if (!sb->allowed_types[header_type])
             continue;
@@ -2568,8 +2675,10 @@ static int parse_sb(ubi_sb_header* sb, STREAMFILE* sf, int target_subsong) {
 
     //;VGM_LOG("UBI SB: types "); {int i; for (i=0;i<16;i++){ VGM_ASSERT(sb->types[i],"%02x=%i ",i,sb->types[i]); }} VGM_LOG("\n");
 
+    index_cache_release(types);
     return 1;
 fail:
+    index_cache_release(types);
     return 0;
 }
 
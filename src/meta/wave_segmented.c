@@ -4,10 +4,163 @@
 
 #define MAX_SEGMENTS 4
 
+typedef struct {
+    int big_endian;
+    int channel_count;
+    int sample_rate;
+    off_t segments_offset;
+} wave_header_t;
+
+/* create a sub-VGMSTREAM per segment
+ * (we'll reopen this sf as needed, so each sub-VGMSTREAM is fully independent) */
+static VGMSTREAM* build_segment(STREAMFILE* sf, wave_header_t* wave, int i) {
+    VGMSTREAM* vgmstream = NULL;
+    off_t extradata_offset, table_offset, segment_offset;
+    size_t segment_size;
+    int32_t segment_samples;
+    int codec, ch;
+    int channel_count = wave->channel_count;
+    off_t segments_offset = wave->segments_offset;
+    int32_t (*read_32bit)(off_t,STREAMFILE*) = wave->big_endian ? read_32bitBE : read_32bitLE;
+    int16_t (*read_16bit)(off_t,STREAMFILE*) = wave->big_endian ? read_16bitBE : read_16bitLE;
+
+    codec = read_8bit(segments_offset+0x10*i+0x00, sf);
+    /* 0x01(1): unknown (flag? usually 0x00/0x01/0x02) */
+    if (read_8bit(segments_offset+0x10*i+0x02, sf) != 0x01) goto fail; /* unknown */
+    if (read_8bit(segments_offset+0x10*i+0x03, sf) != 0x00) goto fail; /* unknown */
+
+    segment_samples  = read_32bit(segments_offset+0x10*i+0x04, sf);
+    extradata_offset = read_32bit(segments_offset+0x10*i+0x08, sf);
+    table_offset     = read_32bit(segments_offset+0x10*i+0x0c, sf);
+
+    switch(codec) {
+        case 0x02: { /* "adpcm" */
+            vgmstream = allocate_vgmstream(channel_count, 0);
+            if (!vgmstream) goto fail;
+
+            vgmstream->sample_rate = wave->sample_rate;
+            vgmstream->meta_type = meta_WAVE;
+            vgmstream->coding_type = coding_IMA_mono;
+            vgmstream->layout_type = layout_none;
+            vgmstream->num_samples = segment_samples;
+
+            if (!vgmstream_open_stream(vgmstream,sf,0x00))
+                goto fail;
+
+            /* bizarrely enough channel data isn't sequential (segment0 ch1+ may go after all other segments) */
+            for (ch = 0; ch < channel_count; ch++) {
+                segment_offset = read_32bit(table_offset + 0x04*ch, sf);
+                vgmstream->ch[ch].channel_start_offset =
+                        vgmstream->ch[ch].offset = segment_offset;
+
+                /* ADPCM setup */
+                vgmstream->ch[ch].adpcm_history1_32 = read_16bit(extradata_offset+0x04*ch+0x00, sf);
+                vgmstream->ch[ch].adpcm_step_index  = read_8bit(extradata_offset+0x04*ch+0x02, sf);
+                /* 0x03: reserved */
+            }
+
+            break;
+        }
+
+        case 0x03: { /* "dsp-adpcm" */
+            vgmstream = allocate_vgmstream(channel_count, 0);
+            if (!vgmstream) goto fail;
+
+            vgmstream->sample_rate = wave->sample_rate;
+            vgmstream->meta_type = meta_WAVE;
+            vgmstream->coding_type = coding_NGC_DSP;
+            vgmstream->layout_type = layout_none;
+            vgmstream->num_samples = segment_samples;
+
+            if (!vgmstream_open_stream(vgmstream,sf,0x00))
+                goto fail;
+
+            /* bizarrely enough channel data isn't sequential (segment0 ch1+ may go after all other segments) */
+            for (ch = 0; ch < channel_count; ch++) {
+                segment_offset = read_32bit(table_offset + 0x04*ch, sf);
+                vgmstream->ch[ch].channel_start_offset =
+                        vgmstream->ch[ch].offset = segment_offset;
+            }
+
+            /* ADPCM setup: 0x06 initial ps/hist1/hist2 (per channel) + 0x20 coefs (per channel) */
+            dsp_read_hist(vgmstream, sf, extradata_offset+0x02, 0x06, wave->big_endian);
+            dsp_read_coefs(vgmstream, sf, extradata_offset+0x06*channel_count+0x00, 0x20, wave->big_endian);
+
+            break;
+        }
+
+#ifdef VGM_USE_VORBIS
+        case 0x04: { /* "vorbis" */
+            ogg_vorbis_meta_info_t ovmi = {0};
+
+            segment_offset = read_32bit(table_offset, sf);
+            segment_size = read_32bitBE(segment_offset, sf); /* always BE */
+
+            ovmi.meta_type = meta_WAVE;
+            ovmi.stream_size = segment_size;
+
+            vgmstream = init_vgmstream_ogg_vorbis_config(sf, segment_offset+0x04, &ovmi);
+            if (!vgmstream) goto fail;
+
+            if (vgmstream->num_samples != segment_samples) {
+                VGM_LOG("WAVE: segment %i samples != num_samples\n", i);
+                goto fail;
+            }
+
+            break;
+        }
+#endif
+
+        default: /* others: s16be/s16le/mp3 as referenced in the exe? */
+            VGM_LOG("WAVE: unknown codec\n");
+            goto fail;
+    }
+
+    return vgmstream;
+fail:
+    close_vgmstream(vgmstream);
+    return NULL;
+}
+
+/* segments can be rebuilt from the header, so the layout may close them */
+typedef struct {
+    STREAMFILE* sf;
+    wave_header_t wave;
+} wave_opener_t;
+
+static VGMSTREAM* reopen_segment(void* priv, int segment) {
+    wave_opener_t* opener = priv;
+    return build_segment(opener->sf, &opener->wave, segment);
+}
+
+static void free_opener(void* priv) {
+    wave_opener_t* opener = priv;
+    if (!opener)
+        return;
+    close_streamfile(opener->sf);
+    free(opener);
+}
+
+static void set_opener(segmented_layout_data* data, STREAMFILE* sf, wave_header_t* wave) {
+    wave_opener_t* opener = calloc(1, sizeof(wave_opener_t));
+    if (!opener) return; /* segments stay open */
+
+    opener->wave = *wave; /* memcpy */
+    opener->sf = reopen_streamfile(sf, 0);
+    if (!opener->sf || !segmented_set_opener(data, reopen_segment, free_opener, opener)) {
+        free_opener(opener);
+        return;
+    }
+
+    for (int i = 0; i < data->segment_count; i++) {
+        data->can_reopen[i] = true;
+    }
+}
+
 /* .WAVE - "EngineBlack" games, segmented [Shantae and the Pirate's Curse (PC/3DS), TMNT: Danger of the Ooze (PS3/3DS)] */
 VGMSTREAM * init_vgmstream_wave_segmented(STREAMFILE *sf) {
     VGMSTREAM * vgmstream = NULL;
-    off_t segments_offset;
+    wave_header_t wave = {0};
     int loop_flag = 0, channel_count, sample_rate;
     int32_t num_samples, loop_start_sample = 0, loop_end_sample = 0;
 
@@ -45,122 +198,30 @@ VGMSTREAM * init_vgmstream_wave_segmented(STREAMFILE *sf) {
 
     loop_start_segment = read_16bit(0x08, sf);
     loop_end_segment   = read_16bit(0x0a, sf);
-    segments_offset = read_32bit(0x0c, sf);
+    wave.segments_offset = read_32bit(0x0c, sf);
 
     sample_rate = read_32bit(0x10, sf);
     num_samples = read_32bit(0x14, sf);
     /* 0x18: unknown (usually 0, maybe some count) */
 
+    wave.big_endian = big_endian;
+    wave.channel_count = channel_count;
+    wave.sample_rate = sample_rate;
+
 
     /* init layout */
     data = init_layout_segmented(segment_count);
     if (!data) goto fail;
 
+    set_opener(data, sf, &wave);
+
     /* parse segments (usually: preload + intro + loop + ending, intro/ending may be skipped)
      * Often first segment is ADPCM and rest Ogg; may only have one segment. */
-    {
-        off_t extradata_offset, table_offset, segment_offset;
-        size_t segment_size;
-        int32_t segment_samples;
-        int codec;
-        int i, ch;
-
-        /* open each segment subfile */
-        for (i = 0; i < segment_count; i++) {
-            codec = read_8bit(segments_offset+0x10*i+0x00, sf);
-            /* 0x01(1): unknown (flag? usually 0x00/0x01/0x02) */
-            if (read_8bit(segments_offset+0x10*i+0x02, sf) != 0x01) goto fail; /* unknown */
-            if (read_8bit(segments_offset+0x10*i+0x03, sf) != 0x00) goto fail; /* unknown */
-
-            segment_samples  = read_32bit(segments_offset+0x10*i+0x04, sf);
-            extradata_offset = read_32bit(segments_offset+0x10*i+0x08, sf);
-            table_offset     = read_32bit(segments_offset+0x10*i+0x0c, sf);
-
-            /* create a sub-VGMSTREAM per segment
-             * (we'll reopen this sf as needed, so each sub-VGMSTREAM is fully independent) */
-            switch(codec) {
-                case 0x02: { /* "adpcm" */
-                    data->segments[i] = allocate_vgmstream(channel_count, 0);
-                    if (!data->segments[i]) goto fail;
-
-                    data->segments[i]->sample_rate = sample_rate;
-                    data->segments[i]->meta_type = meta_WAVE;
-                    data->segments[i]->coding_type = coding_IMA_mono;
-                    data->segments[i]->layout_type = layout_none;
-                    data->segments[i]->num_samples = segment_samples;
-
-                    if (!vgmstream_open_stream(data->segments[i],sf,0x00))
-                        goto fail;
-
-                    /* bizarrely enough channel data isn't sequential (segment0 ch1+ may go after all other segments) */
-                    for (ch = 0; ch < channel_count; ch++) {
-                        segment_offset = read_32bit(table_offset + 0x04*ch, sf);
-                        data->segments[i]->ch[ch].channel_start_offset =
-                                data->segments[i]->ch[ch].offset = segment_offset;
-
-                        /* ADPCM setup */
-                        data->segments[i]->ch[ch].adpcm_history1_32 = read_16bit(extradata_offset+0x04*ch+0x00, sf);
-                        data->segments[i]->ch[ch].adpcm_step_index  = read_8bit(extradata_offset+0x04*ch+0x02, sf);
-                        /* 0x03: reserved */
-                    }
-
-                    break;
-                }
-
-                case 0x03: { /* "dsp-adpcm" */
-                    data->segments[i] = allocate_vgmstream(channel_count, 0);
-                    if (!data->segments[i]) goto fail;
-
-                    data->segments[i]->sample_rate = sample_rate;
-                    data->segments[i]->meta_type = meta_WAVE;
-                    data->segments[i]->coding_type = coding_NGC_DSP;
-                    data->segments[i]->layout_type = layout_none;
-                    data->segments[i]->num_samples = segment_samples;
-
-                    if (!vgmstream_open_stream(data->segments[i],sf,0x00))
-                        goto fail;
-
-                    /* bizarrely enough channel data isn't sequential (segment0 ch1+ may go after all other segments) */
-                    for (ch = 0; ch < channel_count; ch++) {
-                        segment_offset = read_32bit(table_offset + 0x04*ch, sf);
-                        data->segments[i]->ch[ch].channel_start_offset =
-                                data->segments[i]->ch[ch].offset = segment_offset;
-                    }
-
-                    /* ADPCM setup: 0x06 initial ps/hist1/hist2 (per channel) + 0x20 coefs (per channel) */
-                    dsp_read_hist(data->segments[i], sf, extradata_offset+0x02, 0x06, big_endian);
-                    dsp_read_coefs(data->segments[i], sf, extradata_offset+0x06*channel_count+0x00, 0x20, big_endian);
-
-                    break;
-                }
-
-#ifdef VGM_USE_VORBIS
-                case 0x04: { /* "vorbis" */
-                    ogg_vorbis_meta_info_t ovmi = {0};
-
-                    segment_offset = read_32bit(table_offset, sf);
-                    segment_size = read_32bitBE(segment_offset, sf); /* always BE */
+    for (int i = 0; i < segment_count; i++) {
+        data->segments[i] = build_segment(sf, &wave, i);
+        if (!data->segments[i]) goto fail;
 
-                    ovmi.meta_type = meta_WAVE;
-                    ovmi.stream_size = segment_size;
-
-                    data->segments[i] = init_vgmstream_ogg_vorbis_config(sf, segment_offset+0x04, &ovmi);
-                    if (!data->segments[i]) goto fail;
-
-                    if (data->segments[i]->num_samples != segment_samples) {
-                        VGM_LOG("WAVE: segment %i samples != num_samples\n", i);
-                        goto fail;
-                    }
-
-                    break;
-                }
-#endif
-
-                default: /* others: s16be/s16le/mp3 as referenced in the exe? */
-                    VGM_LOG("WAVE: unknown codec\n");
-                    goto fail;
-            }
-        }
+        segmented_release_segment(data, i, sf);
     }
 
     /* setup segmented VGMSTREAMs */
@@ -180,7 +241,7 @@ VGMSTREAM * init_vgmstream_wave_segmented(STREAMFILE *sf) {
                 loop_start_sample = sample_count;
             }
 
-            sample_count += data->segments[i]->num_samples;
+            sample_count += data->segment_infos[i].num_samples;
 
             if (loop_flag && loop_end_segment-1 == i) {
                 loop_end_sample = sample_count;
@@ -207,7 +268,7 @@ VGMSTREAM * init_vgmstream_wave_segmented(STREAMFILE *sf) {
     vgmstream->stream_size = get_streamfile_size(sf); /* wrong kbps otherwise */
 
     /* .wave can mix codecs, usually first segment is a small ADPCM section) */
-    vgmstream->coding_type = (segment_count == 1 ? data->segments[0]->coding_type : data->segments[1]->coding_type);
+    vgmstream->coding_type = (segment_count == 1 ? data->segment_infos[0].coding_type : data->segment_infos[1].coding_type);
     vgmstream->layout_type = layout_segmented;
     vgmstream->layout_data = data;
 
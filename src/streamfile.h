@@ -73,6 +73,15 @@ typedef struct _STREAMFILE {
      * Not ideal here, but it was the simplest way to pass to all init_vgmstream_x functions. */
     int stream_index; /* 0=default/auto (first), 1=first, N=Nth */
 
+    /* Hint for segmented formats that can reopen segments: only this many need to stay open (0=all),
+     * so they may be closed right after parsing them. Passed like stream_index. */
+    int max_open_segments;
+
+    /* Optional: returns a pointer to 'length' bytes at 'offset' if they are in the internal buffer
+     * (valid until next call to this SF), or NULL otherwise (then a regular read is needed).
+     * Sets 'p_size' to the buffered bytes from 'offset' (at least 'length'). */
+    const uint8_t* (*read_span)(struct _STREAMFILE* sf, offv_t offset, size_t length, size_t* p_size);
+
 } STREAMFILE;
 
 /* All open_ fuctions should be safe to call with wrong/null parameters.
@@ -86,12 +95,33 @@ STREAMFILE* open_stdio_streamfile(const char* filename);
 /* Opens a standard STREAMFILE from a pre-opened FILE. */
 STREAMFILE* open_stdio_streamfile_by_file(FILE* file, const char* filename);
 
+/* Opens a STREAMFILE that reads from a memory-mapped file, shared by SFs reopened from it.
+ * Falls back to a stdio STREAMFILE if the file can't be mapped (pipes, etc).
+ * Only for local files that won't change while open: on POSIX, truncating a mapped file makes reads crash (SIGBUS). */
+STREAMFILE* open_mmap_streamfile(const char* filename);
+
 /* Opens a STREAMFILE that does buffered IO.
  * Can be used when the underlying IO may be slow (like when using custom IO).
  * Buffer size is optional. */
 STREAMFILE* open_buffer_streamfile(STREAMFILE* sf, size_t buffer_size);
 STREAMFILE* open_buffer_streamfile_f(STREAMFILE* sf, size_t buffer_size);
 
+/* Opens a STREAMFILE that keeps pages of the file in memory, shared by all SFs reopened from it (same filename).
+ * Can be used when many SFs read nearby parts of the same file (like one SF per channel).
+ * Max size (memory budget) is optional, 0 uses the default. */
+STREAMFILE* open_cache_streamfile(STREAMFILE* sf, size_t max_size);
+STREAMFILE* open_cache_streamfile_f(STREAMFILE* sf, size_t max_size);
+/* Process-wide default max size for cache streamfiles; 0 = don't use them for channels. */
+void set_cache_streamfile_max_size(size_t max_size);
+size_t get_cache_streamfile_max_size(void);
+/* Bytes read from the underlying streamfile and bytes returned by reads (must be a cache streamfile). */
+bool get_cache_streamfile_stats(STREAMFILE* sf, int64_t* p_inner_bytes, int64_t* p_served_bytes);
+
+/* Opens a STREAMFILE that reads windows of buf_size, loading the next one in a background thread
+ * when reads are sequential. Can be used when the underlying IO is slow (like network storage). */
+STREAMFILE* open_readahead_streamfile(STREAMFILE* sf, size_t buf_size);
+STREAMFILE* open_readahead_streamfile_f(STREAMFILE* sf, size_t buf_size);
+
 /* Opens a STREAMFILE that doesn't close the underlying streamfile.
  * Calls to open won't wrap the new SF (assumes it needs to be closed).
  * Can be used in metas to test custom IO without closing the external SF. */
@@ -126,6 +156,13 @@ STREAMFILE* open_fakename_streamfile_f(STREAMFILE* sf, const char* fakename, con
 STREAMFILE* open_multifile_streamfile(STREAMFILE** sfs, size_t sfs_size);
 STREAMFILE* open_multifile_streamfile_f(STREAMFILE** sfs, size_t sfs_size);
 
+/* Opens a STREAMFILE that keeps the start and end of the file in memory, and doesn't close the underlying streamfile.
+ * Used during format detection, since parsers read headers/footers from both ends a lot.
+ * Cache size is optional. Calls to open won't wrap the new SF. */
+STREAMFILE* open_probe_streamfile(STREAMFILE* sf, size_t cache_size);
+/* Reads that reached the underlying streamfile (must be a probe streamfile). */
+int get_probe_streamfile_reads(STREAMFILE* sf);
+
 /* Opens a STREAMFILE from a (path)+filename.
  * Just a wrapper, to avoid having to access the STREAMFILE's callbacks directly. */
 STREAMFILE* open_streamfile(STREAMFILE* sf, const char* pathname);
@@ -146,6 +183,22 @@ static inline size_t read_streamfile(uint8_t* dst, offv_t offset, size_t length,
     return sf->read(sf, dst, offset, length);
 }
 
+/* read from a file, returning a pointer to the SF's buffer if possible (valid until next read) to avoid copies,
+ * or dst otherwise; bytes past EOF are set to 0 (for frame decoders that ignore EOF errors) */
+static inline const uint8_t* read_streamfile_span(uint8_t* dst, offv_t offset, size_t length, STREAMFILE* sf) {
+    if (sf->read_span) {
+        size_t size;
+        const uint8_t* span = sf->read_span(sf, offset, length, &size);
+        if (span)
+            return span;
+    }
+
+    size_t bytes = sf->read(sf, dst, offset, length);
+    if (bytes < length)
+        memset(dst + bytes, 0, length - bytes);
+    return dst;
+}
+
 /* return file size */
 static inline size_t get_streamfile_size(STREAMFILE* sf) {
     return sf->get_size(sf);
@@ -0,0 +1,229 @@
+#include "block_cache.h"
+#include "threads.h"
+
+#define BLOCK_CACHE_DEFAULT_SIZE  0x800000
+
+/* block being loaded by some thread, that others wanting it wait on */
+typedef struct {
+    vgm_event_t done;       /* set once the block is ready (or failed), then by each waiter for the next one */
+    int waiters;
+} block_loading_t;
+
+typedef struct {
+    uint8_t* data;
+    offv_t offset;
+    size_t size;            /* valid bytes */
+    size_t alloc_size;
+    uint32_t last_use;      /* LRU tick */
+    block_loading_t* loading; /* not NULL while loading (no data yet, can't be evicted) */
+} cache_block_t;
+
+struct block_cache_t {
+    block_cache_load_t load;
+    size_t max_size;
+    int refs;
+    vgm_mutex_t lock;
+
+    cache_block_t* blocks;
+    int count;
+    int capacity;
+    size_t total_size;
+    uint32_t tick;
+};
+
+
+block_cache_t* block_cache_init(block_cache_load_t load, size_t max_size) {
+    block_cache_t* cache = calloc(1, sizeof(block_cache_t));
+    if (!cache) return NULL;
+
+    if (!vgm_mutex_init(&cache->lock)) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->load = load;
+    cache->max_size = max_size ? max_size : BLOCK_CACHE_DEFAULT_SIZE;
+    cache->refs = 1;
+    return cache;
+}
+
+void block_cache_ref(block_cache_t* cache) {
+    vgm_mutex_lock(&cache->lock);
+    cache->refs++;
+    vgm_mutex_unlock(&cache->lock);
+}
+
+void block_cache_free(block_cache_t* cache) {
+    if (!cache) return;
+
+    vgm_mutex_lock(&cache->lock);
+    int refs = --cache->refs;
+    vgm_mutex_unlock(&cache->lock);
+    if (refs > 0)
+        return;
+
+    for (int i = 0; i < cache->count; i++) {
+        free(cache->blocks[i].data);
+    }
+    free(cache->blocks);
+    vgm_mutex_free(&cache->lock);
+    free(cache);
+}
+
+/* must hold the lock */
+static cache_block_t* find_block(block_cache_t* cache, offv_t offset) {
+    for (int i = 0; i < cache->count; i++) {
+        if (cache->blocks[i].offset == offset) {
+            cache->blocks[i].last_use = ++cache->tick;
+            return &cache->blocks[i];
+        }
+    }
+    return NULL;
+}
+
+static void remove_block(block_cache_t* cache, cache_block_t* block) {
+    cache->total_size -= block->alloc_size;
+    free(block->data);
+    *block = cache->blocks[cache->count - 1];
+    cache->count--;
+}
+
+/* adds a block to be loaded, evicting old ones if over budget (returns NULL on errors); must hold the lock */
+static cache_block_t* add_block(block_cache_t* cache, offv_t offset, size_t alloc_size, block_loading_t* loading) {
+
+    while (cache->total_size + alloc_size > cache->max_size) {
+        int lru = -1;
+        for (int i = 0; i < cache->count; i++) {
+            if (cache->blocks[i].loading)
+                continue;
+            if (lru < 0 || cache->blocks[i].last_use < cache->blocks[lru].last_use)
+                lru = i;
+        }
+        if (lru < 0)
+            break; /* only blocks being loaded, allowed over budget meanwhile */
+
+        remove_block(cache, &cache->blocks[lru]);
+    }
+
+    if (cache->count == cache->capacity) {
+        int capacity = cache->capacity ? cache->capacity * 2 : 4;
+        cache_block_t* blocks = realloc(cache->blocks, capacity * sizeof(cache_block_t));
+        if (!blocks) return NULL;
+        cache->blocks = blocks;
+        cache->capacity = capacity;
+    }
+
+    cache_block_t* block = &cache->blocks[cache->count];
+    block->data = NULL;
+    block->offset = offset;
+    block->size = 0;
+    block->alloc_size = alloc_size;
+    block->last_use = ++cache->tick;
+    block->loading = loading;
+    cache->count++;
+    cache->total_size += alloc_size;
+
+    return block;
+}
+
+static size_t copy_block(cache_block_t* block, uint8_t* dst, size_t pos, size_t length) {
+    if (pos >= block->size)
+        return 0;
+    if (length > block->size - pos)
+        length = block->size - pos;
+    memcpy(dst, block->data + pos, length);
+    return length;
+}
+
+/* Waits until the block being loaded by another thread is done; must hold the lock (released meanwhile). */
+static void wait_block(block_cache_t* cache, block_loading_t* loading) {
+    loading->waiters++;
+    vgm_mutex_unlock(&cache->lock);
+
+    vgm_event_wait(&loading->done);
+
+    vgm_mutex_lock(&cache->lock);
+    loading->waiters--;
+    if (loading->waiters > 0) {
+        vgm_event_set(&loading->done); /* wake up next waiter */
+    }
+    else {
+        vgm_event_free(&loading->done);
+        free(loading);
+    }
+}
+
+size_t block_cache_read(block_cache_t* cache, uint8_t* dst, offv_t block_offset, size_t block_size, size_t pos, size_t length, STREAMFILE* sf, void* data) {
+    size_t bytes;
+
+    vgm_mutex_lock(&cache->lock);
+    cache_block_t* block = find_block(cache, block_offset);
+    while (block && block->loading) {
+        /* other thread is loading the same block (ex. another layer), no need to load it twice */
+        wait_block(cache, block->loading);
+        block = find_block(cache, block_offset); /* may have failed (removed) */
+    }
+    if (block) {
+        bytes = copy_block(block, dst, pos, length);
+        vgm_mutex_unlock(&cache->lock);
+        return bytes;
+    }
+
+    /* mark as loading, so other threads wanting it wait (if this fails it's loaded but not cached) */
+    block_loading_t* loading = calloc(1, sizeof(block_loading_t));
+    if (loading && !vgm_event_init(&loading->done)) {
+        free(loading);
+        loading = NULL;
+    }
+    if (loading && !add_block(cache, block_offset, block_size, loading)) {
+        vgm_event_free(&loading->done);
+        free(loading);
+        loading = NULL;
+    }
+    vgm_mutex_unlock(&cache->lock);
+
+    /* loaded without the lock as it may be slow */
+    uint8_t* buf = malloc(block_size);
+    size_t size = 0;
+    if (buf)
+        size = cache->load(sf, buf, block_offset, block_size, data);
+    if (size == 0) {
+        free(buf);
+        buf = NULL;
+    }
+
+    if (!loading) {
+        bytes = 0;
+        if (buf && pos < size) {
+            bytes = length < size - pos ? length : size - pos;
+            memcpy(dst, buf + pos, bytes);
+        }
+        free(buf);
+        return bytes;
+    }
+
+    /* loading blocks aren't evicted, but may have moved */
+    vgm_mutex_lock(&cache->lock);
+    block = find_block(cache, block_offset);
+    block->loading = NULL;
+    if (buf) {
+        block->data = buf;
+        block->size = size;
+        bytes = copy_block(block, dst, pos, length);
+    }
+    else {
+        remove_block(cache, block);
+        bytes = 0;
+    }
+
+    if (loading->waiters > 0) {
+        vgm_event_set(&loading->done); /* waiters free it */
+    }
+    else {
+        vgm_event_free(&loading->done);
+        free(loading);
+    }
+    vgm_mutex_unlock(&cache->lock);
+
+    return bytes;
+}
@@ -0,0 +1,30 @@
+#ifndef _BLOCK_CACHE_H_
+#define _BLOCK_CACHE_H_
+
+#include "../streamfile.h"
+
+/* Shared cache of decoded blocks (ex. decrypted), for IO streamfiles where making a block is slow and the same
+ * blocks are read again by every SF reopened from them (one per channel or layer). Blocks are identified by
+ * offset, loaded once with the callback and evicted in LRU order once over the memory budget. Threads that
+ * want a block another thread is loading wait for it, while different blocks may be loaded in parallel.
+ *
+ * IO SFs can keep the cache in their data and add a ref in their init callback (data is copied on reopen),
+ * so all handles of the same source share it. */
+typedef struct block_cache_t block_cache_t;
+
+/* Fills buf with the block at offset (up to size), reading from sf. Returns valid bytes or 0 on errors. */
+typedef size_t (*block_cache_load_t)(STREAMFILE* sf, uint8_t* buf, offv_t offset, size_t size, void* data);
+
+/* Creates a cache with one ref, using max_size bytes (0 = default). At least one block is always kept. */
+block_cache_t* block_cache_init(block_cache_load_t load, size_t max_size);
+
+void block_cache_ref(block_cache_t* cache);
+
+/* Removes a ref, freeing the cache with the last one. */
+void block_cache_free(block_cache_t* cache);
+
+/* Copies up to length bytes at pos within the block at block_offset (of block_size, loaded with sf + data
+ * if not cached). Returns bytes copied, or 0 if the block can't be loaded. */
+size_t block_cache_read(block_cache_t* cache, uint8_t* dst, offv_t block_offset, size_t block_size, size_t pos, size_t length, STREAMFILE* sf, void* data);
+
+#endif
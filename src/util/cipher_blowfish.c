@@ -301,3 +301,45 @@ void blowfish_decrypt_ecb(blowfish_ctx* ctx, uint8_t* block) {
     put_u32be(block + 0x00, xl);
     put_u32be(block + 0x04, xr);
 }
+
+/* Decrypts 4 blocks at once. Lookups depend on the previous round so a single block is mostly waiting
+ * on S-box loads, while independent blocks can be interleaved (SSE2 has no gathers, so this is plain C). */
+void blowfish_decrypt_ecb_blocks(blowfish_ctx* ctx, uint8_t* buf, size_t size) {
+    size_t pos = 0;
+
+    for (; pos + 0x20 <= size; pos += 0x20) {
+        uint8_t* block = buf + pos;
+        uint32_t xl0 = get_u32be(block + 0x00), xr0 = get_u32be(block + 0x04);
+        uint32_t xl1 = get_u32be(block + 0x08), xr1 = get_u32be(block + 0x0c);
+        uint32_t xl2 = get_u32be(block + 0x10), xr2 = get_u32be(block + 0x14);
+        uint32_t xl3 = get_u32be(block + 0x18), xr3 = get_u32be(block + 0x1c);
+
+        /* same as blowfish_decrypt, but 2 rounds per loop instead of swapping */
+        for (int i = 16 + 1; i > 1; i -= 2) {
+            uint32_t p0 = ctx->P[i + 0];
+            uint32_t p1 = ctx->P[i - 1];
+
+            xl0 ^= p0; xl1 ^= p0; xl2 ^= p0; xl3 ^= p0;
+            xr0 ^= blowfish_F(ctx, xl0);
+            xr1 ^= blowfish_F(ctx, xl1);
+            xr2 ^= blowfish_F(ctx, xl2);
+            xr3 ^= blowfish_F(ctx, xl3);
+
+            xr0 ^= p1; xr1 ^= p1; xr2 ^= p1; xr3 ^= p1;
+            xl0 ^= blowfish_F(ctx, xr0);
+            xl1 ^= blowfish_F(ctx, xr1);
+            xl2 ^= blowfish_F(ctx, xr2);
+            xl3 ^= blowfish_F(ctx, xr3);
+        }
+
+        /* last swap is undone, so xl/xr are output reversed */
+        put_u32be(block + 0x00, xr0 ^ ctx->P[0]); put_u32be(block + 0x04, xl0 ^ ctx->P[1]);
+        put_u32be(block + 0x08, xr1 ^ ctx->P[0]); put_u32be(block + 0x0c, xl1 ^ ctx->P[1]);
+        put_u32be(block + 0x10, xr2 ^ ctx->P[0]); put_u32be(block + 0x14, xl2 ^ ctx->P[1]);
+        put_u32be(block + 0x18, xr3 ^ ctx->P[0]); put_u32be(block + 0x1c, xl3 ^ ctx->P[1]);
+    }
+
+    for (; pos + 0x08 <= size; pos += 0x08) {
+        blowfish_decrypt_ecb(ctx, buf + pos);
+    }
+}
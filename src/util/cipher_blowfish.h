@@ -1,6 +1,7 @@
 #ifndef _CIPHER_BLOWFISH_H_
 #define _CIPHER_BLOWFISH_H_
 #include <inttypes.h>
+#include <stddef.h>
 
 typedef struct blowfish_ctx blowfish_ctx;
 
@@ -11,4 +12,7 @@ void blowfish_free(blowfish_ctx* ctx);
 
 /* assumed block size is at least 0x08 */
 void blowfish_decrypt_ecb(blowfish_ctx* ctx, uint8_t* block);
+
+/* same as calling blowfish_decrypt_ecb every 0x08 (size should be a multiple of 0x08), but faster */
+void blowfish_decrypt_ecb_blocks(blowfish_ctx* ctx, uint8_t* buf, size_t size);
 #endif
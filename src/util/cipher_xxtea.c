@@ -2,6 +2,7 @@
 #include "cipher_xxtea.h"
 #include "reader_get.h"
 #include "reader_put.h"
+#include "simd.h"
 
 
 // Original MX is pasted and uses stuff declared below, rather than working like a function.
@@ -45,3 +46,78 @@ void xxtea_decrypt(uint8_t* v, uint32_t size, const uint32_t* key) {
     }
     while (--rounds);
 }
+
+#ifdef VGM_SIMD
+static inline v4i_t xxtea_mx_v4i(v4i_t y, v4i_t z, v4i_t sum, v4i_t key) {
+    v4i_t xor1 = v4i_xor(v4i_srl(z, 5), v4i_sll(y, 2));
+    v4i_t xor2 = v4i_xor(v4i_srl(y, 3), v4i_sll(z, 4));
+    v4i_t xor3 = v4i_xor(sum, y);
+    v4i_t xor4 = v4i_xor(key, z);
+
+    return v4i_xor(v4i_add(xor1, xor2), v4i_add(xor3, xor4));
+}
+
+/* Decrypts 4 blocks in parallel. A single block can't be vectorized (each word needs the previous result)
+ * but blocks of the same size use the same sum/key per word, so words are interleaved into lanes in tmp. */
+static void xxtea_decrypt_v4i(uint8_t* v, uint32_t size, const uint32_t* key, int32_t* tmp) {
+    const uint32_t xxtea_delta = 0x9e3779b9;
+
+    unsigned n = size >> 2; /* in ints */
+    for (unsigned p = 0; p < n; p++) {
+        for (int lane = 0; lane < 4; lane++) {
+            tmp[p * 4 + lane] = get_u32le(v + lane * size + p * 4);
+        }
+    }
+
+    unsigned rounds = 6 + 52 / n;
+    uint32_t sum = rounds * xxtea_delta;
+
+    v4i_t y = v4i_load(tmp + 0 * 4);
+    do {
+        unsigned int e = (sum >> 2) & 3;
+        v4i_t vsum = v4i_set1(sum);
+        v4i_t vkey[4];
+        for (int i = 0; i < 4; i++) {
+            vkey[i] = v4i_set1(key[i ^ e]);
+        }
+
+        v4i_t z;
+        for (unsigned p = n - 1; p > 0; p--) {
+            z = v4i_load(tmp + (p - 1) * 4);
+            y = v4i_sub(v4i_load(tmp + p * 4), xxtea_mx_v4i(y, z, vsum, vkey[p & 3]));
+            v4i_store(tmp + p * 4, y);
+        }
+        z = v4i_load(tmp + (n - 1) * 4);
+        y = v4i_sub(v4i_load(tmp + 0 * 4), xxtea_mx_v4i(y, z, vsum, vkey[0]));
+        v4i_store(tmp + 0 * 4, y);
+        sum -= xxtea_delta;
+    }
+    while (--rounds);
+
+    for (unsigned p = 0; p < n; p++) {
+        for (int lane = 0; lane < 4; lane++) {
+            put_u32le(v + lane * size + p * 4, tmp[p * 4 + lane]);
+        }
+    }
+}
+#endif
+
+void xxtea_decrypt_blocks(uint8_t* v, uint32_t size, int count, const uint32_t* key) {
+    int done = 0;
+
+#ifdef VGM_SIMD
+    if (count >= 4 && size > 0x04) {
+        int32_t* tmp = malloc((size >> 2) * 4 * sizeof(int32_t));
+        if (tmp) {
+            for (; done + 4 <= count; done += 4) {
+                xxtea_decrypt_v4i(v + done * size, size, key, tmp);
+            }
+            free(tmp);
+        }
+    }
+#endif
+
+    for (; done < count; done++) {
+        xxtea_decrypt(v + done * size, size, key);
+    }
+}
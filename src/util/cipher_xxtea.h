@@ -15,4 +15,8 @@
  * key: 0x10 key converted into 4 u32le ints
  */
 void xxtea_decrypt(uint8_t* v, uint32_t size, const uint32_t* key);
+
+/* Same as calling xxtea_decrypt over count consecutive blocks of size each, but faster
+ * (blocks are decrypted several at once when possible). */
+void xxtea_decrypt_blocks(uint8_t* v, uint32_t size, int count, const uint32_t* key);
 #endif
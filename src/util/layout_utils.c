@@ -236,18 +236,18 @@ VGMSTREAM* allocate_segmented_vgmstream(segmented_layout_data* data, int loop_fl
     int channel_layout;
     int i, sample_rate;
     int32_t num_samples, loop_start, loop_end;
-    coding_t coding_type = data->segments[0]->coding_type;
+    coding_t coding_type = data->segment_infos[0].coding_type;
 
-    /* save data */
-    channel_layout = data->segments[0]->channel_layout;
+    /* save data (from infos as segments may be closed) */
+    channel_layout = data->segment_infos[0].channel_layout;
     num_samples = 0;
     loop_start = 0;
     loop_end = 0;
     sample_rate = 0;
     for (i = 0; i < data->segment_count; i++) {
         /* needs get_samples since element may use play settings */
-        int32_t segment_samples = vgmstream_get_samples(data->segments[i]);
-        int segment_rate = data->segments[i]->sample_rate;
+        int32_t segment_samples = data->segment_infos[i].samples;
+        int segment_rate = data->segment_infos[i].sample_rate;
 
         if (loop_flag && i == loop_start_segment)
             loop_start = num_samples;
@@ -258,14 +258,14 @@ VGMSTREAM* allocate_segmented_vgmstream(segmented_layout_data* data, int loop_fl
             loop_end = num_samples;
 
         /* inherit first segment's layout but only if all segments' layout match */
-        if (channel_layout != 0 && channel_layout != data->segments[i]->channel_layout)
+        if (channel_layout != 0 && channel_layout != data->segment_infos[i].channel_layout)
             channel_layout = 0;
 
         if (sample_rate < segment_rate)
             sample_rate = segment_rate;
 
         if (coding_type == coding_SILENCE)
-            coding_type = data->segments[i]->coding_type;
+            coding_type = data->segment_infos[i].coding_type;
     }
 
     /* respect loop_flag even when no loop_end found as it's possible file loops are set outside */
@@ -275,7 +275,7 @@ VGMSTREAM* allocate_segmented_vgmstream(segmented_layout_data* data, int loop_fl
     vgmstream = allocate_vgmstream(data->output_channels, loop_flag);
     if (!vgmstream) goto fail;
 
-    vgmstream->meta_type = data->segments[0]->meta_type;
+    vgmstream->meta_type = data->segment_infos[0].meta_type;
     vgmstream->sample_rate = sample_rate;
     vgmstream->num_samples = num_samples;
     vgmstream->loop_start_sample = loop_start;
@@ -300,11 +300,14 @@ void blocked_count_samples(VGMSTREAM* vgmstream, STREAMFILE* sf, blocked_counter
         return;
 
     int block_samples;
+    int32_t index_sample = 0; /* as counted when decoding, in case it's different */
     off_t max_offset = get_streamfile_size(sf);
 
     vgmstream->next_block_offset = cfg->offset;
     do {
-        block_update(vgmstream->next_block_offset, vgmstream);
+        off_t block_offset = vgmstream->next_block_offset;
+        size_t full_block_size = vgmstream->full_block_size;
+        block_update(block_offset, vgmstream);
 
         if (vgmstream->current_block_samples < 0 || vgmstream->current_block_size == 0xFFFFFFFF)
             break;
@@ -328,6 +331,11 @@ void blocked_count_samples(VGMSTREAM* vgmstream, STREAMFILE* sf, blocked_counter
             }
         }
 
+        /* save for seeking (first block is the start) */
+        if (block_offset != cfg->offset)
+            blocked_index_add(vgmstream, index_sample, block_offset, full_block_size);
+        index_sample += blocked_get_block_samples(vgmstream);
+
         vgmstream->num_samples += block_samples;
     }
     while (vgmstream->next_block_offset < max_offset);
@@ -164,4 +164,56 @@ static inline /*const*/ int is_id64be(off_t offset, STREAMFILE* sf, const char*
     return read_u64be(offset, sf) == get_id64be(s);
 }
 
+/* Reads small values at nearby offsets (like ADPCM nibbles) from windows borrowed from the SF's buffer
+ * (see read_streamfile_span), rather than doing a full read per value. Windows are as big as the buffered
+ * data, or copied chunks if the SF can't lend its buffer (chunks start small as some callers only read
+ * a few bytes, like 1 sample per interleave). A window is only valid until the next read to the same SF,
+ * so don't mix with read_xxx calls while in use. */
+#define SF_SPAN_SIZE 0x100
+#define SF_SPAN_MIN_SIZE 0x10
+
+typedef struct {
+    STREAMFILE* sf;
+    const uint8_t* data;
+    offv_t offset;
+    size_t size;
+    size_t copy_size;
+    uint8_t tmp[SF_SPAN_SIZE];
+} sf_span_t;
+
+static inline void sf_span_init(sf_span_t* span, STREAMFILE* sf) {
+    span->sf = sf;
+    span->data = NULL;
+    span->offset = 0;
+    span->size = 0;
+    span->copy_size = 0;
+}
+
+static inline const uint8_t* sf_span_get(sf_span_t* span, offv_t offset, size_t length) {
+    if (offset < span->offset || offset + length > span->offset + span->size) {
+        span->offset = offset;
+        span->data = span->sf->read_span ? span->sf->read_span(span->sf, offset, length, &span->size) : NULL;
+        if (!span->data) {
+            /* not buffered (read refills the SF's buffer for next windows) or EOF, where missing bytes read as 0xFF (like failed read_u8) */
+            size_t size = span->copy_size > length ? span->copy_size : length;
+            size_t bytes = read_streamfile(span->tmp, offset, size, span->sf);
+            if (bytes < size)
+                memset(span->tmp + bytes, 0xFF, size - bytes);
+            span->data = span->tmp;
+            span->size = size;
+
+            if (span->copy_size == 0)
+                span->copy_size = SF_SPAN_MIN_SIZE;
+            else if (span->copy_size < SF_SPAN_SIZE)
+                span->copy_size *= 2;
+        }
+    }
+    return span->data + (offset - span->offset);
+}
+
+static inline uint8_t sf_span_u8(sf_span_t* span, offv_t offset)   { return sf_span_get(span, offset, 1)[0]; }
+static inline int8_t  sf_span_s8(sf_span_t* span, offv_t offset)   { return (int8_t)sf_span_get(span, offset, 1)[0]; }
+static inline int16_t sf_span_s16le(sf_span_t* span, offv_t offset) { return get_s16le(sf_span_get(span, offset, 2)); }
+static inline int16_t sf_span_s16be(sf_span_t* span, offv_t offset) { return get_s16be(sf_span_get(span, offset, 2)); }
+
 #endif
@@ -0,0 +1,141 @@
+#ifndef _UTIL_SIMD_H
+#define _UTIL_SIMD_H
+
+/* Minimal 4 x float/int32/int16 vector helpers, for a few hot loops in decoders and ciphers.
+ *
+ * Only uses instruction sets that are always present on the compile target (SSE2 on x64 and x86
+ * builds with SSE2 enabled, NEON on ARM64), so no runtime detection is needed. Otherwise
+ * VGM_SIMD isn't defined and callers use their plain C loops. Ops map 1:1 to scalar float ops
+ * (no fused multiply-add) so results should be the same as the C versions. */
+
+#include <stdint.h>
+
+#if defined(VGM_DISABLE_SIMD)
+    /* nothing */
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define VGM_SIMD
+    #define VGM_SIMD_SSE2
+
+    typedef __m128 v4f_t;
+
+    #define v4f_load(p)         _mm_loadu_ps(p)
+    #define v4f_store(p, v)     _mm_storeu_ps(p, v)
+    #define v4f_set1(f)         _mm_set1_ps(f)
+    #define v4f_add(a, b)       _mm_add_ps(a, b)
+    #define v4f_sub(a, b)       _mm_sub_ps(a, b)
+    #define v4f_mul(a, b)       _mm_mul_ps(a, b)
+
+    /* (a0 a1 a2 a3) > (a3 a2 a1 a0) */
+    #define v4f_reverse(a)      _mm_shuffle_ps(a, a, _MM_SHUFFLE(0,1,2,3))
+    /* (a0 a1 a2 a3) + (b0 b1 b2 b3) > (a0 a2 b0 b2) / (a1 a3 b1 b3) */
+    #define v4f_even(a, b)      _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0))
+    #define v4f_odd(a, b)       _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1))
+    /* (a0 a1 a2 a3) + (b0 b1 b2 b3) > (a0 b0 a1 b1) / (a2 b2 a3 b3) */
+    #define v4f_zip_lo(a, b)    _mm_unpacklo_ps(a, b)
+    #define v4f_zip_hi(a, b)    _mm_unpackhi_ps(a, b)
+
+    /* truncates 2x4 floats to int and saves as 8 saturated int16 */
+    static inline void v4f_store_s16x2(int16_t* p, v4f_t a, v4f_t b) {
+        _mm_storeu_si128((__m128i*)p, _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b)));
+    }
+
+    typedef __m128i v4i_t;
+
+    #define v4i_load(p)         _mm_loadu_si128((const __m128i*)(p))
+    #define v4i_store(p, v)     _mm_storeu_si128((__m128i*)(p), v)
+    #define v4i_set1(i)         _mm_set1_epi32(i)
+    #define v4i_add(a, b)       _mm_add_epi32(a, b)
+    #define v4i_sub(a, b)       _mm_sub_epi32(a, b)
+    #define v4i_and(a, b)       _mm_and_si128(a, b)
+    #define v4i_xor(a, b)       _mm_xor_si128(a, b)
+    #define v4i_sra(a, n)       _mm_srai_epi32(a, n)
+    #define v4i_srl(a, n)       _mm_srli_epi32(a, n)
+    #define v4i_sll(a, n)       _mm_slli_epi32(a, n)
+    #define v4i_to_v4f(a)       _mm_cvtepi32_ps(a)
+    #define v4f_to_v4i(a)       _mm_cvttps_epi32(a) /* truncates, like (int) casts */
+
+    /* saves as 4 saturated int16 */
+    static inline void v4i_store_s16(int16_t* p, v4i_t a) {
+        _mm_storel_epi64((__m128i*)p, _mm_packs_epi32(a, a));
+    }
+
+    /* 4 x int16 (for int16 filters, as SSE2 has no 32-bit mul) */
+    typedef __m128i v4s_t;
+    /* 4 x pairs of int16 */
+    typedef __m128i v4p_t;
+
+    #define v4i_to_v4s(a)       _mm_packs_epi32(a, a) /* saturated, like clamp16 */
+    #define v4s_load(p)         _mm_loadl_epi64((const __m128i*)(p))
+    #define v4s_store(p, v)     _mm_storel_epi64((__m128i*)(p), v)
+    /* (a0 a1 a2 a3) + (b0 b1 b2 b3) > (a0 b0) (a1 b1) (a2 b2) (a3 b3) */
+    #define v4s_zip(a, b)       _mm_unpacklo_epi16(a, b)
+    /* (a0 b0) * (c0 d0) > a0*c0 + b0*d0 (x4) */
+    #define v4p_madd(a, b)      _mm_madd_epi16(a, b)
+
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+    #include <arm_neon.h>
+    #define VGM_SIMD
+    #define VGM_SIMD_NEON
+
+    typedef float32x4_t v4f_t;
+
+    #define v4f_load(p)         vld1q_f32(p)
+    #define v4f_store(p, v)     vst1q_f32(p, v)
+    #define v4f_set1(f)         vdupq_n_f32(f)
+    #define v4f_add(a, b)       vaddq_f32(a, b)
+    #define v4f_sub(a, b)       vsubq_f32(a, b)
+    #define v4f_mul(a, b)       vmulq_f32(a, b)
+
+    static inline v4f_t v4f_reverse(v4f_t a) {
+        float32x4_t r = vrev64q_f32(a);
+        return vcombine_f32(vget_high_f32(r), vget_low_f32(r));
+    }
+    #define v4f_even(a, b)      vuzpq_f32(a, b).val[0]
+    #define v4f_odd(a, b)       vuzpq_f32(a, b).val[1]
+    #define v4f_zip_lo(a, b)    vzipq_f32(a, b).val[0]
+    #define v4f_zip_hi(a, b)    vzipq_f32(a, b).val[1]
+
+    static inline void v4f_store_s16x2(int16_t* p, v4f_t a, v4f_t b) {
+        vst1q_s16(p, vcombine_s16(vqmovn_s32(vcvtq_s32_f32(a)), vqmovn_s32(vcvtq_s32_f32(b))));
+    }
+
+    typedef int32x4_t v4i_t;
+
+    #define v4i_load(p)         vld1q_s32(p)
+    #define v4i_store(p, v)     vst1q_s32(p, v)
+    #define v4i_set1(i)         vdupq_n_s32(i)
+    #define v4i_add(a, b)       vaddq_s32(a, b)
+    #define v4i_sub(a, b)       vsubq_s32(a, b)
+    #define v4i_and(a, b)       vandq_s32(a, b)
+    #define v4i_xor(a, b)       veorq_s32(a, b)
+    #define v4i_sra(a, n)       vshrq_n_s32(a, n)
+    #define v4i_srl(a, n)       vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a), n))
+    #define v4i_sll(a, n)       vshlq_n_s32(a, n)
+    #define v4i_to_v4f(a)       vcvtq_f32_s32(a)
+    #define v4f_to_v4i(a)       vcvtq_s32_f32(a)
+
+    static inline void v4i_store_s16(int16_t* p, v4i_t a) {
+        vst1_s16(p, vqmovn_s32(a));
+    }
+
+    typedef int16x4_t v4s_t;
+    typedef int16x4x2_t v4p_t;
+
+    #define v4i_to_v4s(a)       vqmovn_s32(a)
+    #define v4s_load(p)         vld1_s16(p)
+    #define v4s_store(p, v)     vst1_s16(p, v)
+
+    static inline v4p_t v4s_zip(v4s_t a, v4s_t b) {
+        v4p_t p;
+        p.val[0] = a;
+        p.val[1] = b;
+        return p;
+    }
+
+    static inline v4i_t v4p_madd(v4p_t a, v4p_t b) {
+        return vmlal_s16(vmull_s16(a.val[0], b.val[0]), a.val[1], b.val[1]);
+    }
+#endif
+
+#endif
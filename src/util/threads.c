@@ -0,0 +1,187 @@
+#include "threads.h"
+
+#if defined(_WIN32) || defined(WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+void vgm_mutex_lock(vgm_mutex_t* mutex) {
+    while (InterlockedCompareExchange((LONG volatile*)&mutex->lock, 1, 0) != 0) {
+        Sleep(0);
+    }
+}
+
+void vgm_mutex_unlock(vgm_mutex_t* mutex) {
+    InterlockedExchange((LONG volatile*)&mutex->lock, 0);
+}
+
+bool vgm_mutex_init(vgm_mutex_t* mutex) {
+    mutex->lock = 0;
+    return true;
+}
+
+void vgm_mutex_free(vgm_mutex_t* mutex) {
+}
+
+static DWORD WINAPI thread_main(LPVOID arg) {
+    vgm_thread_t* thread = arg;
+    thread->func(thread->arg);
+    return 0;
+}
+
+bool vgm_thread_start(vgm_thread_t* thread, void (*func)(void* arg), void* arg) {
+    thread->func = func;
+    thread->arg = arg;
+    thread->handle = CreateThread(NULL, 0, thread_main, thread, 0, NULL);
+    return thread->handle != NULL;
+}
+
+void vgm_thread_join(vgm_thread_t* thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    thread->handle = NULL;
+}
+
+int vgm_get_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+bool vgm_event_init(vgm_event_t* event) {
+    event->handle = CreateEvent(NULL, FALSE, FALSE, NULL);
+    return event->handle != NULL;
+}
+
+void vgm_event_free(vgm_event_t* event) {
+    if (event->handle)
+        CloseHandle(event->handle);
+    event->handle = NULL;
+}
+
+void vgm_event_set(vgm_event_t* event) {
+    SetEvent(event->handle);
+}
+
+void vgm_event_wait(vgm_event_t* event) {
+    WaitForSingleObject(event->handle, INFINITE);
+}
+
+int vgm_atomic_get(vgm_atomic_t* atomic) {
+    return InterlockedCompareExchange((LONG volatile*)&atomic->value, 0, 0);
+}
+
+void vgm_atomic_set(vgm_atomic_t* atomic, int value) {
+    InterlockedExchange((LONG volatile*)&atomic->value, value);
+}
+
+double vgm_get_time(void) {
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+
+#else
+#include <unistd.h>
+#include <time.h>
+
+void vgm_mutex_lock(vgm_mutex_t* mutex) {
+    pthread_mutex_lock(&mutex->lock);
+}
+
+void vgm_mutex_unlock(vgm_mutex_t* mutex) {
+    pthread_mutex_unlock(&mutex->lock);
+}
+
+bool vgm_mutex_init(vgm_mutex_t* mutex) {
+    return pthread_mutex_init(&mutex->lock, NULL) == 0;
+}
+
+void vgm_mutex_free(vgm_mutex_t* mutex) {
+    pthread_mutex_destroy(&mutex->lock);
+}
+
+static void* thread_main(void* arg) {
+    vgm_thread_t* thread = arg;
+    thread->func(thread->arg);
+    return NULL;
+}
+
+bool vgm_thread_start(vgm_thread_t* thread, void (*func)(void* arg), void* arg) {
+    thread->func = func;
+    thread->arg = arg;
+    return pthread_create(&thread->handle, NULL, thread_main, thread) == 0;
+}
+
+void vgm_thread_join(vgm_thread_t* thread) {
+    pthread_join(thread->handle, NULL);
+}
+
+int vgm_get_cpu_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#else
+    return 1;
+#endif
+}
+
+bool vgm_event_init(vgm_event_t* event) {
+    event->signaled = false;
+    if (pthread_mutex_init(&event->lock, NULL) != 0)
+        return false;
+    if (pthread_cond_init(&event->cond, NULL) != 0) {
+        pthread_mutex_destroy(&event->lock);
+        return false;
+    }
+    return true;
+}
+
+void vgm_event_free(vgm_event_t* event) {
+    pthread_cond_destroy(&event->cond);
+    pthread_mutex_destroy(&event->lock);
+}
+
+void vgm_event_set(vgm_event_t* event) {
+    pthread_mutex_lock(&event->lock);
+    event->signaled = true;
+    pthread_cond_signal(&event->cond);
+    pthread_mutex_unlock(&event->lock);
+}
+
+void vgm_event_wait(vgm_event_t* event) {
+    pthread_mutex_lock(&event->lock);
+    while (!event->signaled) {
+        pthread_cond_wait(&event->cond, &event->lock);
+    }
+    event->signaled = false;
+    pthread_mutex_unlock(&event->lock);
+}
+
+int vgm_atomic_get(vgm_atomic_t* atomic) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(&atomic->value, __ATOMIC_ACQUIRE);
+#else
+    return atomic->value; /* volatile, best effort */
+#endif
+}
+
+void vgm_atomic_set(vgm_atomic_t* atomic, int value) {
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(&atomic->value, value, __ATOMIC_RELEASE);
+#else
+    atomic->value = value;
+#endif
+}
+
+double vgm_get_time(void) {
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef _UTIL_THREADS_H
+#define _UTIL_THREADS_H
+
+/* Minimal threading helpers, for the few places where libvgmstream keeps state shared between
+ * handles (which may be used from different threads by plugins/CLI), or splits slow work. */
+
+#include <stdbool.h>
+
+#if defined(_WIN32) || defined(WIN32)
+    /* simple spinlock: CRITICAL_SECTION needs runtime init and SRWLOCK is Vista+ */
+    typedef struct {
+        volatile long lock;
+    } vgm_mutex_t;
+
+    #define VGM_MUTEX_INIT  { 0 }
+
+    typedef void* vgm_thread_handle_t;
+
+    typedef struct {
+        void* handle;
+    } vgm_event_t;
+#else
+    #include <pthread.h>
+
+    typedef struct {
+        pthread_mutex_t lock;
+    } vgm_mutex_t;
+
+    #define VGM_MUTEX_INIT  { PTHREAD_MUTEX_INITIALIZER }
+
+    typedef pthread_t vgm_thread_handle_t;
+
+    typedef struct {
+        pthread_mutex_t lock;
+        pthread_cond_t cond;
+        bool signaled;
+    } vgm_event_t;
+#endif
+
+/* Mutexes are meant to be static (init'd with VGM_MUTEX_INIT) and held for short periods.
+ * Mutexes inside malloc'd state must use _init/_free instead. */
+void vgm_mutex_lock(vgm_mutex_t* mutex);
+void vgm_mutex_unlock(vgm_mutex_t* mutex);
+bool vgm_mutex_init(vgm_mutex_t* mutex);
+void vgm_mutex_free(vgm_mutex_t* mutex);
+
+
+typedef struct {
+    vgm_thread_handle_t handle;
+    void (*func)(void* arg);
+    void* arg;
+} vgm_thread_t;
+
+/* Starts func(arg) in a new thread (thread struct must stay valid until joined). Threads may not
+ * be available (no pthreads in some builds, limits, etc), so callers must be ready to do the work themselves. */
+bool vgm_thread_start(vgm_thread_t* thread, void (*func)(void* arg), void* arg);
+void vgm_thread_join(vgm_thread_t* thread);
+
+/* Number of logical CPUs (1 if unknown). */
+int vgm_get_cpu_count(void);
+
+
+/* Auto-reset event, to wake up long-lived workers: each set releases one wait (or the next one). */
+bool vgm_event_init(vgm_event_t* event);
+void vgm_event_free(vgm_event_t* event);
+void vgm_event_set(vgm_event_t* event);
+void vgm_event_wait(vgm_event_t* event);
+
+
+/* Int shared by 2 threads without locks (like positions of a single producer/consumer buffer).
+ * Gets see everything written before the matching set in the other thread. */
+typedef struct {
+    volatile long value;
+} vgm_atomic_t;
+
+int vgm_atomic_get(vgm_atomic_t* atomic);
+void vgm_atomic_set(vgm_atomic_t* atomic, int value);
+
+
+/* Monotonic time in seconds (only meaningful as a difference), for timing stats. */
+double vgm_get_time(void);
+
+#endif
@@ -114,6 +114,9 @@ bool prepare_vgmstream(VGMSTREAM* vgmstream, STREAMFILE* sf) {
         vgmstream->stream_index = sf->stream_index;
     }
 
+    /* seek tables built before, if enabled */
+    seek_table_load_cache(vgmstream, sf);
+
     //TODO: this should be called in setup_vgmstream sometimes, but hard to detect since it's used for other stuff
     /* clean as loops are readable metadata but loop fields may contain garbage
      * (done *after* dual stereo as it needs loop fields to match) */
@@ -236,12 +239,7 @@ VGMSTREAM* allocate_vgmstream(int channels, int loop_flag) {
     vgmstream->decode_state = decode_init();
     if (!vgmstream->decode_state) goto fail;
 
-    //TODO: improve/init later to minimize memory
-    /* garbage buffer for seeking/discarding (local bufs may cause stack overflows with segments/layers)
-     * in theory the bigger the better but in practice there isn't much difference. */
-    vgmstream->tmpbuf_size = 1024 * 2 * channels * sizeof(float);
-    vgmstream->tmpbuf = malloc(vgmstream->tmpbuf_size);
-    if (!vgmstream->tmpbuf) goto fail;
+    /* tmpbuf is allocated on first use (see vgmstream_alloc_tmpbuf) */
 
     /* BEWARE: merge_vgmstream does some free'ing too */ 
 
@@ -252,6 +250,29 @@ fail:
     return NULL;
 }
 
+/* Garbage buffer for seeking/discarding (local bufs may cause stack overflows with segments/layers).
+ * In theory the bigger the better but in practice there isn't much difference. Allocated on first use
+ * since most streams (like segments/layers of big TXTP) never need it. */
+bool vgmstream_alloc_tmpbuf(VGMSTREAM* vgmstream) {
+    if (vgmstream->tmpbuf)
+        return true;
+
+    size_t tmpbuf_size = 1024 * 2 * vgmstream->channels * sizeof(float);
+    void* tmpbuf = malloc(tmpbuf_size);
+    if (!tmpbuf) return false;
+
+    vgmstream->tmpbuf = tmpbuf;
+    vgmstream->tmpbuf_size = tmpbuf_size;
+
+    /* also for resets, as start_vgmstream is restored then */
+    VGMSTREAM* start_vgmstream = vgmstream->start_vgmstream;
+    if (start_vgmstream && start_vgmstream != vgmstream) {
+        start_vgmstream->tmpbuf = tmpbuf;
+        start_vgmstream->tmpbuf_size = tmpbuf_size;
+    }
+    return true;
+}
+
 void close_vgmstream(VGMSTREAM* vgmstream) {
     if (!vgmstream)
         return;
@@ -259,6 +280,9 @@ void close_vgmstream(VGMSTREAM* vgmstream) {
     seek_table_free(vgmstream);
     vgmstream->seek_table = NULL;
 
+    blocked_index_free(vgmstream);
+    vgmstream->block_index = NULL;
+
     decode_free(vgmstream);
     vgmstream->codec_data = NULL;
 
@@ -283,6 +307,7 @@ void close_vgmstream(VGMSTREAM* vgmstream) {
 
     mixer_free(vgmstream->mixer);
     free(vgmstream->tmpbuf);
+    free(vgmstream->entry_times);
     free(vgmstream->ch);
     free(vgmstream->start_ch);
     free(vgmstream->loop_ch);
@@ -290,6 +315,37 @@ void close_vgmstream(VGMSTREAM* vgmstream) {
     free(vgmstream);
 }
 
+/* Memory held by the VGMSTREAM's own structs and buffers, plus its layers/segments (opened ones).
+ * Codec libs and STREAMFILE buffers aren't included as their internals aren't known here. */
+size_t vgmstream_get_memory_size(VGMSTREAM* vgmstream) {
+    if (!vgmstream)
+        return 0;
+
+    size_t size = sizeof(VGMSTREAM) * 2; /* + start_vgmstream */
+    size += vgmstream->channels * sizeof(VGMSTREAMCHANNEL) * (vgmstream->loop_ch ? 3 : 2); /* ch + start_ch + loop_ch */
+    size += vgmstream->tmpbuf_size;
+    size += mixer_get_memory_size(vgmstream->mixer);
+    size += seek_table_get_memory_size(vgmstream);
+    size += blocked_index_get_memory_size(vgmstream);
+
+    if (vgmstream->layout_type == layout_layered) {
+        layered_layout_data* data = vgmstream->layout_data;
+        size += sizeof(layered_layout_data) + data->layer_count * sizeof(VGMSTREAM*) + data->buffer_size;
+        for (int i = 0; i < data->layer_count; i++) {
+            size += vgmstream_get_memory_size(data->layers[i]);
+        }
+    }
+    else if (vgmstream->layout_type == layout_segmented) {
+        segmented_layout_data* data = vgmstream->layout_data;
+        size += sizeof(segmented_layout_data) + data->segment_count * sizeof(VGMSTREAM*) + data->buffer_size;
+        for (int i = 0; i < data->segment_count; i++) {
+            size += vgmstream_get_memory_size(data->segments[i]); /* may be closed */
+        }
+    }
+
+    return size;
+}
+
 void vgmstream_force_loop(VGMSTREAM* vgmstream, int loop_flag, int loop_start_sample, int loop_end_sample) {
     if (!vgmstream) return;
 
@@ -615,6 +671,7 @@ bool vgmstream_open_stream(VGMSTREAM* vgmstream, STREAMFILE* sf, off_t start_off
 
 bool vgmstream_open_stream_bf(VGMSTREAM* vgmstream, STREAMFILE* sf, off_t start_offset, bool force_multibuffer) {
     STREAMFILE* file = NULL;
+    STREAMFILE* cache_sf = NULL;
     char filename[PATH_LIMIT];
     bool use_streamfile_per_channel = false;
     bool use_same_offset_per_channel = false;
@@ -749,6 +806,13 @@ bool vgmstream_open_stream_bf(VGMSTREAM* vgmstream, STREAMFILE* sf, off_t start_
             if (!file) goto fail;
         }
 
+        /* channels read from a shared page cache, rather than each re-reading nearby data into its own buffer
+         * (size read once, as it may change meanwhile) */
+        size_t cache_size = get_cache_streamfile_max_size();
+        if (use_streamfile_per_channel && vgmstream->channels > 1 && cache_size > 0) {
+            cache_sf = open_cache_streamfile_f(open_streamfile(sf, filename), cache_size);
+        }
+
         for (int ch = 0; ch < vgmstream->channels; ch++) {
             off_t offset;
             if (use_same_offset_per_channel) {
@@ -769,7 +833,7 @@ bool vgmstream_open_stream_bf(VGMSTREAM* vgmstream, STREAMFILE* sf, off_t start_
             /* open new one if needed, useful to avoid jumping around when each channel data is too apart
              * (don't use when data is close as it'd make buffers read the full file multiple times) */
             if (use_streamfile_per_channel) {
-                file = open_streamfile(sf,filename);
+                file = open_streamfile(cache_sf ? cache_sf : sf, filename);
                 if (!file) goto fail;
             }
 
@@ -777,6 +841,8 @@ bool vgmstream_open_stream_bf(VGMSTREAM* vgmstream, STREAMFILE* sf, off_t start_
             vgmstream->ch[ch].channel_start_offset = offset;
             vgmstream->ch[ch].offset = offset;
         }
+
+        close_streamfile(cache_sf); /* kept open by channels */
     }
 
     /* init first block for blocked layout (if not blocked this will do nothing) */
@@ -791,6 +857,7 @@ bool vgmstream_open_stream_bf(VGMSTREAM* vgmstream, STREAMFILE* sf, off_t start_
 
 fail:
     /* open streams will be closed in close_vgmstream(), hopefully called by the meta */
+    close_streamfile(cache_sf);
     return false;
 }
 
@@ -182,6 +182,9 @@ typedef struct {
     /* other config */
     bool allow_dual_stereo;         /* search for dual stereo (file_L.ext + file_R.ext = single stereo file) */
     int format_id;                  /* internal format ID */
+    int probe_reads;                /* reads done to the base file while detecting the format (info) */
+    double* entry_times;            /* open time of each entry in formats made of other files, like TXTP (info) */
+    int entry_count;
 
 
     /* decoder config/state */
@@ -236,11 +239,12 @@ typedef struct {
     int loop_count;                 /* counter of complete loops (1=looped once) */
     int loop_target;                /* max loops before continuing with the stream end (loops forever if not set) */
 
-    void* tmpbuf;                   /* garbage buffer used for seeking/trimming */
+    void* tmpbuf;                   /* garbage buffer used for seeking/trimming (see vgmstream_alloc_tmpbuf) */
     size_t tmpbuf_size;             /* for all channels (samples = tmpbuf_size / channels / sample_size) */
 
     void* decode_state;             /* for some decoders (TO-DO: to be moved around) */
     void* seek_table;               /* for some decoders (TO-DO: to be moved around) */
+    void* block_index;              /* for blocked layouts (seeking) */
 } VGMSTREAM;
 
 
@@ -279,6 +283,12 @@ void seek_vgmstream(VGMSTREAM* vgmstream, int32_t seek_sample);
 /* Allocate initial memory for the VGMSTREAM */
 VGMSTREAM* allocate_vgmstream(int channel_count, int looped);
 
+/* Allocate the tmpbuf if not done yet. Returns false on alloc errors. */
+bool vgmstream_alloc_tmpbuf(VGMSTREAM* vgmstream);
+
+/* Approximate memory used by the VGMSTREAM, including layers/segments. */
+size_t vgmstream_get_memory_size(VGMSTREAM* vgmstream);
+
 /* Prepare the VGMSTREAM's initial state once parsed and ready, but before playing. */
 void setup_vgmstream(VGMSTREAM* vgmstream);
 
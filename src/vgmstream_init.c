@@ -1,4 +1,5 @@
 #include "vgmstream_init.h"
+#include "util/threads.h"
 
 //typedef VGMSTREAM* (*init_vgmstream_t)(STREAMFILE*);
 
@@ -578,39 +579,328 @@ init_vgmstream_t init_vgmstream_functions[] = {
 #endif
 };
 
+/* Parsers whose first check rejects any file without this ID at 0x00. Detection reads the ID once
+ * and skips non-matching parsers without calling them (so they don't re-read the header), while the
+ * list above still decides priority. Only add parsers that test the ID before anything else. */
+typedef struct {
+    init_vgmstream_t init;
+    const char* id;
+} init_vgmstream_id_t;
+
+static const init_vgmstream_id_t init_vgmstream_ids[] = {
+    {init_vgmstream_brstm,                        "RSTM"},
+    {init_vgmstream_brwav,                        "RWAV"},
+    {init_vgmstream_bfwav,                        "FWAV"},
+    {init_vgmstream_bcwav,                        "CWAV"},
+    {init_vgmstream_rwar,                         "RWAR"},
+    {init_vgmstream_nds_strm,                     "STRM"},
+    {init_vgmstream_csmp,                         "CSMP"},
+    {init_vgmstream_cstr,                         "Cstr"},
+    {init_vgmstream_ads,                          "SShd"},
+    {init_vgmstream_npsf,                         "NPSF"},
+    {init_vgmstream_vag_aaap,                     "AAAp"},
+    {init_vgmstream_ild,                          "ILD\0"},
+    {init_vgmstream_caf,                          "CAF "},
+    {init_vgmstream_vpk,                          " KPV"},
+    {init_vgmstream_genh,                         "GENH"},
+    {init_vgmstream_sadb,                         "sadb"},
+    {init_vgmstream_aifc,                         "FORM"},
+    {init_vgmstream_iivb,                         "BVII"},
+    {init_vgmstream_svs,                          "SVS\0"},
+    {init_vgmstream_riff,                         "RIFF"},
+    {init_vgmstream_rifx,                         "RIFX"},
+    {init_vgmstream_ea_crdf,                      "CRDF"},
+    {init_vgmstream_sl3,                          "SL3\0"},
+    {init_vgmstream_hgc1,                         "hgC1"},
+    {init_vgmstream_aus,                          "AUS "},
+    {init_vgmstream_fsb5,                         "FSB5"},
+    {init_vgmstream_rwax,                         "RAWX"},
+    {init_vgmstream_musc,                         "MUSC"},
+    {init_vgmstream_filp,                         "FILp"},
+    {init_vgmstream_ikm,                          "IKM\0"},
+    {init_vgmstream_ster,                         "STER"},
+    {init_vgmstream_bg00,                         "BG00"},
+    {init_vgmstream_dvi,                          "DVI."},
+    {init_vgmstream_rstm_rockstar,                "RSTM"},
+    {init_vgmstream_hxd,                          "\0DXH"},
+    {init_vgmstream_aix,                          "AIXF"},
+    {init_vgmstream_xmu,                          "XMU "},
+    {init_vgmstream_idvi,                         "IDVI"},
+    {init_vgmstream_idsp_tt,                      "IDSP"},
+    {init_vgmstream_kraw,                         "kRAW"},
+    {init_vgmstream_omu,                          "OMU "},
+    {init_vgmstream_idsp_nl,                      "IDSP"},
+    {init_vgmstream_idsp_ie,                      "IDSP"},
+    {init_vgmstream_spsd,                         "SPSD"},
+    {init_vgmstream_ubi_jade,                     "RIFF"},
+    {init_vgmstream_seg,                          "seg\0"},
+    {init_vgmstream_riff_ima,                     "RIFF"},
+    {init_vgmstream_knon,                         "KNON"},
+    {init_vgmstream_gca,                          "GCA1"},
+    {init_vgmstream_ish_isd,                      "I_SF"},
+    {init_vgmstream_gsnd,                         "GSND"},
+    {init_vgmstream_ydsp,                         "YDSP"},
+    {init_vgmstream_vgs,                          "VgS!"},
+    {init_vgmstream_thp,                          "THP\0"},
+    {init_vgmstream_gbts,                         "GbTs"},
+    {init_vgmstream_ngc_dsp_iadp,                 "iadp"},
+    {init_vgmstream_aax,                          "@UTF"},
+    {init_vgmstream_utf_dsp,                      "@UTF"},
+    {init_vgmstream_str_sqex,                     "STR\0"},
+    {init_vgmstream_baka,                         "BAKA"},
+    {init_vgmstream_swav,                         "SWAV"},
+    {init_vgmstream_vsf,                          "VSF\0"},
+    {init_vgmstream_smss,                         "SMSS"},
+    {init_vgmstream_zsd,                          "ZSD\0"},
+    {init_vgmstream_vgs_ps,                       "VGS\0"},
+    {init_vgmstream_dsp_ndp,                      "NDP\0"},
+    {init_vgmstream_ssnd,                         "SSND"},
+    {init_vgmstream_sd9,                          "SD9\0"},
+    {init_vgmstream_2dx9,                         "2DX9"},
+    {init_vgmstream_gcub,                         "GCub"},
+    {init_vgmstream_apple_caff,                   "caff"},
+    {init_vgmstream_wii_was,                      "iSWS"},
+    {init_vgmstream_ast_mmv,                      "AST\0"},
+    {init_vgmstream_ast_mv,                       "AST\0"},
+    {init_vgmstream_dmsg,                         "RIFF"},
+    {init_vgmstream_ngc_dsp_aaap,                 "AAAp"},
+    {init_vgmstream_bnsf,                         "BNSF"},
+    {init_vgmstream_mcg,                          "MCG\0"},
+    {init_vgmstream_smpl,                         "SMPL"},
+    {init_vgmstream_mpds,                         "MPDS"},
+    {init_vgmstream_lpcm_shade,                   "LPCM"},
+    {init_vgmstream_vms,                          "VMS "},
+    {init_vgmstream_xau,                          "XAU\0"},
+    {init_vgmstream_dsp_dspw,                     "DSPW"},
+    {init_vgmstream_cps,                          "CPS "},
+    {init_vgmstream_baf,                          "BANK"},
+    {init_vgmstream_sndp,                         "SNDP"},
+    {init_vgmstream_ras,                          "RAS_"},
+    {init_vgmstream_xwav_new,                     "VAWX"},
+    {init_vgmstream_xwav_old,                     "XWAV"},
+    {init_vgmstream_hyperscan_kvag,               "KVAG"},
+    {init_vgmstream_psnd,                         "PSND"},
+    {init_vgmstream_adp_wildfire,                 "ADP!"},
+    {init_vgmstream_alp,                          "ALP "},
+    {init_vgmstream_wpd,                          " DPW"},
+    {init_vgmstream_mcss,                         "MCSS"},
+    {init_vgmstream_2pfs,                         "2PFS"},
+    {init_vgmstream_bcstm,                        "CSTM"},
+    {init_vgmstream_idsp_namco,                   "IDSP"},
+    {init_vgmstream_madp,                         "MADP"},
+    {init_vgmstream_cxs,                          "CXS "},
+    {init_vgmstream_akb,                          "AKB "},
+    {init_vgmstream_akb2,                         "AKB2"},
+    {init_vgmstream_astb,                         "ASTB"},
+    {init_vgmstream_pasx,                         "PASX"},
+    {init_vgmstream_xma,                          "RIFF"},
+    {init_vgmstream_mpc3,                         "MPC3"},
+    {init_vgmstream_ghs,                          "GHS "},
+    {init_vgmstream_va3,                          "!3AV"},
+    {init_vgmstream_xa_04sw,                      "04SW"},
+    {init_vgmstream_ea_bnk_fixed,                 "BNKl"},
+    {init_vgmstream_ea_schl_fixed,                "SCHl"},
+    {init_vgmstream_opus_nop,                     "sadf"},
+    {init_vgmstream_opus_nus3,                    "OPUS"},
+    {init_vgmstream_astl,                         "ASTL"},
+    {init_vgmstream_vxn,                          "VoxN"},
+    {init_vgmstream_ea_sbr,                       "SBKR"},
+    {init_vgmstream_kma9,                         "KMA9"},
+    {init_vgmstream_atsl,                         "ATSL"},
+    {init_vgmstream_apa3,                         "APA3"},
+    {init_vgmstream_waf,                          "WAF\0"},
+    {init_vgmstream_ea_wve_au00,                  "VLC0"},
+    {init_vgmstream_sthd,                         "STHD"},
+    {init_vgmstream_ubi_lyn,                      "RIFF"},
+    {init_vgmstream_ppst,                         "PPST"},
+    {init_vgmstream_asf,                          "ASF\0"},
+    {init_vgmstream_cks,                          "ckmk"},
+    {init_vgmstream_ckb,                          "ckmk"},
+    {init_vgmstream_hd3_bd3,                      "P3HD"},
+    {init_vgmstream_nus3bank,                     "NUS3"},
+    {init_vgmstream_sscf,                         "SSCF"},
+    {init_vgmstream_a2m,                          "A2M\0"},
+    {init_vgmstream_msv,                          "MSVp"},
+    {init_vgmstream_svgp,                         "SVGp"},
+    {init_vgmstream_apc,                          "CRYO"},
+    {init_vgmstream_wav2,                         "WAV2"},
+    {init_vgmstream_sfxb,                         "SFXB"},
+    {init_vgmstream_derf,                         "DERF"},
+    {init_vgmstream_nxa1,                         "NXA1"},
+    {init_vgmstream_xwma,                         "RIFF"},
+    {init_vgmstream_vs_square,                    "VS\0\0"},
+    {init_vgmstream_nwav,                         "NWAV"},
+    {init_vgmstream_xpcm,                         "XPCM"},
+    {init_vgmstream_opus_opusx,                   "OPUS"},
+    {init_vgmstream_dsp_adpy,                     "ADPY"},
+    {init_vgmstream_dsp_adpx,                     "ADPX"},
+    {init_vgmstream_ogg_opus,                     "OggS"},
+    {init_vgmstream_nus3audio,                    "NUS3"},
+    {init_vgmstream_strm_abylight,                "STRM"},
+    {init_vgmstream_sfh,                          "\0SFH"},
+    {init_vgmstream_xwma_konami,                  "XWMA"},
+    {init_vgmstream_9tav,                         "9TAV"},
+    {init_vgmstream_fsb5_fev_bank,                "RIFF"},
+    {init_vgmstream_bwav,                         "BWAV"},
+    {init_vgmstream_opus_prototype,               "OPUS"},
+    {init_vgmstream_acb,                          "@UTF"},
+    {init_vgmstream_mzrt_v0,                      "mzrt"},
+    {init_vgmstream_xavs,                         "XAVS"},
+    {init_vgmstream_nub_at3,                      "at3\0"},
+    {init_vgmstream_nub_idsp,                     "idsp"},
+    {init_vgmstream_xwv_valve,                    "XWV "},
+    {init_vgmstream_csb,                          "@UTF"},
+    {init_vgmstream_lrmd,                         "LRMD"},
+    {init_vgmstream_ktsr,                         "KTSR"},
+    {init_vgmstream_asrs,                         "ASRS"},
+    {init_vgmstream_mups,                         "MUPS"},
+    {init_vgmstream_ktsc,                         "KTSC"},
+    {init_vgmstream_sdrh_old,                     "SDRH"},
+    {init_vgmstream_opus_nsopus,                  "EWNO"},
+    {init_vgmstream_sbk,                          "RIFF"},
+    {init_vgmstream_dsp_cwac,                     "CWAC"},
+    {init_vgmstream_mzrt_v1,                      "mzrt"},
+    {init_vgmstream_bsnf,                         "bsnf"},
+    {init_vgmstream_ogv_3rdeye,                   "OGV\0"},
+    {init_vgmstream_sspr,                         "SSPR"},
+    {init_vgmstream_piff_tpcm,                    "PIFF"},
+    {init_vgmstream_wxh_wxd,                      "WXH1"},
+    {init_vgmstream_psb,                          "PSB\0"},
+    {init_vgmstream_lopu_fb,                      "LOPU"},
+    {init_vgmstream_lpcm_fb,                      "LPCM"},
+    {init_vgmstream_wbk_nslb,                     "NSLB"},
+    {init_vgmstream_dsp_apex,                     "APEX"},
+    {init_vgmstream_ubi_ckd_cwav,                 "RIFF"},
+    {init_vgmstream_sspf,                         "SSPF"},
+    {init_vgmstream_opus_rsnd,                    "RSND"},
+    {init_vgmstream_adm3,                         "ADM3"},
+    {init_vgmstream_tt_ad,                        "FMT "},
+    {init_vgmstream_bw_riff_mp3,                  "RIFF"},
+    {init_vgmstream_sndz,                         "SNDZ"},
+    {init_vgmstream_sscf_encrypted,               "SSCF"},
+    {init_vgmstream_utf_ahx,                      "@UTF"},
+    {init_vgmstream_ego_dic,                      "DIC1"},
+    {init_vgmstream_pwb,                          "WB\2\0"},
+    {init_vgmstream_snds,                         "SSDD"},
+    {init_vgmstream_adm2,                         "ADM2"},
+    {init_vgmstream_dsp_asura_ttss,               "TTSS"},
+    {init_vgmstream_adp_ongakukan,                "RIFF"},
+    {init_vgmstream_sdd,                          "DSBH"},
+    {init_vgmstream_ka1a,                         "KA1A"},
+    {init_vgmstream_pphd,                         "PPHD"},
+    {init_vgmstream_xabp,                         "pBAX"},
+    {init_vgmstream_i3ds,                         "i3DS"},
+    {init_vgmstream_sdbs,                         "sdbs"},
+    {init_vgmstream_skex,                         "SKEX"},
+    {init_vgmstream_axhd,                         "AXHD"},
+    {init_vgmstream_shaa,                         "SHAA"},
+    {init_vgmstream_swar,                         "SWAR"},
+    {init_vgmstream_ivb,                          "IVB\0"},
+    {init_vgmstream_mhwk,                         "MHWK"},
+    {init_vgmstream_snd_koei,                     "SND\0"},
+    {init_vgmstream_bcf1,                         "1FCB"},
+    {init_vgmstream_ueba,                         "ABEU"},
+    {init_vgmstream_jaudio_baa,                   "AA_<"},
+    {init_vgmstream_rwsd,                         "RWSD"},
+};
+
 #define LOCAL_ARRAY_LENGTH(array) (sizeof(array) / sizeof(array[0]))
 static const int init_vgmstream_count = LOCAL_ARRAY_LENGTH(init_vgmstream_functions);
+static const int init_vgmstream_ids_count = LOCAL_ARRAY_LENGTH(init_vgmstream_ids);
 
+/* per-format ID from the list above (0 = none, parser is always called), built on first detection */
+static uint32_t probe_ids[LOCAL_ARRAY_LENGTH(init_vgmstream_functions)];
+static vgm_atomic_t probe_ids_built;
+static vgm_mutex_t probe_ids_lock = VGM_MUTEX_INIT;
 
-VGMSTREAM* detect_vgmstream_format(STREAMFILE* sf) {
+/* detection may run from several threads, so the table is built once and the flag set only after it's done */
+static void build_probe_ids(void) {
+    vgm_mutex_lock(&probe_ids_lock);
+    if (!vgm_atomic_get(&probe_ids_built)) {
+        for (int i = 0; i < init_vgmstream_ids_count; i++) {
+            for (int j = 0; j < init_vgmstream_count; j++) {
+                if (init_vgmstream_functions[j] == init_vgmstream_ids[i].init) {
+                    probe_ids[j] = get_id32be(init_vgmstream_ids[i].id);
+                }
+            }
+        }
+
+        vgm_atomic_set(&probe_ids_built, 1);
+    }
+    vgm_mutex_unlock(&probe_ids_lock);
+}
+
+
+/* calls format's init and validates result */
+static VGMSTREAM* init_format(int index, STREAMFILE* sf, STREAMFILE* sf_probe) {
+    init_vgmstream_t init_vgmstream_function = init_vgmstream_functions[index];
+
+    /* call init function and see if valid VGMSTREAM was returned */
+    VGMSTREAM* vgmstream = init_vgmstream_function(sf);
+    if (!vgmstream)
+        return NULL;
+
+    vgmstream->format_id = index + 1;
+    vgmstream->probe_reads = sf_probe ? get_probe_streamfile_reads(sf_probe) : 0;
+
+    /* validate + setup vgmstream */
+    if (!prepare_vgmstream(vgmstream, sf)) {
+        /* keep trying if wasn't valid, as simpler formats may return a vgmstream by mistake */
+        close_vgmstream(vgmstream);
+        return NULL;
+    }
+
+    return vgmstream;
+}
+
+VGMSTREAM* detect_vgmstream_format_hint(STREAMFILE* sf, int format_id) {
     if (!sf)
         return NULL;
 
+    if (!vgm_atomic_get(&probe_ids_built))
+        build_probe_ids();
+
+    /* parsers jump around headers and footers, so keep both ends in memory while testing (optional) */
+    STREAMFILE* sf_probe = open_probe_streamfile(sf, 0);
+    if (sf_probe)
+        sf = sf_probe;
+
+    /* try the format that worked for this file before, if any (skips probing many parsers) */
+    if (format_id > 0 && format_id <= init_vgmstream_count) {
+        VGMSTREAM* vgmstream = init_format(format_id - 1, sf, sf_probe);
+        if (vgmstream) {
+            close_streamfile(sf_probe);
+            return vgmstream;
+        }
+    }
+
+    /* same value parsers would get (including -1 on small files) */
+    uint32_t header_id = read_u32be(0x00, sf);
+
     /* try a series of formats, see which works */
     for (int i = 0; i < init_vgmstream_count; i++) {
-        init_vgmstream_t init_vgmstream_function = init_vgmstream_functions[i];
-    
-        /* call init function and see if valid VGMSTREAM was returned */
-        VGMSTREAM* vgmstream = init_vgmstream_function(sf);
-        if (!vgmstream)
+        if (probe_ids[i] && probe_ids[i] != header_id)
             continue;
+        if (i == format_id - 1)
+            continue; /* already tried */
 
-        vgmstream->format_id = i + 1;
-
-        /* validate + setup vgmstream */
-        if (!prepare_vgmstream(vgmstream, sf)) {
-            /* keep trying if wasn't valid, as simpler formats may return a vgmstream by mistake */
-            close_vgmstream(vgmstream);
+        VGMSTREAM* vgmstream = init_format(i, sf, sf_probe);
+        if (!vgmstream)
             continue;
-        }
 
+        close_streamfile(sf_probe);
         return vgmstream;
     }
 
     /* not supported */
+    close_streamfile(sf_probe);
     return NULL;
 }
 
+VGMSTREAM* detect_vgmstream_format(STREAMFILE* sf) {
+    return detect_vgmstream_format_hint(sf, 0);
+}
+
 init_vgmstream_t get_vgmstream_format_init(int format_id) {
     // ID is expected to be from 1...N, to distinguish from 0 = not set
     if (format_id <= 0 || format_id > init_vgmstream_count)
@@ -6,6 +6,8 @@
 
 bool prepare_vgmstream(VGMSTREAM* vgmstream, STREAMFILE* sf);
 VGMSTREAM* detect_vgmstream_format(STREAMFILE* sf);
+/* Same, but tries format_id first (from a VGMSTREAM of the same file), then the rest as usual. */
+VGMSTREAM* detect_vgmstream_format_hint(STREAMFILE* sf, int format_id);
 init_vgmstream_t get_vgmstream_format_init(int format_id);
 
 #endif